@@ -0,0 +1,429 @@
+/*
+File    : bench_decode.cpp
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : C++11
+Protocol    : FAZT I4 Data Transmission Format
+
+Microbenchmarks of the decode path of one sweep, on synthetic sweeps from
+../common/i4_stream_generator.h (no interrogator needed) :
+
+- header        : processPacket_Header / processPacket_HeaderInfo, per sweep
+- peak decode   : processPacket_Payload / processPacket_tsPayload, the id accessors and
+                  wavelength(), decodePeakRecord and decodePeakBatch, per peak
+- spectral      : processPacket_spectralPayload, per 8-byte payload (4 samples)
+- calibration   : calibrationForce / calibrationForce_batch, per peak
+- forwarding    : 11-byte packing (3 ids + double, as the client does) and the compact
+                  float32 / int32 sweep encoding, per peak
+
+Every benchmark runs for at least BENCH_MIN_TIME_S, BENCH_REPEATS times; the best
+repeat is reported (ns per operation and millions of operations per second). Results
+are folded into a volatile sink so the compiler cannot drop the work.
+
+- -n, --peaks <n>      : peaks per sweep (default 64)
+- -e, --errors <rate>  : fraction of sweeps with error payloads (default 0)
+- -f, --filter <text>  : only benchmarks whose name contains <text>
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <chrono>
+
+#include "../common/i4_protocol.h"
+#include "../common/i4_peak_decoder.h"
+#include "../common/i4_calibration.h"
+#include "../common/fbg_compact_protocol.h"
+#include "../common/i4_stream_generator.h"
+
+#define BENCH_SWEEPS 64          // distinct sweeps cycled through
+#define BENCH_SPECTRAL_PAYLOADS 8192
+#define BENCH_MIN_TIME_S 0.2
+#define BENCH_REPEATS 5
+#define PACKET_SIZE 11           // int8_t 3, double 1
+
+struct bench_input_t {
+    uint32_t peaks;
+    char* frames[2];             // [0] peak, [1] time-stamped peak sweeps, BENCH_SWEEPS each
+    uint32_t frame_stride;
+    uint32_t data_offset[2][BENCH_SWEEPS];
+    char* spectral;              // BENCH_SPECTRAL_PAYLOADS x SPECTRAL_PAYLOAD_SIZE
+    peak_batch_t batch;          // decoded sweep 0, input of the calibration / forwarding benchmarks
+    struct calibration_table_t calibration;
+    struct compact_layout_t layout;
+    double* force;
+    char* out;                   // forwarding output
+};
+
+// one pass over the input, returns the number of operations done
+typedef uint64_t (*bench_function_t)(struct bench_input_t* input);
+
+struct benchmark_t {
+    const char* name;
+    const char* unit;
+    bench_function_t function;
+};
+
+static volatile double bench_sink;
+
+uint64_t benchHeader(struct bench_input_t* input);
+uint64_t benchHeaderInfo(struct bench_input_t* input);
+uint64_t benchPayload(struct bench_input_t* input);
+uint64_t benchTsPayload(struct bench_input_t* input);
+uint64_t benchPeakIds(struct bench_input_t* input);
+uint64_t benchWavelength(struct bench_input_t* input);
+uint64_t benchDecodeRecord(struct bench_input_t* input);
+uint64_t benchDecodeBatch(struct bench_input_t* input);
+uint64_t benchDecodeBatchTs(struct bench_input_t* input);
+uint64_t benchSpectralPayload(struct bench_input_t* input);
+uint64_t benchCalibrationForce(struct bench_input_t* input);
+uint64_t benchCalibrationForceBatch(struct bench_input_t* input);
+uint64_t benchPack11(struct bench_input_t* input);
+uint64_t benchCompactFloat32(struct bench_input_t* input);
+uint64_t benchCompactInt32(struct bench_input_t* input);
+int initBenchInput(struct bench_input_t* input, uint32_t peaks, double error_rate);
+void freeBenchInput(struct bench_input_t* input);
+void runBenchmark(const struct benchmark_t* benchmark, struct bench_input_t* input);
+
+static const struct benchmark_t benchmarks[] = {
+    { "header", "sweep", benchHeader },
+    { "header_info", "sweep", benchHeaderInfo },
+    { "payload", "peak", benchPayload },
+    { "ts_payload", "peak", benchTsPayload },
+    { "peak_ids", "peak", benchPeakIds },
+    { "wavelength", "peak", benchWavelength },
+    { "decode_record", "peak", benchDecodeRecord },
+    { "decode_batch", "peak", benchDecodeBatch },
+    { "decode_batch_ts", "peak", benchDecodeBatchTs },
+    { "spectral_payload", "payload", benchSpectralPayload },
+    { "calibration_force", "peak", benchCalibrationForce },
+    { "calibration_force_batch", "peak", benchCalibrationForceBatch },
+    { "pack_11byte", "peak", benchPack11 },
+    { "compact_float32", "peak", benchCompactFloat32 },
+    { "compact_int32", "peak", benchCompactInt32 },
+};
+
+/* =============================================================================
+ *
+ * Main Function
+ *
+ * =============================================================================
+ */
+
+int main(int argc, char* argv[]) {
+    uint32_t peaks = 64;
+    double error_rate = 0.0;
+    const char* filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--peaks") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            peaks = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--errors") == 0) && i + 1 < argc) {
+            error_rate = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--filter") == 0) && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-n|--peaks <n>] [-e|--errors <rate>] [-f|--filter <text>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (peaks > GENERATOR_MAX_PEAKS) {
+        peaks = GENERATOR_MAX_PEAKS;
+    }
+
+    struct bench_input_t input;
+    if (initBenchInput(&input, peaks, error_rate) != 0) {
+        freeBenchInput(&input);
+        return 1;
+    }
+    printf("%u peaks per sweep, %u sweeps, error rate %.3f, decoder %s\n", peaks, BENCH_SWEEPS, error_rate,
+#if defined(PEAK_DECODER_AVX2)
+        "AVX2"
+#elif defined(PEAK_DECODER_SSE2)
+        "SSE2"
+#else
+        "scalar"
+#endif
+    );
+
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        if (filter == NULL || strstr(benchmarks[b].name, filter) != NULL) {
+            runBenchmark(&benchmarks[b], &input);
+        }
+    }
+
+    freeBenchInput(&input);
+    return 0;
+}
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* bench* : One pass of a benchmark over the generated sweeps, returns the operations done.
+* initBenchInput : Generates the peak / time-stamped sweeps, a spectrum, the decoded batch,
+*                  a calibration of every generated sensor and the compact layout.
+* freeBenchInput : Frees what initBenchInput allocated.
+* runBenchmark : Times a benchmark (best of BENCH_REPEATS) and prints ns/op and Mops/s.
+* ==============================================================================
+*/
+
+uint64_t benchHeader(struct bench_input_t* input) {
+    int64_t sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        int sweep_type, DO, DL;
+        processPacket_Header(input->frames[0] + s * input->frame_stride, &sweep_type, &DO, &DL);
+        sum += sweep_type + DO + DL;
+    }
+    bench_sink = bench_sink + (double)sum;
+    return BENCH_SWEEPS;
+}
+
+uint64_t benchHeaderInfo(struct bench_input_t* input) {
+    uint64_t sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        struct i4_header_info_t info;
+        processPacket_HeaderInfo(input->frames[0] + s * input->frame_stride, &info);
+        sum += info.packetCounter + info.dataOffset + info.dataLength + info.timeStamp;
+    }
+    bench_sink = bench_sink + (double)sum;
+    return BENCH_SWEEPS;
+}
+
+uint64_t benchPayload(struct bench_input_t* input) {
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[0] + s * input->frame_stride + input->data_offset[0][s];
+        for (uint32_t i = 0; i < input->peaks; i++) {
+            uint8_t channel, fiber, sensor;
+            double wavelength_nm;
+            processPacket_Payload(payload + i * PEAK_PAYLOAD_SIZE, &channel, &fiber, &sensor, &wavelength_nm);
+            sum += wavelength_nm + channel + fiber + sensor;
+        }
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchTsPayload(struct bench_input_t* input) {
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[1] + s * input->frame_stride + input->data_offset[1][s];
+        for (uint32_t i = 0; i < input->peaks; i++) {
+            uint8_t channel, fiber, sensor;
+            double wavelength_nm, time_stamp_s;
+            processPacket_tsPayload(payload + i * TSPEAK_PAYLOAD_SIZE, &channel, &fiber, &sensor, &wavelength_nm, &time_stamp_s);
+            sum += wavelength_nm + time_stamp_s + channel + fiber + sensor;
+        }
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchPeakIds(struct bench_input_t* input) {
+    uint64_t sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[0] + s * input->frame_stride + input->data_offset[0][s];
+        for (uint32_t i = 0; i < input->peaks; i++) {
+            peak_data_t peak_data;
+            memcpy(peak_data, payload + i * PEAK_PAYLOAD_SIZE, sizeof(peak_data));
+            sum += channel_id(peak_data) + fiber_id(peak_data) + sensor_id(peak_data);
+        }
+    }
+    bench_sink = bench_sink + (double)sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchWavelength(struct bench_input_t* input) {
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[0] + s * input->frame_stride + input->data_offset[0][s];
+        for (uint32_t i = 0; i < input->peaks; i++) {
+            peak_data_t peak_data;
+            memcpy(peak_data, payload + i * PEAK_PAYLOAD_SIZE, sizeof(peak_data));
+            sum += wavelength(peak_data);
+        }
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchDecodeRecord(struct bench_input_t* input) {
+    peak_batch_t* batch = &input->batch;
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[0] + s * input->frame_stride + input->data_offset[0][s];
+        for (uint32_t i = 0; i < input->peaks; i++) {
+            decodePeakRecord(payload + i * PEAK_PAYLOAD_SIZE, PEAK_PAYLOAD_SIZE, batch, i);
+        }
+        sum += batch->wavelength[input->peaks - 1];
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchDecodeBatch(struct bench_input_t* input) {
+    peak_batch_t* batch = &input->batch;
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[0] + s * input->frame_stride + input->data_offset[0][s];
+        sum += decodePeakBatch(payload, input->peaks, PEAK_PAYLOAD_SIZE, batch) + batch->wavelength[input->peaks - 1];
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchDecodeBatchTs(struct bench_input_t* input) {
+    peak_batch_t* batch = &input->batch;
+    double sum = 0;
+    for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+        const char* payload = input->frames[1] + s * input->frame_stride + input->data_offset[1][s];
+        sum += decodePeakBatch(payload, input->peaks, TSPEAK_PAYLOAD_SIZE, batch) + batch->timestamp[input->peaks - 1];
+    }
+    bench_sink = bench_sink + sum;
+    return (uint64_t)BENCH_SWEEPS * input->peaks;
+}
+
+uint64_t benchSpectralPayload(struct bench_input_t* input) {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < BENCH_SPECTRAL_PAYLOADS; i++) {
+        int16_t data1, data2, data3, data4;
+        processPacket_spectralPayload(input->spectral + i * SPECTRAL_PAYLOAD_SIZE, &data1, &data2, &data3, &data4);
+        sum += data1 + data2 + data3 + data4;
+    }
+    bench_sink = bench_sink + (double)sum;
+    return BENCH_SPECTRAL_PAYLOADS;
+}
+
+uint64_t benchCalibrationForce(struct bench_input_t* input) {
+    const peak_batch_t* batch = &input->batch;
+    for (uint32_t i = 0; i < batch->count; i++) {
+        input->force[i] = calibrationForce(&input->calibration, batch->channel[i], batch->fiber[i], batch->sensor[i],
+            batch->wavelength[i]);
+    }
+    bench_sink = bench_sink + input->force[batch->count - 1];
+    return batch->count;
+}
+
+uint64_t benchCalibrationForceBatch(struct bench_input_t* input) {
+    calibrationForce_batch(&input->calibration, &input->batch, input->force);
+    bench_sink = bench_sink + input->force[input->batch.count - 1];
+    return input->batch.count;
+}
+
+uint64_t benchPack11(struct bench_input_t* input) {
+    const peak_batch_t* batch = &input->batch;
+    for (uint32_t i = 0; i < batch->count; i++) {
+        uint8_t int_data[3] = { batch->channel[i], batch->fiber[i], batch->sensor[i] };
+        char* cBuffer = input->out + i * PACKET_SIZE;
+
+        memcpy(cBuffer, int_data, sizeof(int_data));
+        memcpy(cBuffer + sizeof(int_data), &batch->wavelength[i], sizeof(double));
+    }
+    bench_sink = bench_sink + input->out[(batch->count - 1) * PACKET_SIZE + PACKET_SIZE - 1];
+    return batch->count;
+}
+
+uint64_t benchCompactFloat32(struct bench_input_t* input) {
+    uint32_t size = encodeCompactSweep(&input->layout, COMPACT_ENCODING_FLOAT32, 0, input->batch.wavelength, input->out);
+    bench_sink = bench_sink + input->out[size - 1];
+    return input->batch.count;
+}
+
+uint64_t benchCompactInt32(struct bench_input_t* input) {
+    uint32_t size = encodeCompactSweep(&input->layout, COMPACT_ENCODING_INT32, 0, input->batch.wavelength, input->out);
+    bench_sink = bench_sink + input->out[size - 1];
+    return input->batch.count;
+}
+
+/* returns 0, or -1 if an allocation fails */
+int initBenchInput(struct bench_input_t* input, uint32_t peaks, double error_rate) {
+    memset(input, 0, sizeof(*input));
+    input->peaks = peaks;
+    initPeakBatch(&input->batch, peaks);
+    initCompactLayout(&input->layout);
+    if (initCalibration(&input->calibration) != 0) {
+        return -1;
+    }
+
+    struct generator_config_t config;
+    initGeneratorConfig(&config);
+    config.peaks = peaks;
+    config.error_rate = error_rate;
+    config.sweep_type = SWEEP_TYPE_TSPEAK;
+    input->frame_stride = generatorMaxSweepSize(&config);
+    input->frames[0] = (char*)malloc((size_t)BENCH_SWEEPS * input->frame_stride);
+    input->frames[1] = (char*)malloc((size_t)BENCH_SWEEPS * input->frame_stride);
+    input->spectral = (char*)malloc((size_t)BENCH_SPECTRAL_PAYLOADS * SPECTRAL_PAYLOAD_SIZE);
+    input->force = (double*)malloc(peaks * sizeof(double));
+    input->out = (char*)malloc((size_t)peaks * PACKET_SIZE + COMPACT_SWEEP_HEADER_SIZE);
+    if (input->frames[0] == NULL || input->frames[1] == NULL || input->spectral == NULL || input->force == NULL
+        || input->out == NULL || input->batch.capacity < peaks) {
+        fprintf(stderr, "Benchmark allocation failed.\n");
+        return -1;
+    }
+
+    for (int t = 0; t < 2; t++) {
+        struct i4_generator_t generator;
+        config.sweep_type = t == 0 ? SWEEP_TYPE_PEAK : SWEEP_TYPE_TSPEAK;
+        initGenerator(&generator, &config);
+        for (uint32_t s = 0; s < BENCH_SWEEPS; s++) {
+            char* frame = input->frames[t] + s * input->frame_stride;
+            generateSweep(&generator, frame);
+            int sweep_type, DO, DL;
+            processPacket_Header(frame, &sweep_type, &DO, &DL);
+            input->data_offset[t][s] = (uint32_t)DO;
+        }
+    }
+
+    struct i4_generator_t noise;
+    initGenerator(&noise, &config);
+    for (uint32_t i = 0; i < BENCH_SPECTRAL_PAYLOADS * SPECTRAL_PAYLOAD_SIZE / sizeof(uint64_t); i++) {
+        uint64_t samples = generatorRandom(&noise);
+        memcpy(input->spectral + i * sizeof(uint64_t), &samples, sizeof(samples));
+    }
+
+    decodePeakBatch(input->frames[0] + input->data_offset[0][0], peaks, PEAK_PAYLOAD_SIZE, &input->batch);
+    for (uint32_t i = 0; i < peaks; i++) {
+        setCalibration(&input->calibration, input->batch.channel[i], input->batch.fiber[i], input->batch.sensor[i],
+            input->batch.wavelength[i], CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+    }
+    return setCompactLayout(&input->layout, &input->batch, input->batch.wavelength);
+}
+
+void freeBenchInput(struct bench_input_t* input) {
+    free(input->frames[0]);
+    free(input->frames[1]);
+    free(input->spectral);
+    free(input->force);
+    free(input->out);
+    freePeakBatch(&input->batch);
+    freeCompactLayout(&input->layout);
+    freeCalibration(&input->calibration);
+}
+
+void runBenchmark(const struct benchmark_t* benchmark, struct bench_input_t* input) {
+    double best_ns = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        uint64_t operations = 0;
+        double elapsed = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        do {
+            for (int pass = 0; pass < 16; pass++) {
+                operations += benchmark->function(input);
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < BENCH_MIN_TIME_S);
+
+        double ns = elapsed * 1e9 / (double)operations;
+        best_ns = (r == 0 || ns < best_ns) ? ns : best_ns;
+    }
+    printf("%-24s %9.3f ns/%-8s %9.1f Mops/s\n", benchmark->name, best_ns, benchmark->unit, 1e3 / best_ns);
+}
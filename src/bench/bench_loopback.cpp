@@ -0,0 +1,427 @@
+/*
+File    : bench_loopback.cpp
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : C++11
+Protocol    : TCP/IP Server pair (I4 side and main server side) around the forwarder
+
+End-to-end benchmark of client_FBGs_data_tx without a physical interrogator : this
+program is both ends of the forwarder on one host,
+
+- the I4 (port 9931) : synthetic sweeps from ../common/i4_stream_generator.h at a fixed
+  rate, or as fast as the forwarder takes them (-r 0), each header stamped with this
+  host's clock when it is sent, so the forwarder's own latency statistics are meaningful too
+- the main server (port 4578) : receives the forwarded messages and matches each sweep,
+  by its sweep counter, to the time its frame was sent
+
+and reports sweeps/s, peaks/s and the latency percentiles of "frame sent -> forwarded
+sweep received"; sweeps the forwarder dropped (full sweep ring) are counted apart.
+Start it first, then e.g. client_FBGs_data_tx -i 127.0.0.1 -b.
+
+- -f, --format <packet|batch|compact> : what the client forwards (packet : no sweep
+                                        counter on the wire, throughput only)
+- -n, --peaks <n>      : peaks per sweep (default 64)
+- -r, --rate <Hz>      : sweep rate (default 1000, 0 = as fast as possible)
+- -s, --sweeps <n>     : sweeps to send (default 10000)
+- -e, --errors <rate>  : fraction of sweeps with error payloads (default 0)
+- -t, --tspeak         : time-stamped peak payloads
+
+Builds on Windows and Linux (../common/platform_socket.h).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+#include "../common/platform_socket.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_stream_generator.h"
+#include "../common/fbg_compact_protocol.h"
+#include "../common/low_latency.h"
+
+#define PORT 4578
+#define PORT_I4 9931
+#define PACKET_SIZE 11       // int8_t 3, double 1
+#define BATCH_HEADER_SIZE 6  // uint32_t sweep counter, uint16_t peak count
+#define BENCH_IDLE_TIMEOUT_MS 2000 // after the last sweep, wait this long for the forwarder to catch up
+
+#define BENCH_FORMAT_PACKET 0
+#define BENCH_FORMAT_BATCH 1
+#define BENCH_FORMAT_COMPACT 2
+
+struct loopback_options_t {
+    int format;
+    struct generator_config_t generator;
+    uint32_t sweeps;
+};
+
+struct loopback_state_t {
+    const struct loopback_options_t* options;
+    SOCKET hMain;                                // forwarded messages
+    std::unique_ptr<std::atomic<uint64_t>[]> sent_ns; // steady time each sweep went out, by sweep counter
+    std::atomic<uint64_t> received_sweeps;
+    std::atomic<uint64_t> received_peaks;
+    uint64_t unknown_sweeps;                     // counter outside the sent range (receiver only)
+    uint64_t first_received_ns;
+    uint64_t last_received_ns;
+    struct latency_histogram_t latency;
+};
+
+int sendAll(SOCKET hSocket, const char* buffer, int length);
+int recvAll(SOCKET hSocket, char* buffer, int length);
+SOCKET listenOn(int port);
+SOCKET acceptOne(SOCKET hListen, const char* name, int port);
+void recordSweep(struct loopback_state_t* state, uint32_t sweep_counter, uint32_t peaks);
+void receiverThread(struct loopback_state_t* state);
+int sendSweeps(SOCKET hI4, struct loopback_state_t* state);
+
+/* =============================================================================
+ *
+ * Main Function
+ *
+ * =============================================================================
+ */
+
+int main(int argc, char* argv[]) {
+    struct loopback_options_t options;
+    options.format = BENCH_FORMAT_BATCH;
+    initGeneratorConfig(&options.generator);
+    options.sweeps = 10000;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc) {
+            i++;
+            options.format = strcmp(argv[i], "packet") == 0 ? BENCH_FORMAT_PACKET
+                : strcmp(argv[i], "batch") == 0 ? BENCH_FORMAT_BATCH
+                : strcmp(argv[i], "compact") == 0 ? BENCH_FORMAT_COMPACT : -1;
+            if (options.format < 0) {
+                break;
+            }
+        }
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--peaks") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.generator.peaks = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            options.generator.rate_hz = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sweeps") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.sweeps = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--errors") == 0) && i + 1 < argc) {
+            options.generator.error_rate = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tspeak") == 0) {
+            options.generator.sweep_type = SWEEP_TYPE_TSPEAK;
+        }
+        else {
+            options.format = -1;
+            break;
+        }
+    }
+    if (options.format < 0) {
+        fprintf(stderr, "Usage: %s [-f|--format <packet|batch|compact>] [-n|--peaks <n>] [-r|--rate <Hz>] "
+            "[-s|--sweeps <n>] [-e|--errors <rate>] [-t|--tspeak]\n", argv[0]);
+        return 1;
+    }
+    if (options.generator.peaks > GENERATOR_MAX_PEAKS) {
+        options.generator.peaks = GENERATOR_MAX_PEAKS;
+    }
+
+    /*****************************************/
+    /**** Initialize TCP/IP communication ****/
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed.\n");
+        return 1;
+    }
+
+    SOCKET hListenMain = listenOn(PORT);
+    SOCKET hListenI4 = listenOn(PORT_I4);
+    if (hListenMain == INVALID_SOCKET || hListenI4 == INVALID_SOCKET) {
+        if (hListenMain != INVALID_SOCKET) closesocket(hListenMain);
+        if (hListenI4 != INVALID_SOCKET) closesocket(hListenI4);
+        WSACleanup();
+        return 1;
+    }
+
+    // the forwarder connects to its main server first, then to the I4
+    struct loopback_state_t state;
+    state.options = &options;
+    state.hMain = acceptOne(hListenMain, "main server", PORT);
+    SOCKET hI4 = state.hMain != INVALID_SOCKET ? acceptOne(hListenI4, "I4", PORT_I4) : INVALID_SOCKET;
+    closesocket(hListenMain);
+    closesocket(hListenI4);
+    if (hI4 == INVALID_SOCKET) {
+        if (state.hMain != INVALID_SOCKET) closesocket(state.hMain);
+        WSACleanup();
+        return 1;
+    }
+    socketSetNoDelay(hI4);
+
+    state.sent_ns.reset(new std::atomic<uint64_t>[options.sweeps]);
+    for (uint32_t k = 0; k < options.sweeps; k++) {
+        state.sent_ns[k].store(0, std::memory_order_relaxed);
+    }
+    state.received_sweeps = 0;
+    state.received_peaks = 0;
+    state.unknown_sweeps = 0;
+    state.first_received_ns = 0;
+    state.last_received_ns = 0;
+    latencyHistogram_init(&state.latency);
+
+    /******************************/
+    /**** Sending and receiving ****/
+    std::thread receiver(receiverThread, &state);
+    uint64_t start_ns = latencySteady_ns();
+    int result = sendSweeps(hI4, &state);
+    uint64_t sent_ns = latencySteady_ns();
+
+    // wait for the forwarder to drain, as long as it makes progress
+    uint64_t expected = options.format == BENCH_FORMAT_PACKET ? (uint64_t)options.sweeps * options.generator.peaks : options.sweeps;
+    uint64_t seen = 0;
+    std::chrono::steady_clock::time_point progress = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - progress < std::chrono::milliseconds(BENCH_IDLE_TIMEOUT_MS)) {
+        uint64_t now_seen = options.format == BENCH_FORMAT_PACKET ? state.received_peaks.load() : state.received_sweeps.load();
+        if (now_seen >= expected) {
+            break;
+        }
+        if (now_seen != seen) {
+            seen = now_seen;
+            progress = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    shutdown(state.hMain, SD_BOTH);
+    receiver.join();
+    closesocket(hI4);
+    closesocket(state.hMain);
+
+    double send_s = (double)(sent_ns - start_ns) * 1e-9;
+    double receive_s = (double)(state.last_received_ns - state.first_received_ns) * 1e-9;
+    uint64_t sweeps = state.received_sweeps.load();
+    uint64_t peaks = state.received_peaks.load();
+    printf("Sent %u sweeps of %u peaks in %.3f s : %.0f sweeps/s\n", options.sweeps, options.generator.peaks, send_s,
+        send_s > 0 ? options.sweeps / send_s : 0.0);
+    printf("Received %llu sweeps, %llu peaks in %.3f s : %.0f sweeps/s, %.0f peaks/s",
+        (unsigned long long)sweeps, (unsigned long long)peaks, receive_s,
+        receive_s > 0 ? sweeps / receive_s : 0.0, receive_s > 0 ? peaks / receive_s : 0.0);
+    if (options.format != BENCH_FORMAT_PACKET && sweeps < options.sweeps) {
+        printf(", %llu not forwarded", (unsigned long long)(options.sweeps - sweeps));
+    }
+    if (state.unknown_sweeps > 0) {
+        printf(" (%llu with an unknown sweep counter)", (unsigned long long)state.unknown_sweeps);
+    }
+    printf("\n");
+    if (options.format == BENCH_FORMAT_PACKET) {
+        printf("Packet format : no sweep counter on the wire, no latency\n");
+    }
+    else {
+        latencyHistogram_print(&state.latency, "Latency sent -> received");
+    }
+
+    // Close TCP/IP communication
+    WSACleanup();
+
+    return result == 0 ? 0 : 1;
+}
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* sendAll : Sends exactly 'length' bytes, looping over partial sends.
+* recvAll : Receives exactly 'length' bytes, -1 if the connection closes first.
+* listenOn : Listening socket on a port of every interface.
+* acceptOne : Waits for one connection.
+* recordSweep : Counts a forwarded sweep and its latency from the send time of its frame.
+* receiverThread : Parses the forwarded messages (packet, batch or compact) until the socket closes.
+* sendSweeps : Generates and sends the sweeps, paced to the configured rate.
+* ==============================================================================
+*/
+
+int sendAll(SOCKET hSocket, const char* buffer, int length) {
+    int sent = 0;
+    while (sent < length) {
+        int bytesSent = send(hSocket, buffer + sent, length - sent, 0);
+        if (bytesSent == SOCKET_ERROR) {
+            fprintf(stderr, "Send failed (%d).\n", WSAGetLastError());
+            return SOCKET_ERROR;
+        }
+        sent += bytesSent;
+    }
+    return sent;
+}
+
+/* returns 0, or -1 if the connection closed */
+int recvAll(SOCKET hSocket, char* buffer, int length) {
+    int received = 0;
+    while (received < length) {
+        int bytesReceived = recv(hSocket, buffer + received, length - received, 0);
+        if (bytesReceived <= 0) {
+            return -1;
+        }
+        received += bytesReceived;
+    }
+    return 0;
+}
+
+SOCKET listenOn(int port) {
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, 0);
+    if (hListen == INVALID_SOCKET) {
+        fprintf(stderr, "Socket creation failed.\n");
+        return INVALID_SOCKET;
+    }
+    int reuse = 1;
+    setsockopt(hListen, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    SOCKADDR_IN serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons((u_short)port);
+    serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(hListen, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR || listen(hListen, 1) == SOCKET_ERROR) {
+        fprintf(stderr, "Can't listen on port %d.\n", port);
+        closesocket(hListen);
+        return INVALID_SOCKET;
+    }
+    return hListen;
+}
+
+SOCKET acceptOne(SOCKET hListen, const char* name, int port) {
+    printf("Waiting for the forwarder on the %s port %d\n", name, port);
+    SOCKET hSocket = accept(hListen, NULL, NULL);
+    if (hSocket == INVALID_SOCKET) {
+        fprintf(stderr, "Accept failed.\n");
+    }
+    return hSocket;
+}
+
+void recordSweep(struct loopback_state_t* state, uint32_t sweep_counter, uint32_t peaks) {
+    uint64_t now_ns = latencySteady_ns();
+    if (state->first_received_ns == 0) {
+        state->first_received_ns = now_ns;
+    }
+    state->last_received_ns = now_ns;
+    state->received_sweeps.fetch_add(1, std::memory_order_relaxed);
+    state->received_peaks.fetch_add(peaks, std::memory_order_relaxed);
+
+    if (state->options->format == BENCH_FORMAT_PACKET) {
+        return; // no sweep counter
+    }
+    uint64_t sent_ns = sweep_counter < state->options->sweeps
+        ? state->sent_ns[sweep_counter].load(std::memory_order_acquire) : 0;
+    if (sent_ns == 0) {
+        state->unknown_sweeps++;
+        return;
+    }
+    latencyHistogram_add(&state->latency, sent_ns, now_ns);
+}
+
+void receiverThread(struct loopback_state_t* state) {
+    SOCKET hSocket = state->hMain;
+    std::unique_ptr<char[]> body(new char[(size_t)COMPACT_MAX_SENSORS * PACKET_SIZE]); // largest uint16_t count
+    uint32_t peaks_per_sweep = state->options->generator.peaks;
+    uint64_t packets = 0;
+
+    while (true) {
+        if (state->options->format == BENCH_FORMAT_PACKET) {
+            if (recvAll(hSocket, body.get(), PACKET_SIZE) != 0) {
+                break;
+            }
+            // one packet per peak, a sweep is complete after every 'peaks' packets
+            if (++packets % peaks_per_sweep == 0) {
+                recordSweep(state, 0, peaks_per_sweep);
+            }
+        }
+        else if (state->options->format == BENCH_FORMAT_BATCH) {
+            char header[BATCH_HEADER_SIZE];
+            uint32_t sweep_counter;
+            uint16_t count;
+            if (recvAll(hSocket, header, BATCH_HEADER_SIZE) != 0) {
+                break;
+            }
+            memcpy(&sweep_counter, header, sizeof(sweep_counter));
+            memcpy(&count, header + sizeof(sweep_counter), sizeof(count));
+            if (recvAll(hSocket, body.get(), count * PACKET_SIZE) != 0) {
+                break;
+            }
+            recordSweep(state, sweep_counter, count);
+        }
+        else {
+            char type;
+            if (recvAll(hSocket, &type, 1) != 0) {
+                break;
+            }
+            if (type == COMPACT_MSG_LAYOUT) {
+                char header[COMPACT_LAYOUT_HEADER_SIZE - 1];
+                uint16_t count;
+                if (recvAll(hSocket, header, sizeof(header)) != 0) {
+                    break;
+                }
+                memcpy(&count, header + 1, sizeof(count));
+                if (recvAll(hSocket, body.get(), count * COMPACT_LAYOUT_ENTRY_SIZE) != 0) {
+                    break;
+                }
+            }
+            else if (type == COMPACT_MSG_SWEEP) {
+                char header[COMPACT_SWEEP_HEADER_SIZE - 1];
+                uint32_t sweep_counter;
+                uint16_t count;
+                if (recvAll(hSocket, header, sizeof(header)) != 0) {
+                    break;
+                }
+                memcpy(&sweep_counter, header, sizeof(sweep_counter));
+                memcpy(&count, header + sizeof(sweep_counter), sizeof(count));
+                if (recvAll(hSocket, body.get(), count * COMPACT_VALUE_SIZE) != 0) {
+                    break;
+                }
+                recordSweep(state, sweep_counter, count);
+            }
+            else {
+                fprintf(stderr, "Unknown compact message type 0x%02x.\n", (unsigned char)type);
+                break;
+            }
+        }
+    }
+}
+
+/* returns 0, or -1 if the forwarder went away */
+int sendSweeps(SOCKET hI4, struct loopback_state_t* state) {
+    const struct loopback_options_t* options = state->options;
+    struct generator_config_t config = options->generator;
+    bool paced = config.rate_hz > 0.0;
+    if (!paced) {
+        config.rate_hz = 1000.0; // tick counter of the time-stamped peaks only
+    }
+
+    struct i4_generator_t generator;
+    initGenerator(&generator, &config);
+    std::unique_ptr<char[]> frame(new char[generatorMaxSweepSize(&config)]);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t k = 0; k < options->sweeps; k++) {
+        if (paced) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds((long long)(k * 1e9 / config.rate_hz)));
+        }
+        uint32_t size = generateSweep(&generator, frame.get());
+        struct I4PacketHeader header;
+        memcpy(&header, frame.get(), sizeof(header));
+        header.timeStamp = latencyNow_ns();
+        memcpy(frame.get(), &header, sizeof(header));
+        state->sent_ns[k].store(latencySteady_ns(), std::memory_order_release);
+        if (sendAll(hI4, frame.get(), (int)size) == SOCKET_ERROR) {
+            return -1;
+        }
+    }
+    if (generator.errors > 0) {
+        printf("%llu error payloads sent\n", (unsigned long long)generator.errors);
+    }
+    return 0;
+}
@@ -0,0 +1,399 @@
+/*
+File    : columnar_logger.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only buffered columnar binary logger of every forwarded sample (C++11)
+
+Every sweep of one I4 unit becomes one row : its header timestamp, its sweep counter and
+one float32 per sensor (wavelength [nm], or force [mN] if calibrated). Rows are collected
+column by column in a chunk of COLUMNAR_LOG_CHUNK_ROWS rows; a full chunk (or one older
+than COLUMNAR_LOG_FLUSH_MS, or one whose sensor set changes) is handed to a background
+thread that writes it while the forwarding thread fills the second chunk buffer. The
+forwarding thread only waits if the writer is still busy with the previous chunk.
+
+File : columnar_log_header_t, then chunks of
+    columnar_chunk_header_t
+    stored_bytes of payload (deflated if 'compression', built with COLUMNAR_LOG_ZLIB) :
+        rows x uint64 timestamp [ns], rows x uint32 sweep counter,
+        sensors x rows x float32 value (NaN : sensor missing in that sweep),
+        sensors x (channel, fiber, sensor) uint8
+All little endian. ../tcp_server_rx/export_fbg_log.py converts a log to CSV.
+
+Rows must come from one producer thread (the worker forwarding the unit).
+*/
+
+#ifndef COLUMNAR_LOGGER_H
+#define COLUMNAR_LOGGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef COLUMNAR_LOG_ZLIB
+#include <zlib.h>
+#endif
+
+#include "i4_peak_decoder.h"
+
+#define COLUMNAR_LOG_MAGIC "FBGLOG01"
+#define COLUMNAR_LOG_VERSION 1
+#define COLUMNAR_CHUNK_MAGIC 0x4b4e4843 // "CHNK"
+#define COLUMNAR_LOG_CHUNK_ROWS 4096
+#define COLUMNAR_LOG_FLUSH_MS 1000
+#define COLUMNAR_LOG_MIN_SENSORS 16 // initial column capacity of a chunk buffer
+#define COLUMNAR_LOG_MAX_SENSORS 0xffff
+#define COLUMNAR_LOG_FILE_BUFFER_SIZE (1024 * 1024)
+
+#define COLUMNAR_UNIT_WAVELENGTH_NM 0
+#define COLUMNAR_UNIT_FORCE_MN 1
+
+#define COLUMNAR_COMPRESSION_NONE 0
+#define COLUMNAR_COMPRESSION_DEFLATE 1
+
+#pragma pack(1)
+struct columnar_log_header_t {
+    char magic[8];
+    uint32_t version;
+    uint8_t unit;
+    uint8_t device;   // I4 unit (index in the forwarder's -i list)
+    uint16_t reserved;
+};
+
+struct columnar_chunk_header_t {
+    uint32_t magic;
+    uint32_t rows;
+    uint16_t sensors;
+    uint8_t compression;
+    uint8_t reserved;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint32_t raw_bytes;    // payload before compression
+    uint32_t stored_bytes; // payload in the file
+};
+#pragma pack()
+
+// one chunk buffer, value[s * COLUMNAR_LOG_CHUNK_ROWS + row]
+struct columnar_chunk_t {
+    uint32_t rows;
+    uint32_t sensors;
+    uint32_t sensor_capacity;
+    uint64_t* timestamp;
+    uint32_t* sweep_counter;
+    float* value;
+    uint8_t* ids;          // sensors x (channel, fiber, sensor)
+    std::chrono::steady_clock::time_point started;
+};
+
+struct columnar_logger_t {
+    FILE* file;
+    int compression;
+    struct columnar_chunk_t chunks[2];
+    int active;                        // chunk filled by the producer
+
+    std::mutex lock;
+    std::condition_variable changed;
+    struct columnar_chunk_t* pending;  // handed to the writer, NULL when it is idle
+    bool running;
+    std::thread thread;
+
+    // owned by the writer thread
+    char* scratch;
+    uint32_t scratch_capacity;
+    int failed;                        // a write failed, chunks are discarded
+
+    // statistics, read after columnarLog_close
+    uint64_t rows;
+    uint64_t chunks_written;
+    uint64_t bytes;
+    uint64_t stalls;                   // producer waited for the writer
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* columnarLog_open, columnarLog_close : Create the log file and start its writer / write the last chunk and stop.
+* columnarChunk_reserve : Grows a chunk buffer to a number of sensors.
+* columnarChunk_matches : Whether a sweep has the sensor set of a chunk.
+* columnarLog_submit : Hands the active chunk to the writer and switches to the other buffer.
+* columnarLog_append : Adds one sweep as a row.
+* columnarLog_write : Packs, compresses and writes one chunk (writer thread).
+* columnarLog_thread : Writes the chunks handed over until the logger is closed.
+* ==============================================================================
+*/
+
+inline int columnarChunk_reserve(struct columnar_chunk_t* chunk, uint32_t sensors) {
+    if (sensors <= chunk->sensor_capacity && chunk->timestamp != NULL) {
+        return 0;
+    }
+    uint32_t capacity = sensors > 2 * chunk->sensor_capacity ? sensors : 2 * chunk->sensor_capacity;
+    capacity = capacity < COLUMNAR_LOG_MIN_SENSORS ? COLUMNAR_LOG_MIN_SENSORS : capacity;
+    float* value = (float*)realloc(chunk->value, (size_t)capacity * COLUMNAR_LOG_CHUNK_ROWS * sizeof(float));
+    if (value == NULL) {
+        return -1;
+    }
+    chunk->value = value;
+    uint8_t* ids = (uint8_t*)realloc(chunk->ids, (size_t)capacity * 3);
+    if (ids == NULL) {
+        return -1;
+    }
+    chunk->ids = ids;
+    if (chunk->timestamp == NULL) {
+        chunk->timestamp = (uint64_t*)malloc(COLUMNAR_LOG_CHUNK_ROWS * sizeof(uint64_t));
+        chunk->sweep_counter = (uint32_t*)malloc(COLUMNAR_LOG_CHUNK_ROWS * sizeof(uint32_t));
+        if (chunk->timestamp == NULL || chunk->sweep_counter == NULL) {
+            return -1;
+        }
+    }
+    chunk->sensor_capacity = capacity;
+    return 0;
+}
+
+inline bool columnarChunk_matches(const struct columnar_chunk_t* chunk, const peak_batch_t* peaks) {
+    if (chunk->sensors != peaks->count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        const uint8_t* id = chunk->ids + 3 * i;
+        if (id[0] != peaks->channel[i] || id[1] != peaks->fiber[i] || id[2] != peaks->sensor[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void columnarLog_thread(struct columnar_logger_t* logger);
+
+/* unit : COLUMNAR_UNIT_*, returns 0 or -1 */
+inline int columnarLog_open(struct columnar_logger_t* logger, const char* path, uint8_t unit, uint8_t device, int compression) {
+#ifndef COLUMNAR_LOG_ZLIB
+    if (compression != COLUMNAR_COMPRESSION_NONE) {
+        fprintf(stderr, "Log compression needs a build with COLUMNAR_LOG_ZLIB.\n");
+        return -1;
+    }
+#endif
+    logger->file = NULL;
+#ifdef _MSC_VER
+    if (fopen_s(&logger->file, path, "wb") != 0) {
+        logger->file = NULL;
+    }
+#else
+    logger->file = fopen(path, "wb");
+#endif
+    if (logger->file == NULL) {
+        fprintf(stderr, "Cannot create log file %s\n", path);
+        return -1;
+    }
+    setvbuf(logger->file, NULL, _IOFBF, COLUMNAR_LOG_FILE_BUFFER_SIZE);
+
+    struct columnar_log_header_t header;
+    memcpy(header.magic, COLUMNAR_LOG_MAGIC, sizeof(header.magic));
+    header.version = COLUMNAR_LOG_VERSION;
+    header.unit = unit;
+    header.device = device;
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, logger->file);
+
+    logger->compression = compression;
+    for (int k = 0; k < 2; k++) {
+        struct columnar_chunk_t* chunk = &logger->chunks[k];
+        chunk->rows = 0;
+        chunk->sensors = 0;
+        chunk->sensor_capacity = 0;
+        chunk->timestamp = NULL;
+        chunk->sweep_counter = NULL;
+        chunk->value = NULL;
+        chunk->ids = NULL;
+    }
+    logger->active = 0;
+    logger->pending = NULL;
+    logger->scratch = NULL;
+    logger->scratch_capacity = 0;
+    logger->failed = 0;
+    logger->rows = 0;
+    logger->chunks_written = 0;
+    logger->bytes = sizeof(header);
+    logger->stalls = 0;
+    logger->running = true;
+    logger->thread = std::thread(columnarLog_thread, logger);
+    return 0;
+}
+
+inline void columnarLog_submit(struct columnar_logger_t* logger) {
+    std::unique_lock<std::mutex> guard(logger->lock);
+    if (logger->pending != NULL) {
+        logger->stalls++;
+        logger->changed.wait(guard, [logger] { return logger->pending == NULL; });
+    }
+    logger->pending = &logger->chunks[logger->active];
+    logger->changed.notify_all();
+    guard.unlock();
+
+    // the writer is done with the other buffer
+    logger->active ^= 1;
+    logger->chunks[logger->active].rows = 0;
+}
+
+/* value : one per peak (nm or mN as given to columnarLog_open), returns 0 or -1 if a buffer can't grow */
+inline int columnarLog_append(struct columnar_logger_t* logger, uint64_t timestamp_ns, uint32_t sweep_counter,
+    const peak_batch_t* peaks, const double* value) {
+    if (peaks->count > COLUMNAR_LOG_MAX_SENSORS) {
+        return -1;
+    }
+    struct columnar_chunk_t* chunk = &logger->chunks[logger->active];
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (chunk->rows > 0 && (chunk->rows == COLUMNAR_LOG_CHUNK_ROWS || !columnarChunk_matches(chunk, peaks)
+        || now - chunk->started >= std::chrono::milliseconds(COLUMNAR_LOG_FLUSH_MS))) {
+        columnarLog_submit(logger);
+        chunk = &logger->chunks[logger->active];
+    }
+
+    if (chunk->rows == 0) {
+        // a new chunk takes the sensor set of its first sweep
+        if (columnarChunk_reserve(chunk, peaks->count) != 0) {
+            return -1;
+        }
+        chunk->sensors = peaks->count;
+        for (uint32_t i = 0; i < peaks->count; i++) {
+            chunk->ids[3 * i] = peaks->channel[i];
+            chunk->ids[3 * i + 1] = peaks->fiber[i];
+            chunk->ids[3 * i + 2] = peaks->sensor[i];
+        }
+        chunk->started = now;
+    }
+
+    uint32_t row = chunk->rows;
+    chunk->timestamp[row] = timestamp_ns;
+    chunk->sweep_counter[row] = sweep_counter;
+    float* column = chunk->value + row;
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        column[(size_t)i * COLUMNAR_LOG_CHUNK_ROWS] = (float)value[i];
+    }
+    chunk->rows = row + 1;
+    logger->rows++;
+    return 0;
+}
+
+/* returns 0, or -1 if the chunk could not be written */
+inline int columnarLog_write(struct columnar_logger_t* logger, const struct columnar_chunk_t* chunk) {
+    uint32_t rows = chunk->rows;
+    uint32_t raw_bytes = rows * (uint32_t)(sizeof(uint64_t) + sizeof(uint32_t)) + chunk->sensors * (rows * (uint32_t)sizeof(float) + 3);
+    uint32_t bound = raw_bytes;
+#ifdef COLUMNAR_LOG_ZLIB
+    if (logger->compression == COLUMNAR_COMPRESSION_DEFLATE) {
+        bound += (uint32_t)compressBound(raw_bytes);
+    }
+#endif
+    if (bound > logger->scratch_capacity) {
+        char* grown = (char*)realloc(logger->scratch, bound);
+        if (grown == NULL) {
+            return -1;
+        }
+        logger->scratch = grown;
+        logger->scratch_capacity = bound;
+    }
+
+    // the columns of a partly filled chunk are packed back to back
+    char* raw = logger->scratch;
+    uint32_t offset = 0;
+    memcpy(raw + offset, chunk->timestamp, rows * sizeof(uint64_t));
+    offset += rows * (uint32_t)sizeof(uint64_t);
+    memcpy(raw + offset, chunk->sweep_counter, rows * sizeof(uint32_t));
+    offset += rows * (uint32_t)sizeof(uint32_t);
+    for (uint32_t s = 0; s < chunk->sensors; s++) {
+        memcpy(raw + offset, chunk->value + (size_t)s * COLUMNAR_LOG_CHUNK_ROWS, rows * sizeof(float));
+        offset += rows * (uint32_t)sizeof(float);
+    }
+    memcpy(raw + offset, chunk->ids, chunk->sensors * 3);
+
+    struct columnar_chunk_header_t header;
+    header.magic = COLUMNAR_CHUNK_MAGIC;
+    header.rows = rows;
+    header.sensors = (uint16_t)chunk->sensors;
+    header.compression = COLUMNAR_COMPRESSION_NONE;
+    header.reserved = 0;
+    header.first_ns = chunk->timestamp[0];
+    header.last_ns = chunk->timestamp[rows - 1];
+    header.raw_bytes = raw_bytes;
+    header.stored_bytes = raw_bytes;
+    const char* stored = raw;
+#ifdef COLUMNAR_LOG_ZLIB
+    if (logger->compression == COLUMNAR_COMPRESSION_DEFLATE) {
+        uLongf deflated = (uLongf)(bound - raw_bytes);
+        if (compress2((Bytef*)raw + raw_bytes, &deflated, (const Bytef*)raw, raw_bytes, Z_BEST_SPEED) == Z_OK) {
+            header.compression = COLUMNAR_COMPRESSION_DEFLATE;
+            header.stored_bytes = (uint32_t)deflated;
+            stored = raw + raw_bytes;
+        }
+    }
+#endif
+
+    if (fwrite(&header, sizeof(header), 1, logger->file) != 1
+        || fwrite(stored, 1, header.stored_bytes, logger->file) != header.stored_bytes
+        || fflush(logger->file) != 0) {
+        return -1;
+    }
+    logger->chunks_written++;
+    logger->bytes += sizeof(header) + header.stored_bytes;
+    return 0;
+}
+
+inline void columnarLog_thread(struct columnar_logger_t* logger) {
+    std::unique_lock<std::mutex> guard(logger->lock);
+    while (1) {
+        logger->changed.wait(guard, [logger] { return logger->pending != NULL || !logger->running; });
+        if (logger->pending == NULL) {
+            break; // closed and nothing left
+        }
+        struct columnar_chunk_t* chunk = logger->pending;
+        guard.unlock();
+        if (!logger->failed && columnarLog_write(logger, chunk) != 0) {
+            fprintf(stderr, "Log write failed, logging stopped.\n");
+            logger->failed = 1;
+        }
+        guard.lock();
+        logger->pending = NULL;
+        logger->changed.notify_all();
+    }
+}
+
+inline void columnarLog_close(struct columnar_logger_t* logger) {
+    if (logger->chunks[logger->active].rows > 0) {
+        columnarLog_submit(logger);
+    }
+    {
+        std::lock_guard<std::mutex> guard(logger->lock);
+        logger->running = false;
+        logger->changed.notify_all();
+    }
+    logger->thread.join();
+    fclose(logger->file);
+    logger->file = NULL;
+
+    for (int k = 0; k < 2; k++) {
+        struct columnar_chunk_t* chunk = &logger->chunks[k];
+        free(chunk->timestamp);
+        free(chunk->sweep_counter);
+        free(chunk->value);
+        free(chunk->ids);
+        chunk->timestamp = NULL;
+        chunk->sweep_counter = NULL;
+        chunk->value = NULL;
+        chunk->ids = NULL;
+        chunk->rows = 0;
+        chunk->sensor_capacity = 0;
+    }
+    free(logger->scratch);
+    logger->scratch = NULL;
+    logger->scratch_capacity = 0;
+}
+
+#endif // COLUMNAR_LOGGER_H
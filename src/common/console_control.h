@@ -0,0 +1,162 @@
+/*
+File    : console_control.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only shutdown signal and non-blocking console keys (C / C++)
+
+Ends the programs on a signal instead of polling the console on every sweep :
+
+- consoleControl_install() : Ctrl+C / SIGTERM (Linux), Ctrl+C / Ctrl+Break / console closed
+  (Windows) only set a flag; consoleShutdownRequested() is a plain load of that flag, cheap
+  enough for the forwarding loop. On Linux a terminal stdin is also switched to unbuffered,
+  silent input (restored at exit), so single keys can be read.
+- consoleKey() : the next key pressed, or -1. It is a console system call (_kbhit on Windows,
+  select() on stdin on Linux), so loops call it every CONSOLE_POLL_INTERVAL_MS, not per sweep;
+  consolePollKey() does that timing itself for loops that have no clock of their own.
+
+Without SA_RESTART, a blocking recv() interrupted by the signal returns with EINTR, so
+single-threaded readers see the shutdown without waiting for the next packet.
+
+The flag is static : one per program, all of which are a single translation unit.
+*/
+
+#ifndef CONSOLE_CONTROL_H
+#define CONSOLE_CONTROL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <signal.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <conio.h>
+#else
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#endif
+
+#define CONSOLE_POLL_INTERVAL_MS 50
+#define CONSOLE_KEY_ESC 27
+
+static volatile sig_atomic_t console_shutdown = 0;
+static uint64_t console_key_time_ms = 0;
+#ifndef _WIN32
+static struct termios console_saved;
+static int console_raw = 0;
+#endif
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* consoleControl_install : Routes the shutdown signals to the flag, sets up key input.
+* consoleControl_restore : Gives the terminal its settings back (also run at exit).
+* consoleShutdownRequested : Whether a shutdown signal came in.
+* consoleRequestShutdown : Sets the flag, e.g. on the ESC key.
+* consoleKey : Next key pressed, -1 if none.
+* consoleTime_ms : Monotonic milliseconds.
+* consolePollKey : consoleKey() at most every CONSOLE_POLL_INTERVAL_MS, -1 in between.
+* ==============================================================================
+*/
+
+#ifdef _WIN32
+static BOOL WINAPI consoleCtrlHandler(DWORD type) {
+    (void)type;
+    console_shutdown = 1;
+    return TRUE; // the main thread is left to end the program
+}
+#else
+static void consoleSignalHandler(int signal_number) {
+    (void)signal_number;
+    console_shutdown = 1;
+}
+#endif
+
+static void consoleControl_restore(void) {
+#ifndef _WIN32
+    if (console_raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &console_saved);
+        console_raw = 0;
+    }
+#endif
+}
+
+static inline void consoleControl_install(void) {
+#ifdef _WIN32
+    SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = consoleSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0; // no SA_RESTART : blocking calls return EINTR
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &console_saved) == 0) {
+        struct termios raw = console_saved;
+        raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+            console_raw = 1;
+            atexit(consoleControl_restore);
+        }
+    }
+#endif
+}
+
+static inline int consoleShutdownRequested(void) {
+    return console_shutdown != 0;
+}
+
+static inline void consoleRequestShutdown(void) {
+    console_shutdown = 1;
+}
+
+static inline int consoleKey(void) {
+#ifdef _WIN32
+    return _kbhit() ? _getch() : -1;
+#else
+    if (!console_raw) {
+        return -1; // not a terminal : no keys, signals only
+    }
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(STDIN_FILENO, &readable);
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    unsigned char key;
+    if (select(STDIN_FILENO + 1, &readable, NULL, NULL, &timeout) <= 0 || read(STDIN_FILENO, &key, 1) != 1) {
+        return -1;
+    }
+    return key;
+#endif
+}
+
+static inline uint64_t consoleTime_ms(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#endif
+}
+
+static inline int consolePollKey(void) {
+    uint64_t now = consoleTime_ms();
+    if (now - console_key_time_ms < CONSOLE_POLL_INTERVAL_MS) {
+        return -1;
+    }
+    console_key_time_ms = now;
+    return consoleKey();
+}
+
+#endif // CONSOLE_CONTROL_H
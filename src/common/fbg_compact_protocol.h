@@ -0,0 +1,247 @@
+/*
+File    : fbg_compact_protocol.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only compact (v2) forwarding format to the main server (C / C++)
+
+The legacy format repeats the three id bytes and a full double for every peak
+of every sweep (11 bytes/peak). The sensor ids do not change once the I4 is
+configured, so v2 sends them once in a layout message and then only the
+sweep counter and one 4-byte value per peak, in layout order (4 bytes/peak).
+
+Protocol (little endian, packed):
+- Layout message : sent first, and again whenever the peak set of a sweep changes
+    - uint8  type = COMPACT_MSG_LAYOUT
+    - uint8  encoding (COMPACT_ENCODING_FLOAT32 / COMPACT_ENCODING_INT32)
+    - uint16 sensor count
+    - sensor count x { uint8 channel, uint8 fiber, uint8 sensor, double base }
+- Sweep message :
+    - uint8  type = COMPACT_MSG_SWEEP
+    - uint32 sweep counter
+    - uint16 value count (= layout sensor count)
+    - value count x value
+        FLOAT32 : float, value
+        INT32   : int32, (value - base) * COMPACT_INT32_SCALE, i.e. picometre offsets
+                  for wavelengths [nm]; COMPACT_INT32_INVALID for NaN / out of range
+- Statistics message : every -T sweeps with client -p -T, see ../common/sensor_stats.h
+    - uint8  type = COMPACT_MSG_STATS
+    - uint32 sweep counter
+    - uint16 sensor count
+    - sensor count x { uint8 channel, uint8 fiber, uint8 sensor, uint32 samples,
+                       double mean, std, ewma, min, max [nm], double base [nm], double force [mN] }
+      (base and force NaN without calibration)
+*/
+
+#ifndef FBG_COMPACT_PROTOCOL_H
+#define FBG_COMPACT_PROTOCOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+
+#define COMPACT_MSG_LAYOUT 0x4C // 'L'
+#define COMPACT_MSG_SWEEP 0x53  // 'S'
+#define COMPACT_MSG_STATS 0x54  // 'T'
+
+#define COMPACT_ENCODING_FLOAT32 0
+#define COMPACT_ENCODING_INT32 1
+
+#define COMPACT_LAYOUT_HEADER_SIZE 4 // uint8_t type, uint8_t encoding, uint16_t count
+#define COMPACT_LAYOUT_ENTRY_SIZE 11 // uint8_t 3, double 1
+#define COMPACT_SWEEP_HEADER_SIZE 7  // uint8_t type, uint32_t sweep counter, uint16_t count
+#define COMPACT_VALUE_SIZE 4
+#define COMPACT_STATS_HEADER_SIZE 7  // uint8_t type, uint32_t sweep counter, uint16_t count
+#define COMPACT_STATS_ENTRY_SIZE 63  // uint8_t 3, uint32_t 1, double 7
+
+#define COMPACT_INT32_SCALE 1000.0 // nm -> pm
+#define COMPACT_INT32_INVALID INT32_MIN
+#define COMPACT_MAX_SENSORS 0xffff
+
+#pragma pack(1)
+struct compact_layout_header_t {
+    uint8_t type;
+    uint8_t encoding;
+    uint16_t count;
+};
+
+struct compact_layout_entry_t {
+    uint8_t channel;
+    uint8_t fiber;
+    uint8_t sensor;
+    double base;
+};
+
+struct compact_sweep_header_t {
+    uint8_t type;
+    uint32_t sweep_counter;
+    uint16_t count;
+};
+
+struct compact_stats_entry_t {
+    uint8_t channel;
+    uint8_t fiber;
+    uint8_t sensor;
+    uint32_t samples; // since the start or the last tare
+    double mean;
+    double std;
+    double ewma;
+    double min;       // sliding window
+    double max;
+    double base;      // calibration base wavelength
+    double force;     // of the EWMA
+};
+#pragma pack()
+
+I4_STATIC_ASSERT(sizeof(struct compact_layout_header_t) == COMPACT_LAYOUT_HEADER_SIZE, "compact layout header size");
+I4_STATIC_ASSERT(sizeof(struct compact_layout_entry_t) == COMPACT_LAYOUT_ENTRY_SIZE, "compact layout entry size");
+I4_STATIC_ASSERT(sizeof(struct compact_sweep_header_t) == COMPACT_SWEEP_HEADER_SIZE, "compact sweep header size");
+I4_STATIC_ASSERT(sizeof(struct compact_stats_entry_t) == COMPACT_STATS_ENTRY_SIZE, "compact stats entry size");
+
+// sender side copy of the last layout message
+struct compact_layout_t {
+    uint32_t count;
+    uint32_t capacity;
+    uint8_t* channel;
+    uint8_t* fiber;
+    uint8_t* sensor;
+    double* base;
+    int valid; // 0 until the first layout message is sent
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initCompactLayout, freeCompactLayout : Allocate/release the layout arrays.
+* compactLayoutMatches : Whether a decoded sweep has the same peak ids, in order, as the layout.
+* setCompactLayout : Takes the ids of a decoded sweep, and its values as INT32 bases.
+* compactLayoutSize, compactSweepSize, compactStatsSize : Message sizes in bytes.
+* encodeCompactLayout : Writes the layout message.
+* encodeCompactSweep : Writes the sweep message of one sweep's values.
+* ==============================================================================
+*/
+
+static inline void initCompactLayout(struct compact_layout_t* layout) {
+    layout->count = 0;
+    layout->capacity = 0;
+    layout->channel = NULL;
+    layout->fiber = NULL;
+    layout->sensor = NULL;
+    layout->base = NULL;
+    layout->valid = 0;
+}
+
+static inline void freeCompactLayout(struct compact_layout_t* layout) {
+    free(layout->channel);
+    free(layout->fiber);
+    free(layout->sensor);
+    free(layout->base);
+    initCompactLayout(layout);
+}
+
+static inline int compactLayoutMatches(const struct compact_layout_t* layout, const peak_batch_t* peaks) {
+    if (!layout->valid || layout->count != peaks->count) {
+        return 0;
+    }
+    return memcmp(layout->channel, peaks->channel, peaks->count) == 0
+        && memcmp(layout->fiber, peaks->fiber, peaks->count) == 0
+        && memcmp(layout->sensor, peaks->sensor, peaks->count) == 0;
+}
+
+/* returns 0, or -1 if the sweep has too many peaks or allocation failed */
+static inline int setCompactLayout(struct compact_layout_t* layout, const peak_batch_t* peaks, const double* values) {
+    if (peaks->count > COMPACT_MAX_SENSORS) {
+        fprintf(stderr, "Too many peaks for the compact layout (%u).\n", peaks->count);
+        return -1;
+    }
+    if (peaks->count > layout->capacity) {
+        uint8_t* channel = (uint8_t*)realloc(layout->channel, peaks->count);
+        if (channel != NULL) layout->channel = channel;
+        uint8_t* fiber = (uint8_t*)realloc(layout->fiber, peaks->count);
+        if (fiber != NULL) layout->fiber = fiber;
+        uint8_t* sensor = (uint8_t*)realloc(layout->sensor, peaks->count);
+        if (sensor != NULL) layout->sensor = sensor;
+        double* base = (double*)realloc(layout->base, peaks->count * sizeof(double));
+        if (base != NULL) layout->base = base;
+        if (channel == NULL || fiber == NULL || sensor == NULL || base == NULL) {
+            fprintf(stderr, "Compact layout allocation failed.\n");
+            return -1;
+        }
+        layout->capacity = peaks->count;
+    }
+
+    memcpy(layout->channel, peaks->channel, peaks->count);
+    memcpy(layout->fiber, peaks->fiber, peaks->count);
+    memcpy(layout->sensor, peaks->sensor, peaks->count);
+    memcpy(layout->base, values, peaks->count * sizeof(double));
+    layout->count = peaks->count;
+    layout->valid = 1;
+    return 0;
+}
+
+static inline uint32_t compactLayoutSize(uint32_t count) {
+    return COMPACT_LAYOUT_HEADER_SIZE + count * COMPACT_LAYOUT_ENTRY_SIZE;
+}
+
+static inline uint32_t compactSweepSize(uint32_t count) {
+    return COMPACT_SWEEP_HEADER_SIZE + count * COMPACT_VALUE_SIZE;
+}
+
+static inline uint32_t compactStatsSize(uint32_t count) {
+    return COMPACT_STATS_HEADER_SIZE + count * COMPACT_STATS_ENTRY_SIZE;
+}
+
+/* 'out' holds compactLayoutSize(layout->count) bytes, returns the bytes written */
+static inline uint32_t encodeCompactLayout(const struct compact_layout_t* layout, int encoding, char* out) {
+    struct compact_layout_header_t header;
+    header.type = COMPACT_MSG_LAYOUT;
+    header.encoding = (uint8_t)encoding;
+    header.count = (uint16_t)layout->count;
+    memcpy(out, &header, sizeof(header));
+
+    char* entry = out + COMPACT_LAYOUT_HEADER_SIZE;
+    for (uint32_t i = 0; i < layout->count; i++, entry += COMPACT_LAYOUT_ENTRY_SIZE) {
+        struct compact_layout_entry_t e;
+        e.channel = layout->channel[i];
+        e.fiber = layout->fiber[i];
+        e.sensor = layout->sensor[i];
+        e.base = layout->base[i];
+        memcpy(entry, &e, sizeof(e));
+    }
+    return compactLayoutSize(layout->count);
+}
+
+/* 'out' holds compactSweepSize(layout->count) bytes, 'values' is in layout order; returns the bytes written */
+static inline uint32_t encodeCompactSweep(const struct compact_layout_t* layout, int encoding, uint32_t sweep_counter,
+    const double* values, char* out) {
+    struct compact_sweep_header_t header;
+    header.type = COMPACT_MSG_SWEEP;
+    header.sweep_counter = sweep_counter;
+    header.count = (uint16_t)layout->count;
+    memcpy(out, &header, sizeof(header));
+
+    char* value = out + COMPACT_SWEEP_HEADER_SIZE;
+    if (encoding == COMPACT_ENCODING_FLOAT32) {
+        for (uint32_t i = 0; i < layout->count; i++, value += COMPACT_VALUE_SIZE) {
+            float v = (float)values[i];
+            memcpy(value, &v, sizeof(v));
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < layout->count; i++, value += COMPACT_VALUE_SIZE) {
+            double offset = nearbyint((values[i] - layout->base[i]) * COMPACT_INT32_SCALE);
+            // NaN fails both comparisons
+            int32_t v = (offset > (double)INT32_MIN && offset <= (double)INT32_MAX) ? (int32_t)offset : COMPACT_INT32_INVALID;
+            memcpy(value, &v, sizeof(v));
+        }
+    }
+    return compactSweepSize(layout->count);
+}
+
+#endif // FBG_COMPACT_PROTOCOL_H
@@ -0,0 +1,398 @@
+/*
+File    : force_filter.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only per-sensor filter chain of the forwarded values (C / C++)
+
+Filters the force (or wavelength) of every sensor at the full sweep rate and optionally
+decimates the output, so the main server gets clean values at a rate it can take :
+
+- stages, applied in order (at most FILTER_MAX_STAGES) :
+    lowpass:<fc Hz>[:<Q>]   biquad low-pass (RBJ cookbook, Q 0.7071 : Butterworth)
+    notch:<f0 Hz>[:<Q>]     biquad notch, e.g. mains pick-up (Q 10 by default)
+    average:<N>             moving average of the last N sweeps (N <= FILTER_MAX_AVERAGE)
+- decimate:<D>              only every D-th sweep is forwarded; put a low-pass or an
+                            average first, the filter does not add one by itself
+- spec : <sweep rate Hz>,<stage>[,<stage>..][,decimate:<D>], e.g. "5000,notch:50,lowpass:20,decimate:50"
+
+State is kept as structure of arrays, one array per state variable with one lane per
+sensor, so each stage runs over all sensors together (two lanes per SSE2 instruction).
+Sensors get a lane the first time they are seen and start in the steady state of that
+first value, so the output has no start-up transient. A sensor missing from a sweep, or
+NaN, holds its last valid value.
+
+A biquad runs in transposed direct form II :
+    y = b0 x + z1,  z1 = b1 x - a1 y + z2,  z2 = b2 x - a2 y
+*/
+
+#ifndef FORCE_FILTER_H
+#define FORCE_FILTER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+#include "i4_calibration.h"
+
+#if !defined(PEAK_DECODER_NO_SIMD) && defined(PEAK_DECODER_SSE2)
+#define FORCE_FILTER_SSE2
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define FILTER_MAX_STAGES 4
+#define FILTER_MAX_SENSORS 1024
+#define FILTER_MAX_AVERAGE 256
+#define FILTER_NO_LANE 0xffff
+#define FILTER_DEFAULT_LOWPASS_Q 0.7071
+#define FILTER_DEFAULT_NOTCH_Q 10.0
+
+#define FILTER_STAGE_LOWPASS 0
+#define FILTER_STAGE_NOTCH 1
+#define FILTER_STAGE_AVERAGE 2
+
+struct filter_stage_config_t {
+    int type;
+    double frequency_hz;   // biquads
+    double q;
+    uint32_t length;       // average
+};
+
+struct filter_config_t {
+    double rate_hz;        // sweep rate
+    struct filter_stage_config_t stages[FILTER_MAX_STAGES];
+    uint32_t stage_count;
+    uint32_t decimation;   // 1 : every sweep
+};
+
+struct filter_stage_t {
+    int type;
+    double b0, b1, b2, a1, a2; // normalised by a0
+    double* z1;            // [FILTER_MAX_SENSORS]
+    double* z2;
+    // average
+    uint32_t length;
+    uint32_t cursor;
+    double* history;       // [length][FILTER_MAX_SENSORS]
+    double* sum;
+};
+
+struct force_filter_t {
+    struct filter_config_t config;
+    struct filter_stage_t stages[FILTER_MAX_STAGES];
+    uint16_t* index;       // [CALIB_TABLE_SIZE], lane of (channel, fiber, sensor) or FILTER_NO_LANE
+    uint32_t count;        // lanes in use
+    double* input;         // [FILTER_MAX_SENSORS], last valid value of each lane
+    double* output;
+    uint64_t sweeps;
+    uint64_t untracked;    // values of sensors beyond FILTER_MAX_SENSORS, forwarded unfiltered
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* parseFilterConfig : Reads "<sweep rate Hz>,<stage>[,<stage>..][,decimate:<D>]".
+* describeFilterConfig : One-line summary of a chain.
+* initForceFilter, freeForceFilter : Allocate/release the lanes of all stages, compute the biquad coefficients.
+* filterBiquadCoefficients : Low-pass / notch coefficients for fs, f and Q.
+* filterLane : Lane of (channel, fiber, sensor), added in the steady state of its first value; -1 if none.
+* filterBiquad_run, filterAverage_run : One stage over lanes [0, count), in place.
+* forceFilter_apply : Filters the values of one sweep in place, returns whether the sweep is forwarded.
+* ==============================================================================
+*/
+
+/* returns 0, or -1 if the text is not a valid chain */
+static inline int parseFilterConfig(struct filter_config_t* config, const char* text) {
+    char* end;
+    config->rate_hz = strtod(text, &end);
+    config->stage_count = 0;
+    config->decimation = 1;
+    if (end == text || !(config->rate_hz > 0)) {
+        return -1;
+    }
+
+    while (*end == ',') {
+        const char* item = end + 1;
+        size_t length = strcspn(item, ":,");
+        if (item[length] != ':') {
+            return -1;
+        }
+        const char* arguments = item + length + 1;
+        double first = strtod(arguments, &end);
+        if (end == arguments) {
+            return -1;
+        }
+        double second = NAN;
+        if (*end == ':') {
+            const char* next = end + 1;
+            second = strtod(next, &end);
+            if (end == next || !(second > 0)) {
+                return -1;
+            }
+        }
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+
+        if (length == 8 && strncmp(item, "decimate", 8) == 0) {
+            if (first < 1 || !isnan(second)) {
+                return -1;
+            }
+            config->decimation = (uint32_t)first;
+            continue;
+        }
+        if (config->stage_count == FILTER_MAX_STAGES) {
+            return -1;
+        }
+        struct filter_stage_config_t* stage = &config->stages[config->stage_count++];
+        if (length == 7 && strncmp(item, "lowpass", 7) == 0) {
+            stage->type = FILTER_STAGE_LOWPASS;
+            stage->q = isnan(second) ? FILTER_DEFAULT_LOWPASS_Q : second;
+        }
+        else if (length == 5 && strncmp(item, "notch", 5) == 0) {
+            stage->type = FILTER_STAGE_NOTCH;
+            stage->q = isnan(second) ? FILTER_DEFAULT_NOTCH_Q : second;
+        }
+        else if (length == 7 && strncmp(item, "average", 7) == 0) {
+            if (first < 1 || first > FILTER_MAX_AVERAGE || !isnan(second)) {
+                return -1;
+            }
+            stage->type = FILTER_STAGE_AVERAGE;
+            stage->length = (uint32_t)first;
+            continue;
+        }
+        else {
+            return -1;
+        }
+        if (!(first > 0) || first >= config->rate_hz / 2) {
+            return -1; // above Nyquist
+        }
+        stage->frequency_hz = first;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+static inline void describeFilterConfig(const struct filter_config_t* config, char* text, size_t size) {
+    int used = snprintf(text, size, "%.0f Hz :", config->rate_hz);
+    for (uint32_t k = 0; k < config->stage_count && used > 0 && (size_t)used < size; k++) {
+        const struct filter_stage_config_t* stage = &config->stages[k];
+        if (stage->type == FILTER_STAGE_AVERAGE) {
+            used += snprintf(text + used, size - used, " average %u,", stage->length);
+        }
+        else {
+            used += snprintf(text + used, size - used, " %s %.3g Hz (Q %.3g),",
+                stage->type == FILTER_STAGE_LOWPASS ? "lowpass" : "notch", stage->frequency_hz, stage->q);
+        }
+    }
+    if (used > 0 && (size_t)used < size) {
+        snprintf(text + used, size - used, " 1 of %u sweeps forwarded", config->decimation);
+    }
+}
+
+static inline void filterBiquadCoefficients(struct filter_stage_t* stage, int type, double rate_hz, double frequency_hz, double q) {
+    double w0 = 2.0 * M_PI * frequency_hz / rate_hz;
+    double cos_w0 = cos(w0);
+    double alpha = sin(w0) / (2.0 * q);
+    double a0 = 1.0 + alpha;
+    if (type == FILTER_STAGE_LOWPASS) {
+        stage->b0 = (1.0 - cos_w0) / 2.0 / a0;
+        stage->b1 = (1.0 - cos_w0) / a0;
+        stage->b2 = stage->b0;
+    }
+    else {
+        stage->b0 = 1.0 / a0;
+        stage->b1 = -2.0 * cos_w0 / a0;
+        stage->b2 = stage->b0;
+    }
+    stage->a1 = -2.0 * cos_w0 / a0;
+    stage->a2 = (1.0 - alpha) / a0;
+}
+
+static inline void freeForceFilter(struct force_filter_t* filter) {
+    for (uint32_t k = 0; k < FILTER_MAX_STAGES; k++) {
+        free(filter->stages[k].z1);
+        free(filter->stages[k].z2);
+        free(filter->stages[k].history);
+        free(filter->stages[k].sum);
+        filter->stages[k].z1 = NULL;
+        filter->stages[k].z2 = NULL;
+        filter->stages[k].history = NULL;
+        filter->stages[k].sum = NULL;
+    }
+    free(filter->index);
+    free(filter->input);
+    free(filter->output);
+    filter->index = NULL;
+    filter->input = NULL;
+    filter->output = NULL;
+    filter->count = 0;
+}
+
+/* returns 0, or -1 if allocation failed */
+static inline int initForceFilter(struct force_filter_t* filter, const struct filter_config_t* config) {
+    filter->config = *config;
+    filter->count = 0;
+    filter->sweeps = 0;
+    filter->untracked = 0;
+    filter->index = (uint16_t*)malloc(CALIB_TABLE_SIZE * sizeof(uint16_t));
+    filter->input = (double*)calloc(FILTER_MAX_SENSORS, sizeof(double));
+    filter->output = (double*)calloc(FILTER_MAX_SENSORS, sizeof(double));
+    int failed = filter->index == NULL || filter->input == NULL || filter->output == NULL;
+
+    for (uint32_t k = 0; k < FILTER_MAX_STAGES; k++) {
+        struct filter_stage_t* stage = &filter->stages[k];
+        stage->z1 = NULL;
+        stage->z2 = NULL;
+        stage->history = NULL;
+        stage->sum = NULL;
+        if (k >= config->stage_count) {
+            continue;
+        }
+        const struct filter_stage_config_t* stage_config = &config->stages[k];
+        stage->type = stage_config->type;
+        if (stage->type == FILTER_STAGE_AVERAGE) {
+            stage->length = stage_config->length;
+            stage->cursor = 0;
+            stage->history = (double*)calloc((size_t)stage->length * FILTER_MAX_SENSORS, sizeof(double));
+            stage->sum = (double*)calloc(FILTER_MAX_SENSORS, sizeof(double));
+            failed |= stage->history == NULL || stage->sum == NULL;
+        }
+        else {
+            filterBiquadCoefficients(stage, stage->type, config->rate_hz, stage_config->frequency_hz, stage_config->q);
+            stage->z1 = (double*)calloc(FILTER_MAX_SENSORS, sizeof(double));
+            stage->z2 = (double*)calloc(FILTER_MAX_SENSORS, sizeof(double));
+            failed |= stage->z1 == NULL || stage->z2 == NULL;
+        }
+    }
+    if (failed) {
+        fprintf(stderr, "Filter allocation failed.\n");
+        freeForceFilter(filter);
+        return -1;
+    }
+    for (uint32_t i = 0; i < CALIB_TABLE_SIZE; i++) {
+        filter->index[i] = FILTER_NO_LANE;
+    }
+    return 0;
+}
+
+/* returns the lane, or -1 if the ids are out of range or all lanes are taken */
+static inline int32_t filterLane(struct force_filter_t* filter, uint8_t channel, uint8_t fiber, uint8_t sensor, double value) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0) {
+        return -1;
+    }
+    if (filter->index[index] != FILTER_NO_LANE) {
+        return filter->index[index];
+    }
+    if (filter->count == FILTER_MAX_SENSORS || isnan(value)) {
+        return -1;
+    }
+
+    // steady state of 'value' in every stage (all stages have unit DC gain)
+    uint32_t lane = filter->count++;
+    filter->index[index] = (uint16_t)lane;
+    filter->input[lane] = value;
+    for (uint32_t k = 0; k < filter->config.stage_count; k++) {
+        struct filter_stage_t* stage = &filter->stages[k];
+        if (stage->type == FILTER_STAGE_AVERAGE) {
+            for (uint32_t h = 0; h < stage->length; h++) {
+                stage->history[(size_t)h * FILTER_MAX_SENSORS + lane] = value;
+            }
+            stage->sum[lane] = value * stage->length;
+        }
+        else {
+            stage->z2[lane] = (stage->b2 - stage->a2) * value;
+            stage->z1[lane] = value - stage->b0 * value;
+        }
+    }
+    return (int32_t)lane;
+}
+
+static inline void filterBiquad_run(const struct filter_stage_t* stage, double* values, uint32_t count) {
+    double* z1 = stage->z1;
+    double* z2 = stage->z2;
+    uint32_t s = 0;
+#if defined(FORCE_FILTER_SSE2)
+    const __m128d b0 = _mm_set1_pd(stage->b0), b1 = _mm_set1_pd(stage->b1), b2 = _mm_set1_pd(stage->b2);
+    const __m128d a1 = _mm_set1_pd(stage->a1), a2 = _mm_set1_pd(stage->a2);
+    for (; s + 2 <= count; s += 2) {
+        __m128d x = _mm_loadu_pd(values + s);
+        __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), _mm_loadu_pd(z1 + s));
+        _mm_storeu_pd(z1 + s, _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), _mm_loadu_pd(z2 + s)));
+        _mm_storeu_pd(z2 + s, _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y)));
+        _mm_storeu_pd(values + s, y);
+    }
+#endif
+    for (; s < count; s++) {
+        double x = values[s];
+        double y = stage->b0 * x + z1[s];
+        z1[s] = stage->b1 * x - stage->a1 * y + z2[s];
+        z2[s] = stage->b2 * x - stage->a2 * y;
+        values[s] = y;
+    }
+}
+
+static inline void filterAverage_run(struct filter_stage_t* stage, double* values, uint32_t count) {
+    double* oldest = stage->history + (size_t)stage->cursor * FILTER_MAX_SENSORS;
+    double* sum = stage->sum;
+    double scale = 1.0 / stage->length;
+    uint32_t s = 0;
+#if defined(FORCE_FILTER_SSE2)
+    const __m128d scale2 = _mm_set1_pd(scale);
+    for (; s + 2 <= count; s += 2) {
+        __m128d x = _mm_loadu_pd(values + s);
+        __m128d total = _mm_add_pd(_mm_loadu_pd(sum + s), _mm_sub_pd(x, _mm_loadu_pd(oldest + s)));
+        _mm_storeu_pd(sum + s, total);
+        _mm_storeu_pd(oldest + s, x);
+        _mm_storeu_pd(values + s, _mm_mul_pd(total, scale2));
+    }
+#endif
+    for (; s < count; s++) {
+        double x = values[s];
+        sum[s] += x - oldest[s];
+        oldest[s] = x;
+        values[s] = sum[s] * scale;
+    }
+    stage->cursor = stage->cursor + 1 == stage->length ? 0 : stage->cursor + 1;
+}
+
+/* values[i] of peak i, replaced by its filtered value; returns 1 if the sweep is forwarded, 0 if decimated away */
+static inline int forceFilter_apply(struct force_filter_t* filter, const peak_batch_t* peaks, double* values) {
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        int32_t lane = filterLane(filter, peaks->channel[i], peaks->fiber[i], peaks->sensor[i], values[i]);
+        if (lane < 0) {
+            filter->untracked++;
+        }
+        else if (!isnan(values[i])) {
+            filter->input[lane] = values[i];
+        }
+    }
+
+    memcpy(filter->output, filter->input, filter->count * sizeof(double));
+    for (uint32_t k = 0; k < filter->config.stage_count; k++) {
+        if (filter->stages[k].type == FILTER_STAGE_AVERAGE) {
+            filterAverage_run(&filter->stages[k], filter->output, filter->count);
+        }
+        else {
+            filterBiquad_run(&filter->stages[k], filter->output, filter->count);
+        }
+    }
+
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        int32_t index = calibrationIndex(peaks->channel[i], peaks->fiber[i], peaks->sensor[i]);
+        if (index >= 0 && filter->index[index] != FILTER_NO_LANE) {
+            values[i] = filter->output[filter->index[index]];
+        }
+    }
+    return filter->sweeps++ % filter->config.decimation == 0;
+}
+
+#endif // FORCE_FILTER_H
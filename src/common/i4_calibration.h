@@ -0,0 +1,243 @@
+/*
+File    : i4_calibration.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only per-sensor FBG force calibration table (C / C++)
+
+Per (channel, fiber, sensor) base wavelength and gain, loaded once from a
+config file. The force model of calibrationForce() in read_peak_data.c
+
+    strain = (wavelength - base) / base / (1 - P_epsilon)
+    force  = strain * gain                                  [mN]
+
+is folded into one multiply-add per peak, force = wavelength * scale + offset,
+with scale = gain / (base * (1 - P_epsilon)) and offset = -base * scale.
+Uncalibrated sensors hold NaN coefficients, so their force comes out NaN
+without a branch in the batch loop.
+
+Config file : one sensor per line, '#' starts a comment
+    channel fiber sensor base_wavelength_nm [gain_mN [P_epsilon]]
+ids are the raw ids reported by the I4 (0-based).
+*/
+
+#ifndef I4_CALIBRATION_H
+#define I4_CALIBRATION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+
+#define CALIB_MAX_CHANNELS 4
+#define CALIB_MAX_FIBERS 16
+#define CALIB_MAX_SENSORS 256
+#define CALIB_TABLE_SIZE (CALIB_MAX_CHANNELS * CALIB_MAX_FIBERS * CALIB_MAX_SENSORS)
+
+#define CALIB_DEFAULT_P_EPSILON 0.28
+#define CALIB_DEFAULT_GAIN (460.0 * 0.02986 * 1000.0) // mN per unit strain (1 / K[/N] * 1000)
+
+// fused multiply-add pair of one sensor
+struct calibration_coeff_t {
+    double scale;  // mN / nm
+    double offset; // mN
+};
+
+struct calibration_table_t {
+    struct calibration_coeff_t* coeff; // [CALIB_TABLE_SIZE], hot path
+    double* base_wavelength;           // nm, NaN if uncalibrated
+    double* gain;                      // mN per unit strain
+    double* p_epsilon;                 // photo-elastic coefficient
+    uint32_t sensors;                  // calibrated entries
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initCalibration, freeCalibration : Allocate/release the table (all sensors uncalibrated).
+* copyCalibration : Allocates 'table' as a copy of 'source' (a thread that tares gets its own).
+* calibrationIndex : Table index of (channel, fiber, sensor), or -1 if out of range.
+* setCalibration : Sets one sensor and precomputes its coefficient pair.
+* rebaseCalibration : Replaces the base wavelength of one sensor (tare) and recomputes its coefficients.
+* loadCalibration : Reads sensors from a config file.
+* calibrationForce : Force in mN of one peak.
+* calibrationForce_batch : Force in mN of all peaks of a decoded sweep.
+* ==============================================================================
+*/
+
+static inline int initCalibration(struct calibration_table_t* table) {
+    table->coeff = (struct calibration_coeff_t*)malloc(CALIB_TABLE_SIZE * sizeof(struct calibration_coeff_t));
+    table->base_wavelength = (double*)malloc(CALIB_TABLE_SIZE * sizeof(double));
+    table->gain = (double*)malloc(CALIB_TABLE_SIZE * sizeof(double));
+    table->p_epsilon = (double*)malloc(CALIB_TABLE_SIZE * sizeof(double));
+    table->sensors = 0;
+    if (table->coeff == NULL || table->base_wavelength == NULL || table->gain == NULL || table->p_epsilon == NULL) {
+        fprintf(stderr, "Calibration table allocation failed.\n");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < CALIB_TABLE_SIZE; i++) {
+        table->coeff[i].scale = NAN;
+        table->coeff[i].offset = NAN;
+        table->base_wavelength[i] = NAN;
+        table->gain[i] = CALIB_DEFAULT_GAIN;
+        table->p_epsilon[i] = CALIB_DEFAULT_P_EPSILON;
+    }
+    return 0;
+}
+
+static inline void freeCalibration(struct calibration_table_t* table) {
+    free(table->coeff);
+    free(table->base_wavelength);
+    free(table->gain);
+    free(table->p_epsilon);
+    table->coeff = NULL;
+    table->base_wavelength = NULL;
+    table->gain = NULL;
+    table->p_epsilon = NULL;
+    table->sensors = 0;
+}
+
+/* returns 0, or -1 if allocation failed */
+static inline int copyCalibration(struct calibration_table_t* table, const struct calibration_table_t* source) {
+    if (initCalibration(table) != 0) {
+        freeCalibration(table);
+        return -1;
+    }
+    memcpy(table->coeff, source->coeff, CALIB_TABLE_SIZE * sizeof(struct calibration_coeff_t));
+    memcpy(table->base_wavelength, source->base_wavelength, CALIB_TABLE_SIZE * sizeof(double));
+    memcpy(table->gain, source->gain, CALIB_TABLE_SIZE * sizeof(double));
+    memcpy(table->p_epsilon, source->p_epsilon, CALIB_TABLE_SIZE * sizeof(double));
+    table->sensors = source->sensors;
+    return 0;
+}
+
+static inline int32_t calibrationIndex(uint32_t channel, uint32_t fiber, uint32_t sensor) {
+    if (channel >= CALIB_MAX_CHANNELS || fiber >= CALIB_MAX_FIBERS || sensor >= CALIB_MAX_SENSORS) {
+        return -1;
+    }
+    return (int32_t)((channel * CALIB_MAX_FIBERS + fiber) * CALIB_MAX_SENSORS + sensor);
+}
+
+static inline void updateCalibrationCoeff(struct calibration_table_t* table, int32_t index) {
+    double base = table->base_wavelength[index];
+    double scale = table->gain[index] / (base * (1 - table->p_epsilon[index]));
+    table->coeff[index].scale = scale;
+    table->coeff[index].offset = -base * scale;
+}
+
+static inline int setCalibration(struct calibration_table_t* table, uint32_t channel, uint32_t fiber, uint32_t sensor,
+    double base_wavelength_nm, double gain_mN, double p_epsilon) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0 || !(base_wavelength_nm > 0) || !(p_epsilon < 1)) {
+        return -1;
+    }
+
+    if (isnan(table->base_wavelength[index])) {
+        table->sensors++;
+    }
+    table->base_wavelength[index] = base_wavelength_nm;
+    table->gain[index] = gain_mN;
+    table->p_epsilon[index] = p_epsilon;
+    updateCalibrationCoeff(table, index);
+    return 0;
+}
+
+static inline int rebaseCalibration(struct calibration_table_t* table, uint32_t channel, uint32_t fiber, uint32_t sensor,
+    double base_wavelength_nm) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0 || isnan(table->base_wavelength[index]) || !(base_wavelength_nm > 0)) {
+        return -1;
+    }
+    table->base_wavelength[index] = base_wavelength_nm;
+    updateCalibrationCoeff(table, index);
+    return 0;
+}
+
+/* returns the number of sensors read, or -1 if the file can't be opened or has a bad line */
+static inline int loadCalibration(struct calibration_table_t* table, const char* path) {
+    FILE* file = NULL;
+#ifdef _MSC_VER
+    if (fopen_s(&file, path, "r") != 0) {
+        file = NULL;
+    }
+#else
+    file = fopen(path, "r");
+#endif
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open calibration file %s\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0, loaded = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        // channel fiber sensor base_wavelength_nm [gain_mN [P_epsilon]]
+        double values[6];
+        int count = 0;
+        char* cursor = line;
+        while (count < 6) {
+            char* end;
+            double value = strtod(cursor, &end);
+            if (end == cursor) {
+                break;
+            }
+            values[count++] = value;
+            cursor = end;
+        }
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') {
+            cursor++;
+        }
+        if (count == 0 && *cursor == '\0') {
+            continue; // blank or comment line
+        }
+
+        double gain = count > 4 ? values[4] : CALIB_DEFAULT_GAIN;
+        double p_epsilon = count > 5 ? values[5] : CALIB_DEFAULT_P_EPSILON;
+        if (count < 4 || *cursor != '\0' || values[0] < 0 || values[1] < 0 || values[2] < 0
+            || setCalibration(table, (uint32_t)values[0], (uint32_t)values[1], (uint32_t)values[2], values[3], gain, p_epsilon) != 0) {
+            fprintf(stderr, "%s:%d : invalid calibration line\n", path, line_number);
+            fclose(file);
+            return -1;
+        }
+        loaded++;
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+static inline double calibrationForce(const struct calibration_table_t* table, uint8_t channel, uint8_t fiber, uint8_t sensor,
+    double wavelength_nm) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0) {
+        return NAN;
+    }
+    return wavelength_nm * table->coeff[index].scale + table->coeff[index].offset; // mN
+}
+
+/* force[i] in mN for every peak of the batch, NaN for uncalibrated sensors */
+static inline void calibrationForce_batch(const struct calibration_table_t* table, const peak_batch_t* peaks, double* force) {
+    const struct calibration_coeff_t* coeff = table->coeff;
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        // channel is 4 bits on the wire, the table only covers CALIB_MAX_CHANNELS
+        uint32_t channel = peaks->channel[i];
+        uint32_t index = ((channel & (CALIB_MAX_CHANNELS - 1)) * CALIB_MAX_FIBERS + peaks->fiber[i]) * CALIB_MAX_SENSORS
+            + peaks->sensor[i];
+        double value = peaks->wavelength[i] * coeff[index].scale + coeff[index].offset;
+        force[i] = channel < CALIB_MAX_CHANNELS ? value : NAN;
+    }
+}
+
+#endif // I4_CALIBRATION_H
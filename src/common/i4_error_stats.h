@@ -0,0 +1,131 @@
+/*
+File    : i4_error_stats.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Header-only I4 error payload counters (C / C++)
+
+Deduplicates I4 error payloads by (error id, channel, fiber, sensor) so a
+sensor that keeps reporting "Missing Peak" is printed once in full and then only
+counted. Internal errors name no source, so they are keyed by their error id only.
+Fixed-size table, no allocation.
+*/
+
+#ifndef I4_ERROR_STATS_H
+#define I4_ERROR_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "i4_protocol.h"
+
+#define I4_ERROR_STATS_SLOTS 64 // distinct error sources tracked
+
+struct i4_error_entry_t {
+    uint32_t error_id;
+    uint8_t channel, fiber, sensor;
+    uint8_t used;
+    uint64_t count;
+};
+
+struct i4_error_stats_t {
+    struct i4_error_entry_t entries[I4_ERROR_STATS_SLOTS];
+    uint64_t total;
+    uint64_t missing_peak;   // error id 500
+    uint64_t multiple_peaks; // error id 501
+    uint64_t internal;       // any other error id
+    uint64_t untracked;      // counted in total, but the source table was full
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initErrorStats : Clears all counters.
+* countPacket_errorPayload : Counts one error payload, returns how often its source was seen.
+* errorTypeName : Short name of an error id.
+* printErrorStats : Prints one line per error source with its count.
+* ==============================================================================
+*/
+
+static inline void initErrorStats(struct i4_error_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+/* returns the occurrence count of this error source (1 on first occurrence), 0 if the table is full */
+static inline uint64_t countPacket_errorPayload(struct i4_error_stats_t* stats, const char* error_payload) {
+    uint32_t error_id;
+    uint8_t channel, fiber, sensor;
+    decodePacket_errorPayload(error_payload, &error_id, &channel, &fiber, &sensor);
+
+    stats->total++;
+    if (error_id == I4_ERROR_MISSING_PEAK) {
+        stats->missing_peak++;
+    }
+    else if (error_id == I4_ERROR_MULTIPLE_PEAKS) {
+        stats->multiple_peaks++;
+    }
+    else {
+        stats->internal++;
+        channel = fiber = sensor = 0; // no source, one entry per error id
+    }
+
+    // open addressing on the source key
+    uint32_t key = (error_id * 2654435761u) ^ ((uint32_t)channel << 12) ^ ((uint32_t)fiber << 8) ^ sensor;
+    for (uint32_t probe = 0; probe < I4_ERROR_STATS_SLOTS; probe++) {
+        struct i4_error_entry_t* entry = &stats->entries[(key + probe) % I4_ERROR_STATS_SLOTS];
+        if (!entry->used) {
+            entry->used = 1;
+            entry->error_id = error_id;
+            entry->channel = channel;
+            entry->fiber = fiber;
+            entry->sensor = sensor;
+        }
+        else if (entry->error_id != error_id || entry->channel != channel || entry->fiber != fiber || entry->sensor != sensor) {
+            continue;
+        }
+        return ++entry->count;
+    }
+
+    stats->untracked++;
+    return 0;
+}
+
+static inline const char* errorTypeName(uint32_t error_id) {
+    if (error_id == I4_ERROR_MISSING_PEAK) {
+        return "Missing Peak";
+    }
+    else if (error_id == I4_ERROR_MULTIPLE_PEAKS) {
+        return "Multiple Peaks";
+    }
+    return "Internal Error";
+}
+
+static inline void printErrorStats(const struct i4_error_stats_t* stats) {
+    if (stats->total == 0) {
+        return;
+    }
+    printf("Errors : %llu total (Missing Peak %llu, Multiple Peaks %llu, Internal %llu)\n",
+        (unsigned long long)stats->total, (unsigned long long)stats->missing_peak,
+        (unsigned long long)stats->multiple_peaks, (unsigned long long)stats->internal);
+    for (uint32_t i = 0; i < I4_ERROR_STATS_SLOTS; i++) {
+        const struct i4_error_entry_t* entry = &stats->entries[i];
+        if (!entry->used) {
+            continue;
+        }
+        if (entry->error_id == I4_ERROR_MISSING_PEAK || entry->error_id == I4_ERROR_MULTIPLE_PEAKS) {
+            printf("  %s : Sensor #%u, Fiber #%u, Channel #%u x %llu\n", errorTypeName(entry->error_id),
+                entry->sensor, entry->fiber, entry->channel, (unsigned long long)entry->count);
+        }
+        else {
+            printf("  %s (%u) x %llu\n", errorTypeName(entry->error_id), entry->error_id,
+                (unsigned long long)entry->count);
+        }
+    }
+    if (stats->untracked != 0) {
+        printf("  (%llu errors from further sources)\n", (unsigned long long)stats->untracked);
+    }
+}
+
+#endif // I4_ERROR_STATS_H
@@ -0,0 +1,530 @@
+/*
+File    : i4_management.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only client of the I4 Management API (REST / JSON over HTTP) (C / C++)
+
+Reads and updates the settings of an I4 (docs/FAZT_I4_Management_API_Reference_Guide.pdf) :
+
+- GET / PUT /api/v1/Settings              : wavelengthDownSamplingRate (every n-th sweep is sent),
+                                            wavelengthFilterType / wavelengthCutOffPoint (butterworth),
+                                            wavelengthSamplingRate (read only)
+- GET / PUT /api/v1/Channels/<0..3>       : spectral (peak or spectral sensors), spectralRate (4 or 16 Hz)
+
+Updates are read-modify-write, as the API asks : the current resource is read, the changed
+settings are replaced in its JSON text, and the whole resource goes back. Every other value,
+and so the 17 significant digits of its floats, is sent back as read. Nested resources
+("fibers" of a channel) are removed before the PUT, nested updates are refused by the I4.
+
+The API has no CREATE / DELETE and no per-sensor enable, so the sensor set of a fiber can't be
+changed from here; the load of the streams is set through the downsampling.
+
+One request per connection (Connection: close), the calling thread waits for the answer :
+call it at startup or from a thread of its own, never on the forwarding path.
+
+    struct i4_management_t management;
+    initManagement(&management, "10.100.51.16", MANAGEMENT_DEFAULT_PORT);
+    managementSetDownsampling(&management, 2);
+*/
+
+#ifndef I4_MANAGEMENT_H
+#define I4_MANAGEMENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "platform_socket.h"
+
+#define MANAGEMENT_DEFAULT_PORT 80
+#define MANAGEMENT_TIMEOUT_MS 2000
+#define MANAGEMENT_ADDRESS_SIZE 64
+#define MANAGEMENT_PATH_SIZE 64
+#define MANAGEMENT_INITIAL_RESPONSE (64 * 1024) // a channel response holds the fit arrays of its sensors
+#define MANAGEMENT_VALUE_SIZE 32
+#define MANAGEMENT_CHANNELS 4
+#define MANAGEMENT_MAX_DOWNSAMPLING 1000
+#define MANAGEMENT_UNCHANGED -1
+
+#define MANAGEMENT_SETTINGS_PATH "/api/v1/Settings"
+#define MANAGEMENT_CHANNEL_PATH "/api/v1/Channels/%u"
+
+struct i4_management_t {
+    char address[MANAGEMENT_ADDRESS_SIZE];
+    uint16_t port;
+    char* response;           // head and body of the last answer, NUL terminated
+    uint32_t response_size;
+    uint32_t response_capacity;
+    const char* body;         // in 'response'
+    char* update;             // resource being modified
+    uint32_t update_capacity;
+    uint64_t requests;
+    uint64_t failures;        // no answer, or not 200
+};
+
+// settings applied at startup, MANAGEMENT_UNCHANGED : left as the I4 has them
+struct management_config_t {
+    uint16_t port;
+    int32_t downsampling;     // every n-th sweep
+    double cutoff_hz;         // butterworth, 0 : no filter, NaN : unchanged
+    int32_t spectral_rate[MANAGEMENT_CHANNELS]; // 0 : peak sensors, 4 / 16 : spectral at that rate
+    uint32_t adapt_max;       // > 0 : downsampling raised up to this when sweeps are dropped
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* jsonFindMember : Start of the top-level member "key" of a JSON object, its value and value length.
+* jsonFindValue : Value text of the top-level member "key", or NULL.
+* jsonReplaceValue, jsonRemoveMember : Edit one top-level member of a JSON object in place.
+* initManagement, freeManagement : Set the I4 address / release the buffers.
+* managementRequest : One HTTP request, returns the status code of the answer.
+* managementUpdate : Read-modify-write of the top-level settings of one resource.
+* managementSetDownsampling, managementSetCutoff, managementSetSpectral : The settings of the forwarder.
+* managementReadRate : Sampling rate and downsampling the I4 is running at.
+* initManagementConfig, parseManagementConfig : Reads "setting=value[,setting=value..]".
+* applyManagementConfig : Writes the startup settings to one I4.
+* ==============================================================================
+*/
+
+/* end of the JSON value starting at 'value' (string, object, array or literal) */
+static inline const char* jsonValueEnd(const char* value) {
+    const char* p = value;
+    if (*p == '"') {
+        for (p++; *p != '\0' && *p != '"'; p++) {
+            if (*p == '\\' && p[1] != '\0') {
+                p++;
+            }
+        }
+        return *p == '"' ? p + 1 : p;
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        for (; *p != '\0'; p++) {
+            if (*p == '"') {
+                p = jsonValueEnd(p) - 1;
+            }
+            else if (*p == '{' || *p == '[') {
+                depth++;
+            }
+            else if ((*p == '}' || *p == ']') && --depth == 0) {
+                return p + 1;
+            }
+        }
+        return p;
+    }
+    while (*p != '\0' && *p != ',' && *p != '}' && *p != ']' && !isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+/* returns the opening quote of the key, or NULL if the object has no such top-level member */
+static inline const char* jsonFindMember(const char* json, const char* key, const char** value, uint32_t* length) {
+    size_t key_length = strlen(key);
+    int depth = 0;
+    for (const char* p = json; *p != '\0'; p++) {
+        if (*p == '"') {
+            const char* start = p;
+            const char* end = jsonValueEnd(p);
+            const char* q = end;
+            while (isspace((unsigned char)*q)) {
+                q++;
+            }
+            if (depth == 1 && *q == ':' && (size_t)(end - start) == key_length + 2 && strncmp(start + 1, key, key_length) == 0) {
+                q++;
+                while (isspace((unsigned char)*q)) {
+                    q++;
+                }
+                *value = q;
+                *length = (uint32_t)(jsonValueEnd(q) - q);
+                return start;
+            }
+            p = end - 1;
+        }
+        else if (*p == '{' || *p == '[') {
+            depth++;
+        }
+        else if (*p == '}' || *p == ']') {
+            depth--;
+        }
+    }
+    return NULL;
+}
+
+static inline const char* jsonFindValue(const char* json, const char* key, uint32_t* length) {
+    const char* value;
+    return jsonFindMember(json, key, &value, length) != NULL ? value : NULL;
+}
+
+/* 'text' is the new JSON value; returns 0, or -1 if the member is missing or 'json' has no room */
+static inline int jsonReplaceValue(char* json, uint32_t capacity, const char* key, const char* text) {
+    const char* value;
+    uint32_t length;
+    if (jsonFindMember(json, key, &value, &length) == NULL) {
+        return -1;
+    }
+    size_t text_length = strlen(text);
+    size_t json_length = strlen(json);
+    if (json_length - length + text_length + 1 > capacity) {
+        return -1;
+    }
+    char* start = json + (value - json);
+    memmove(start + text_length, start + length, json_length - (start - json) - length + 1);
+    memcpy(start, text, text_length);
+    return 0;
+}
+
+/* returns 0, or -1 if the object has no such member */
+static inline int jsonRemoveMember(char* json, const char* key) {
+    const char* value;
+    uint32_t length;
+    const char* member = jsonFindMember(json, key, &value, &length);
+    if (member == NULL) {
+        return -1;
+    }
+    char* begin = json + (member - json);
+    char* end = json + (value - json) + length;
+    char* after = end;
+    while (isspace((unsigned char)*after)) {
+        after++;
+    }
+    if (*after == ',') {
+        end = after + 1; // "key": value, next
+    }
+    else {
+        // last member : its leading comma goes
+        while (begin > json && isspace((unsigned char)begin[-1])) {
+            begin--;
+        }
+        if (begin > json && begin[-1] == ',') {
+            begin--;
+        }
+    }
+    memmove(begin, end, strlen(end) + 1);
+    return 0;
+}
+
+static inline void freeManagement(struct i4_management_t* management) {
+    free(management->response);
+    free(management->update);
+    management->response = NULL;
+    management->update = NULL;
+    management->response_capacity = 0;
+    management->update_capacity = 0;
+}
+
+/* returns 0, or -1 if allocation failed */
+static inline int initManagement(struct i4_management_t* management, const char* address, uint16_t port) {
+    snprintf(management->address, sizeof(management->address), "%s", address);
+    management->port = port;
+    management->response = (char*)malloc(MANAGEMENT_INITIAL_RESPONSE);
+    management->update = (char*)malloc(MANAGEMENT_INITIAL_RESPONSE);
+    management->response_size = 0;
+    management->response_capacity = MANAGEMENT_INITIAL_RESPONSE;
+    management->update_capacity = MANAGEMENT_INITIAL_RESPONSE;
+    management->body = NULL;
+    management->requests = 0;
+    management->failures = 0;
+    if (management->response == NULL || management->update == NULL) {
+        fprintf(stderr, "Management buffer allocation failed.\n");
+        freeManagement(management);
+        return -1;
+    }
+    management->response[0] = '\0';
+    return 0;
+}
+
+/* reads the whole answer into management->response; returns 0, or -1 on timeout / error */
+static inline int managementReceive(struct i4_management_t* management, SOCKET hSocket) {
+    management->response_size = 0;
+    management->response[0] = '\0';
+    uint32_t expected = 0; // head + Content-Length, 0 until the head is in
+    while (expected == 0 || management->response_size < expected) {
+        if (management->response_size + 1 >= management->response_capacity) {
+            char* grown = (char*)realloc(management->response, management->response_capacity * 2);
+            if (grown == NULL) {
+                return -1;
+            }
+            management->response = grown;
+            management->response_capacity *= 2;
+        }
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(hSocket, &readable);
+        struct timeval timeout;
+        timeout.tv_sec = MANAGEMENT_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (MANAGEMENT_TIMEOUT_MS % 1000) * 1000;
+        if (select((int)hSocket + 1, &readable, NULL, NULL, &timeout) <= 0) {
+            return -1;
+        }
+        int bytesRead = recv(hSocket, management->response + management->response_size,
+            (int)(management->response_capacity - 1 - management->response_size), 0);
+        if (bytesRead <= 0) {
+            return expected == 0 && management->response_size > 0 ? 0 : -1; // closed : the answer had no Content-Length
+        }
+        management->response_size += bytesRead;
+        management->response[management->response_size] = '\0';
+
+        const char* separator = strstr(management->response, "\r\n\r\n");
+        if (expected == 0 && separator != NULL) {
+            const char* content_length = NULL;
+            for (const char* line = strstr(management->response, "\r\n"); line != NULL && line < separator; line = strstr(line + 2, "\r\n")) {
+                if (strncmp(line + 2, "Content-Length:", 15) == 0 || strncmp(line + 2, "content-length:", 15) == 0) {
+                    content_length = line + 17;
+                }
+            }
+            if (content_length != NULL) {
+                expected = (uint32_t)(separator + 4 - management->response) + (uint32_t)strtoul(content_length, NULL, 10);
+            }
+        }
+    }
+    return 0;
+}
+
+/* 'body' may be NULL; returns the HTTP status, or -1 if the I4 did not answer */
+static inline int managementRequest(struct i4_management_t* management, const char* method, const char* path, const char* body) {
+    management->requests++;
+    management->body = NULL;
+    SOCKET hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (hSocket == INVALID_SOCKET) {
+        management->failures++;
+        return -1;
+    }
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(management->port);
+    if (inet_pton(AF_INET, management->address, &address.sin_addr) <= 0
+        || connect(hSocket, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR) {
+        fprintf(stderr, "Management API of %s:%u unreachable.\n", management->address, management->port);
+        closesocket(hSocket);
+        management->failures++;
+        return -1;
+    }
+
+    size_t body_length = body != NULL ? strlen(body) : 0;
+    char head[256];
+    int head_length = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nAccept: application/json\r\n"
+        "Content-Type: application/json\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+        method, path, management->address, (unsigned)body_length);
+    const char* parts[2] = { head, body };
+    int lengths[2] = { head_length, (int)body_length };
+    for (int p = 0; p < 2; p++) {
+        int sent = 0;
+        while (sent < lengths[p]) {
+            int bytesSent = send(hSocket, parts[p] + sent, lengths[p] - sent, 0);
+            if (bytesSent <= 0) {
+                closesocket(hSocket);
+                management->failures++;
+                return -1;
+            }
+            sent += bytesSent;
+        }
+    }
+    int received = managementReceive(management, hSocket);
+    closesocket(hSocket);
+
+    int status = -1;
+    if (received == 0 && sscanf(management->response, "HTTP/%*d.%*d %d", &status) == 1) {
+        const char* separator = strstr(management->response, "\r\n\r\n");
+        management->body = separator != NULL ? separator + 4 : management->response + management->response_size;
+    }
+    if (status != 200) {
+        management->failures++;
+        if (status < 0) {
+            fprintf(stderr, "Management API : no answer to %s %s.\n", method, path);
+            return -1;
+        }
+        // {"error": {"code": .., "message": ".."}}
+        uint32_t length = 0;
+        const char* error = jsonFindValue(management->body, "error", &length);
+        const char* message = error != NULL ? jsonFindValue(error, "message", &length) : NULL;
+        fprintf(stderr, "Management API : %s %s -> %d %.*s\n", method, path, status,
+            message != NULL ? (int)length : 0, message != NULL ? message : "");
+    }
+    return status;
+}
+
+/* replaces 'count' top-level settings ('values' as JSON text) of the resource, without its nested 'nested' member;
+   returns 0, or -1 if it could not be read or written */
+static inline int managementUpdate(struct i4_management_t* management, const char* path, const char* nested,
+    uint32_t count, const char* const* keys, const char* const* values) {
+    if (managementRequest(management, "GET", path, NULL) != 200) {
+        return -1;
+    }
+    uint32_t length = (uint32_t)strlen(management->body);
+    uint32_t needed = length + 1 + count * MANAGEMENT_VALUE_SIZE;
+    if (needed > management->update_capacity) {
+        char* grown = (char*)realloc(management->update, needed);
+        if (grown == NULL) {
+            return -1;
+        }
+        management->update = grown;
+        management->update_capacity = needed;
+    }
+    memcpy(management->update, management->body, length + 1);
+    if (nested != NULL) {
+        jsonRemoveMember(management->update, nested);
+    }
+    for (uint32_t k = 0; k < count; k++) {
+        if (jsonReplaceValue(management->update, management->update_capacity, keys[k], values[k]) != 0) {
+            fprintf(stderr, "Management API : %s has no setting '%s'.\n", path, keys[k]);
+            return -1;
+        }
+    }
+    return managementRequest(management, "PUT", path, management->update) == 200 ? 0 : -1;
+}
+
+/* every n-th sweep is sent; returns 0 or -1 */
+static inline int managementSetDownsampling(struct i4_management_t* management, uint32_t downsampling) {
+    char value[MANAGEMENT_VALUE_SIZE];
+    snprintf(value, sizeof(value), "%u", downsampling);
+    const char* keys[1] = { "wavelengthDownSamplingRate" };
+    const char* values[1] = { value };
+    return managementUpdate(management, MANAGEMENT_SETTINGS_PATH, NULL, 1, keys, values);
+}
+
+/* butterworth cut-off of all sensors, 0 : no filter; returns 0 or -1 */
+static inline int managementSetCutoff(struct i4_management_t* management, double cutoff_hz) {
+    char value[MANAGEMENT_VALUE_SIZE];
+    snprintf(value, sizeof(value), "%.17g", cutoff_hz);
+    const char* keys[2] = { "wavelengthFilterType", "wavelengthCutOffPoint" };
+    const char* values[2] = { cutoff_hz > 0 ? "\"butterworth\"" : "\"none\"", value };
+    return managementUpdate(management, MANAGEMENT_SETTINGS_PATH, NULL, cutoff_hz > 0 ? 2 : 1, keys, values);
+}
+
+/* rate 0 : peak sensors, 4 or 16 [Hz] : spectral sensors sampled at that rate; returns 0 or -1 */
+static inline int managementSetSpectral(struct i4_management_t* management, uint32_t channel, uint32_t rate) {
+    char path[MANAGEMENT_PATH_SIZE];
+    snprintf(path, sizeof(path), MANAGEMENT_CHANNEL_PATH, channel);
+    const char* keys[2] = { "spectral", "spectralRate" };
+    char value[MANAGEMENT_VALUE_SIZE];
+    snprintf(value, sizeof(value), "%u", rate);
+    const char* values[2] = { rate > 0 ? "true" : "false", value };
+    return managementUpdate(management, path, "fibers", rate > 0 ? 2 : 1, keys, values);
+}
+
+/* returns 0, or -1 if the settings could not be read */
+static inline int managementReadRate(struct i4_management_t* management, double* sampling_hz, uint32_t* downsampling) {
+    if (managementRequest(management, "GET", MANAGEMENT_SETTINGS_PATH, NULL) != 200) {
+        return -1;
+    }
+    uint32_t length;
+    const char* rate = jsonFindValue(management->body, "wavelengthSamplingRate", &length);
+    const char* every = jsonFindValue(management->body, "wavelengthDownSamplingRate", &length);
+    if (rate == NULL || every == NULL) {
+        return -1;
+    }
+    *sampling_hz = strtod(rate, NULL);
+    *downsampling = (uint32_t)strtoul(every, NULL, 10);
+    return 0;
+}
+
+static inline void initManagementConfig(struct management_config_t* config) {
+    config->port = MANAGEMENT_DEFAULT_PORT;
+    config->downsampling = MANAGEMENT_UNCHANGED;
+    config->cutoff_hz = NAN;
+    for (int c = 0; c < MANAGEMENT_CHANNELS; c++) {
+        config->spectral_rate[c] = MANAGEMENT_UNCHANGED;
+    }
+    config->adapt_max = 0;
+}
+
+/* "port=<n>", "downsample=<n>", "cutoff=<Hz|none>", "spectral=<channel>:<4|16|off>", "adapt=<max downsample>",
+   separated by commas; returns 0, or -1 if the text is not valid */
+static inline int parseManagementConfig(struct management_config_t* config, const char* text) {
+    const char* item = text;
+    while (*item != '\0') {
+        size_t length = strcspn(item, ",");
+        const char* equals = (const char*)memchr(item, '=', length);
+        if (equals == NULL) {
+            return -1;
+        }
+        size_t key_length = (size_t)(equals - item);
+        const char* value = equals + 1;
+        char* end;
+        long number = strtol(value, &end, 10);
+        if (key_length == 4 && strncmp(item, "port", 4) == 0) {
+            if (number <= 0 || number > 65535) {
+                return -1;
+            }
+            config->port = (uint16_t)number;
+        }
+        else if (key_length == 10 && strncmp(item, "downsample", 10) == 0) {
+            if (number < 1 || number > MANAGEMENT_MAX_DOWNSAMPLING) {
+                return -1;
+            }
+            config->downsampling = (int32_t)number;
+        }
+        else if (key_length == 5 && strncmp(item, "adapt", 5) == 0) {
+            if (number < 2 || number > MANAGEMENT_MAX_DOWNSAMPLING) {
+                return -1;
+            }
+            config->adapt_max = (uint32_t)number;
+        }
+        else if (key_length == 6 && strncmp(item, "cutoff", 6) == 0) {
+            if (strncmp(value, "none", 4) == 0) {
+                config->cutoff_hz = 0;
+                end = (char*)value + 4;
+            }
+            else {
+                config->cutoff_hz = strtod(value, &end);
+                if (!(config->cutoff_hz >= 1)) {
+                    return -1;
+                }
+            }
+        }
+        else if (key_length == 8 && strncmp(item, "spectral", 8) == 0) {
+            if (number < 0 || number >= MANAGEMENT_CHANNELS || *end != ':') {
+                return -1;
+            }
+            const char* rate = end + 1;
+            long spectral_rate = 0;
+            if (strncmp(rate, "off", 3) == 0) {
+                end = (char*)rate + 3;
+            }
+            else {
+                spectral_rate = strtol(rate, &end, 10);
+                if (spectral_rate != 4 && spectral_rate != 16) {
+                    return -1;
+                }
+            }
+            config->spectral_rate[number] = (int32_t)spectral_rate;
+        }
+        else {
+            return -1;
+        }
+        if (end != item + length) {
+            return -1;
+        }
+        item += length;
+        if (*item == ',') {
+            item++;
+        }
+    }
+    return 0;
+}
+
+/* returns 0, or -1 if a setting was refused or the I4 did not answer */
+static inline int applyManagementConfig(struct i4_management_t* management, const struct management_config_t* config) {
+    if (config->downsampling != MANAGEMENT_UNCHANGED && managementSetDownsampling(management, (uint32_t)config->downsampling) != 0) {
+        return -1;
+    }
+    if (!isnan(config->cutoff_hz) && managementSetCutoff(management, config->cutoff_hz) != 0) {
+        return -1;
+    }
+    for (uint32_t c = 0; c < MANAGEMENT_CHANNELS; c++) {
+        if (config->spectral_rate[c] != MANAGEMENT_UNCHANGED && managementSetSpectral(management, c, (uint32_t)config->spectral_rate[c]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#endif // I4_MANAGEMENT_H
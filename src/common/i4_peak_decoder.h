@@ -0,0 +1,274 @@
+/*
+File    : i4_peak_decoder.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only batch peak decoder (C / C++)
+Protocol    : FAZT I4 Data Transmission Format
+
+Decodes all peak payloads of a sweep into structure-of-arrays outputs.
+The SIMD kernels and the scalar reference (decodePeakRecord, built on the
+i4_protocol.h accessors) live side by side here, so this is the single place
+to benchmark or replace the peak decoder.
+Define PEAK_DECODER_NO_SIMD to force the scalar path.
+
+The kernel is written once with the record stride as a parameter and forced inline into
+one specialisation per payload type (decodePeakBatch_peak, decodePeakBatch_tspeak), so
+each gets its stride as a constant : loads, the id extraction and the time stamps are
+selected at compile time instead of per group of 4 peaks. decodeSweepPeaks() picks the
+specialisation once per sweep from the header's sweep type; a ts-peak sweep always goes
+through the 12-byte kernel and keeps its time stamps.
+*/
+
+#ifndef I4_PEAK_DECODER_H
+#define I4_PEAK_DECODER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "i4_protocol.h"
+
+#if !defined(PEAK_DECODER_NO_SIMD)
+#if defined(__AVX2__)
+#define PEAK_DECODER_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PEAK_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(PEAK_DECODER_AVX2)
+#include <immintrin.h>
+#endif
+#endif
+
+// specialised with a constant stride : always inlined into its callers
+#if defined(_MSC_VER)
+#define PEAK_DECODER_INLINE static __forceinline
+#elif defined(__GNUC__)
+#define PEAK_DECODER_INLINE static inline __attribute__((always_inline))
+#else
+#define PEAK_DECODER_INLINE static inline
+#endif
+
+// decoded peaks of one sweep, structure-of-arrays
+typedef struct peak_batch_t {
+    uint32_t count;
+    uint32_t capacity;
+    uint8_t* channel;
+    uint8_t* fiber;
+    uint8_t* sensor;
+    double* wavelength; // nm
+    double* timestamp;  // s (time-stamped peaks only, otherwise 0)
+} peak_batch_t;
+
+
+/* =============================================================================
+* Batch peak decoder
+* ------------------------------------------------------------------------------
+* decodePeakBatch : Decodes 'count' contiguous peak records (PEAK_PAYLOAD_SIZE or
+*                   TSPEAK_PAYLOAD_SIZE stride) into the structure-of-arrays batch.
+*                   The id mask (& ~0xffff | 0x7fff), the id shifts and the scale
+*                   to nm/s are done for 4 peaks at a time with SSE2 or AVX2.
+*                   Decodes at most batch->capacity records and never allocates.
+* decodePeakBatch_peak, decodePeakBatch_tspeak : The kernel specialised per stride.
+* decodeSweepPeaks : Decodes the payload of one sweep by its sweep type, -1 if it holds no peaks.
+* initPeakBatch, reservePeakBatch, freePeakBatch : Manage the batch arrays.
+* ==============================================================================
+*/
+
+static inline int reservePeakBatch(peak_batch_t* batch, uint32_t capacity) {
+    if (capacity <= batch->capacity) {
+        return 0;
+    }
+    uint8_t* channel = (uint8_t*)realloc(batch->channel, capacity);
+    if (channel != NULL) batch->channel = channel;
+    uint8_t* fiber = (uint8_t*)realloc(batch->fiber, capacity);
+    if (fiber != NULL) batch->fiber = fiber;
+    uint8_t* sensor = (uint8_t*)realloc(batch->sensor, capacity);
+    if (sensor != NULL) batch->sensor = sensor;
+    double* wavelength_nm = (double*)realloc(batch->wavelength, capacity * sizeof(double));
+    if (wavelength_nm != NULL) batch->wavelength = wavelength_nm;
+    double* timestamp_s = (double*)realloc(batch->timestamp, capacity * sizeof(double));
+    if (timestamp_s != NULL) batch->timestamp = timestamp_s;
+
+    if (channel == NULL || fiber == NULL || sensor == NULL || wavelength_nm == NULL || timestamp_s == NULL) {
+        fprintf(stderr, "Peak batch allocation failed.\n");
+        return -1;
+    }
+    batch->capacity = capacity;
+    return 0;
+}
+
+static inline void initPeakBatch(peak_batch_t* batch, uint32_t capacity) {
+    batch->count = 0;
+    batch->capacity = 0;
+    batch->channel = NULL;
+    batch->fiber = NULL;
+    batch->sensor = NULL;
+    batch->wavelength = NULL;
+    batch->timestamp = NULL;
+    reservePeakBatch(batch, capacity);
+}
+
+static inline void freePeakBatch(peak_batch_t* batch) {
+    free(batch->channel);
+    free(batch->fiber);
+    free(batch->sensor);
+    free(batch->wavelength);
+    free(batch->timestamp);
+    batch->channel = NULL;
+    batch->fiber = NULL;
+    batch->sensor = NULL;
+    batch->wavelength = NULL;
+    batch->timestamp = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
+}
+
+/* scalar reference for one record, also used for the tail of a batch */
+PEAK_DECODER_INLINE void decodePeakRecord(const char* record, uint32_t stride, peak_batch_t* batch, uint32_t i) {
+    ts_peak_data_t peak_data;
+    memcpy(peak_data, record, stride == TSPEAK_PAYLOAD_SIZE ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE);
+
+    batch->channel[i] = channel_id(peak_data);
+    batch->fiber[i] = fiber_id(peak_data);
+    batch->sensor[i] = sensor_id(peak_data);
+    batch->wavelength[i] = 1e9 * wavelength(peak_data); // nm
+    batch->timestamp[i] = stride == TSPEAK_PAYLOAD_SIZE ? time_stamp(peak_data) : 0; // s
+}
+
+#if defined(PEAK_DECODER_SSE2)
+/* ids of 4 peaks from their LSB words [lo0, lo1, lo2, lo3] */
+PEAK_DECODER_INLINE void decodePeakIds_x4(__m128i lo, peak_batch_t* batch, uint32_t i) {
+    const __m128i mask_0f = _mm_set1_epi32(0x0f);
+    const __m128i mask_ff = _mm_set1_epi32(0xff);
+    __m128i channel = _mm_and_si128(_mm_srli_epi32(lo, 12), mask_0f);
+    __m128i fiber = _mm_and_si128(_mm_srli_epi32(lo, 8), mask_0f);
+    __m128i sensor = _mm_and_si128(lo, mask_ff);
+
+    // 32 -> 8 bit, values are already in 0..255
+    int32_t c = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(channel, channel), channel));
+    int32_t f = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(fiber, fiber), fiber));
+    int32_t s = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(sensor, sensor), sensor));
+    memcpy(batch->channel + i, &c, 4);
+    memcpy(batch->fiber + i, &f, 4);
+    memcpy(batch->sensor + i, &s, 4);
+}
+
+/* time stamps of 4 ts-peaks, unsigned 32-bit counts of 0.5 ns */
+PEAK_DECODER_INLINE void decodePeakTimestamps_x4(const char* record, peak_batch_t* batch, uint32_t i) {
+    uint32_t ts[4];
+    for (int k = 0; k < 4; k++) {
+        memcpy(&ts[k], record + k * TSPEAK_PAYLOAD_SIZE + 8, sizeof(uint32_t));
+    }
+    // unsigned -> double via the signed conversion biased by 2^31
+    __m128i biased = _mm_xor_si128(_mm_loadu_si128((const __m128i*)ts), _mm_set1_epi32((int)0x80000000u));
+    const __m128d bias = _mm_set1_pd(2147483648.0);
+    const __m128d scale = _mm_set1_pd(5e-10);
+    __m128d t01 = _mm_add_pd(_mm_cvtepi32_pd(biased), bias);
+    __m128d t23 = _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, _MM_SHUFFLE(1, 0, 3, 2))), bias);
+    _mm_storeu_pd(batch->timestamp + i, _mm_mul_pd(t01, scale));
+    _mm_storeu_pd(batch->timestamp + i + 2, _mm_mul_pd(t23, scale));
+}
+
+/* two 8-byte peak words into one register, any stride */
+PEAK_DECODER_INLINE __m128i loadPeakWords_x2(const char* record, uint32_t stride) {
+    if (stride == PEAK_PAYLOAD_SIZE) {
+        return _mm_loadu_si128((const __m128i*)record);
+    }
+    return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)record),
+        _mm_loadl_epi64((const __m128i*)(record + stride)));
+}
+#endif
+
+/* the kernel, 'stride' a constant in each specialisation below */
+PEAK_DECODER_INLINE uint32_t decodePeakKernel(const char* records, uint32_t count, const uint32_t stride, peak_batch_t* batch) {
+    if (count > batch->capacity) {
+        count = batch->capacity; // zero-allocation : caller reserves the batch per sweep
+    }
+
+    uint32_t i = 0;
+#if defined(PEAK_DECODER_AVX2)
+    const __m256i id_mask = _mm256_set1_epi64x((long long)~0xffffULL);
+    const __m256i id_fill = _mm256_set1_epi64x(0x7fff);
+    const __m256d scale_nm = _mm256_set1_pd(1e9);
+    const __m256i lo_index = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    for (; i + 4 <= count; i += 4) {
+        const char* record = records + (size_t)i * stride;
+        __m256i peak = _mm256_set_m128i(loadPeakWords_x2(record + 2 * stride, stride),
+            loadPeakWords_x2(record, stride));
+
+        __m256i value = _mm256_or_si256(_mm256_and_si256(peak, id_mask), id_fill); /* mask out id bits */
+        _mm256_storeu_pd(batch->wavelength + i, _mm256_mul_pd(_mm256_castsi256_pd(value), scale_nm));
+
+        decodePeakIds_x4(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(peak, lo_index)), batch, i);
+        if (stride == TSPEAK_PAYLOAD_SIZE) {
+            decodePeakTimestamps_x4(record, batch, i);
+        }
+        else {
+            _mm256_storeu_pd(batch->timestamp + i, _mm256_setzero_pd());
+        }
+    }
+#elif defined(PEAK_DECODER_SSE2)
+    const __m128i id_mask = _mm_set_epi32(-1, (int)~0xffffu, -1, (int)~0xffffu);
+    const __m128i id_fill = _mm_set_epi32(0, 0x7fff, 0, 0x7fff);
+    const __m128d scale_nm = _mm_set1_pd(1e9);
+    for (; i + 4 <= count; i += 4) {
+        const char* record = records + (size_t)i * stride;
+        __m128i peak01 = loadPeakWords_x2(record, stride);
+        __m128i peak23 = loadPeakWords_x2(record + 2 * stride, stride);
+
+        __m128i value01 = _mm_or_si128(_mm_and_si128(peak01, id_mask), id_fill); /* mask out id bits */
+        __m128i value23 = _mm_or_si128(_mm_and_si128(peak23, id_mask), id_fill);
+        _mm_storeu_pd(batch->wavelength + i, _mm_mul_pd(_mm_castsi128_pd(value01), scale_nm));
+        _mm_storeu_pd(batch->wavelength + i + 2, _mm_mul_pd(_mm_castsi128_pd(value23), scale_nm));
+
+        __m128i lo = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(peak01), _mm_castsi128_ps(peak23),
+            _MM_SHUFFLE(2, 0, 2, 0)));
+        decodePeakIds_x4(lo, batch, i);
+        if (stride == TSPEAK_PAYLOAD_SIZE) {
+            decodePeakTimestamps_x4(record, batch, i);
+        }
+        else {
+            _mm_storeu_pd(batch->timestamp + i, _mm_setzero_pd());
+            _mm_storeu_pd(batch->timestamp + i + 2, _mm_setzero_pd());
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        decodePeakRecord(records + (size_t)i * stride, stride, batch, i);
+    }
+
+    batch->count = count;
+    return count;
+}
+
+static inline uint32_t decodePeakBatch_peak(const char* records, uint32_t count, peak_batch_t* batch) {
+    return decodePeakKernel(records, count, PEAK_PAYLOAD_SIZE, batch);
+}
+
+static inline uint32_t decodePeakBatch_tspeak(const char* records, uint32_t count, peak_batch_t* batch) {
+    return decodePeakKernel(records, count, TSPEAK_PAYLOAD_SIZE, batch);
+}
+
+static inline uint32_t decodePeakBatch(const char* records, uint32_t count, uint32_t stride, peak_batch_t* batch) {
+    return stride == TSPEAK_PAYLOAD_SIZE ? decodePeakBatch_tspeak(records, count, batch)
+        : decodePeakBatch_peak(records, count, batch);
+}
+
+/* returns the peaks decoded from the 'DL' payload bytes, or -1 for a sweep type without peaks (spectral) */
+static inline int decodeSweepPeaks(int sweep_type, const char* payload, uint32_t DL, peak_batch_t* batch) {
+    switch (sweep_type) {
+    case SWEEP_TYPE_PEAK:
+        return (int)decodePeakBatch_peak(payload, DL / PEAK_PAYLOAD_SIZE, batch);
+    case SWEEP_TYPE_TSPEAK:
+        return (int)decodePeakBatch_tspeak(payload, DL / TSPEAK_PAYLOAD_SIZE, batch);
+    default:
+        batch->count = 0;
+        return -1;
+    }
+}
+
+#endif // I4_PEAK_DECODER_H
@@ -0,0 +1,290 @@
+/*
+File    : i4_protocol.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only I4 data transmission format (C / C++)
+Protocol    : TCP/IP, FAZT I4 Data Transmission Format
+
+Shared packet layouts and decoders of the I4 Interrogator data stream, used by
+read_peak_data.c, read_spectral_data.c and client_FBGs_data_tx.cpp.
+Everything is inline and works on caller-owned buffers (no allocation).
+
+One sweep on the wire :
+- Header Packet (16 bytes): packet counter, sweeping type, trigger mode, data offset, data length, timestamp.
+- Error Packet (dataOffset - 16 bytes): 8-byte error payloads, only present if an error exists.
+- Payload Packet (dataLength bytes): peak (8), time-stamped peak (12) or spectral (8) payloads.
+- Flag Packet (8 bytes): sweep counter.
+*/
+
+#ifndef I4_PROTOCOL_H
+#define I4_PROTOCOL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// packet size
+#define HEADER_SIZE 16
+#define ERROR_PAYLOAD_SIZE 8
+#define PEAK_PAYLOAD_SIZE 8
+#define TSPEAK_PAYLOAD_SIZE 12
+#define SPECTRAL_PAYLOAD_SIZE 8
+#define FLAG_SIZE 8
+
+// sweeping type
+#define SWEEP_TYPE_PEAK 0
+#define SWEEP_TYPE_SPECTRAL 1
+#define SWEEP_TYPE_TSPEAK 2
+
+// error id
+#define I4_ERROR_MISSING_PEAK 500
+#define I4_ERROR_MULTIPLE_PEAKS 501
+
+#ifdef __cplusplus
+#define I4_CONSTEXPR constexpr
+#define I4_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define I4_CONSTEXPR
+#define I4_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#else
+#define I4_CONSTEXPR
+#define I4_STATIC_ASSERT_NAME(line) i4_static_assert_##line
+#define I4_STATIC_ASSERT_LINE(cond, line) typedef char I4_STATIC_ASSERT_NAME(line)[(cond) ? 1 : -1]
+#define I4_STATIC_ASSERT(cond, msg) I4_STATIC_ASSERT_LINE(cond, __LINE__)
+#endif
+
+#pragma pack(1)
+struct ts_peak_payload_t {
+    uint32_t ts_peak_payload_LSB : 32;
+    uint32_t ts_peak_payload_MSB : 32;
+    uint32_t time_stamp : 32;
+};
+struct peak_payload_t {
+    uint32_t peak_payload_LSB : 32;
+    uint32_t peak_payload_MSB : 32;
+};
+struct spectral_payload_info_t {
+    uint32_t spectral_payload_LSB : 32;
+    uint32_t spectral_payload_MSB : 32;
+};
+struct spectral_payload_t {
+    int16_t spectral_amplitude_1 : 16;
+    int16_t spectral_amplitude_2 : 16;
+    int16_t spectral_amplitude_3 : 16;
+    int16_t spectral_amplitude_4 : 16;
+};
+struct error_payload_t {
+    uint32_t error_id : 32;
+    uint32_t error_description : 32;
+};
+struct I4PacketHeader {
+    uint16_t info : 16; // packetCounter(12) + sweepingType(3) + triggerMode(1)
+    uint16_t dataOffset : 16;
+    uint32_t dataLength : 32;
+    uint64_t timeStamp : 64;
+};
+struct I4PacketFlag {
+    uint32_t sweep_counter : 32;
+    uint32_t reserved : 32;
+};
+#pragma pack()
+
+// wire layout checks
+I4_STATIC_ASSERT(sizeof(struct I4PacketHeader) == HEADER_SIZE, "I4PacketHeader must be 16 bytes");
+I4_STATIC_ASSERT(sizeof(struct error_payload_t) == ERROR_PAYLOAD_SIZE, "error_payload_t must be 8 bytes");
+I4_STATIC_ASSERT(sizeof(struct peak_payload_t) == PEAK_PAYLOAD_SIZE, "peak_payload_t must be 8 bytes");
+I4_STATIC_ASSERT(sizeof(struct ts_peak_payload_t) == TSPEAK_PAYLOAD_SIZE, "ts_peak_payload_t must be 12 bytes");
+I4_STATIC_ASSERT(sizeof(struct spectral_payload_info_t) == SPECTRAL_PAYLOAD_SIZE, "spectral_payload_info_t must be 8 bytes");
+I4_STATIC_ASSERT(sizeof(struct spectral_payload_t) == SPECTRAL_PAYLOAD_SIZE, "spectral_payload_t must be 8 bytes");
+I4_STATIC_ASSERT(sizeof(struct I4PacketFlag) == FLAG_SIZE, "I4PacketFlag must be 8 bytes");
+I4_STATIC_ASSERT(sizeof(double) == 2 * sizeof(uint32_t), "wavelength decoding needs a 64-bit double");
+
+typedef uint32_t peak_data_t[2];
+typedef uint32_t ts_peak_data_t[3];
+
+// decoded packet header
+struct i4_header_info_t {
+    uint16_t packetCounter; // 12 bits, wraps at 4096
+    uint8_t sweepingType;   // Peak(0), Spectral(1), Peak with timestamps(2)
+    uint8_t triggerMode;    // Internal trigger(0), External trigger(1)
+    uint16_t dataOffset;    // bytes from start of header to payload
+    uint32_t dataLength;    // payload bytes
+    uint64_t timeStamp;     // ns since 1900-01-01 (NTP epoch)
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* channel_id, fiber_id, sensor_id : Extract respective IDs from peak data.
+* wavelength : Extracts wavelength in meters from peak data.
+* time_stamp : Extracts time stamp in seconds from peak data.
+* processPacket_HeaderInfo : Extracts all packet header fields.
+* processPacket_Header : Extracts packet header info(type, offset, length).
+* processPacket_Payload : Extracts peak payload info(channel, fiber, sensor, wavelength[nm]).
+* processPacket_tsPayload : Extracts timestamp payload info(channel, fiber, sensor, wavelength[nm], time stamp[s]).
+* processPacket_spectralPayload_info : Extracts spectral info(channel, fiber, sensor, number of points).
+* processPacket_spectralPayload : Extracts four spectral amplitudes.
+* decodePacket_errorPayload : Extracts error id and source ids.
+* processPacket_errorPayload : Processes error payload and prints error details.
+* ==============================================================================
+*/
+
+static inline I4_CONSTEXPR uint8_t channel_id(const uint32_t* const peak_data) {
+    return (uint8_t)((peak_data[0] >> 12) & 0x0f);
+}
+
+static inline I4_CONSTEXPR uint8_t fiber_id(const uint32_t* const peak_data) {
+    return (uint8_t)((peak_data[0] >> 8) & 0x0f);
+}
+
+static inline I4_CONSTEXPR uint8_t sensor_id(const uint32_t* const peak_data) {
+    return (uint8_t)(peak_data[0] & 0xff);
+}
+
+/* extract wavelength value in meters */
+static inline double wavelength(const uint32_t* const peak_data) {
+    uint32_t peak_value[2];
+    peak_value[0] = (peak_data[0] & ~0xffffu) | 0x7fffu; /* mask out id bits */
+    peak_value[1] = peak_data[1];
+
+    double value;
+    memcpy(&value, peak_value, sizeof(value));
+    return value;
+}
+
+/* extract time stamp value in seconds */
+static inline I4_CONSTEXPR double time_stamp(const uint32_t* const peak_data) {
+    return (double)peak_data[2] * 5e-10;
+}
+
+static inline int processPacket_HeaderInfo(const char* buffer_header, struct i4_header_info_t* info) {
+    struct I4PacketHeader header;
+    memcpy(&header, buffer_header, sizeof(header));
+
+    // Packet Header (bit field mask)
+    const uint16_t packetCounterMask = 0xFFF; // lower 12 bits
+    const uint16_t sweepingTypeMask = 0x7000; // middle 3 bits
+    const uint16_t triggerModeMask = 0x8000;  // top 1 bit
+
+    info->packetCounter = (uint16_t)(header.info & packetCounterMask);
+    info->sweepingType = (uint8_t)((header.info & sweepingTypeMask) >> 12);
+    info->triggerMode = (uint8_t)((header.info & triggerModeMask) >> 15);
+    info->dataOffset = header.dataOffset; // 0~65535 byte offset
+    info->dataLength = header.dataLength; // bytes
+    info->timeStamp = header.timeStamp;
+
+    return 0;
+}
+
+static inline int processPacket_Header(const char* buffer_header, int* sweep_type, int* DO, int* DL) {
+    struct i4_header_info_t info;
+    processPacket_HeaderInfo(buffer_header, &info);
+
+    *sweep_type = info.sweepingType;
+    *DO = info.dataOffset;
+    *DL = (int)info.dataLength;
+
+    return 0;
+}
+
+static inline int processPacket_Payload(const char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data) {
+    peak_data_t peak_data;
+    memcpy(peak_data, buffer_payload, sizeof(peak_data));
+
+    *channel = channel_id(peak_data);
+    *fiber = fiber_id(peak_data);
+    *sensor = sensor_id(peak_data);
+    *wavelength_data = 1e9 * wavelength(peak_data); //nm
+
+    return 0;
+}
+
+static inline int processPacket_tsPayload(const char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data, double* time_stamp_data) {
+    ts_peak_data_t peak_data;
+    memcpy(peak_data, buffer_payload, sizeof(peak_data));
+
+    *channel = channel_id(peak_data);
+    *fiber = fiber_id(peak_data);
+    *sensor = sensor_id(peak_data);
+    *wavelength_data = 1e9 * wavelength(peak_data); //nm
+    *time_stamp_data = time_stamp(peak_data); //s
+
+    return 0;
+}
+
+static inline int processPacket_spectralPayload_info(const char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, uint32_t* num_points) {
+    uint32_t data[2];
+    memcpy(data, buffer_payload, sizeof(data));
+
+    *channel = channel_id(data);
+    *fiber = fiber_id(data);
+    *sensor = sensor_id(data);
+    *num_points = data[1];
+
+    return 0;
+}
+
+static inline int processPacket_spectralPayload(const char* buffer_payload, int16_t* data1, int16_t* data2, int16_t* data3, int16_t* data4) {
+    int16_t data[4];
+    memcpy(data, buffer_payload, sizeof(data));
+
+    *data1 = data[0];
+    *data2 = data[1];
+    *data3 = data[2];
+    *data4 = data[3];
+
+    return 0;
+}
+
+static inline int decodePacket_errorPayload(const char* error_payload, uint32_t* error_id, uint8_t* channel, uint8_t* fiber, uint8_t* sensor) {
+    struct error_payload_t payload;
+    memcpy(&payload, error_payload, sizeof(payload));
+
+    peak_data_t data;
+    data[1] = payload.error_id;
+    data[0] = payload.error_description;
+
+    *error_id = data[1];
+    *channel = channel_id(data);
+    *fiber = fiber_id(data);
+    *sensor = sensor_id(data);
+
+    return 0;
+}
+
+static inline int processPacket_errorPayload(const char* error_payload) {
+    uint32_t error_id;
+    uint8_t channel, fiber, sensor;
+    decodePacket_errorPayload(error_payload, &error_id, &channel, &fiber, &sensor);
+
+    if (error_id == I4_ERROR_MISSING_PEAK) {
+        printf("Error type : Missing Peak\n");
+        printf("Sensor #%u, Fiber #%u, Channel #%u\n", sensor, fiber, channel);
+        printf("Error source: No peak was detected where one was "
+            "expected from the interrogator configuration.\n"
+            "Possible causes include :\n"
+            "* Misconfiguration of sensor wavelength range or threshold\n"
+            "* disconnected sensor\n");
+    }
+    else if (error_id == I4_ERROR_MULTIPLE_PEAKS) {
+        printf("Error type : Multiple Peaks\n");
+        printf("Sensor #%u, Fiber #%u, Channel #%u\n", sensor, fiber, channel);
+        printf("Error source : More than the expected number of peaks was "
+            "detected in the sensors wavelength range.\n"
+            "Possible causes include :\n"
+            "* Misconfiguration of sensor wavelength range or threshold\n");
+    }
+    else {
+        printf("Error type : Internal Error\n");
+        printf("Error source: Internal error\n"
+            "Possible causes include :\n"
+            "* Transient mismatch of configuration and data stream\n"
+            "* Internal failure\n");
+    }
+
+    return 0;
+}
+
+#endif // I4_PROTOCOL_H
@@ -0,0 +1,446 @@
+/*
+File    : i4_recorder.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only memory-mapped raw I4 stream recorder and reader (C / C++)
+
+Records whole sweep frames (header + error payload + data payload + flag) byte
+for byte as received from the I4 into a preallocated, memory-mapped file:
+
+    <path>      : recording_header_t, padded to RECORDER_HEADER_SIZE, then the frames back to back
+    <path>.idx  : recording_index_header_t, then one recording_index_entry_t per frame
+                  (header timeStamp, offset in <path>, size, device)
+
+Frames are copied into the mapping sequentially; every RECORDER_FLUSH_BYTES the
+completed, page-aligned range is handed to the OS for write-back in one go
+(msync / FlushViewOfFile) instead of many small write() calls. The file is grown
+by RECORDER_GROW_BYTES when full and cut to the recorded size on close.
+The reader maps a recording read-only and loads its index, sorted by arrival
+(= time order per device), for playback and timestamp lookup.
+*/
+
+#ifndef I4_RECORDER_H
+#define I4_RECORDER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "i4_protocol.h"
+
+#define RECORDER_MAGIC "I4REC001"
+#define RECORDER_INDEX_MAGIC "I4IDX001"
+#define RECORDER_VERSION 1
+#define RECORDER_HEADER_SIZE 4096                     // frames start page aligned
+#define RECORDER_DEFAULT_RESERVE (1024ull * 1024 * 1024) // preallocated bytes
+#define RECORDER_GROW_BYTES (1024ull * 1024 * 1024)
+#define RECORDER_FLUSH_BYTES (64u * 1024 * 1024)
+#define RECORDER_PAGE_SIZE 65536                     // multiple of the page size / allocation granularity
+#define RECORDER_INDEX_BUFFER_SIZE (1024 * 1024)
+#define RECORDER_PATH_SIZE 512
+
+#pragma pack(1)
+struct recording_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;  // offset of the first frame
+    uint64_t data_bytes;   // frame bytes after header_size
+    uint64_t frames;
+    uint64_t first_ns;     // header timeStamp of the first / last frame
+    uint64_t last_ns;
+};
+struct recording_index_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+};
+struct recording_index_entry_t {
+    uint64_t timestamp_ns; // header timeStamp
+    uint64_t offset;       // in the recording file
+    uint32_t size;         // frame bytes
+    uint8_t device;        // I4 unit (index in the forwarder's -i list)
+    uint8_t sweep_type;
+    uint16_t reserved;
+};
+#pragma pack()
+
+I4_STATIC_ASSERT(sizeof(struct recording_index_entry_t) == 24, "recording_index_entry_t must be 24 bytes");
+
+struct i4_recorder_t {
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    char* base;            // mapping of the whole file
+    uint64_t mapped;       // mapped (= file) bytes
+    uint64_t used;         // header + recorded frames
+    uint64_t flushed;      // written back up to here
+    FILE* index;
+    char index_path[RECORDER_PATH_SIZE];
+    struct recording_header_t header;
+    int failed;            // a write failed, recording stopped
+};
+
+struct i4_recording_t {
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    const char* base;
+    uint64_t size;
+    const struct recording_header_t* header;
+    struct recording_index_entry_t* entries;
+    uint64_t count;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* recorderOpen : Creates <path> (preallocating 'reserve' bytes) and <path>.idx.
+* recorderWrite : Appends one frame and its index entry.
+* recorderClose : Writes back, cuts the file to the recorded size and closes both files.
+* recordingOpen, recordingClose : Map a recording read-only and load its index.
+* recordingFind : First index entry at or after a header timestamp.
+* recordingFrame : Bytes of one indexed frame.
+* ==============================================================================
+*/
+
+/* maps 'size' bytes of the recorder file, growing the file if needed, returns 0 or -1 */
+static inline int recorderMap(struct i4_recorder_t* recorder, uint64_t size) {
+#ifdef _WIN32
+    if (recorder->base != NULL) {
+        UnmapViewOfFile(recorder->base);
+        CloseHandle(recorder->mapping);
+    }
+    recorder->base = NULL;
+    recorder->mapping = CreateFileMappingA(recorder->file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (recorder->mapping == NULL) {
+        return -1;
+    }
+    recorder->base = (char*)MapViewOfFile(recorder->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+    if (recorder->base == NULL) {
+        CloseHandle(recorder->mapping);
+        recorder->mapping = NULL;
+        return -1;
+    }
+#else
+    if (recorder->base != NULL) {
+        munmap(recorder->base, recorder->mapped);
+    }
+    recorder->base = NULL;
+#if defined(__linux__)
+    if (posix_fallocate(recorder->fd, 0, (off_t)size) != 0 && ftruncate(recorder->fd, (off_t)size) != 0) {
+        return -1; // fallocate reserves the blocks, ftruncate only where it is unsupported
+    }
+#else
+    if (ftruncate(recorder->fd, (off_t)size) != 0) {
+        return -1;
+    }
+#endif
+    void* base = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, recorder->fd, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    recorder->base = (char*)base;
+#endif
+    recorder->mapped = size;
+    return 0;
+}
+
+/* writes back [flushed, up_to) of the mapping, up_to rounded down to RECORDER_PAGE_SIZE unless 'all' */
+static inline void recorderFlush(struct i4_recorder_t* recorder, uint64_t up_to, int all) {
+    if (!all) {
+        up_to -= up_to % RECORDER_PAGE_SIZE;
+    }
+    if (up_to <= recorder->flushed) {
+        return;
+    }
+    uint64_t from = recorder->flushed - recorder->flushed % RECORDER_PAGE_SIZE;
+#ifdef _WIN32
+    FlushViewOfFile(recorder->base + from, (SIZE_T)(up_to - from));
+#else
+    msync(recorder->base + from, (size_t)(up_to - from), all ? MS_SYNC : MS_ASYNC);
+#endif
+    recorder->flushed = up_to;
+}
+
+static inline void recorderClose(struct i4_recorder_t* recorder) {
+    if (recorder->base != NULL) {
+        recorder->header.data_bytes = recorder->used - RECORDER_HEADER_SIZE;
+        memcpy(recorder->base, &recorder->header, sizeof(recorder->header));
+        recorder->flushed = 0;
+        recorderFlush(recorder, recorder->used, 1);
+#ifdef _WIN32
+        UnmapViewOfFile(recorder->base);
+        CloseHandle(recorder->mapping);
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)recorder->used;
+        SetFilePointerEx(recorder->file, end, NULL, FILE_BEGIN);
+        SetEndOfFile(recorder->file);
+#else
+        munmap(recorder->base, recorder->mapped);
+        if (ftruncate(recorder->fd, (off_t)recorder->used) != 0) {
+            fprintf(stderr, "Can't cut the recording to %llu bytes.\n", (unsigned long long)recorder->used);
+        }
+#endif
+        recorder->base = NULL;
+    }
+#ifdef _WIN32
+    if (recorder->file != NULL && recorder->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(recorder->file);
+    }
+    recorder->file = NULL;
+#else
+    if (recorder->fd > 0) {
+        close(recorder->fd);
+    }
+    recorder->fd = -1;
+#endif
+    if (recorder->index != NULL) {
+        fclose(recorder->index);
+        recorder->index = NULL;
+    }
+}
+
+/* returns 0, or -1 if a file can't be created or mapped */
+static inline int recorderOpen(struct i4_recorder_t* recorder, const char* path, uint64_t reserve) {
+    memset(recorder, 0, sizeof(*recorder));
+    size_t length = strlen(path);
+    if (length + 5 > RECORDER_PATH_SIZE) {
+        fprintf(stderr, "Recording path too long.\n");
+        return -1;
+    }
+    memcpy(recorder->index_path, path, length);
+    memcpy(recorder->index_path + length, ".idx", 5);
+
+#ifdef _WIN32
+    recorder->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (recorder->file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Can't create recording %s.\n", path);
+        recorderClose(recorder);
+        return -1;
+    }
+#else
+    recorder->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (recorder->fd < 0) {
+        fprintf(stderr, "Can't create recording %s.\n", path);
+        recorderClose(recorder);
+        return -1;
+    }
+#endif
+#ifdef _MSC_VER
+    if (fopen_s(&recorder->index, recorder->index_path, "wb") != 0) {
+        recorder->index = NULL;
+    }
+#else
+    recorder->index = fopen(recorder->index_path, "wb");
+#endif
+    reserve = reserve < RECORDER_HEADER_SIZE + RECORDER_PAGE_SIZE ? RECORDER_HEADER_SIZE + RECORDER_PAGE_SIZE : reserve;
+    reserve += (RECORDER_PAGE_SIZE - reserve % RECORDER_PAGE_SIZE) % RECORDER_PAGE_SIZE;
+    if (recorder->index == NULL || recorderMap(recorder, reserve) != 0) {
+        fprintf(stderr, "Can't create recording %s (%llu bytes).\n", path, (unsigned long long)reserve);
+        recorderClose(recorder);
+        return -1;
+    }
+    setvbuf(recorder->index, NULL, _IOFBF, RECORDER_INDEX_BUFFER_SIZE);
+
+    struct recording_index_header_t index_header;
+    memcpy(index_header.magic, RECORDER_INDEX_MAGIC, sizeof(index_header.magic));
+    index_header.version = RECORDER_VERSION;
+    index_header.entry_size = sizeof(struct recording_index_entry_t);
+    fwrite(&index_header, sizeof(index_header), 1, recorder->index);
+
+    memcpy(recorder->header.magic, RECORDER_MAGIC, sizeof(recorder->header.magic));
+    recorder->header.version = RECORDER_VERSION;
+    recorder->header.header_size = RECORDER_HEADER_SIZE;
+    memset(recorder->base, 0, RECORDER_HEADER_SIZE);
+    recorder->used = RECORDER_HEADER_SIZE;
+    return 0;
+}
+
+/* returns 0, or -1 if the recording failed (then it stays stopped) */
+static inline int recorderWrite(struct i4_recorder_t* recorder, uint8_t device, const char* frame, uint32_t size) {
+    if (recorder->failed) {
+        return -1;
+    }
+    if (recorder->used + size > recorder->mapped) {
+        uint64_t grown = recorder->mapped + RECORDER_GROW_BYTES;
+        while (grown < recorder->used + size) {
+            grown += RECORDER_GROW_BYTES;
+        }
+        recorderFlush(recorder, recorder->used, 0);
+        if (recorderMap(recorder, grown) != 0) {
+            fprintf(stderr, "Recording stopped, can't grow the file to %llu bytes.\n", (unsigned long long)grown);
+            recorder->failed = 1;
+            return -1;
+        }
+    }
+
+    struct i4_header_info_t info;
+    processPacket_HeaderInfo(frame, &info);
+    struct recording_index_entry_t entry;
+    entry.timestamp_ns = info.timeStamp;
+    entry.offset = recorder->used;
+    entry.size = size;
+    entry.device = device;
+    entry.sweep_type = info.sweepingType;
+    entry.reserved = 0;
+    if (fwrite(&entry, sizeof(entry), 1, recorder->index) != 1) {
+        fprintf(stderr, "Recording stopped, index write failed.\n");
+        recorder->failed = 1;
+        return -1;
+    }
+
+    memcpy(recorder->base + recorder->used, frame, size);
+    recorder->used += size;
+    if (recorder->header.frames == 0) {
+        recorder->header.first_ns = info.timeStamp;
+    }
+    recorder->header.last_ns = info.timeStamp;
+    recorder->header.frames++;
+    if (recorder->used - recorder->flushed >= RECORDER_FLUSH_BYTES) {
+        recorderFlush(recorder, recorder->used, 0);
+    }
+    return 0;
+}
+
+static inline void recordingClose(struct i4_recording_t* recording) {
+#ifdef _WIN32
+    if (recording->base != NULL) UnmapViewOfFile(recording->base);
+    if (recording->mapping != NULL) CloseHandle(recording->mapping);
+    if (recording->file != NULL && recording->file != INVALID_HANDLE_VALUE) CloseHandle(recording->file);
+    recording->mapping = NULL;
+    recording->file = NULL;
+#else
+    if (recording->base != NULL) munmap((void*)recording->base, recording->size);
+    if (recording->fd > 0) close(recording->fd);
+    recording->fd = -1;
+#endif
+    free(recording->entries);
+    recording->base = NULL;
+    recording->header = NULL;
+    recording->entries = NULL;
+    recording->count = 0;
+}
+
+/* returns 0, or -1 if the files are missing or not a recording */
+static inline int recordingOpen(struct i4_recording_t* recording, const char* path) {
+    memset(recording, 0, sizeof(*recording));
+    char index_path[RECORDER_PATH_SIZE];
+    size_t length = strlen(path);
+    if (length + 5 > RECORDER_PATH_SIZE) {
+        fprintf(stderr, "Recording path too long.\n");
+        return -1;
+    }
+    memcpy(index_path, path, length);
+    memcpy(index_path + length, ".idx", 5);
+
+#ifdef _WIN32
+    recording->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER size;
+    if (recording->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(recording->file, &size) || size.QuadPart < RECORDER_HEADER_SIZE) {
+        fprintf(stderr, "Can't open recording %s.\n", path);
+        recordingClose(recording);
+        return -1;
+    }
+    recording->size = (uint64_t)size.QuadPart;
+    recording->mapping = CreateFileMappingA(recording->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    recording->base = recording->mapping != NULL ? (const char*)MapViewOfFile(recording->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    recording->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (recording->fd < 0 || fstat(recording->fd, &st) != 0 || st.st_size < RECORDER_HEADER_SIZE) {
+        fprintf(stderr, "Can't open recording %s.\n", path);
+        recordingClose(recording);
+        return -1;
+    }
+    recording->size = (uint64_t)st.st_size;
+    void* base = mmap(NULL, (size_t)recording->size, PROT_READ, MAP_SHARED, recording->fd, 0);
+    recording->base = base != MAP_FAILED ? (const char*)base : NULL;
+    if (recording->base != NULL) {
+        madvise(base, (size_t)recording->size, MADV_SEQUENTIAL);
+    }
+#endif
+    recording->header = (const struct recording_header_t*)recording->base;
+    if (recording->base == NULL || memcmp(recording->header->magic, RECORDER_MAGIC, 8) != 0
+        || recording->header->header_size + recording->header->data_bytes > recording->size) {
+        fprintf(stderr, "%s is not a complete I4 recording.\n", path);
+        recordingClose(recording);
+        return -1;
+    }
+
+    FILE* index = NULL;
+#ifdef _MSC_VER
+    if (fopen_s(&index, index_path, "rb") != 0) {
+        index = NULL;
+    }
+#else
+    index = fopen(index_path, "rb");
+#endif
+    struct recording_index_header_t index_header;
+    if (index == NULL || fread(&index_header, sizeof(index_header), 1, index) != 1
+        || memcmp(index_header.magic, RECORDER_INDEX_MAGIC, 8) != 0 || index_header.entry_size != sizeof(struct recording_index_entry_t)) {
+        fprintf(stderr, "Can't read index %s.\n", index_path);
+        if (index != NULL) fclose(index);
+        recordingClose(recording);
+        return -1;
+    }
+    recording->entries = (struct recording_index_entry_t*)malloc((size_t)recording->header->frames * sizeof(struct recording_index_entry_t) + 1);
+    if (recording->entries != NULL) {
+        recording->count = fread(recording->entries, sizeof(struct recording_index_entry_t), (size_t)recording->header->frames, index);
+    }
+    fclose(index);
+    if (recording->entries == NULL || recording->count != recording->header->frames) {
+        fprintf(stderr, "Index %s is incomplete.\n", index_path);
+        recordingClose(recording);
+        return -1;
+    }
+    for (uint64_t i = 0; i < recording->count; i++) {
+        const struct recording_index_entry_t* entry = &recording->entries[i];
+        if (entry->offset < RECORDER_HEADER_SIZE || entry->size < HEADER_SIZE + FLAG_SIZE || entry->offset + entry->size > recording->size) {
+            fprintf(stderr, "Index %s does not match the recording (entry %llu).\n", index_path, (unsigned long long)i);
+            recordingClose(recording);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* returns the first entry at or after 'timestamp_ns', 'count' if none
+   (entries are in arrival order : exact per device, within the network skew across devices) */
+static inline uint64_t recordingFind(const struct i4_recording_t* recording, uint64_t timestamp_ns) {
+    uint64_t lo = 0, hi = recording->count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (recording->entries[mid].timestamp_ns < timestamp_ns) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline const char* recordingFrame(const struct i4_recording_t* recording, uint64_t entry) {
+    return recording->base + recording->entries[entry].offset;
+}
+
+#endif // I4_RECORDER_H
@@ -0,0 +1,286 @@
+/*
+File    : i4_stream_generator.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Header-only synthetic I4 sweep generator (C / C++)
+Protocol    : FAZT I4 Data Transmission Format
+
+Builds complete sweep frames (header, error payloads, peak or spectral payloads, flag) the
+way the interrogator sends them, for benchmarks and tests without a physical interrogator :
+
+- generator_config_t : peaks per sweep (spread over channels / sensors like a real
+  array), peak, time-stamped peak or spectral payloads, sweep rate (timestamps and tick
+  counter) and the fraction of sweeps carrying error payloads (Missing Peak, Multiple
+  Peaks, Internal, in that proportion 3 : 1 : 1, or only the one error_id).
+- Wavelengths move around their sensor's base with a small per-sweep modulation, so
+  consumers cannot be fooled by constant values.
+- Spectral sweeps : one spectrum of spectral_points amplitudes per channel / fiber in use
+  (info payload, then 4 int16_t per payload), on the axis GENERATOR_SPECTRAL_START_NM +
+  i * GENERATOR_SPECTRAL_STEP_NM (config/spectral_detector.cfg). Each sensor of the
+  spectrum is a Gaussian peak at its wavelength over a noisy floor; only the samples
+  near a peak are computed with exp(), the floor costs one random draw per payload.
+- The xorshift seed (GENERATOR_DEFAULT_SEED unless set) makes every run produce the same
+  stream.
+
+generateSweep() writes into a caller-owned buffer of generatorMaxSweepSize() bytes.
+*/
+
+#ifndef I4_STREAM_GENERATOR_H
+#define I4_STREAM_GENERATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+
+#define GENERATOR_CHANNELS 4
+#define GENERATOR_MAX_PEAKS 4096
+#define GENERATOR_MAX_ERRORS 4             // per erroneous sweep
+#define GENERATOR_BASE_NM 1520.0           // first sensor
+#define GENERATOR_SPACING_NM 4.0           // between sensors of one fiber
+#define GENERATOR_MODULATION_NM 0.05
+#define GENERATOR_TICKS_PER_S 2000000000.0 // time-stamped peak counter (0.5 ns)
+#define GENERATOR_INTERNAL_ERROR 1         // error id of the synthetic internal errors
+#define GENERATOR_DEFAULT_SEED 0x9E3779B97F4A7C15ULL
+#define GENERATOR_ERROR_MIX 0              // error_id : Missing Peak, Multiple Peaks and Internal errors 3 : 1 : 1
+#define GENERATOR_MAX_SPECTRAL_POINTS 65536
+#define GENERATOR_DEFAULT_SPECTRAL_POINTS 16384 // 1510 .. 1591.9 nm, covers every sensor base
+#define GENERATOR_SPECTRAL_START_NM 1510.0
+#define GENERATOR_SPECTRAL_STEP_NM 0.005
+#define GENERATOR_SPECTRAL_FLOOR 200       // + 0..63 noise
+#define GENERATOR_SPECTRAL_AMPLITUDE 20000
+#define GENERATOR_SPECTRAL_SIGMA_NM 0.04
+#define GENERATOR_SPECTRAL_REACH 4.0       // sigmas around a peak that are computed
+
+struct generator_config_t {
+    uint32_t peaks;        // per sweep
+    int sweep_type;        // SWEEP_TYPE_PEAK, SWEEP_TYPE_TSPEAK or SWEEP_TYPE_SPECTRAL
+    uint32_t spectral_points; // per spectrum (spectral sweeps)
+    double rate_hz;        // sweep rate of the timestamps
+    double error_rate;     // 0..1, fraction of sweeps with error payloads
+    uint32_t error_id;     // GENERATOR_ERROR_MIX or the id of every error payload
+    uint64_t seed;         // xorshift seed, 0 : GENERATOR_DEFAULT_SEED
+    uint64_t start_ns;     // timeStamp of sweep 0, ns since the NTP epoch
+};
+
+struct i4_generator_t {
+    struct generator_config_t config;
+    uint64_t state;        // xorshift64
+    uint32_t sweep;        // next sweep counter
+    uint64_t errors;       // error payloads generated
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initGeneratorConfig : 64 peaks, no timestamps, 1 kHz, mixed errors at rate 0, default seed, starting at 0.
+* initGenerator : Generator at sweep 0 for a configuration (peaks and spectral points clamped).
+* generatorSpectra : Number of spectra of a spectral sweep (channels / fibers in use).
+* generatorMaxSweepSize : Largest frame generateSweep() can write for a configuration.
+* generatorRandom : Next xorshift64 value.
+* generatorPeakIds : Channel, fiber and sensor of peak i (round robin over the channels, then sensors, then fibers).
+* generatorWavelength : Wavelength of a sensor in sweep k, nm.
+* encodeGeneratorPeak : Writes one peak / time-stamped peak payload.
+* encodeGeneratorError : Writes one error payload.
+* encodeGeneratorSpectrum : Writes one spectrum (info payload and amplitudes), returns its size.
+* generateSweep : Writes the whole next sweep frame, returns its size.
+* ==============================================================================
+*/
+
+static inline void initGeneratorConfig(struct generator_config_t* config) {
+    config->peaks = 64;
+    config->sweep_type = SWEEP_TYPE_PEAK;
+    config->spectral_points = GENERATOR_DEFAULT_SPECTRAL_POINTS;
+    config->rate_hz = 1000.0;
+    config->error_rate = 0.0;
+    config->error_id = GENERATOR_ERROR_MIX;
+    config->seed = 0;
+    config->start_ns = 0;
+}
+
+static inline void initGenerator(struct i4_generator_t* generator, const struct generator_config_t* config) {
+    generator->config = *config;
+    if (generator->config.peaks > GENERATOR_MAX_PEAKS) {
+        generator->config.peaks = GENERATOR_MAX_PEAKS;
+    }
+    if (generator->config.spectral_points > GENERATOR_MAX_SPECTRAL_POINTS) {
+        generator->config.spectral_points = GENERATOR_MAX_SPECTRAL_POINTS;
+    }
+    if (generator->config.rate_hz <= 0.0) {
+        generator->config.rate_hz = 1000.0;
+    }
+    generator->state = config->seed != 0 ? config->seed : GENERATOR_DEFAULT_SEED;
+    generator->sweep = 0;
+    generator->errors = 0;
+}
+
+static inline uint32_t generatorSpectra(uint32_t peaks) {
+    uint32_t spectra = 0;
+    for (uint32_t first = 0; first < peaks; first += GENERATOR_CHANNELS * 256) {
+        spectra += peaks - first < GENERATOR_CHANNELS ? peaks - first : GENERATOR_CHANNELS; // fiber first / (4 x 256)
+    }
+    return spectra;
+}
+
+static inline uint32_t generatorMaxSweepSize(const struct generator_config_t* config) {
+    uint32_t peaks = config->peaks > GENERATOR_MAX_PEAKS ? GENERATOR_MAX_PEAKS : config->peaks;
+    uint32_t data_length = peaks * TSPEAK_PAYLOAD_SIZE;
+    if (config->sweep_type == SWEEP_TYPE_SPECTRAL) {
+        uint32_t points = config->spectral_points > GENERATOR_MAX_SPECTRAL_POINTS ? GENERATOR_MAX_SPECTRAL_POINTS : config->spectral_points;
+        data_length = generatorSpectra(peaks) * (SPECTRAL_PAYLOAD_SIZE + (points + 3) / 4 * SPECTRAL_PAYLOAD_SIZE);
+    }
+    return HEADER_SIZE + GENERATOR_MAX_ERRORS * ERROR_PAYLOAD_SIZE + data_length + FLAG_SIZE;
+}
+
+static inline uint64_t generatorRandom(struct i4_generator_t* generator) {
+    uint64_t x = generator->state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    generator->state = x;
+    return x;
+}
+
+static inline void generatorPeakIds(uint32_t i, uint8_t* channel, uint8_t* fiber, uint8_t* sensor) {
+    *channel = (uint8_t)(i % GENERATOR_CHANNELS);
+    *sensor = (uint8_t)(i / GENERATOR_CHANNELS % 256);
+    *fiber = (uint8_t)(i / (GENERATOR_CHANNELS * 256) % 16);
+}
+
+static inline double generatorWavelength(uint8_t sensor, uint32_t k) {
+    return GENERATOR_BASE_NM + GENERATOR_SPACING_NM * (sensor % 16) + GENERATOR_MODULATION_NM * sin((double)k * 0.01);
+}
+
+static inline void encodeGeneratorPeak(char* payload, int sweep_type, uint8_t channel, uint8_t fiber, uint8_t sensor,
+    double wavelength_nm, uint32_t ticks) {
+    double wavelength_m = wavelength_nm * 1e-9;
+    uint32_t words[3];
+    memcpy(words, &wavelength_m, sizeof(double));
+    words[0] = (words[0] & ~0xffffu) | ((uint32_t)(channel & 0x0f) << 12) | ((uint32_t)(fiber & 0x0f) << 8) | sensor;
+    words[2] = ticks;
+    memcpy(payload, words, sweep_type == SWEEP_TYPE_TSPEAK ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE);
+}
+
+static inline void encodeGeneratorError(char* payload, uint32_t error_id, uint8_t channel, uint8_t fiber, uint8_t sensor) {
+    struct error_payload_t error;
+    error.error_id = error_id;
+    error.error_description = ((uint32_t)(channel & 0x0f) << 12) | ((uint32_t)(fiber & 0x0f) << 8) | sensor;
+    memcpy(payload, &error, sizeof(error));
+}
+
+/* sensors : sensors 0..sensors-1 of (channel, fiber) are in the spectrum; returns the bytes written */
+static inline uint32_t encodeGeneratorSpectrum(struct i4_generator_t* generator, char* payload, uint8_t channel, uint8_t fiber,
+    uint32_t sensors, uint32_t k) {
+    uint32_t points = generator->config.spectral_points;
+    uint32_t info[2];
+    info[0] = ((uint32_t)(channel & 0x0f) << 12) | ((uint32_t)(fiber & 0x0f) << 8);
+    info[1] = points;
+    memcpy(payload, info, sizeof(info));
+
+    // noise floor, 4 samples of 6 random bits per draw (the padding of the last payload too)
+    char* samples = payload + SPECTRAL_PAYLOAD_SIZE;
+    uint32_t payloads = (points + 3) / 4;
+    for (uint32_t p = 0; p < payloads; p++) {
+        uint64_t draw = generatorRandom(generator);
+        int16_t amplitudes[4];
+        for (int j = 0; j < 4; j++) {
+            amplitudes[j] = (int16_t)(GENERATOR_SPECTRAL_FLOOR + ((draw >> (16 * j)) & 63));
+        }
+        memcpy(samples + p * SPECTRAL_PAYLOAD_SIZE, amplitudes, sizeof(amplitudes));
+    }
+
+    // Gaussian peaks, sensors 16 apart share a wavelength (generatorWavelength)
+    double reach = GENERATOR_SPECTRAL_REACH * GENERATOR_SPECTRAL_SIGMA_NM / GENERATOR_SPECTRAL_STEP_NM;
+    for (uint32_t sensor = 0; sensor < sensors && sensor < 16; sensor++) {
+        double center = (generatorWavelength((uint8_t)sensor, k) - GENERATOR_SPECTRAL_START_NM) / GENERATOR_SPECTRAL_STEP_NM;
+        double low = ceil(center - reach);
+        double high = floor(center + reach);
+        if (high < 0.0 || low >= (double)points) {
+            continue; // outside the axis
+        }
+        uint32_t first = low < 0.0 ? 0 : (uint32_t)low;
+        uint32_t last = high >= (double)points ? points - 1 : (uint32_t)high;
+        for (uint32_t i = first; i <= last; i++) {
+            double sigmas = ((double)i - center) * GENERATOR_SPECTRAL_STEP_NM / GENERATOR_SPECTRAL_SIGMA_NM;
+            int16_t amplitude;
+            memcpy(&amplitude, samples + i * sizeof(int16_t), sizeof(amplitude));
+            amplitude = (int16_t)(amplitude + GENERATOR_SPECTRAL_AMPLITUDE * exp(-0.5 * sigmas * sigmas));
+            memcpy(samples + i * sizeof(int16_t), &amplitude, sizeof(amplitude));
+        }
+    }
+    return SPECTRAL_PAYLOAD_SIZE + payloads * SPECTRAL_PAYLOAD_SIZE;
+}
+
+/* returns the frame size in bytes (at most generatorMaxSweepSize()) */
+static inline uint32_t generateSweep(struct i4_generator_t* generator, char* frame) {
+    const struct generator_config_t* config = &generator->config;
+    uint32_t k = generator->sweep++;
+    uint32_t payload_size = config->sweep_type == SWEEP_TYPE_TSPEAK ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE;
+    double period_s = 1.0 / config->rate_hz;
+
+    uint32_t error_count = 0;
+    if (config->error_rate > 0.0 && (double)(generatorRandom(generator) >> 11) * (1.0 / 9007199254740992.0) < config->error_rate) {
+        error_count = 1 + (uint32_t)(generatorRandom(generator) % GENERATOR_MAX_ERRORS);
+    }
+    uint32_t data_offset = HEADER_SIZE + error_count * ERROR_PAYLOAD_SIZE;
+    uint32_t data_length = config->peaks * payload_size;
+    if (config->sweep_type == SWEEP_TYPE_SPECTRAL) {
+        data_length = generatorSpectra(config->peaks) * (SPECTRAL_PAYLOAD_SIZE + (config->spectral_points + 3) / 4 * SPECTRAL_PAYLOAD_SIZE);
+    }
+
+    struct I4PacketHeader header;
+    header.info = (uint16_t)((k & 0xfff) | ((uint32_t)config->sweep_type << 12));
+    header.dataOffset = (uint16_t)data_offset;
+    header.dataLength = data_length;
+    header.timeStamp = config->start_ns + (uint64_t)((double)k * period_s * 1e9);
+    memcpy(frame, &header, sizeof(header));
+
+    for (uint32_t e = 0; e < error_count; e++) {
+        uint64_t draw = generatorRandom(generator);
+        uint32_t kind = (uint32_t)(draw % 5);
+        uint32_t error_id = config->error_id != GENERATOR_ERROR_MIX ? config->error_id
+            : kind < 3 ? I4_ERROR_MISSING_PEAK : kind == 3 ? I4_ERROR_MULTIPLE_PEAKS : GENERATOR_INTERNAL_ERROR;
+        uint8_t channel, fiber, sensor;
+        generatorPeakIds((uint32_t)((draw >> 8) % (config->peaks > 0 ? config->peaks : 1)), &channel, &fiber, &sensor);
+        encodeGeneratorError(frame + HEADER_SIZE + e * ERROR_PAYLOAD_SIZE, error_id, channel, fiber, sensor);
+    }
+    generator->errors += error_count;
+
+    if (config->sweep_type == SWEEP_TYPE_SPECTRAL) {
+        // peaks 4 x 256 f .. 4 x 256 (f + 1) - 1 are fiber f, round robin over the channels
+        char* payload = frame + data_offset;
+        for (uint32_t first = 0; first < config->peaks; first += GENERATOR_CHANNELS * 256) {
+            uint32_t in_fiber = config->peaks - first < GENERATOR_CHANNELS * 256 ? config->peaks - first : GENERATOR_CHANNELS * 256;
+            for (uint32_t channel = 0; channel < GENERATOR_CHANNELS && channel < in_fiber; channel++) {
+                uint32_t sensors = (in_fiber - channel + GENERATOR_CHANNELS - 1) / GENERATOR_CHANNELS;
+                payload += encodeGeneratorSpectrum(generator, payload, (uint8_t)channel,
+                    (uint8_t)(first / (GENERATOR_CHANNELS * 256) % 16), sensors, k);
+            }
+        }
+    }
+    else {
+        uint32_t base_ticks = (uint32_t)(uint64_t)((double)k * period_s * GENERATOR_TICKS_PER_S);
+        double wavelengths[16];
+        for (uint32_t s = 0; s < 16; s++) {
+            wavelengths[s] = generatorWavelength((uint8_t)s, k);
+        }
+        for (uint32_t i = 0; i < config->peaks; i++) {
+            uint8_t channel, fiber, sensor;
+            generatorPeakIds(i, &channel, &fiber, &sensor);
+            encodeGeneratorPeak(frame + data_offset + i * payload_size, config->sweep_type, channel, fiber, sensor,
+                wavelengths[sensor % 16], base_ticks + i * 20);
+        }
+    }
+
+    struct I4PacketFlag flag;
+    flag.sweep_counter = k;
+    flag.reserved = 0;
+    memcpy(frame + data_offset + data_length, &flag, sizeof(flag));
+    return data_offset + data_length + FLAG_SIZE;
+}
+
+#endif // I4_STREAM_GENERATOR_H
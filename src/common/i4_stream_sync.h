@@ -0,0 +1,175 @@
+/*
+File    : i4_stream_sync.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only I4 stream gap detection and resync (C / C++)
+
+Sweep frames have no sync word, so a short read leaves the parser misaligned
+and every following "header" is garbage. This header
+- checks a header against sane bounds before its dataOffset / dataLength are
+  trusted : sweep type 0..2, dataOffset = 16 + n x 8 error payloads,
+  dataLength a whole number of payloads and below a caller bound,
+- scans a byte range for the next position that can start such a header,
+  also on a partial header, so realigning does not need a byte-wise recv(),
+- checks the wavelengths of peak payloads and the sweep_counter step, which
+  catches a false header,
+- counts gaps in the 12-bit packetCounter (wrap-around) and the 32-bit
+  sweep_counter of consecutive accepted sweeps; with the I4 downsampling
+  (every n-th sweep sent, ../common/i4_management.h) set sweep_step to n,
+  so the skipped sweeps are not counted as dropped.
+
+After a reconnect, streamReconnected() restarts the counter checks from the first sweep of
+the new connection : the sweeps sent while it was down are not counted as dropped, and a
+long outage does not make every following sweep_counter look like garbage.
+*/
+
+#ifndef I4_STREAM_SYNC_H
+#define I4_STREAM_SYNC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "i4_protocol.h"
+
+#define I4_SYNC_MAX_ERROR_PAYLOADS 64 // dataOffset bound, 16 + 64 x 8 bytes
+#define I4_SYNC_MAX_SWEEP_GAP 65536  // larger sweep_counter jumps are taken as garbage (restarts count from ~0)
+#define I4_SYNC_MIN_WAVELENGTH_M 1.0e-6
+#define I4_SYNC_MAX_WAVELENGTH_M 2.0e-6
+#define I4_PACKET_COUNTER_MASK 0xfff
+
+struct i4_stream_stats_t {
+    uint64_t sweeps;         // frames accepted
+    uint64_t dropped;        // sweeps missing according to sweep_counter
+    uint64_t packet_gaps;    // packets missing according to packetCounter
+    uint64_t restarts;       // sweep_counter went backwards (acquisition restarted)
+    uint64_t resyncs;        // realignments onto a header
+    uint64_t skipped_bytes;  // bytes dropped while realigning
+    uint64_t malformed;      // headers or payloads that failed the checks
+    uint64_t reconnects;     // connections restarted by streamReconnected()
+    int started;
+    uint16_t last_packet_counter;
+    uint32_t last_sweep_counter;
+    uint32_t sweep_step;     // expected sweep_counter step, the I4 downsampling
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initStreamStats : Clears all counters.
+* i4HeaderPlausible : Whether 'length' bytes (up to HEADER_SIZE) can be the start of a header.
+* i4ScanHeader : Offset of the first position after byte 0 that can start a header.
+* i4PayloadPlausible : Whether the peak payloads of a frame hold FBG wavelengths.
+* i4SweepPlausible : Whether a sweep_counter can follow the previous accepted one.
+* streamReconnected : Restarts the counter checks on a new connection.
+* trackSweep : Counts packetCounter / sweep_counter gaps of an accepted sweep, returns the sweeps missed.
+* printStreamStats : Prints all counters in one line.
+* ==============================================================================
+*/
+
+static inline void initStreamStats(struct i4_stream_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->sweep_step = 1;
+}
+
+/* checks only the fields inside the first 'length' bytes, so a partial header can be rejected early */
+static inline int i4HeaderPlausible(const char* bytes, uint32_t length, uint32_t max_data_length) {
+    const uint8_t* b = (const uint8_t*)bytes;
+    uint32_t sweep_type = 0;
+    if (length >= 2) {
+        sweep_type = (b[1] >> 4) & 0x07; // bits 12-14 of the info field
+        if (sweep_type > SWEEP_TYPE_TSPEAK) {
+            return 0;
+        }
+    }
+    if (length >= 4) {
+        uint32_t DO = (uint32_t)b[2] | ((uint32_t)b[3] << 8);
+        if (DO < HEADER_SIZE || (DO - HEADER_SIZE) % ERROR_PAYLOAD_SIZE != 0
+            || DO > HEADER_SIZE + I4_SYNC_MAX_ERROR_PAYLOADS * ERROR_PAYLOAD_SIZE) {
+            return 0;
+        }
+    }
+    if (length >= 8) {
+        uint32_t DL = (uint32_t)b[4] | ((uint32_t)b[5] << 8) | ((uint32_t)b[6] << 16) | ((uint32_t)b[7] << 24);
+        uint32_t record = sweep_type == SWEEP_TYPE_TSPEAK ? TSPEAK_PAYLOAD_SIZE
+            : sweep_type == SWEEP_TYPE_SPECTRAL ? SPECTRAL_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE;
+        if (DL > max_data_length || DL % record != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* returns the offset in 1..length of the next possible header start, 'length' if there is none */
+static inline uint32_t i4ScanHeader(const char* bytes, uint32_t length, uint32_t max_data_length) {
+    for (uint32_t k = 1; k < length; k++) {
+        uint32_t available = length - k < HEADER_SIZE ? length - k : HEADER_SIZE;
+        if (i4HeaderPlausible(bytes + k, available, max_data_length)) {
+            return k;
+        }
+    }
+    return length;
+}
+
+/* payload : DL bytes of a frame, checks the first and last peak (spectral payloads pass) */
+static inline int i4PayloadPlausible(const char* payload, uint32_t DL, int sweep_type) {
+    uint32_t record = sweep_type == SWEEP_TYPE_TSPEAK ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE;
+    if (sweep_type == SWEEP_TYPE_SPECTRAL || DL < record) {
+        return 1;
+    }
+    uint32_t offsets[2] = { 0, DL - record };
+    for (int i = 0; i < 2; i++) {
+        peak_data_t peak_data;
+        memcpy(peak_data, payload + offsets[i], sizeof(peak_data));
+        double value = wavelength(peak_data); // m, NaN fails too
+        if (!(value > I4_SYNC_MIN_WAVELENGTH_M && value < I4_SYNC_MAX_WAVELENGTH_M)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline int i4SweepPlausible(const struct i4_stream_stats_t* stats, uint32_t sweep_counter) {
+    if (!stats->started) {
+        return 1;
+    }
+    uint32_t step = sweep_counter - stats->last_sweep_counter;
+    return (step >= 1 && step <= I4_SYNC_MAX_SWEEP_GAP) || sweep_counter < I4_SYNC_MAX_SWEEP_GAP;
+}
+
+static inline void streamReconnected(struct i4_stream_stats_t* stats) {
+    stats->started = 0;
+    stats->reconnects++;
+}
+
+/* returns the number of sweeps missed between the previous accepted sweep and this one */
+static inline uint32_t trackSweep(struct i4_stream_stats_t* stats, uint16_t packet_counter, uint32_t sweep_counter) {
+    uint32_t missed = 0;
+    if (stats->started) {
+        stats->packet_gaps += (uint16_t)(packet_counter - stats->last_packet_counter - 1) & I4_PACKET_COUNTER_MASK;
+        uint32_t step = sweep_counter - stats->last_sweep_counter;
+        if (step == 0 || step > 0x7fffffffu) {
+            stats->restarts++; // repeated or backwards : new acquisition, not a gap
+        }
+        else if (step > stats->sweep_step) {
+            missed = step / stats->sweep_step - 1;
+            stats->dropped += missed;
+        }
+    }
+    stats->started = 1;
+    stats->last_packet_counter = packet_counter;
+    stats->last_sweep_counter = sweep_counter;
+    stats->sweeps++;
+    return missed;
+}
+
+static inline void printStreamStats(const struct i4_stream_stats_t* stats) {
+    printf("Stream : %llu sweeps, %llu dropped, %llu packet gaps, %llu restarts, %llu resyncs (%llu bytes skipped), %llu malformed, %llu reconnects\n",
+        (unsigned long long)stats->sweeps, (unsigned long long)stats->dropped, (unsigned long long)stats->packet_gaps,
+        (unsigned long long)stats->restarts, (unsigned long long)stats->resyncs, (unsigned long long)stats->skipped_bytes,
+        (unsigned long long)stats->malformed, (unsigned long long)stats->reconnects);
+}
+
+#endif // I4_STREAM_SYNC_H
@@ -0,0 +1,239 @@
+/*
+File    : log_sink.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only asynchronous, rate-limited console log sink (C++11)
+
+The hot loop only copies small fixed-size records into an SPSC ring; a
+background thread formats and prints them. Console output is rate limited
+(lines above the limit are counted, not printed) and I4 error payloads are
+deduplicated through i4_error_stats.h. If the ring is full the record is
+dropped and counted, so logging can never stall the caller.
+
+Verbosity :
+- LOG_LEVEL_QUIET : errors (first occurrence) and summaries only
+- LOG_LEVEL_SWEEP : plus one summary line per sweep (default)
+- LOG_LEVEL_PEAK  : plus one line per forwarded peak
+
+Records must come from one producer thread (the forwarding thread).
+*/
+
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include "i4_protocol.h"
+#include "i4_error_stats.h"
+#include "spsc_ring.h"
+
+#define LOG_LEVEL_QUIET 0
+#define LOG_LEVEL_SWEEP 1
+#define LOG_LEVEL_PEAK 2
+
+#define LOG_RING_SLOTS 4096
+#define LOG_TEXT_SIZE 96
+#define LOG_DEFAULT_LINES_PER_SEC 20
+
+enum log_record_type_t {
+    LOG_RECORD_SWEEP,
+    LOG_RECORD_PEAK,
+    LOG_RECORD_ERROR,
+    LOG_RECORD_TEXT
+};
+
+struct log_record_t {
+    uint8_t type;
+    uint8_t channel, fiber, sensor;
+    uint32_t sweep_counter;
+    uint32_t peak_count;
+    uint32_t error_count;
+    double wavelength; // nm
+    char text[LOG_TEXT_SIZE]; // message, or raw error payload
+};
+
+struct log_sink_t {
+    int verbosity;
+    uint32_t max_lines_per_sec;
+    spsc_ring_t<log_record_t> ring;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    // owned by the log thread
+    struct i4_error_stats_t errors;
+    uint64_t suppressed; // lines over the rate limit
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* logSink_start, logSink_stop : Start/stop the log thread (stop drains the ring and prints the error summary).
+* logSink_enabled : True if records of this level are printed.
+* logSink_sweep, logSink_peak, logSink_error, logSink_text : Queue a record (never blocks).
+* logSink_thread : Formats and prints queued records.
+* ==============================================================================
+*/
+
+inline bool logSink_enabled(const log_sink_t* sink, int level) {
+    return sink->verbosity >= level;
+}
+
+inline log_record_t* logSink_acquire(log_sink_t* sink) {
+    log_record_t* record = spscRing_acquire(&sink->ring);
+    if (record == NULL) {
+        spscRing_overflow(&sink->ring);
+    }
+    return record;
+}
+
+inline void logSink_sweep(log_sink_t* sink, uint32_t sweep_counter, uint32_t peak_count, uint32_t error_count) {
+    if (!logSink_enabled(sink, LOG_LEVEL_SWEEP)) {
+        return;
+    }
+    log_record_t* record = logSink_acquire(sink);
+    if (record == NULL) {
+        return;
+    }
+    record->type = LOG_RECORD_SWEEP;
+    record->sweep_counter = sweep_counter;
+    record->peak_count = peak_count;
+    record->error_count = error_count;
+    spscRing_publish(&sink->ring);
+}
+
+inline void logSink_peak(log_sink_t* sink, uint8_t channel, uint8_t fiber, uint8_t sensor, double wavelength_nm) {
+    if (!logSink_enabled(sink, LOG_LEVEL_PEAK)) {
+        return;
+    }
+    log_record_t* record = logSink_acquire(sink);
+    if (record == NULL) {
+        return;
+    }
+    record->type = LOG_RECORD_PEAK;
+    record->channel = channel;
+    record->fiber = fiber;
+    record->sensor = sensor;
+    record->wavelength = wavelength_nm;
+    spscRing_publish(&sink->ring);
+}
+
+/* errors are always queued; the log thread counts them and prints each source once */
+inline void logSink_error(log_sink_t* sink, const char* error_payload) {
+    log_record_t* record = logSink_acquire(sink);
+    if (record == NULL) {
+        return;
+    }
+    record->type = LOG_RECORD_ERROR;
+    memcpy(record->text, error_payload, ERROR_PAYLOAD_SIZE);
+    spscRing_publish(&sink->ring);
+}
+
+/* for rare messages only : formats on the calling thread */
+inline void logSink_text(log_sink_t* sink, const char* format, ...) {
+    log_record_t* record = logSink_acquire(sink);
+    if (record == NULL) {
+        return;
+    }
+    record->type = LOG_RECORD_TEXT;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(record->text, LOG_TEXT_SIZE, format, args);
+    va_end(args);
+    spscRing_publish(&sink->ring);
+}
+
+inline void logSink_print(log_sink_t* sink, const log_record_t* record, uint32_t* lines) {
+    if (record->type == LOG_RECORD_ERROR) {
+        // first occurrence of a source in full, repeats only counted
+        if (countPacket_errorPayload(&sink->errors, record->text) == 1) {
+            processPacket_errorPayload(record->text);
+        }
+        return;
+    }
+
+    if (*lines >= sink->max_lines_per_sec) {
+        sink->suppressed++;
+        return;
+    }
+    (*lines)++;
+
+    if (record->type == LOG_RECORD_SWEEP) {
+        printf("Sweep #%u - %u peaks, %u errors\n", record->sweep_counter, record->peak_count, record->error_count);
+    }
+    else if (record->type == LOG_RECORD_PEAK) {
+        printf("Sent data %u - Channel#%u, Sensor#%u, Wavelength: %.5f nm\n",
+            record->fiber, record->channel, record->sensor, record->wavelength);
+    }
+    else {
+        printf("%s\n", record->text);
+    }
+}
+
+inline void logSink_thread(log_sink_t* sink) {
+    std::chrono::steady_clock::time_point window = std::chrono::steady_clock::now();
+    uint32_t lines = 0;
+    uint64_t reported_suppressed = 0;
+
+    while (1) {
+        log_record_t* record = spscRing_front(&sink->ring);
+        if (record != NULL) {
+            logSink_print(sink, record, &lines);
+            spscRing_pop(&sink->ring);
+            continue;
+        }
+        if (!sink->running.load()) {
+            break; // stopped and drained
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - window >= std::chrono::seconds(1)) {
+            if (sink->suppressed != reported_suppressed) {
+                printf("(%llu log lines suppressed)\n", (unsigned long long)(sink->suppressed - reported_suppressed));
+                reported_suppressed = sink->suppressed;
+            }
+            fflush(stdout);
+            window = now;
+            lines = 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+inline int logSink_start(log_sink_t* sink, int verbosity, uint32_t max_lines_per_sec) {
+    sink->verbosity = verbosity;
+    sink->max_lines_per_sec = max_lines_per_sec;
+    sink->suppressed = 0;
+    initErrorStats(&sink->errors);
+    if (spscRing_init(&sink->ring, LOG_RING_SLOTS) != 0) {
+        return -1;
+    }
+    sink->running = true;
+    sink->thread = std::thread(logSink_thread, sink);
+    return 0;
+}
+
+inline void logSink_stop(log_sink_t* sink) {
+    sink->running = false;
+    if (sink->thread.joinable()) {
+        sink->thread.join();
+    }
+
+    printErrorStats(&sink->errors);
+    if (sink->suppressed != 0 || sink->ring.overflows.load() != 0) {
+        printf("Log : %llu lines suppressed, %llu records dropped\n",
+            (unsigned long long)sink->suppressed, (unsigned long long)sink->ring.overflows.load());
+    }
+    fflush(stdout);
+    spscRing_free(&sink->ring);
+}
+
+#endif // LOG_SINK_H
@@ -0,0 +1,224 @@
+/*
+File    : low_latency.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only low-latency helpers and latency histogram (C++11)
+
+For the closed control loop, where the delay and jitter of one sweep matter more
+than throughput :
+
+- socketSetNoDelay : TCP_NODELAY, a small message goes out at once instead of
+  waiting for Nagle to coalesce it with the next one.
+- socketSetBusyPoll : SO_BUSY_POLL (Linux), a recv() on an empty socket spins on the
+  NIC queue for a while before sleeping, instead of waiting for the interrupt.
+- threadPinCurrent : runs the calling thread on one core only (affinity), and
+  raises its priority (THREAD_PRIORITY_TIME_CRITICAL on Windows, SCHED_FIFO on
+  Linux, which needs the rights to do so; otherwise only the affinity is kept).
+- latency_histogram_t : log-linear histogram of latencies in ns, 16 buckets per
+  power of two (<= 6.25 % relative error), fixed size, no allocation, so it can be
+  filled on the hot path. Percentiles are reported as the upper bound of their bucket.
+
+Latency of a sweep : the I4 stamps its header with its own clock (ns since the NTP
+epoch), so "header timestamp -> send completion" is only meaningful when the I4 and
+this host are synchronised (NTP / PTP). latencyNow_ns() is this host's wall clock on
+the same epoch. Negative latencies (I4 clock ahead) are counted apart. Host-only
+latencies (e.g. frame received -> sent) use latencySteady_ns(), which never jumps.
+
+A histogram is filled by one thread; latencyHistogram_merge() combines them afterwards.
+*/
+
+#ifndef LOW_LATENCY_H
+#define LOW_LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform_socket.h"
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanReverse64
+#endif
+
+#include <chrono>
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS) // up to 2^64 ns
+#define LATENCY_NTP_UNIX_OFFSET_S 2208988800ULL                                // 1900-01-01 -> 1970-01-01
+#define LOW_LATENCY_BUSY_POLL_US 50                                           // SO_BUSY_POLL spin before a recv() sleeps
+
+struct latency_histogram_t {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t samples;
+    uint64_t negative; // sample earlier than its reference (clock offset), not in 'counts'
+    uint64_t min_ns;
+    uint64_t max_ns;
+    double sum_ns;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* socketSetNoDelay : Disables Nagle's algorithm on a TCP socket.
+* socketSetBusyPoll : Busy-polls the device queue on an empty receive (Linux only).
+* threadPinCurrent : Pins the calling thread to one core with raised priority.
+* latencyNow_ns : Wall clock of this host in ns since the NTP epoch (I4 header timeStamp epoch).
+* latencySteady_ns : Monotonic clock in ns, for intervals measured on this host only.
+* latencyHistogram_init : Empty histogram.
+* latencyHistogram_bucket, latencyHistogram_upper : Bucket of a latency / largest latency of a bucket.
+* latencyHistogram_add : Records one latency (end - start, both in ns).
+* latencyHistogram_merge : Adds the samples of one histogram to another.
+* latencyHistogram_percentile : Latency below which 'percent' % of the samples are.
+* latencyHistogram_print : One summary line (count, mean, p50 / p90 / p99 / p99.9, max).
+* ==============================================================================
+*/
+
+/* returns 0, or -1 on failure */
+static inline int socketSetNoDelay(SOCKET hSocket) {
+    int enable = 1;
+    return setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable)) == 0 ? 0 : -1;
+}
+
+/* returns 0, 1 if the platform has no busy polling, or -1 on failure (Linux : needs CAP_NET_ADMIN above net.core.busy_read) */
+static inline int socketSetBusyPoll(SOCKET hSocket, int microseconds) {
+#if defined(SO_BUSY_POLL)
+    return setsockopt(hSocket, SOL_SOCKET, SO_BUSY_POLL, (const char*)&microseconds, sizeof(microseconds)) == 0 ? 0 : -1;
+#else
+    (void)hSocket;
+    (void)microseconds;
+    return 1;
+#endif
+}
+
+/* returns 0 if pinned with raised priority, 1 if only pinned, -1 if neither */
+static inline int threadPinCurrent(int core) {
+#ifdef _WIN32
+    if (core < 0 || core >= (int)(sizeof(DWORD_PTR) * 8) || SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) == 0) {
+        return -1;
+    }
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? 0 : 1;
+#else
+    if (core < 0 || core >= CPU_SETSIZE) {
+        return -1;
+    }
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) != 0) {
+        return -1;
+    }
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1; // leave the top to the kernel's own threads
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 ? 0 : 1;
+#endif
+}
+
+static inline uint64_t latencyNow_ns(void) {
+    uint64_t unix_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return unix_ns + LATENCY_NTP_UNIX_OFFSET_S * 1000000000ULL;
+}
+
+static inline uint64_t latencySteady_ns(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void latencyHistogram_init(struct latency_histogram_t* histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min_ns = UINT64_MAX;
+}
+
+static inline uint32_t latencyHistogram_bucket(uint64_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return (uint32_t)ns;
+    }
+    uint32_t msb = 0;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, ns);
+    msb = (uint32_t)index;
+#else
+    msb = 63 - (uint32_t)__builtin_clzll(ns);
+#endif
+    uint32_t sub = (uint32_t)(ns >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return (msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+static inline uint64_t latencyHistogram_upper(uint32_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t msb = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint64_t sub = bucket % LATENCY_SUB_BUCKETS;
+    uint64_t width = 1ULL << (msb - LATENCY_SUB_BITS);
+    return ((uint64_t)LATENCY_SUB_BUCKETS + sub) * width + (width - 1);
+}
+
+static inline void latencyHistogram_add(struct latency_histogram_t* histogram, uint64_t start_ns, uint64_t end_ns) {
+    if (end_ns < start_ns) {
+        histogram->negative++;
+        return;
+    }
+    uint64_t ns = end_ns - start_ns;
+    histogram->counts[latencyHistogram_bucket(ns)]++;
+    histogram->samples++;
+    histogram->min_ns = ns < histogram->min_ns ? ns : histogram->min_ns;
+    histogram->max_ns = ns > histogram->max_ns ? ns : histogram->max_ns;
+    histogram->sum_ns += (double)ns;
+}
+
+static inline void latencyHistogram_merge(struct latency_histogram_t* into, const struct latency_histogram_t* from) {
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+        into->counts[b] += from->counts[b];
+    }
+    into->samples += from->samples;
+    into->negative += from->negative;
+    into->min_ns = from->min_ns < into->min_ns ? from->min_ns : into->min_ns;
+    into->max_ns = from->max_ns > into->max_ns ? from->max_ns : into->max_ns;
+    into->sum_ns += from->sum_ns;
+}
+
+static inline uint64_t latencyHistogram_percentile(const struct latency_histogram_t* histogram, double percent) {
+    if (histogram->samples == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percent / 100.0 * (double)histogram->samples + 0.5);
+    rank = rank < 1 ? 1 : rank > histogram->samples ? histogram->samples : rank;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram->counts[b];
+        if (seen >= rank) {
+            uint64_t upper = latencyHistogram_upper(b);
+            return upper < histogram->max_ns ? upper : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+static inline void latencyHistogram_print(const struct latency_histogram_t* histogram, const char* name) {
+    if (histogram->samples == 0) {
+        printf("%s : no samples (%llu negative)\n", name, (unsigned long long)histogram->negative);
+        return;
+    }
+    printf("%s : %llu sweeps, mean %.1f us, min %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f us",
+        name, (unsigned long long)histogram->samples, histogram->sum_ns / (double)histogram->samples / 1000.0,
+        histogram->min_ns / 1000.0,
+        latencyHistogram_percentile(histogram, 50.0) / 1000.0, latencyHistogram_percentile(histogram, 90.0) / 1000.0,
+        latencyHistogram_percentile(histogram, 99.0) / 1000.0, latencyHistogram_percentile(histogram, 99.9) / 1000.0,
+        histogram->max_ns / 1000.0);
+    if (histogram->negative > 0) {
+        printf(" (%llu negative, clocks not synchronised?)", (unsigned long long)histogram->negative);
+    }
+    printf("\n");
+}
+
+#endif // LOW_LATENCY_H
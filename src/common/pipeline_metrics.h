@@ -0,0 +1,385 @@
+/*
+File    : pipeline_metrics.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only per-thread pipeline metrics with a Prometheus HTTP endpoint (C++11)
+
+Every thread of the pipeline (ingest, decode workers) gets its own metrics_slot_t, on
+cache lines of its own, and is the only one writing it : counters are plain relaxed
+loads and stores, no read-modify-write, no lock, no false sharing between threads.
+
+Per slot :
+- counters : bytes / sweeps received, sweeps dropped (ring full), peaks decoded,
+  messages / bytes sent, I4 error payloads by type (500 Missing Peak, 501 Multiple
+  Peaks, Internal)
+- gauges   : occupancy and high watermark of the thread's sweep ring
+- stage times per sweep (recv : first byte to complete frame, decode, send), as
+  histograms with fixed buckets from 1 us to 10 ms
+
+metrics_serve() answers every HTTP request on its port with the current values in the
+Prometheus text format (GET /metrics), from a thread of its own that only reads the slots,
+so a scraper polling every few seconds shows a saturated link (recv time, drops) or a slow
+consumer (send time, ring occupancy) before data is lost.
+
+    struct metrics_slot_t* slot = metrics_slot(&metrics, "ingest");  // before the thread starts
+    metrics_add(slot->bytes_received, n);                            // on that thread only
+    metricsTime_add(&slot->stages[METRICS_STAGE_RECV], end_ns - start_ns);
+*/
+
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "platform_socket.h"
+
+#include <thread>
+#include <atomic>
+
+#include "i4_protocol.h"
+
+#define METRICS_MAX_SLOTS 32
+#define METRICS_CACHE_LINE 64
+#define METRICS_NAME_SIZE 24 // "worker" + any uint32_t
+#define METRICS_TIME_BUCKETS 13 // + Inf
+#define METRICS_ACCEPT_TIMEOUT_MS 100
+#define METRICS_REQUEST_SIZE 2048
+#define METRICS_INITIAL_RESPONSE (64 * 1024)
+
+#define METRICS_STAGE_RECV 0
+#define METRICS_STAGE_DECODE 1
+#define METRICS_STAGE_SEND 2
+#define METRICS_STAGES 3
+
+// upper bounds of the stage time buckets [ns]
+static const uint64_t metrics_time_bounds_ns[METRICS_TIME_BUCKETS] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000, 5000000, 10000000
+};
+
+struct metrics_time_t {
+    std::atomic<uint64_t> buckets[METRICS_TIME_BUCKETS + 1]; // not cumulative, last : above every bound
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+};
+
+// written by one thread only
+struct alignas(METRICS_CACHE_LINE) metrics_slot_t {
+    char name[METRICS_NAME_SIZE];
+
+    std::atomic<uint64_t> bytes_received;
+    std::atomic<uint64_t> sweeps_received;
+    std::atomic<uint64_t> sweeps_dropped;
+    std::atomic<uint64_t> peaks_decoded;
+    std::atomic<uint64_t> messages_sent;
+    std::atomic<uint64_t> bytes_sent;
+    std::atomic<uint64_t> errors_missing_peak;
+    std::atomic<uint64_t> errors_multiple_peaks;
+    std::atomic<uint64_t> errors_internal;
+
+    std::atomic<uint64_t> ring_occupancy;
+    std::atomic<uint64_t> ring_high_watermark;
+
+    struct metrics_time_t stages[METRICS_STAGES];
+};
+
+struct metrics_t {
+    struct metrics_slot_t slots[METRICS_MAX_SLOTS];
+    uint32_t slot_count;
+
+    SOCKET hSocket;             // INVALID_SOCKET : not serving
+    uint16_t port;
+    std::atomic<bool> running;
+    std::thread thread;
+    uint64_t scrapes;           // owned by the serving thread
+    char* response;
+    uint32_t response_capacity;
+    uint32_t response_size;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* metrics_init : No slot, not serving.
+* metrics_slot : Hands out the slot of one thread, NULL once all METRICS_MAX_SLOTS are taken.
+* metrics_add, metrics_set : Single-writer counter increment / gauge update (relaxed, no RMW).
+* metricsTime_add : Records one stage time in its bucket.
+* metricsError_add : Counts one I4 error payload by its type.
+* metrics_serve : Listens on a port and answers scrapes on a thread of its own.
+* metrics_stop : Stops serving.
+* metricsResponse_append : printf into the response buffer, growing it on demand.
+* metrics_render : Formats every slot in the Prometheus text format.
+* metrics_answer : Reads one request and sends the rendered metrics.
+* metrics_thread : Accept loop of the endpoint.
+* ==============================================================================
+*/
+
+static inline void metrics_init(struct metrics_t* metrics) {
+    metrics->slot_count = 0;
+    metrics->hSocket = INVALID_SOCKET;
+    metrics->port = 0;
+    metrics->running.store(false);
+    metrics->scrapes = 0;
+    metrics->response = NULL;
+    metrics->response_capacity = 0;
+    metrics->response_size = 0;
+}
+
+static inline struct metrics_slot_t* metrics_slot(struct metrics_t* metrics, const char* name) {
+    if (metrics->slot_count == METRICS_MAX_SLOTS) {
+        return NULL;
+    }
+    struct metrics_slot_t* slot = &metrics->slots[metrics->slot_count++];
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    std::atomic<uint64_t>* counters[] = { &slot->bytes_received, &slot->sweeps_received, &slot->sweeps_dropped,
+        &slot->peaks_decoded, &slot->messages_sent, &slot->bytes_sent, &slot->errors_missing_peak,
+        &slot->errors_multiple_peaks, &slot->errors_internal, &slot->ring_occupancy, &slot->ring_high_watermark };
+    for (size_t k = 0; k < sizeof(counters) / sizeof(counters[0]); k++) {
+        counters[k]->store(0);
+    }
+    for (int s = 0; s < METRICS_STAGES; s++) {
+        for (int b = 0; b <= METRICS_TIME_BUCKETS; b++) {
+            slot->stages[s].buckets[b].store(0);
+        }
+        slot->stages[s].count.store(0);
+        slot->stages[s].sum_ns.store(0);
+    }
+    return slot;
+}
+
+static inline void metrics_add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static inline void metrics_set(std::atomic<uint64_t>& gauge, uint64_t value) {
+    gauge.store(value, std::memory_order_relaxed);
+}
+
+static inline void metricsTime_add(struct metrics_time_t* time, uint64_t ns) {
+    int b = 0;
+    while (b < METRICS_TIME_BUCKETS && ns > metrics_time_bounds_ns[b]) {
+        b++;
+    }
+    metrics_add(time->buckets[b], 1);
+    metrics_add(time->count, 1);
+    metrics_add(time->sum_ns, ns);
+}
+
+static inline void metricsError_add(struct metrics_slot_t* slot, const char* error_payload) {
+    uint32_t error_id;
+    uint8_t channel, fiber, sensor;
+    decodePacket_errorPayload(error_payload, &error_id, &channel, &fiber, &sensor);
+    if (error_id == I4_ERROR_MISSING_PEAK) {
+        metrics_add(slot->errors_missing_peak, 1);
+    }
+    else if (error_id == I4_ERROR_MULTIPLE_PEAKS) {
+        metrics_add(slot->errors_multiple_peaks, 1);
+    }
+    else {
+        metrics_add(slot->errors_internal, 1);
+    }
+}
+
+/* returns 0, or -1 if out of memory */
+static inline int metricsResponse_append(struct metrics_t* metrics, const char* format, ...) {
+    while (1) {
+        uint32_t room = metrics->response_capacity - metrics->response_size;
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(metrics->response + metrics->response_size, room, format, args);
+        va_end(args);
+        if (length < 0) {
+            return -1;
+        }
+        if ((uint32_t)length < room) {
+            metrics->response_size += (uint32_t)length;
+            return 0;
+        }
+        char* grown = (char*)realloc(metrics->response, metrics->response_capacity * 2);
+        if (grown == NULL) {
+            return -1;
+        }
+        metrics->response = grown;
+        metrics->response_capacity *= 2;
+    }
+}
+
+static inline int metrics_render(struct metrics_t* metrics) {
+    static const char* const stage_names[METRICS_STAGES] = { "recv", "decode", "send" };
+    struct counter_t {
+        const char* name;
+        const char* type;
+        const char* help;
+        size_t offset;
+        const char* label; // extra label, e.g. the error type
+    };
+    static const counter_t counters[] = {
+        { "fbg_received_bytes_total", "counter", "Bytes received from the I4 units", offsetof(metrics_slot_t, bytes_received), NULL },
+        { "fbg_received_sweeps_total", "counter", "Complete sweep frames received", offsetof(metrics_slot_t, sweeps_received), NULL },
+        { "fbg_dropped_sweeps_total", "counter", "Sweeps dropped because the ring was full", offsetof(metrics_slot_t, sweeps_dropped), NULL },
+        { "fbg_decoded_peaks_total", "counter", "Peaks decoded (or detected on spectra)", offsetof(metrics_slot_t, peaks_decoded), NULL },
+        { "fbg_sent_messages_total", "counter", "Messages sent to the main server", offsetof(metrics_slot_t, messages_sent), NULL },
+        { "fbg_sent_bytes_total", "counter", "Bytes sent to the main server", offsetof(metrics_slot_t, bytes_sent), NULL },
+        { "fbg_i4_errors_total", "counter", "I4 error payloads by type", offsetof(metrics_slot_t, errors_missing_peak), "type=\"missing_peak\"" },
+        { "fbg_i4_errors_total", NULL, NULL, offsetof(metrics_slot_t, errors_multiple_peaks), "type=\"multiple_peaks\"" },
+        { "fbg_i4_errors_total", NULL, NULL, offsetof(metrics_slot_t, errors_internal), "type=\"internal\"" },
+        { "fbg_ring_occupancy", "gauge", "Sweeps waiting in the ring of the thread", offsetof(metrics_slot_t, ring_occupancy), NULL },
+        { "fbg_ring_high_watermark", "gauge", "Highest ring occupancy seen", offsetof(metrics_slot_t, ring_high_watermark), NULL },
+    };
+
+    metrics->response_size = 0;
+    int result = 0;
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+        if (counters[c].type != NULL) {
+            result |= metricsResponse_append(metrics, "# HELP %s %s\n# TYPE %s %s\n",
+                counters[c].name, counters[c].help, counters[c].name, counters[c].type);
+        }
+        for (uint32_t k = 0; k < metrics->slot_count; k++) {
+            const struct metrics_slot_t* slot = &metrics->slots[k];
+            const std::atomic<uint64_t>* value = (const std::atomic<uint64_t>*)((const char*)slot + counters[c].offset);
+            result |= metricsResponse_append(metrics, "%s{thread=\"%s\"%s%s} %llu\n", counters[c].name, slot->name,
+                counters[c].label != NULL ? "," : "", counters[c].label != NULL ? counters[c].label : "",
+                (unsigned long long)value->load(std::memory_order_relaxed));
+        }
+    }
+
+    result |= metricsResponse_append(metrics, "# HELP fbg_stage_seconds Time per sweep in each pipeline stage\n"
+        "# TYPE fbg_stage_seconds histogram\n");
+    for (uint32_t k = 0; k < metrics->slot_count; k++) {
+        const struct metrics_slot_t* slot = &metrics->slots[k];
+        for (int s = 0; s < METRICS_STAGES; s++) {
+            const struct metrics_time_t* time = &slot->stages[s];
+            uint64_t count = time->count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue; // stage not run by this thread
+            }
+            uint64_t cumulative = 0;
+            for (int b = 0; b < METRICS_TIME_BUCKETS; b++) {
+                cumulative += time->buckets[b].load(std::memory_order_relaxed);
+                result |= metricsResponse_append(metrics, "fbg_stage_seconds_bucket{thread=\"%s\",stage=\"%s\",le=\"%g\"} %llu\n",
+                    slot->name, stage_names[s], metrics_time_bounds_ns[b] * 1e-9, (unsigned long long)cumulative);
+            }
+            cumulative += time->buckets[METRICS_TIME_BUCKETS].load(std::memory_order_relaxed);
+            // the buckets are read one by one while the thread goes on, keep the exposition consistent
+            count = cumulative > count ? cumulative : count;
+            result |= metricsResponse_append(metrics, "fbg_stage_seconds_bucket{thread=\"%s\",stage=\"%s\",le=\"+Inf\"} %llu\n"
+                "fbg_stage_seconds_sum{thread=\"%s\",stage=\"%s\"} %.9f\n"
+                "fbg_stage_seconds_count{thread=\"%s\",stage=\"%s\"} %llu\n",
+                slot->name, stage_names[s], (unsigned long long)count,
+                slot->name, stage_names[s], time->sum_ns.load(std::memory_order_relaxed) * 1e-9,
+                slot->name, stage_names[s], (unsigned long long)count);
+        }
+    }
+    result |= metricsResponse_append(metrics, "# HELP fbg_metrics_scrapes_total Requests answered by this endpoint\n"
+        "# TYPE fbg_metrics_scrapes_total counter\nfbg_metrics_scrapes_total %llu\n", (unsigned long long)metrics->scrapes);
+    return result;
+}
+
+static inline void metrics_answer(struct metrics_t* metrics, SOCKET hClient) {
+    // the request itself does not matter, every path gets the metrics; read its head so the client sees a clean close
+    char request[METRICS_REQUEST_SIZE];
+    int received = 0;
+    while (received < (int)sizeof(request) - 1) {
+        int bytesRead = recv(hClient, request + received, (int)sizeof(request) - 1 - received, 0);
+        if (bytesRead <= 0) {
+            return;
+        }
+        received += bytesRead;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+            break;
+        }
+    }
+
+    metrics->scrapes++;
+    if (metrics_render(metrics) != 0) {
+        return;
+    }
+    char head[160];
+    int head_length = snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %u\r\nConnection: close\r\n\r\n", metrics->response_size);
+    const char* parts[2] = { head, metrics->response };
+    int lengths[2] = { head_length, (int)metrics->response_size };
+    for (int p = 0; p < 2; p++) {
+        int sent = 0;
+        while (sent < lengths[p]) {
+            int bytesSent = send(hClient, parts[p] + sent, lengths[p] - sent, 0);
+            if (bytesSent <= 0) {
+                return;
+            }
+            sent += bytesSent;
+        }
+    }
+}
+
+static inline void metrics_thread(struct metrics_t* metrics) {
+    while (metrics->running.load()) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(metrics->hSocket, &readable);
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = METRICS_ACCEPT_TIMEOUT_MS * 1000;
+        if (select((int)metrics->hSocket + 1, &readable, NULL, NULL, &timeout) <= 0) {
+            continue;
+        }
+        SOCKET hClient = accept(metrics->hSocket, NULL, NULL);
+        if (hClient == INVALID_SOCKET) {
+            continue;
+        }
+        metrics_answer(metrics, hClient); // one scraper at a time, each answer takes well under a millisecond
+        closesocket(hClient);
+    }
+}
+
+/* returns 0, or -1 if the port can't be opened */
+static inline int metrics_serve(struct metrics_t* metrics, uint16_t port) {
+    metrics->response = (char*)malloc(METRICS_INITIAL_RESPONSE);
+    if (metrics->response == NULL) {
+        return -1;
+    }
+    metrics->response_capacity = METRICS_INITIAL_RESPONSE;
+
+    SOCKET hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (hSocket == INVALID_SOCKET) {
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(hSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(hSocket, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR || listen(hSocket, 4) == SOCKET_ERROR) {
+        closesocket(hSocket);
+        return -1;
+    }
+    metrics->hSocket = hSocket;
+    metrics->port = port;
+    metrics->running.store(true);
+    metrics->thread = std::thread(metrics_thread, metrics);
+    return 0;
+}
+
+static inline void metrics_stop(struct metrics_t* metrics) {
+    if (metrics->running.load()) {
+        metrics->running.store(false);
+        metrics->thread.join();
+    }
+    if (metrics->hSocket != INVALID_SOCKET) {
+        closesocket(metrics->hSocket);
+        metrics->hSocket = INVALID_SOCKET;
+    }
+    free(metrics->response);
+    metrics->response = NULL;
+    metrics->response_capacity = 0;
+}
+
+#endif // PIPELINE_METRICS_H
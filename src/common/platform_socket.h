@@ -0,0 +1,94 @@
+/*
+File    : platform_socket.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only socket layer of Windows (Winsock) and Linux (BSD sockets) (C / C++)
+
+The programs are written against the Winsock names; on Linux this header maps them onto
+the BSD socket calls, so the same sources build on both :
+
+- SOCKET, INVALID_SOCKET, SOCKET_ERROR, SOCKADDR, SOCKADDR_IN, SD_BOTH
+- WSAStartup / WSACleanup    : no-ops on Linux (WSAStartup also ignores SIGPIPE, so a send()
+                               to a closed peer fails with EPIPE instead of ending the process)
+- WSAGetLastError            : errno
+- closesocket                : close
+- Sleep                      : milliseconds, as on Windows
+
+Non-blocking sockets and the readiness of many : ../common/socket_poller.h (I/O completion port / epoll).
+*/
+
+#ifndef PLATFORM_SOCKET_H
+#define PLATFORM_SOCKET_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+typedef int SOCKET;
+typedef struct sockaddr SOCKADDR;
+typedef struct sockaddr_in SOCKADDR_IN;
+typedef struct { int unused; } WSADATA;
+typedef unsigned long DWORD;
+typedef unsigned short WORD;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_BOTH SHUT_RDWR
+#define MAKEWORD(low, high) ((WORD)(((low) & 0xff) | (((high) & 0xff) << 8)))
+#endif
+
+
+/* =============================================================================
+* Function Descriptions (Linux) :
+* ------------------------------------------------------------------------------
+* WSAStartup, WSACleanup : Ignore SIGPIPE / nothing, always succeed.
+* WSAGetLastError : errno of the last failed call.
+* closesocket : Closes the socket descriptor.
+* Sleep : Waits 'ms' milliseconds.
+* ==============================================================================
+*/
+
+#ifndef _WIN32
+static inline int WSAStartup(WORD version, WSADATA* data) {
+    (void)version;
+    (void)data;
+    signal(SIGPIPE, SIG_IGN);
+    return 0;
+}
+
+static inline int WSACleanup(void) {
+    return 0;
+}
+
+static inline int WSAGetLastError(void) {
+    return errno;
+}
+
+static inline int closesocket(SOCKET hSocket) {
+    return close(hSocket);
+}
+
+static inline void Sleep(DWORD ms) {
+    struct timespec delay;
+    delay.tv_sec = (time_t)(ms / 1000);
+    delay.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
+#endif
+
+#endif // PLATFORM_SOCKET_H
@@ -0,0 +1,251 @@
+/*
+File    : sensor_stats.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only streaming per-sensor statistics and drift tare (C / C++)
+
+Follows the wavelength of every sensor of a decoded peak stream with O(1) work per
+sample and no sample history :
+
+- mean / standard deviation since the start or the last tare (Welford's update)
+- exponentially weighted moving average, ewma += alpha * (x - ewma)
+- minimum / maximum over a sliding window of 'window' samples, kept as two tumbling
+  buckets of window / 2 samples : the reported extremes cover the last window / 2
+  to window samples
+
+Sensors get a slot the first time they are seen (up to STATS_MAX_SENSORS), found
+through a (channel, fiber, sensor) index of calibration table size.
+
+Tare (auto-zero) : statsTare() rebases the calibration of every sensor onto its EWMA
+with rebaseCalibration(), so a drift of the unloaded FBGs (temperature, ..) stops
+showing up as force, and restarts the mean / deviation of the tared sensors.
+
+encodeStatsMessage() writes the compact statistics message ('T', ../common/fbg_compact_protocol.h).
+*/
+
+#ifndef SENSOR_STATS_H
+#define SENSOR_STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+#include "i4_calibration.h"
+#include "fbg_compact_protocol.h"
+
+#define STATS_MAX_SENSORS 1024
+#define STATS_NO_SLOT 0xffff
+#define STATS_DEFAULT_ALPHA 0.01   // EWMA weight of a new sample (~100 sweeps time constant)
+#define STATS_DEFAULT_WINDOW 1000  // samples of the sliding min / max
+
+struct sensor_stats_t {
+    uint8_t channel, fiber, sensor;
+    uint32_t count;        // Welford samples
+    double mean;
+    double m2;             // sum of squared deviations from the mean
+    double ewma;           // NaN until the first sample
+    // sliding window, current and previous bucket
+    uint32_t bucket_count;
+    double min_current, max_current;
+    double min_previous, max_previous; // NaN until a bucket is complete
+};
+
+struct stats_engine_t {
+    struct sensor_stats_t* slots;
+    uint16_t* index;       // [CALIB_TABLE_SIZE], slot of (channel, fiber, sensor) or STATS_NO_SLOT
+    uint32_t count;
+    double alpha;
+    uint32_t half_window;
+    uint64_t sweeps;
+    uint64_t untracked;    // samples of sensors beyond STATS_MAX_SENSORS
+    uint32_t tares;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initStatsEngine, freeStatsEngine : Allocate/release the slots and the sensor index.
+* statsEngine_slot : Slot of (channel, fiber, sensor), added on first use; NULL if out of range or full.
+* statsReset : Restarts the mean / deviation of one sensor.
+* statsUpdate : Adds one sample to a sensor's statistics.
+* statsEngine_add : Adds every peak of a decoded sweep.
+* statsStd, statsWindowMin, statsWindowMax : Standard deviation / sliding extremes of a sensor.
+* statsTare : Rebases the calibration of every calibrated sensor onto its EWMA.
+* encodeStatsMessage : Writes the statistics message of all sensors.
+* ==============================================================================
+*/
+
+static inline void freeStatsEngine(struct stats_engine_t* engine) {
+    free(engine->slots);
+    free(engine->index);
+    engine->slots = NULL;
+    engine->index = NULL;
+    engine->count = 0;
+}
+
+/* window in samples (>= 2); returns 0, or -1 if allocation failed */
+static inline int initStatsEngine(struct stats_engine_t* engine, double alpha, uint32_t window) {
+    engine->slots = (struct sensor_stats_t*)malloc(STATS_MAX_SENSORS * sizeof(struct sensor_stats_t));
+    engine->index = (uint16_t*)malloc(CALIB_TABLE_SIZE * sizeof(uint16_t));
+    engine->count = 0;
+    engine->alpha = alpha;
+    engine->half_window = window < 2 ? 1 : window / 2;
+    engine->sweeps = 0;
+    engine->untracked = 0;
+    engine->tares = 0;
+    if (engine->slots == NULL || engine->index == NULL) {
+        fprintf(stderr, "Statistics allocation failed.\n");
+        freeStatsEngine(engine);
+        return -1;
+    }
+    for (uint32_t i = 0; i < CALIB_TABLE_SIZE; i++) {
+        engine->index[i] = STATS_NO_SLOT;
+    }
+    return 0;
+}
+
+static inline void statsReset(struct sensor_stats_t* stats) {
+    stats->count = 0;
+    stats->mean = 0.0;
+    stats->m2 = 0.0;
+}
+
+static inline struct sensor_stats_t* statsEngine_slot(struct stats_engine_t* engine, uint8_t channel, uint8_t fiber, uint8_t sensor) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0) {
+        return NULL;
+    }
+    if (engine->index[index] != STATS_NO_SLOT) {
+        return &engine->slots[engine->index[index]];
+    }
+    if (engine->count == STATS_MAX_SENSORS) {
+        return NULL;
+    }
+
+    struct sensor_stats_t* stats = &engine->slots[engine->count];
+    engine->index[index] = (uint16_t)engine->count++;
+    stats->channel = channel;
+    stats->fiber = fiber;
+    stats->sensor = sensor;
+    statsReset(stats);
+    stats->ewma = NAN;
+    stats->bucket_count = 0;
+    stats->min_current = INFINITY;
+    stats->max_current = -INFINITY;
+    stats->min_previous = NAN;
+    stats->max_previous = NAN;
+    return stats;
+}
+
+static inline void statsUpdate(struct sensor_stats_t* stats, double value, double alpha, uint32_t half_window) {
+    // Welford
+    stats->count++;
+    double delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    stats->ewma = isnan(stats->ewma) ? value : stats->ewma + alpha * (value - stats->ewma);
+
+    if (value < stats->min_current) stats->min_current = value;
+    if (value > stats->max_current) stats->max_current = value;
+    if (++stats->bucket_count == half_window) {
+        stats->min_previous = stats->min_current;
+        stats->max_previous = stats->max_current;
+        stats->min_current = INFINITY;
+        stats->max_current = -INFINITY;
+        stats->bucket_count = 0;
+    }
+}
+
+/* wavelengths of one decoded sweep, NaN peaks are skipped */
+static inline void statsEngine_add(struct stats_engine_t* engine, const peak_batch_t* peaks) {
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        double value = peaks->wavelength[i];
+        if (isnan(value)) {
+            continue;
+        }
+        struct sensor_stats_t* stats = statsEngine_slot(engine, peaks->channel[i], peaks->fiber[i], peaks->sensor[i]);
+        if (stats == NULL) {
+            engine->untracked++;
+            continue;
+        }
+        statsUpdate(stats, value, engine->alpha, engine->half_window);
+    }
+    engine->sweeps++;
+}
+
+static inline double statsStd(const struct sensor_stats_t* stats) {
+    return stats->count > 1 ? sqrt(stats->m2 / (stats->count - 1)) : 0.0;
+}
+
+static inline double statsWindowMin(const struct sensor_stats_t* stats) {
+    if (stats->bucket_count == 0) {
+        return stats->min_previous;
+    }
+    // the current bucket alone until the first one is complete
+    return isnan(stats->min_previous) || stats->min_current < stats->min_previous ? stats->min_current : stats->min_previous;
+}
+
+static inline double statsWindowMax(const struct sensor_stats_t* stats) {
+    if (stats->bucket_count == 0) {
+        return stats->max_previous;
+    }
+    return isnan(stats->max_previous) || stats->max_current > stats->max_previous ? stats->max_current : stats->max_previous;
+}
+
+/* returns the number of sensors rebased; the table must not be in use by another thread */
+static inline uint32_t statsTare(struct stats_engine_t* engine, struct calibration_table_t* table) {
+    uint32_t rebased = 0;
+    for (uint32_t s = 0; s < engine->count; s++) {
+        struct sensor_stats_t* stats = &engine->slots[s];
+        if (!isnan(stats->ewma) && rebaseCalibration(table, stats->channel, stats->fiber, stats->sensor, stats->ewma) == 0) {
+            statsReset(stats);
+            rebased++;
+        }
+    }
+    engine->tares++;
+    return rebased;
+}
+
+/* 'out' holds compactStatsSize(engine->count) bytes, 'table' may be NULL; returns the bytes written */
+static inline uint32_t encodeStatsMessage(const struct stats_engine_t* engine, const struct calibration_table_t* table,
+    uint32_t sweep_counter, char* out) {
+    uint32_t count = engine->count > COMPACT_MAX_SENSORS ? COMPACT_MAX_SENSORS : engine->count;
+    struct compact_sweep_header_t header; // same layout as the sweep header
+    header.type = COMPACT_MSG_STATS;
+    header.sweep_counter = sweep_counter;
+    header.count = (uint16_t)count;
+    memcpy(out, &header, sizeof(header));
+
+    char* entry = out + COMPACT_STATS_HEADER_SIZE;
+    for (uint32_t s = 0; s < count; s++, entry += COMPACT_STATS_ENTRY_SIZE) {
+        const struct sensor_stats_t* stats = &engine->slots[s];
+        struct compact_stats_entry_t e;
+        e.channel = stats->channel;
+        e.fiber = stats->fiber;
+        e.sensor = stats->sensor;
+        e.samples = stats->count;
+        e.mean = stats->count > 0 ? stats->mean : NAN;
+        e.std = statsStd(stats);
+        e.ewma = stats->ewma;
+        e.min = statsWindowMin(stats);
+        e.max = statsWindowMax(stats);
+        e.base = NAN;
+        e.force = NAN;
+        if (table != NULL) {
+            int32_t index = calibrationIndex(stats->channel, stats->fiber, stats->sensor);
+            e.base = table->base_wavelength[index];
+            e.force = calibrationForce(table, stats->channel, stats->fiber, stats->sensor, stats->ewma);
+        }
+        memcpy(entry, &e, sizeof(e));
+    }
+    return compactStatsSize(count);
+}
+
+#endif // SENSOR_STATS_H
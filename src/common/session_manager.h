@@ -0,0 +1,633 @@
+/*
+File    : session_manager.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Header-only reconnecting TCP sessions with bounded outbound queues (C++11)
+
+Keeps the connections of the forwarder alive without blocking the thread that uses them :
+
+- session_backoff_t : exponential backoff between connection attempts, from
+  SESSION_BACKOFF_INITIAL_MS doubling up to SESSION_BACKOFF_MAX_MS, reset by a success.
+- sessionConnect_start / sessionConnect_result : non-blocking connect() of a new socket and
+  its completion, polled without waiting (select() for writability, then SO_ERROR). The
+  ingest thread reconnects its I4 units with these between two polls of the others.
+- server_session_t : the outgoing connection to the main server. serverSession_send() hands
+  one whole message to the session :
+    - write-through : when connected and nothing is queued, the caller send()s it right away
+      on the non-blocking socket, so an idle link adds no thread hop to the latency;
+    - otherwise (socket buffer full, or disconnected) the message goes into a bounded queue of
+      whole messages, drained by the session thread. When the queue is full the policy decides :
+      SESSION_POLICY_BLOCK waits for room (the forwarder then backs up into its sweep rings,
+      whose drops are counted), SESSION_POLICY_DROP_OLDEST / _NEWEST lose whole messages.
+      serverSession_requestStop() ends such a wait, so a shutdown does not hang on a main
+      server that is down and reconnecting.
+  On a broken connection the session thread closes it and reconnects with backoff; the
+  message cut on the old connection is lost, the new one starts on a message boundary and
+  'generation' is bumped so the compact layouts are sent again.
+
+A 'stateful' session carries messages that build on earlier ones (a compact sweep on the
+layout sent before it). Those are handed over with serverSession_sendFor() and the session
+generation they were encoded for : a message of an older generation is dropped, and so is
+everything still queued when the session reconnects or drops to a full queue, so a new
+connection or a gap always starts on freshly encoded layouts.
+
+Without reconnect (serverSession_init(.., reconnect = false)) a broken connection fails the
+session : serverSession_send() returns -1 from then on, as a failed send() did before.
+
+A session initialised without an address (NULL, client -N) is detached : there is no main
+server, serverSession_send() accepts and drops every message, counting it, and no thread runs.
+*/
+
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform_socket.h"
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "socket_poller.h"
+#include "low_latency.h"
+
+#define SESSION_POLICY_BLOCK 0
+#define SESSION_POLICY_DROP_OLDEST 1
+#define SESSION_POLICY_DROP_NEWEST 2
+
+#define SESSION_BACKOFF_INITIAL_MS 10
+#define SESSION_BACKOFF_MAX_MS 2000
+#define SESSION_CONNECT_TIMEOUT_MS 1000   // an attempt still pending after this counts as failed
+#define SESSION_POLL_MS 10                // longest wait of the session thread on a pending connect / full socket
+#define SESSION_IDLE_MS 100               // idle link : checked for a closed peer this often
+#define SESSION_DEFAULT_QUEUE_BYTES (4 * 1024 * 1024)
+#define SESSION_MAX_QUEUE_KIB (1024 * 1024)
+#define SESSION_SEND_CHUNK (256 * 1024)   // bytes moved out of the queue per send
+#define SESSION_DRAIN_TIMEOUT_MS 1000     // at stop, for the queued messages to go out
+#define SESSION_LENGTH_SIZE 4             // uint32_t length in front of every queued message
+#define SESSION_ADDRESS_SIZE 64
+#ifdef MSG_NOSIGNAL
+#define SESSION_SEND_FLAGS MSG_NOSIGNAL   // a vanished peer is a send() error, not SIGPIPE
+#else
+#define SESSION_SEND_FLAGS 0
+#endif
+
+struct session_backoff_t {
+    uint32_t delay_ms;        // before the next attempt
+    uint64_t next_ms;         // sessionTime_ms() of the next attempt
+    uint32_t failures;        // in a row
+};
+
+struct server_session_t {
+    char address[SESSION_ADDRESS_SIZE];
+    uint16_t port;
+    SOCKET hSocket;
+    int policy;
+    bool reconnect;
+    bool no_delay;            // TCP_NODELAY on every connection
+    bool stateful;            // messages depend on earlier ones : stale generations are dropped
+    bool detached;            // no main server
+
+    std::mutex lock;
+    std::condition_variable ready;   // queued data, or the session state changed
+    std::condition_variable room;    // queue space freed (SESSION_POLICY_BLOCK)
+    char* queue;              // byte ring of (uint32 length, message) records
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t size;
+    char* out;                // bytes on their way out, whole messages only
+    uint32_t out_capacity;
+    uint32_t out_size;
+    uint32_t out_sent;
+    bool connected;
+    bool failed;              // broken without reconnect
+    bool running;
+    std::atomic<bool> stopping; // serverSession_requestStop() : senders waiting for room give up
+    struct session_backoff_t backoff;
+    std::thread thread;
+
+    std::atomic<uint32_t> generation; // every (re)connect and every drop
+    uint64_t messages;        // handed to the session
+    uint64_t written_through; // sent by the caller without queueing
+    uint64_t dropped;         // lost to a full queue
+    uint64_t blocked;         // serverSession_send() calls that waited for room
+    uint64_t cut;             // connections broken with a message partly sent
+    uint64_t reconnects;
+    uint64_t bytes_sent;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* sessionTime_ms : Monotonic milliseconds.
+* sessionBackoff_init, sessionBackoff_failed, sessionBackoff_due : Delay between connection attempts.
+* sessionConnect_start : Starts a non-blocking connect() of a new socket.
+* sessionConnect_result : Whether a pending connect() completed, failed, or is still in progress.
+* sessionPeerClosed : Whether an idle connection was closed by its peer.
+* serverSession_init, serverSession_free : Queue and settings / release.
+* serverSession_connect : First connection, waiting up to a timeout.
+* serverSession_start, serverSession_stop : Session thread; stop drains the queue for a bounded time.
+* serverSession_requestStop : Makes the senders waiting for queue room return (shutdown).
+* serverSession_send : Sends or queues one whole message, applying the policy when the queue is full.
+* serverSession_sendFor : Same, for a message encoded at a given generation (stateful sessions).
+* sessionQueue_write, sessionQueue_read : Copy into / out of the byte ring.
+* sessionQueue_clear : Drops every queued message (lock held).
+* serverSession_disconnect : Closes a broken connection (lock held).
+* serverSession_thread : Sends the queued messages and reconnects.
+* serverSession_print : One line of counters.
+* ==============================================================================
+*/
+
+static inline uint64_t sessionTime_ms(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void sessionBackoff_init(struct session_backoff_t* backoff) {
+    backoff->delay_ms = SESSION_BACKOFF_INITIAL_MS;
+    backoff->next_ms = 0;
+    backoff->failures = 0;
+}
+
+/* an attempt failed or a connection broke at 'now_ms' : the next attempt waits, twice as long as the last */
+static inline void sessionBackoff_failed(struct session_backoff_t* backoff, uint64_t now_ms) {
+    backoff->next_ms = now_ms + backoff->delay_ms;
+    backoff->delay_ms = backoff->delay_ms * 2 > SESSION_BACKOFF_MAX_MS ? SESSION_BACKOFF_MAX_MS : backoff->delay_ms * 2;
+    backoff->failures++;
+}
+
+static inline bool sessionBackoff_due(const struct session_backoff_t* backoff, uint64_t now_ms) {
+    return now_ms >= backoff->next_ms;
+}
+
+/* returns 1 if connected at once, 0 if in progress, -1 on failure; *hSocket is then non-blocking */
+static inline int sessionConnect_start(const char* address, uint16_t port, SOCKET* hSocket) {
+    SOCKADDR_IN serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &serverAddr.sin_addr) <= 0) {
+        return -1;
+    }
+    *hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (*hSocket == INVALID_SOCKET) {
+        return -1;
+    }
+    if (socketSetNonBlocking(*hSocket) != 0) {
+        closesocket(*hSocket);
+        *hSocket = INVALID_SOCKET;
+        return -1;
+    }
+    if (connect(*hSocket, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == 0) {
+        return 1;
+    }
+#ifdef _WIN32
+    if (WSAGetLastError() == WSAEWOULDBLOCK) {
+#else
+    if (errno == EINPROGRESS) {
+#endif
+        return 0;
+    }
+    closesocket(*hSocket);
+    *hSocket = INVALID_SOCKET;
+    return -1;
+}
+
+/* waits up to 'timeout_ms'; returns 1 once connected, 0 while in progress, -1 if the attempt failed */
+static inline int sessionConnect_result(SOCKET hSocket, int timeout_ms) {
+    fd_set writable, failed;
+    FD_ZERO(&writable);
+    FD_ZERO(&failed);
+    FD_SET(hSocket, &writable);
+    FD_SET(hSocket, &failed); // Windows reports a refused connect() here
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    int ready = select((int)hSocket + 1, NULL, &writable, &failed, &timeout);
+    if (ready == 0) {
+        return 0;
+    }
+#ifndef _WIN32
+    if (ready < 0 && errno == EINTR) {
+        return 0;
+    }
+#endif
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (ready < 0 || FD_ISSET(hSocket, &failed)
+        || getsockopt(hSocket, SOL_SOCKET, SO_ERROR, (char*)&error, &length) != 0 || error != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+/* a non-blocking socket nobody sends on : returns true once the peer closed it */
+static inline bool sessionPeerClosed(SOCKET hSocket) {
+    char byte;
+    int result = recv(hSocket, &byte, 1, MSG_PEEK);
+    return result == 0 || (result == SOCKET_ERROR && !socketWouldBlock());
+}
+
+static inline void serverSession_free(struct server_session_t* session) {
+    free(session->queue);
+    free(session->out);
+    session->queue = NULL;
+    session->out = NULL;
+    if (session->hSocket != INVALID_SOCKET) {
+        closesocket(session->hSocket);
+        session->hSocket = INVALID_SOCKET;
+    }
+}
+
+/* returns 0, or -1 if the address is invalid or allocation failed */
+static inline int serverSession_init(struct server_session_t* session, const char* address, uint16_t port, int policy,
+    uint32_t capacity, bool reconnect, bool no_delay) {
+    if (address != NULL && strlen(address) >= SESSION_ADDRESS_SIZE) {
+        return -1;
+    }
+    strcpy(session->address, address != NULL ? address : "");
+    session->detached = address == NULL;
+    session->port = port;
+    session->hSocket = INVALID_SOCKET;
+    session->policy = policy;
+    session->reconnect = reconnect;
+    session->no_delay = no_delay;
+    session->stateful = false;
+    session->queue = (char*)malloc(capacity);
+    session->capacity = capacity;
+    session->head = 0;
+    session->size = 0;
+    session->out = (char*)malloc(SESSION_SEND_CHUNK);
+    session->out_capacity = SESSION_SEND_CHUNK;
+    session->out_size = 0;
+    session->out_sent = 0;
+    session->connected = false;
+    session->failed = false;
+    session->running = false;
+    session->stopping.store(false);
+    sessionBackoff_init(&session->backoff);
+    session->generation.store(0);
+    session->messages = 0;
+    session->written_through = 0;
+    session->dropped = 0;
+    session->blocked = 0;
+    session->cut = 0;
+    session->reconnects = 0;
+    session->bytes_sent = 0;
+    if (session->queue == NULL || session->out == NULL) {
+        fprintf(stderr, "Session queue allocation failed.\n");
+        serverSession_free(session);
+        return -1;
+    }
+    return 0;
+}
+
+/* returns 0 once connected, or -1 if the server could not be reached within 'timeout_ms' */
+static inline int serverSession_connect(struct server_session_t* session, int timeout_ms) {
+    int result = sessionConnect_start(session->address, session->port, &session->hSocket);
+    if (result == 0) {
+        result = sessionConnect_result(session->hSocket, timeout_ms);
+    }
+    if (result != 1) {
+        if (session->hSocket != INVALID_SOCKET) {
+            closesocket(session->hSocket);
+            session->hSocket = INVALID_SOCKET;
+        }
+        return -1;
+    }
+    if (session->no_delay && socketSetNoDelay(session->hSocket) != 0) {
+        fprintf(stderr, "TCP_NODELAY failed for %s:%u (%d).\n", session->address, session->port, WSAGetLastError());
+    }
+    session->connected = true;
+    return 0;
+}
+
+static inline void sessionQueue_write(struct server_session_t* session, const char* data, uint32_t length) {
+    uint32_t tail = (session->head + session->size) % session->capacity;
+    uint32_t first = session->capacity - tail < length ? session->capacity - tail : length;
+    memcpy(session->queue + tail, data, first);
+    memcpy(session->queue, data + first, length - first);
+    session->size += length;
+}
+
+/* out == NULL only skips the bytes */
+static inline void sessionQueue_read(struct server_session_t* session, char* out, uint32_t length) {
+    if (out != NULL) {
+        uint32_t first = session->capacity - session->head < length ? session->capacity - session->head : length;
+        memcpy(out, session->queue + session->head, first);
+        memcpy(out + first, session->queue, length - first);
+    }
+    session->head = (session->head + length) % session->capacity;
+    session->size -= length;
+}
+
+/* with the lock held : returns the number of messages dropped */
+static inline uint32_t sessionQueue_clear(struct server_session_t* session) {
+    uint32_t count = 0;
+    while (session->size > 0) {
+        uint32_t length;
+        sessionQueue_read(session, (char*)&length, SESSION_LENGTH_SIZE);
+        sessionQueue_read(session, NULL, length);
+        count++;
+    }
+    session->room.notify_all();
+    return count;
+}
+
+/* with the lock held : the connection broke */
+static inline void serverSession_disconnect(struct server_session_t* session, const char* reason) {
+    if (!session->connected) {
+        return;
+    }
+    closesocket(session->hSocket);
+    session->hSocket = INVALID_SOCKET;
+    session->connected = false;
+    if (session->out_sent > 0 && session->out_sent < session->out_size) {
+        session->cut++;
+    }
+    session->out_size = 0; // the rest of a message cut on the old connection is worthless on a new one
+    session->out_sent = 0;
+    sessionBackoff_failed(&session->backoff, sessionTime_ms());
+    if (!session->reconnect) {
+        session->failed = true;
+        session->room.notify_all();
+    }
+    fprintf(stderr, "Connection to %s:%u lost (%s)%s\n", session->address, session->port, reason,
+        session->reconnect ? ", reconnecting" : "");
+}
+
+/* returns 0 (sent, queued or dropped by the policy), or -1 if the session failed or is stopping;
+   'generation' is the one the message was encoded for, older ones are dropped by a stateful session */
+static inline int serverSession_sendFor(struct server_session_t* session, const char* data, uint32_t length, uint32_t generation) {
+    std::unique_lock<std::mutex> guard(session->lock);
+    if (session->failed) {
+        return -1;
+    }
+    session->messages++;
+    if (session->detached) {
+        return 0;
+    }
+    if (session->stateful && generation != session->generation.load()) {
+        session->dropped++; // built on a layout the peer may not have : the next one is encoded afresh
+        return 0;
+    }
+    if (session->connected && session->size == 0 && session->out_sent == session->out_size) {
+        // write-through : nothing ahead of it
+        int bytesSent = send(session->hSocket, data, (int)length, SESSION_SEND_FLAGS);
+        if (bytesSent == (int)length) {
+            session->bytes_sent += length;
+            session->written_through++;
+            return 0;
+        }
+        if (bytesSent > 0 || socketWouldBlock()) {
+            // the rest goes first, from the session thread
+            uint32_t sent = bytesSent > 0 ? (uint32_t)bytesSent : 0;
+            if (length > session->out_capacity) {
+                char* grown = (char*)realloc(session->out, length);
+                if (grown == NULL) {
+                    serverSession_disconnect(session, "no memory");
+                    return session->failed ? -1 : 0;
+                }
+                session->out = grown;
+                session->out_capacity = length;
+            }
+            memcpy(session->out, data, length);
+            session->out_size = length;
+            session->out_sent = sent;
+            session->bytes_sent += sent;
+            session->ready.notify_all();
+            return 0;
+        }
+        serverSession_disconnect(session, "send failed");
+        if (session->failed) {
+            return -1;
+        }
+    }
+
+    uint32_t needed = SESSION_LENGTH_SIZE + length;
+    if (needed > session->capacity) {
+        session->dropped++;
+        session->generation++;
+        return 0;
+    }
+    if (session->size + needed > session->capacity) {
+        if (session->policy == SESSION_POLICY_DROP_NEWEST) {
+            session->dropped++;
+            session->generation++;
+            return 0;
+        }
+        if (session->policy == SESSION_POLICY_DROP_OLDEST && session->stateful) {
+            // the queued messages may hold the layouts the newer ones build on : all go
+            session->dropped += sessionQueue_clear(session) + 1;
+            session->generation++;
+            return 0;
+        }
+        if (session->policy == SESSION_POLICY_DROP_OLDEST) {
+            while (session->size + needed > session->capacity) {
+                uint32_t oldest;
+                sessionQueue_read(session, (char*)&oldest, SESSION_LENGTH_SIZE);
+                sessionQueue_read(session, NULL, oldest);
+                session->dropped++;
+            }
+            session->generation++;
+        }
+        else {
+            session->blocked++;
+            // re-checked every SESSION_POLL_MS : serverSession_requestStop() notifies without the lock
+            while (!session->room.wait_for(guard, std::chrono::milliseconds(SESSION_POLL_MS), [session, needed] {
+                return session->size + needed <= session->capacity || session->failed || !session->running
+                    || session->stopping.load();
+            })) {
+            }
+            if (session->size + needed > session->capacity) {
+                return -1;
+            }
+            if (session->stateful && generation != session->generation.load()) {
+                session->dropped++; // reconnected while waiting
+                return 0;
+            }
+        }
+    }
+    sessionQueue_write(session, (const char*)&length, SESSION_LENGTH_SIZE);
+    sessionQueue_write(session, data, length);
+    session->ready.notify_all();
+    return 0;
+}
+
+static inline int serverSession_send(struct server_session_t* session, const char* data, uint32_t length) {
+    return serverSession_sendFor(session, data, length, session->generation.load());
+}
+
+static inline void serverSession_thread(struct server_session_t* session) {
+    std::unique_lock<std::mutex> guard(session->lock);
+    uint64_t drain_deadline = 0;
+    SOCKET pending = INVALID_SOCKET; // connect() in progress
+    uint64_t pending_since = 0;
+    while (!session->failed) {
+        if (!session->running) {
+            // stopping : whatever is queued goes out if the link allows, for a bounded time
+            if (drain_deadline == 0) {
+                drain_deadline = sessionTime_ms() + SESSION_DRAIN_TIMEOUT_MS;
+            }
+            if ((session->size == 0 && session->out_sent == session->out_size) || !session->connected
+                || sessionTime_ms() >= drain_deadline) {
+                break;
+            }
+        }
+
+        if (!session->connected) {
+            uint64_t now = sessionTime_ms();
+            if (pending == INVALID_SOCKET && !sessionBackoff_due(&session->backoff, now)) {
+                uint64_t wait = session->backoff.next_ms - now;
+                session->ready.wait_for(guard, std::chrono::milliseconds(wait < SESSION_POLL_MS ? wait : SESSION_POLL_MS));
+                continue;
+            }
+            guard.unlock();
+            int result;
+            if (pending == INVALID_SOCKET) {
+                result = sessionConnect_start(session->address, session->port, &pending);
+                pending_since = now;
+            }
+            else {
+                result = sessionConnect_result(pending, SESSION_POLL_MS);
+            }
+            if (result == 0 && sessionTime_ms() - pending_since >= SESSION_CONNECT_TIMEOUT_MS) {
+                result = -1;
+            }
+            if (result > 0 && session->no_delay) {
+                socketSetNoDelay(pending);
+            }
+            guard.lock();
+            if (result < 0) {
+                if (pending != INVALID_SOCKET) {
+                    closesocket(pending);
+                    pending = INVALID_SOCKET;
+                }
+                sessionBackoff_failed(&session->backoff, sessionTime_ms());
+            }
+            else if (result > 0) {
+                session->hSocket = pending;
+                pending = INVALID_SOCKET;
+                session->connected = true;
+                session->reconnects++;
+                session->generation++; // a new stream : the compact layouts go out again
+                if (session->stateful) {
+                    session->dropped += sessionQueue_clear(session); // encoded for the old stream
+                }
+                printf("Reconnected to %s:%u after %u attempts\n", session->address, session->port, session->backoff.failures);
+                sessionBackoff_init(&session->backoff);
+            }
+            continue;
+        }
+
+        if (session->out_sent == session->out_size) {
+            // whole messages only, so a drop never cuts one that is already on the wire
+            session->out_size = 0;
+            session->out_sent = 0;
+            while (session->size > 0) {
+                uint32_t next;
+                uint32_t head = session->head;
+                sessionQueue_read(session, (char*)&next, SESSION_LENGTH_SIZE);
+                if (session->out_size > 0 && session->out_size + next > session->out_capacity) {
+                    session->head = head; // put the length back, next round
+                    session->size += SESSION_LENGTH_SIZE;
+                    break;
+                }
+                if (next > session->out_capacity) {
+                    char* grown = (char*)realloc(session->out, next);
+                    if (grown == NULL) {
+                        sessionQueue_read(session, NULL, next);
+                        session->dropped++;
+                        continue;
+                    }
+                    session->out = grown;
+                    session->out_capacity = next;
+                }
+                sessionQueue_read(session, session->out + session->out_size, next);
+                session->out_size += next;
+            }
+            session->room.notify_all();
+            if (session->out_size == 0) {
+                if (session->running && !session->ready.wait_for(guard, std::chrono::milliseconds(SESSION_IDLE_MS),
+                    [session] { return session->size > 0 || session->out_sent < session->out_size || !session->running; })
+                    && sessionPeerClosed(session->hSocket)) {
+                    serverSession_disconnect(session, "closed by the peer");
+                }
+                continue;
+            }
+        }
+
+        // the socket is non-blocking : a send() under the lock never waits
+        int bytesSent = send(session->hSocket, session->out + session->out_sent, (int)(session->out_size - session->out_sent), SESSION_SEND_FLAGS);
+        if (bytesSent > 0) {
+            session->out_sent += (uint32_t)bytesSent;
+            session->bytes_sent += (uint64_t)bytesSent;
+        }
+        else if (bytesSent == SOCKET_ERROR && socketWouldBlock()) {
+            SOCKET hSocket = session->hSocket;
+            guard.unlock();
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(hSocket, &writable);
+            struct timeval timeout;
+            timeout.tv_sec = 0;
+            timeout.tv_usec = SESSION_POLL_MS * 1000;
+            select((int)hSocket + 1, NULL, &writable, NULL, &timeout);
+            guard.lock();
+        }
+        else {
+            serverSession_disconnect(session, "send failed");
+        }
+    }
+    if (pending != INVALID_SOCKET) {
+        closesocket(pending);
+    }
+    session->room.notify_all();
+}
+
+static inline void serverSession_start(struct server_session_t* session) {
+    if (session->detached) {
+        return;
+    }
+    session->running = true;
+    session->thread = std::thread(serverSession_thread, session);
+}
+
+/* from any thread (not a signal handler); queued messages still go out until serverSession_stop() */
+static inline void serverSession_requestStop(struct server_session_t* session) {
+    session->stopping.store(true);
+    session->room.notify_all();
+}
+
+static inline void serverSession_stop(struct server_session_t* session) {
+    {
+        std::lock_guard<std::mutex> guard(session->lock);
+        if (!session->running) {
+            return;
+        }
+        session->running = false;
+        session->ready.notify_all();
+        session->room.notify_all();
+    }
+    session->thread.join();
+}
+
+static inline void serverSession_print(const struct server_session_t* session, const char* name) {
+    if (session->detached) {
+        printf("%s : none, %llu messages not sent\n", name, (unsigned long long)session->messages);
+        return;
+    }
+    printf("%s : %llu messages (%llu written through), %llu dropped, %llu waits for room, %llu reconnects, %llu cut, %llu bytes sent\n",
+        name, (unsigned long long)session->messages, (unsigned long long)session->written_through,
+        (unsigned long long)session->dropped, (unsigned long long)session->blocked, (unsigned long long)session->reconnects,
+        (unsigned long long)session->cut, (unsigned long long)session->bytes_sent);
+}
+
+#endif // SESSION_MANAGER_H
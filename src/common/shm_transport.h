@@ -0,0 +1,484 @@
+/*
+File    : shm_transport.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only shared-memory transport of the decoded sweeps (C++11)
+
+For consumers on the same PC as the forwarder (-H <name>) : the decoded peaks of every
+forwarded sweep are written into a named mapping, which readers map and read without a
+system call (Windows : named file mapping 'name'; Linux : POSIX shared memory, /dev/shm/name).
+
+    shm_region_header_t    : SHM_HEADER_SIZE bytes, layout below; 'published' on its own cache line
+    snapshots              : 'devices' records, the latest sweep of each I4 unit
+    ring                   : 'slots' records (a power of two), every sweep in arrival order
+
+Every record is a shm_sweep_header_t followed by 'max_peaks' shm_peak_t (32 bytes each : ids,
+wavelength [nm], value [mN with a calibration, else nm, after the filters], time stamp [s]).
+Sweeps with more peaks are cut to max_peaks and counted.
+
+Each record is guarded by its own seqlock : the writer makes 'sequence' odd, writes the record,
+then makes it even again. A reader copies the record between two loads of 'sequence' and keeps
+the copy only if both are the same even value, so it never blocks the writer and never sees a
+half-written sweep. Ring records also carry their ring 'index' : a reader that fell more than
+'slots' sweeps behind skips to the oldest record still in the ring and counts the lost ones.
+
+There is one writer (the forwarder, under its send lock); any number of readers. The writer
+creates the mapping afresh at start and marks it SHM_STATE_CLOSED at exit; a reader that sees
+that re-opens the name to follow a restarted forwarder.
+*/
+
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <atomic>
+#include <new>
+
+#include "i4_peak_decoder.h"
+
+#define SHM_MAGIC "FBGSHM01"
+#define SHM_VERSION 1
+#define SHM_HEADER_SIZE 128
+#define SHM_CACHE_LINE 64
+#define SHM_DEFAULT_SLOTS 1024
+#define SHM_MAX_SLOTS (1u << 20)
+#define SHM_DEFAULT_MAX_PEAKS 256
+#define SHM_MAX_PEAKS 4096
+#define SHM_NAME_SIZE 128
+
+#define SHM_STATE_RUNNING 1
+#define SHM_STATE_CLOSED 2
+
+#define SHM_VALUE_WAVELENGTH 0 // value [nm]
+#define SHM_VALUE_FORCE 1      // value [mN]
+
+#if ATOMIC_INT_LOCK_FREE != 2 || ATOMIC_LLONG_LOCK_FREE != 2
+#error "the shared-memory transport needs lock-free 32 and 64-bit atomics"
+#endif
+
+struct shm_region_header_t {
+    char magic[8];                  // SHM_MAGIC, written last
+    uint32_t version;
+    uint32_t header_size;           // offset of the first snapshot
+    uint32_t record_size;           // bytes of one record
+    uint32_t max_peaks;
+    uint32_t devices;               // snapshot records
+    uint32_t slots;                 // ring records
+    uint64_t snapshot_offset;
+    uint64_t ring_offset;
+    uint64_t total_size;            // bytes of the mapping
+    uint32_t value_kind;            // SHM_VALUE_WAVELENGTH / SHM_VALUE_FORCE
+    uint32_t reserved;
+    // written on every sweep
+    alignas(SHM_CACHE_LINE) std::atomic<uint64_t> published; // sweeps written to the ring
+    std::atomic<uint32_t> state;    // SHM_STATE_RUNNING / SHM_STATE_CLOSED
+    uint32_t padding;
+    uint64_t truncated;             // sweeps cut to max_peaks
+};
+
+struct shm_sweep_header_t {
+    std::atomic<uint32_t> sequence; // seqlock, odd while the record is written
+    uint32_t sweep_counter;
+    uint64_t index;                 // ring position (snapshots : 'published' at the time)
+    uint64_t timestamp_ns;          // I4 header time stamp, ns since 1900-01-01
+    uint8_t device;
+    uint8_t sweep_type;
+    uint16_t count;                 // peaks that follow
+    uint32_t reserved;
+};
+
+struct shm_peak_t {
+    uint8_t channel;
+    uint8_t fiber;
+    uint8_t sensor;
+    uint8_t reserved[5];
+    double wavelength;              // nm
+    double value;                   // mN or nm, see value_kind
+    double timestamp;               // s, time-stamped peaks only, else 0
+};
+
+static_assert(sizeof(struct shm_region_header_t) == SHM_HEADER_SIZE, "shm_region_header_t must be SHM_HEADER_SIZE bytes");
+static_assert(offsetof(struct shm_region_header_t, published) == 64, "'published' must start the second cache line");
+static_assert(sizeof(struct shm_sweep_header_t) == 32, "shm_sweep_header_t must be 32 bytes");
+static_assert(sizeof(struct shm_peak_t) == 32, "shm_peak_t must be 32 bytes");
+
+// the mapping, as the writer or a reader holds it
+struct shm_mapping_t {
+    char name[SHM_NAME_SIZE];
+    char* base;
+    uint64_t size;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+};
+
+struct shm_writer_t {
+    struct shm_mapping_t mapping;
+    struct shm_region_header_t* header;
+    uint32_t mask;                  // slots - 1
+    uint64_t published;
+};
+
+struct shm_reader_t {
+    struct shm_mapping_t mapping;
+    const struct shm_region_header_t* header;
+    uint32_t mask;
+    uint64_t next;                  // ring index of the next record to read
+    uint64_t lost;                  // overwritten before they were read
+    uint64_t retries;               // copies redone because the writer was on the record
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* shmRecordSize : Bytes of one record with 'max_peaks' peaks.
+* shmMapping_create, shmMapping_open, shmMapping_close : Map the named region (writer / readers).
+* shmWriter_open : Creates the region and lays out its header, snapshots and ring.
+* shmWriter_publish : Writes one sweep into the ring and the snapshot of its unit.
+* shmWriter_close : Marks the region closed and unmaps it (the name is removed).
+* shmWriter_print : One line of counters.
+* shmRecord_write : Seqlock write of one record.
+* shmRecord_read : Seqlock copy of one record, 0 if the writer was on it.
+* shmReader_open, shmReader_close : Maps an existing region read-only, from its newest sweep on.
+* shmReader_snapshot : Copy of the latest sweep of a unit.
+* shmReader_next : Copy of the next sweep of the ring, 0 when there is none yet.
+* shmReader_closed : Whether the writer closed the region.
+* ==============================================================================
+*/
+
+static inline uint32_t shmRecordSize(uint32_t max_peaks) {
+    return (uint32_t)(sizeof(struct shm_sweep_header_t) + (size_t)max_peaks * sizeof(struct shm_peak_t));
+}
+
+/* returns 0, or -1 if the region can't be created */
+static inline int shmMapping_create(struct shm_mapping_t* mapping, const char* name, uint64_t size) {
+    mapping->base = NULL;
+    mapping->size = size;
+#ifdef _WIN32
+    snprintf(mapping->name, sizeof(mapping->name), "%s", name);
+    mapping->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, mapping->name);
+    if (mapping->handle == NULL || GetLastError() == ERROR_ALREADY_EXISTS) {
+        fprintf(stderr, "Shared memory '%s' can't be created (%lu%s).\n", name, GetLastError(),
+            mapping->handle != NULL ? ", another forwarder has it" : "");
+        if (mapping->handle != NULL) {
+            CloseHandle(mapping->handle);
+            mapping->handle = NULL;
+        }
+        return -1;
+    }
+    mapping->base = (char*)MapViewOfFile(mapping->handle, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+    if (mapping->base == NULL) {
+        CloseHandle(mapping->handle);
+        mapping->handle = NULL;
+        return -1;
+    }
+#else
+    snprintf(mapping->name, sizeof(mapping->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    shm_unlink(mapping->name); // a region left by a forwarder that did not exit : its readers keep the old one
+    mapping->fd = shm_open(mapping->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (mapping->fd < 0 || ftruncate(mapping->fd, (off_t)size) != 0) {
+        fprintf(stderr, "Shared memory '%s' can't be created (%d).\n", mapping->name, errno);
+        if (mapping->fd >= 0) {
+            close(mapping->fd);
+            shm_unlink(mapping->name);
+        }
+        mapping->fd = -1;
+        return -1;
+    }
+    void* base = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+    if (base == MAP_FAILED) {
+        close(mapping->fd);
+        shm_unlink(mapping->name);
+        mapping->fd = -1;
+        return -1;
+    }
+    mapping->base = (char*)base;
+#endif
+    return 0;
+}
+
+/* maps 'size' bytes of an existing region read-only (size 0 : its whole size), returns 0 or -1 */
+static inline int shmMapping_open(struct shm_mapping_t* mapping, const char* name, uint64_t size) {
+    mapping->base = NULL;
+#ifdef _WIN32
+    snprintf(mapping->name, sizeof(mapping->name), "%s", name);
+    mapping->handle = OpenFileMappingA(FILE_MAP_READ, FALSE, mapping->name);
+    if (mapping->handle == NULL) {
+        return -1;
+    }
+    mapping->base = (char*)MapViewOfFile(mapping->handle, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+    if (mapping->base == NULL) {
+        CloseHandle(mapping->handle);
+        mapping->handle = NULL;
+        return -1;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    mapping->size = size > 0 ? size : VirtualQuery(mapping->base, &info, sizeof(info)) != 0 ? (uint64_t)info.RegionSize : 0;
+#else
+    snprintf(mapping->name, sizeof(mapping->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    mapping->fd = shm_open(mapping->name, O_RDONLY, 0);
+    struct stat status;
+    if (mapping->fd < 0 || fstat(mapping->fd, &status) != 0 || (uint64_t)status.st_size < SHM_HEADER_SIZE) {
+        if (mapping->fd >= 0) {
+            close(mapping->fd);
+        }
+        mapping->fd = -1;
+        return -1;
+    }
+    mapping->size = size > 0 ? size : (uint64_t)status.st_size;
+    void* base = mmap(NULL, (size_t)mapping->size, PROT_READ, MAP_SHARED, mapping->fd, 0);
+    if (base == MAP_FAILED) {
+        close(mapping->fd);
+        mapping->fd = -1;
+        return -1;
+    }
+    mapping->base = (char*)base;
+#endif
+    return 0;
+}
+
+/* 'remove' : the writer, the name goes with it */
+static inline void shmMapping_close(struct shm_mapping_t* mapping, int remove) {
+    if (mapping->base == NULL) {
+        return;
+    }
+#ifdef _WIN32
+    (void)remove; // the mapping ends with its last handle
+    UnmapViewOfFile(mapping->base);
+    CloseHandle(mapping->handle);
+    mapping->handle = NULL;
+#else
+    munmap(mapping->base, (size_t)mapping->size);
+    close(mapping->fd);
+    mapping->fd = -1;
+    if (remove) {
+        shm_unlink(mapping->name);
+    }
+#endif
+    mapping->base = NULL;
+}
+
+/* returns 0, or -1 if the region can't be created; 'slots' is rounded up to a power of two */
+static inline int shmWriter_open(struct shm_writer_t* writer, const char* name, uint32_t slots, uint32_t max_peaks,
+    uint32_t devices, uint32_t value_kind) {
+    uint32_t ring_slots = 1;
+    while (ring_slots < slots) {
+        ring_slots <<= 1;
+    }
+    uint32_t record_size = shmRecordSize(max_peaks);
+    uint64_t snapshot_offset = SHM_HEADER_SIZE;
+    uint64_t ring_offset = snapshot_offset + (uint64_t)devices * record_size;
+    uint64_t total_size = ring_offset + (uint64_t)ring_slots * record_size;
+
+    writer->header = NULL;
+    if (shmMapping_create(&writer->mapping, name, total_size) != 0) {
+        return -1;
+    }
+    char* base = writer->mapping.base;
+    struct shm_region_header_t* header = new (base) shm_region_header_t;
+    header->version = SHM_VERSION;
+    header->header_size = SHM_HEADER_SIZE;
+    header->record_size = record_size;
+    header->max_peaks = max_peaks;
+    header->devices = devices;
+    header->slots = ring_slots;
+    header->snapshot_offset = snapshot_offset;
+    header->ring_offset = ring_offset;
+    header->total_size = total_size;
+    header->value_kind = value_kind;
+    header->reserved = 0;
+    header->published.store(0, std::memory_order_relaxed);
+    header->padding = 0;
+    header->truncated = 0;
+    for (uint32_t r = 0; r < devices + ring_slots; r++) {
+        struct shm_sweep_header_t* record = new (base + snapshot_offset + (uint64_t)r * record_size) shm_sweep_header_t;
+        record->sequence.store(0, std::memory_order_relaxed);
+    }
+    header->state.store(SHM_STATE_RUNNING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SHM_MAGIC, sizeof(header->magic)); // readers check it first
+
+    writer->header = header;
+    writer->mask = ring_slots - 1;
+    writer->published = 0;
+    return 0;
+}
+
+static inline void shmRecord_write(struct shm_sweep_header_t* record, uint64_t index, uint8_t device, int sweep_type,
+    uint32_t sweep_counter, uint64_t timestamp_ns, const peak_batch_t* peaks, const double* value, uint32_t count) {
+    uint32_t sequence = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // odd before any of the data
+
+    record->sweep_counter = sweep_counter;
+    record->index = index;
+    record->timestamp_ns = timestamp_ns;
+    record->device = device;
+    record->sweep_type = (uint8_t)sweep_type;
+    record->count = (uint16_t)count;
+    record->reserved = 0;
+    struct shm_peak_t* peak = (struct shm_peak_t*)(record + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        peak[i].channel = peaks->channel[i];
+        peak[i].fiber = peaks->fiber[i];
+        peak[i].sensor = peaks->sensor[i];
+        memset(peak[i].reserved, 0, sizeof(peak[i].reserved));
+        peak[i].wavelength = peaks->wavelength[i];
+        peak[i].value = value[i];
+        peak[i].timestamp = peaks->timestamp[i];
+    }
+
+    record->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/* one writer at a time; 'value' : the forwarded values of the peaks */
+static inline void shmWriter_publish(struct shm_writer_t* writer, uint8_t device, int sweep_type, uint32_t sweep_counter,
+    uint64_t timestamp_ns, const peak_batch_t* peaks, const double* value) {
+    struct shm_region_header_t* header = writer->header;
+    uint32_t count = peaks->count;
+    if (count > header->max_peaks) {
+        count = header->max_peaks;
+        header->truncated++;
+    }
+    char* base = writer->mapping.base;
+    uint64_t index = writer->published;
+    struct shm_sweep_header_t* slot = (struct shm_sweep_header_t*)(base + header->ring_offset
+        + (uint64_t)(index & writer->mask) * header->record_size);
+    shmRecord_write(slot, index, device, sweep_type, sweep_counter, timestamp_ns, peaks, value, count);
+    if (device < header->devices) {
+        struct shm_sweep_header_t* snapshot = (struct shm_sweep_header_t*)(base + header->snapshot_offset
+            + (uint64_t)device * header->record_size);
+        shmRecord_write(snapshot, index, device, sweep_type, sweep_counter, timestamp_ns, peaks, value, count);
+    }
+    writer->published = index + 1;
+    header->published.store(writer->published, std::memory_order_release);
+}
+
+static inline void shmWriter_close(struct shm_writer_t* writer) {
+    if (writer->header == NULL) {
+        return;
+    }
+    writer->header->state.store(SHM_STATE_CLOSED, std::memory_order_release);
+    shmMapping_close(&writer->mapping, 1);
+    writer->header = NULL;
+}
+
+static inline void shmWriter_print(const struct shm_writer_t* writer) {
+    if (writer->header == NULL) {
+        return;
+    }
+    printf("Shared memory %s : %llu sweeps, %llu cut to %u peaks, %u ring slots\n", writer->mapping.name,
+        (unsigned long long)writer->published, (unsigned long long)writer->header->truncated,
+        writer->header->max_peaks, writer->header->slots);
+}
+
+/* copies the record into 'out' (record_size bytes), returns 1, or 0 if the writer was on it */
+static inline int shmRecord_read(const struct shm_sweep_header_t* record, uint32_t max_peaks, struct shm_sweep_header_t* out) {
+    uint32_t before = record->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return 0;
+    }
+    // the atomic itself is not copied : the rest of the record as plain bytes
+    memcpy((char*)out + sizeof(out->sequence), (const char*)record + sizeof(record->sequence),
+        sizeof(struct shm_sweep_header_t) - sizeof(record->sequence));
+    uint32_t count = out->count <= max_peaks ? out->count : max_peaks;
+    memcpy((char*)(out + 1), (const char*)(record + 1), (size_t)count * sizeof(struct shm_peak_t));
+    std::atomic_thread_fence(std::memory_order_acquire); // the copy before the second load
+    if (record->sequence.load(std::memory_order_relaxed) != before) {
+        return 0;
+    }
+    out->count = (uint16_t)count;
+    out->sequence.store(before, std::memory_order_relaxed);
+    return 1;
+}
+
+/* returns 0, or -1 if there is no region 'name' (yet) or it is not one of ours */
+static inline int shmReader_open(struct shm_reader_t* reader, const char* name) {
+    reader->header = NULL;
+    if (shmMapping_open(&reader->mapping, name, 0) != 0) {
+        return -1;
+    }
+    const struct shm_region_header_t* header = (const struct shm_region_header_t*)reader->mapping.base;
+    if (memcmp(header->magic, SHM_MAGIC, sizeof(header->magic)) != 0 || header->version != SHM_VERSION
+        || header->total_size > reader->mapping.size) {
+        shmMapping_close(&reader->mapping, 0);
+        return -1;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    reader->header = header;
+    reader->mask = header->slots - 1;
+    reader->next = header->published.load(std::memory_order_acquire);
+    reader->lost = 0;
+    reader->retries = 0;
+    return 0;
+}
+
+static inline void shmReader_close(struct shm_reader_t* reader) {
+    shmMapping_close(&reader->mapping, 0);
+    reader->header = NULL;
+}
+
+static inline int shmReader_closed(const struct shm_reader_t* reader) {
+    return reader->header->state.load(std::memory_order_acquire) == SHM_STATE_CLOSED;
+}
+
+/* 'out' : record_size bytes; returns 1, or 0 if the unit has no sweep yet */
+static inline int shmReader_snapshot(struct shm_reader_t* reader, uint8_t device, struct shm_sweep_header_t* out) {
+    const struct shm_region_header_t* header = reader->header;
+    if (device >= header->devices) {
+        return 0;
+    }
+    const struct shm_sweep_header_t* record = (const struct shm_sweep_header_t*)(reader->mapping.base
+        + header->snapshot_offset + (uint64_t)device * header->record_size);
+    while (!shmRecord_read(record, header->max_peaks, out)) {
+        reader->retries++;
+    }
+    return out->sequence.load(std::memory_order_relaxed) != 0;
+}
+
+/* 'out' : record_size bytes; returns 1 with the next sweep, or 0 if the reader is up to date */
+static inline int shmReader_next(struct shm_reader_t* reader, struct shm_sweep_header_t* out) {
+    const struct shm_region_header_t* header = reader->header;
+    while (true) {
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (reader->next >= published) {
+            return 0;
+        }
+        if (published - reader->next > header->slots) {
+            reader->lost += published - header->slots - reader->next;
+            reader->next = published - header->slots; // the oldest record still in the ring
+        }
+        const struct shm_sweep_header_t* record = (const struct shm_sweep_header_t*)(reader->mapping.base
+            + header->ring_offset + (uint64_t)(reader->next & reader->mask) * header->record_size);
+        if (!shmRecord_read(record, header->max_peaks, out)) {
+            reader->retries++; // being written : the writer caught up with us
+            continue;
+        }
+        if (out->index != reader->next) {
+            continue; // overwritten by a later lap, 'published' tells how far to skip
+        }
+        reader->next++;
+        return 1;
+    }
+}
+
+#endif // SHM_TRANSPORT_H
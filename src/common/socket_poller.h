@@ -0,0 +1,249 @@
+/*
+File    : socket_poller.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Header-only readiness poller for many TCP sockets on one thread (C / C++)
+
+Tells one thread which of its (non-blocking) sockets have data, so a single
+thread can serve many I4 units without one blocking recv() thread per socket.
+
+- Windows : I/O completion port. A zero-byte overlapped WSARecv() is posted per
+            socket and completes as soon as data (or the disconnect) is there;
+            the caller drains the socket with non-blocking recv() and re-arms it.
+            Each added socket gets its own op (OVERLAPPED). pollerRemove() leaves an
+            op with a receive in flight to its completion, which pollerWait() frees
+            instead of reporting, so a key added again never shares an OVERLAPPED
+            with the closed socket's stale completion.
+- Linux   : level-triggered epoll, re-arming is a no-op.
+
+Usage :     pollerAdd(&poller, socket, key);      // socket made non-blocking
+            n = pollerWait(&poller, keys, max, timeout_ms);
+            for each keys[i] : recv() until socketWouldBlock(), then pollerRearm(&poller, keys[i]);
+Keys are 0 .. capacity-1, chosen by the caller (e.g. the I4 device index).
+*/
+
+#ifndef SOCKET_POLLER_H
+#define SOCKET_POLLER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform_socket.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/epoll.h>
+#endif
+
+#define POLLER_MAX_EVENTS 64 // per pollerWait
+
+#ifdef _WIN32
+struct poller_op_t {
+    OVERLAPPED overlapped; // zero-byte WSARecv, first member : the completion points at the op
+    SOCKET socket;
+    uint32_t key;
+    int pending;           // receive posted, its completion not dequeued yet
+    int removed;           // socket removed : freed on its completion, not reported
+};
+#endif
+
+struct socket_poller_t {
+#ifdef _WIN32
+    HANDLE port;
+    struct poller_op_t** ops; // [capacity], op of the socket registered under each key, NULL : none
+#else
+    int epoll_fd;
+#endif
+    uint32_t capacity;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* socketSetNonBlocking : Makes recv() on a socket return instead of waiting.
+* socketWouldBlock : Whether the last failed recv() only means "no data right now".
+* pollerInit, pollerFree : Create/destroy the completion port / epoll instance.
+* pollerAdd : Registers a socket under a key and arms it.
+* pollerRearm : Arms a drained socket again (Windows), no-op on Linux.
+* pollerRemove : Unregisters the socket of a key before it is closed, the key can be added again at once.
+* pollerWait : Waits up to timeout_ms and returns the keys of readable sockets.
+* ==============================================================================
+*/
+
+static inline int socketSetNonBlocking(SOCKET hSocket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(hSocket, FIONBIO, &mode) == 0 ? 0 : -1;
+#else
+    int flags = fcntl(hSocket, F_GETFL, 0);
+    return (flags >= 0 && fcntl(hSocket, F_SETFL, flags | O_NONBLOCK) == 0) ? 0 : -1;
+#endif
+}
+
+static inline int socketWouldBlock(void) {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/* returns 0, or -1 on failure */
+static inline int pollerInit(struct socket_poller_t* poller, uint32_t capacity) {
+    poller->capacity = capacity;
+#ifdef _WIN32
+    poller->ops = (struct poller_op_t**)calloc(capacity, sizeof(struct poller_op_t*));
+    poller->port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (poller->ops == NULL || poller->port == NULL) {
+        fprintf(stderr, "Completion port creation failed.\n");
+        return -1;
+    }
+#else
+    poller->epoll_fd = epoll_create1(0);
+    if (poller->epoll_fd < 0) {
+        fprintf(stderr, "epoll creation failed.\n");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static inline void pollerFree(struct socket_poller_t* poller) {
+#ifdef _WIN32
+    if (poller->port != NULL) {
+        CloseHandle(poller->port);
+    }
+    // ops with a receive in flight (never dequeued) are left allocated, the kernel may still write them
+    for (uint32_t i = 0; poller->ops != NULL && i < poller->capacity; i++) {
+        if (poller->ops[i] != NULL && !poller->ops[i]->pending) {
+            free(poller->ops[i]);
+        }
+    }
+    free(poller->ops);
+    poller->port = NULL;
+    poller->ops = NULL;
+#else
+    if (poller->epoll_fd >= 0) {
+        close(poller->epoll_fd);
+    }
+    poller->epoll_fd = -1;
+#endif
+    poller->capacity = 0;
+}
+
+static inline int pollerRearm(struct socket_poller_t* poller, uint32_t key) {
+#ifdef _WIN32
+    struct poller_op_t* op = key < poller->capacity ? poller->ops[key] : NULL;
+    if (op == NULL || op->pending) {
+        return -1; // not registered, or its receive is still in flight
+    }
+    memset(&op->overlapped, 0, sizeof(op->overlapped));
+    WSABUF buffer;
+    buffer.len = 0;
+    buffer.buf = NULL;
+    DWORD flags = 0;
+    if (WSARecv(op->socket, &buffer, 1, NULL, &flags, &op->overlapped, NULL) == SOCKET_ERROR
+        && WSAGetLastError() != WSA_IO_PENDING) {
+        return -1;
+    }
+    op->pending = 1; // also on immediate success : the completion is queued all the same
+#else
+    (void)poller;
+    (void)key;
+#endif
+    return 0;
+}
+
+/* returns 0, or -1 if the socket can't be registered */
+static inline int pollerAdd(struct socket_poller_t* poller, SOCKET hSocket, uint32_t key) {
+    if (key >= poller->capacity || socketSetNonBlocking(hSocket) != 0) {
+        return -1;
+    }
+#ifdef _WIN32
+    if (poller->ops[key] != NULL || CreateIoCompletionPort((HANDLE)hSocket, poller->port, (ULONG_PTR)key, 0) == NULL) {
+        return -1;
+    }
+    struct poller_op_t* op = (struct poller_op_t*)calloc(1, sizeof(struct poller_op_t));
+    if (op == NULL) {
+        return -1;
+    }
+    op->socket = hSocket;
+    op->key = key;
+    poller->ops[key] = op;
+    if (pollerRearm(poller, key) != 0) {
+        poller->ops[key] = NULL; // nothing in flight, the key stays free
+        free(op);
+        return -1;
+    }
+    return 0;
+#else
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.u32 = key;
+    return epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, hSocket, &event) == 0 ? 0 : -1;
+#endif
+}
+
+static inline void pollerRemove(struct socket_poller_t* poller, SOCKET hSocket, uint32_t key) {
+#ifdef _WIN32
+    (void)hSocket;
+    struct poller_op_t* op = key < poller->capacity ? poller->ops[key] : NULL;
+    if (op == NULL) {
+        return;
+    }
+    poller->ops[key] = NULL;
+    if (op->pending) {
+        op->removed = 1; // closing the socket completes its receive, pollerWait() frees the op then
+    }
+    else {
+        free(op);
+    }
+#else
+    (void)key;
+    epoll_ctl(poller->epoll_fd, EPOLL_CTL_DEL, hSocket, NULL);
+#endif
+}
+
+/* returns the number of keys written (0 on timeout), or -1 on failure */
+static inline int pollerWait(struct socket_poller_t* poller, uint32_t* keys, int max_keys, int timeout_ms) {
+    if (max_keys > POLLER_MAX_EVENTS) {
+        max_keys = POLLER_MAX_EVENTS;
+    }
+#ifdef _WIN32
+    OVERLAPPED_ENTRY entries[POLLER_MAX_EVENTS];
+    ULONG count = 0;
+    if (!GetQueuedCompletionStatusEx(poller->port, entries, (ULONG)max_keys, &count, (DWORD)timeout_ms, FALSE)) {
+        return GetLastError() == WAIT_TIMEOUT ? 0 : -1;
+    }
+    int ready = 0;
+    for (ULONG i = 0; i < count; i++) {
+        struct poller_op_t* op = (struct poller_op_t*)entries[i].lpOverlapped;
+        if (op == NULL) {
+            continue;
+        }
+        op->pending = 0;
+        if (op->removed) {
+            free(op); // stale completion of a closed socket
+            continue;
+        }
+        keys[ready++] = op->key;
+    }
+    return ready;
+#else
+    struct epoll_event events[POLLER_MAX_EVENTS];
+    int count = epoll_wait(poller->epoll_fd, events, max_keys, timeout_ms);
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < count; i++) {
+        keys[i] = events[i].data.u32;
+    }
+    return count;
+#endif
+}
+
+#endif // SOCKET_POLLER_H
@@ -0,0 +1,558 @@
+/*
+File    : spectral_peak_detector.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only peak detection on raw I4 spectra (sweep type 1) (C++11)
+
+Finds FBG peaks in the int16_t amplitude arrays of a spectral sweep and emits
+them as a peak_batch_t, i.e. the same channel/fiber/sensor/wavelength tuples
+the I4 peak mode produces, so they go through the same forwarding path.
+
+Per spectrum (one per channel/fiber in the sweep payload) :
+- windows configured for its channel/fiber : the maximum inside each wavelength
+  window is a peak when it reaches the threshold, reported with the window's
+  sensor id. A window without a peak is simply missing from the batch.
+- no windows : every run of samples above the threshold is a peak, numbered
+  0, 1, .. in wavelength order.
+The peak position is refined to sub-sample resolution (centroid of the run,
+parabolic or Gaussian 3-point fit) and mapped to nm through the channel axis,
+wavelength = start_nm + index * step_nm.
+
+The threshold scan and the window maximum run 8 samples at a time with SSE2.
+With 'threads' > 1 the spectra of a sweep are split by channel over worker
+threads (channel % threads), each writing its own batch; the batches are
+concatenated in worker order, so the output order is stable sweep to sweep.
+
+Config file : one setting per line, '#' starts a comment
+    axis <channel> <start_nm> <step_nm>
+    threshold <amplitude>
+    fit <centroid|parabolic|gaussian>
+    threads <0..DETECTOR_MAX_CHANNELS>
+    window <channel> <fiber> <sensor> <low_nm> <high_nm>
+*/
+
+#ifndef SPECTRAL_PEAK_DETECTOR_H
+#define SPECTRAL_PEAK_DETECTOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+
+#if !defined(PEAK_DECODER_NO_SIMD) && defined(PEAK_DECODER_SSE2)
+#define SPECTRAL_DETECTOR_SSE2
+#endif
+
+#define DETECTOR_MAX_CHANNELS 4
+#define DETECTOR_MAX_WINDOWS 1024
+#define DETECTOR_MAX_AUTO_PEAKS 256 // per spectrum, without windows
+#define DETECTOR_MAX_SPECTRA 64     // per sweep
+
+#define DETECTOR_FIT_CENTROID 0
+#define DETECTOR_FIT_PARABOLIC 1
+#define DETECTOR_FIT_GAUSSIAN 2
+
+#define DETECTOR_DEFAULT_START_NM 1510.0
+#define DETECTOR_DEFAULT_STEP_NM 0.005
+#define DETECTOR_DEFAULT_THRESHOLD 1000
+
+struct detector_window_t {
+    uint8_t channel, fiber, sensor;
+    double low_nm, high_nm;
+};
+
+struct detector_config_t {
+    double start_nm[DETECTOR_MAX_CHANNELS];
+    double step_nm[DETECTOR_MAX_CHANNELS];
+    int16_t threshold;
+    int fit;
+    uint32_t threads;
+    struct detector_window_t windows[DETECTOR_MAX_WINDOWS];
+    uint32_t window_count;
+};
+
+// one spectrum of the sweep payload, amplitudes left in place
+struct detector_spectrum_t {
+    const char* samples; // num_points little-endian int16_t, any alignment
+    uint32_t num_points;
+    uint8_t channel, fiber, sensor;
+};
+
+struct detector_worker_t {
+    std::thread thread;
+    peak_batch_t peaks;
+    int result; // of the last sweep
+};
+
+struct spectral_detector_t {
+    const struct detector_config_t* config;
+    struct detector_spectrum_t spectra[DETECTOR_MAX_SPECTRA];
+    uint32_t spectrum_count;
+    uint64_t dropped_spectra; // over DETECTOR_MAX_SPECTRA in one sweep
+
+    // workers (threads > 1)
+    struct detector_worker_t workers[DETECTOR_MAX_CHANNELS];
+    uint32_t worker_count;
+    std::mutex lock;
+    std::condition_variable start;
+    std::condition_variable done;
+    uint64_t generation; // bumped per sweep
+    uint32_t pending;    // workers still running the current sweep
+    bool running;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initDetectorConfig : Default axis, threshold and fit, no windows.
+* loadDetectorConfig : Reads settings and windows from a config file.
+* spectrumSample : One amplitude of a spectrum.
+* spectrumMax : Maximum (and its first index) of samples [begin, end).
+* spectrumNextAbove : First index >= begin with a sample above the threshold.
+* fitPeak : Sub-sample peak index around a maximum.
+* detectSpectrumPeaks : Appends the peaks of one spectrum to a batch.
+* initSpectralDetector, freeSpectralDetector : Start/stop the worker threads.
+* detectSpectralPeaks : Splits a spectral sweep payload into spectra and detects all peaks.
+* ==============================================================================
+*/
+
+static inline void initDetectorConfig(struct detector_config_t* config) {
+    for (int c = 0; c < DETECTOR_MAX_CHANNELS; c++) {
+        config->start_nm[c] = DETECTOR_DEFAULT_START_NM;
+        config->step_nm[c] = DETECTOR_DEFAULT_STEP_NM;
+    }
+    config->threshold = DETECTOR_DEFAULT_THRESHOLD;
+    config->fit = DETECTOR_FIT_PARABOLIC;
+    config->threads = 0;
+    config->window_count = 0;
+}
+
+/* reads up to 'max' numbers after the keyword, returns how many; *cursor ends after them */
+static inline int detectorConfigNumbers(char** cursor, double* values, int max) {
+    int count = 0;
+    while (count < max) {
+        char* end;
+        double value = strtod(*cursor, &end);
+        if (end == *cursor) {
+            break;
+        }
+        values[count++] = value;
+        *cursor = end;
+    }
+    while (**cursor == ' ' || **cursor == '\t' || **cursor == '\r' || **cursor == '\n') {
+        (*cursor)++;
+    }
+    return count;
+}
+
+static inline int detectorConfigKeyword(char** cursor, const char* keyword) {
+    size_t length = strlen(keyword);
+    if (strncmp(*cursor, keyword, length) != 0 || (*cursor)[length] == '\0' || strchr(" \t", (*cursor)[length]) == NULL) {
+        return 0;
+    }
+    *cursor += length;
+    return 1;
+}
+
+/* returns the number of windows read, or -1 if the file can't be opened or has a bad line */
+static inline int loadDetectorConfig(struct detector_config_t* config, const char* path) {
+    FILE* file = NULL;
+#ifdef _MSC_VER
+    if (fopen_s(&file, path, "r") != 0) {
+        file = NULL;
+    }
+#else
+    file = fopen(path, "r");
+#endif
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open detector config %s\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char* cursor = line;
+        while (*cursor == ' ' || *cursor == '\t') {
+            cursor++;
+        }
+        if (*cursor == '\0' || *cursor == '\r' || *cursor == '\n') {
+            continue; // blank or comment line
+        }
+
+        double v[5];
+        int valid = 0;
+        if (detectorConfigKeyword(&cursor, "axis")) {
+            valid = detectorConfigNumbers(&cursor, v, 3) == 3 && *cursor == '\0'
+                && v[0] >= 0 && v[0] < DETECTOR_MAX_CHANNELS && v[2] > 0;
+            if (valid) {
+                config->start_nm[(int)v[0]] = v[1];
+                config->step_nm[(int)v[0]] = v[2];
+            }
+        }
+        else if (detectorConfigKeyword(&cursor, "threshold")) {
+            valid = detectorConfigNumbers(&cursor, v, 1) == 1 && *cursor == '\0' && v[0] >= INT16_MIN && v[0] <= INT16_MAX;
+            if (valid) {
+                config->threshold = (int16_t)v[0];
+            }
+        }
+        else if (detectorConfigKeyword(&cursor, "threads")) {
+            valid = detectorConfigNumbers(&cursor, v, 1) == 1 && *cursor == '\0' && v[0] >= 0 && v[0] <= DETECTOR_MAX_CHANNELS;
+            if (valid) {
+                config->threads = (uint32_t)v[0];
+            }
+        }
+        else if (detectorConfigKeyword(&cursor, "fit")) {
+            while (*cursor == ' ' || *cursor == '\t') {
+                cursor++;
+            }
+            valid = 1;
+            if (strncmp(cursor, "centroid", 8) == 0) config->fit = DETECTOR_FIT_CENTROID;
+            else if (strncmp(cursor, "parabolic", 9) == 0) config->fit = DETECTOR_FIT_PARABOLIC;
+            else if (strncmp(cursor, "gaussian", 8) == 0) config->fit = DETECTOR_FIT_GAUSSIAN;
+            else valid = 0;
+        }
+        else if (detectorConfigKeyword(&cursor, "window")) {
+            valid = detectorConfigNumbers(&cursor, v, 5) == 5 && *cursor == '\0' && config->window_count < DETECTOR_MAX_WINDOWS
+                && v[0] >= 0 && v[0] < DETECTOR_MAX_CHANNELS && v[1] >= 0 && v[1] <= 15 && v[2] >= 0 && v[2] <= 255
+                && v[3] < v[4];
+            if (valid) {
+                struct detector_window_t* window = &config->windows[config->window_count++];
+                window->channel = (uint8_t)v[0];
+                window->fiber = (uint8_t)v[1];
+                window->sensor = (uint8_t)v[2];
+                window->low_nm = v[3];
+                window->high_nm = v[4];
+            }
+        }
+        if (!valid) {
+            fprintf(stderr, "%s:%d : invalid detector config line\n", path, line_number);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+    return (int)config->window_count;
+}
+
+static inline int16_t spectrumSample(const char* samples, uint32_t i) {
+    int16_t value;
+    memcpy(&value, samples + 2 * (size_t)i, sizeof(value));
+    return value;
+}
+
+/* returns the maximum of samples [begin, end), end > begin; *index is its first position */
+static inline int16_t spectrumMax(const char* samples, uint32_t begin, uint32_t end, uint32_t* index) {
+    uint32_t i = begin;
+    int16_t max_value = INT16_MIN;
+#if defined(SPECTRAL_DETECTOR_SSE2)
+    if (end - begin >= 8) {
+        __m128i max8 = _mm_set1_epi16(INT16_MIN);
+        for (; i + 8 <= end; i += 8) {
+            max8 = _mm_max_epi16(max8, _mm_loadu_si128((const __m128i*)(samples + 2 * (size_t)i)));
+        }
+        // horizontal max of 8 lanes
+        max8 = _mm_max_epi16(max8, _mm_shuffle_epi32(max8, _MM_SHUFFLE(1, 0, 3, 2)));
+        max8 = _mm_max_epi16(max8, _mm_shuffle_epi32(max8, _MM_SHUFFLE(2, 3, 0, 1)));
+        max8 = _mm_max_epi16(max8, _mm_shufflelo_epi16(max8, _MM_SHUFFLE(2, 3, 0, 1)));
+        max_value = (int16_t)_mm_extract_epi16(max8, 0);
+    }
+#endif
+    for (uint32_t k = i; k < end; k++) {
+        int16_t value = spectrumSample(samples, k);
+        if (value > max_value) {
+            max_value = value;
+        }
+    }
+    uint32_t k = begin;
+#if defined(SPECTRAL_DETECTOR_SSE2)
+    const __m128i target = _mm_set1_epi16(max_value);
+    for (; k + 8 <= end; k += 8) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(samples + 2 * (size_t)k)), target));
+        if (mask != 0) {
+            break;
+        }
+    }
+#endif
+    while (spectrumSample(samples, k) != max_value) {
+        k++;
+    }
+    *index = k;
+    return max_value;
+}
+
+/* returns the first index in [begin, end) with a sample above the threshold, or end */
+static inline uint32_t spectrumNextAbove(const char* samples, uint32_t begin, uint32_t end, int16_t threshold) {
+    uint32_t i = begin;
+#if defined(SPECTRAL_DETECTOR_SSE2)
+    const __m128i limit = _mm_set1_epi16(threshold);
+    for (; i + 8 <= end; i += 8) {
+        __m128i above = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(samples + 2 * (size_t)i)), limit);
+        if (_mm_movemask_epi8(above) != 0) {
+            break; // the scalar loop finds the lane
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        if (spectrumSample(samples, i) > threshold) {
+            return i;
+        }
+    }
+    return end;
+}
+
+/* sub-sample index of the peak at 'top' inside the run [low, high] of samples above the threshold */
+static inline double fitPeak(const char* samples, uint32_t low, uint32_t high, uint32_t top, int16_t threshold, int fit) {
+    if (fit == DETECTOR_FIT_CENTROID) {
+        double weight = 0, moment = 0;
+        for (uint32_t i = low; i <= high; i++) {
+            double w = (double)spectrumSample(samples, i) - threshold;
+            weight += w;
+            moment += w * (double)(i - low);
+        }
+        return weight > 0 ? low + moment / weight : (double)top;
+    }
+
+    if (top == low || top == high) {
+        return (double)top; // no neighbour on one side
+    }
+    double ym = spectrumSample(samples, top - 1);
+    double y0 = spectrumSample(samples, top);
+    double yp = spectrumSample(samples, top + 1);
+    if (fit == DETECTOR_FIT_GAUSSIAN) {
+        // parabola through the logs, heights taken above the threshold
+        double floor_value = (double)threshold - 1.0;
+        if (ym > floor_value && yp > floor_value) {
+            ym = log(ym - floor_value);
+            y0 = log(y0 - floor_value);
+            yp = log(yp - floor_value);
+        }
+    }
+    double curvature = ym - 2.0 * y0 + yp;
+    if (curvature >= 0) {
+        return (double)top;
+    }
+    return top + 0.5 * (ym - yp) / curvature;
+}
+
+static inline int appendDetectedPeak(peak_batch_t* peaks, uint8_t channel, uint8_t fiber, uint8_t sensor, double wavelength_nm) {
+    if (peaks->count == peaks->capacity && reservePeakBatch(peaks, peaks->capacity * 2 + 16) != 0) {
+        return -1;
+    }
+    uint32_t i = peaks->count++;
+    peaks->channel[i] = channel;
+    peaks->fiber[i] = fiber;
+    peaks->sensor[i] = sensor;
+    peaks->wavelength[i] = wavelength_nm;
+    peaks->timestamp[i] = 0;
+    return 0;
+}
+
+/* returns 0, or -1 if the batch could not grow */
+static inline int detectSpectrumPeaks(const struct detector_config_t* config, const struct detector_spectrum_t* spectrum,
+    peak_batch_t* peaks) {
+    if (spectrum->num_points == 0) {
+        return 0;
+    }
+    uint32_t c = spectrum->channel & (DETECTOR_MAX_CHANNELS - 1);
+    double start_nm = config->start_nm[c], step_nm = config->step_nm[c];
+    uint32_t last = spectrum->num_points - 1;
+    int16_t threshold = config->threshold;
+
+    int windowed = 0;
+    for (uint32_t w = 0; w < config->window_count; w++) {
+        const struct detector_window_t* window = &config->windows[w];
+        if (window->channel != spectrum->channel || window->fiber != spectrum->fiber) {
+            continue;
+        }
+        windowed = 1;
+
+        double low = ceil((window->low_nm - start_nm) / step_nm);
+        double high = floor((window->high_nm - start_nm) / step_nm);
+        if (high < 0 || low > last || low > high) {
+            continue; // window outside this spectrum
+        }
+        uint32_t begin = low < 0 ? 0 : (uint32_t)low;
+        uint32_t end = high > last ? last : (uint32_t)high;
+
+        uint32_t top;
+        if (spectrumMax(spectrum->samples, begin, end + 1, &top) <= threshold) {
+            continue;
+        }
+        uint32_t run_low = top, run_high = top;
+        while (run_low > begin && spectrumSample(spectrum->samples, run_low - 1) > threshold) run_low--;
+        while (run_high < end && spectrumSample(spectrum->samples, run_high + 1) > threshold) run_high++;
+
+        double index = fitPeak(spectrum->samples, run_low, run_high, top, threshold, config->fit);
+        if (appendDetectedPeak(peaks, spectrum->channel, spectrum->fiber, window->sensor, start_nm + index * step_nm) != 0) {
+            return -1;
+        }
+    }
+    if (windowed) {
+        return 0;
+    }
+
+    // no windows : one peak per run above the threshold
+    uint32_t sensor = 0;
+    uint32_t i = spectrumNextAbove(spectrum->samples, 0, spectrum->num_points, threshold);
+    while (i < spectrum->num_points && sensor < DETECTOR_MAX_AUTO_PEAKS) {
+        uint32_t run_high = i;
+        while (run_high < last && spectrumSample(spectrum->samples, run_high + 1) > threshold) run_high++;
+
+        uint32_t top;
+        spectrumMax(spectrum->samples, i, run_high + 1, &top);
+        double index = fitPeak(spectrum->samples, i, run_high, top, threshold, config->fit);
+        if (appendDetectedPeak(peaks, spectrum->channel, spectrum->fiber, (uint8_t)sensor++, start_nm + index * step_nm) != 0) {
+            return -1;
+        }
+        i = spectrumNextAbove(spectrum->samples, run_high + 1, spectrum->num_points, threshold);
+    }
+    return 0;
+}
+
+/* worker k : spectra with channel % worker_count == k */
+static inline int detectWorkerSpectra(struct spectral_detector_t* detector, uint32_t k, peak_batch_t* peaks) {
+    peaks->count = 0;
+    int result = 0;
+    for (uint32_t s = 0; s < detector->spectrum_count; s++) {
+        if (detector->spectra[s].channel % detector->worker_count == k
+            && detectSpectrumPeaks(detector->config, &detector->spectra[s], peaks) != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+static inline void detectorWorkerThread(struct spectral_detector_t* detector, uint32_t k) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> guard(detector->lock);
+    while (true) {
+        detector->start.wait(guard, [&] { return !detector->running || detector->generation != seen; });
+        if (!detector->running) {
+            return;
+        }
+        seen = detector->generation;
+        guard.unlock();
+        detector->workers[k].result = detectWorkerSpectra(detector, k, &detector->workers[k].peaks);
+        guard.lock();
+        if (--detector->pending == 0) {
+            detector->done.notify_one();
+        }
+    }
+}
+
+static inline void initSpectralDetector(struct spectral_detector_t* detector, const struct detector_config_t* config) {
+    detector->config = config;
+    detector->spectrum_count = 0;
+    detector->dropped_spectra = 0;
+    detector->generation = 0;
+    detector->pending = 0;
+    detector->running = true;
+    detector->worker_count = config->threads > 1 ? config->threads : 0; // 0, 1 : inline on the caller
+    for (uint32_t k = 0; k < detector->worker_count; k++) {
+        initPeakBatch(&detector->workers[k].peaks, 64);
+        detector->workers[k].result = 0;
+        detector->workers[k].thread = std::thread(detectorWorkerThread, detector, k);
+    }
+}
+
+static inline void freeSpectralDetector(struct spectral_detector_t* detector) {
+    {
+        std::lock_guard<std::mutex> guard(detector->lock);
+        detector->running = false;
+    }
+    detector->start.notify_all();
+    for (uint32_t k = 0; k < detector->worker_count; k++) {
+        detector->workers[k].thread.join();
+        freePeakBatch(&detector->workers[k].peaks);
+    }
+    detector->worker_count = 0;
+}
+
+/* 'payload' is the DL bytes of a spectral sweep; returns the peaks found, or -1 on a malformed payload */
+static inline int detectSpectralPeaks(struct spectral_detector_t* detector, const char* payload, uint32_t length,
+    peak_batch_t* peaks) {
+    // 1. spectra of the sweep : spectral info + amplitudes, packed 4 per payload
+    detector->spectrum_count = 0;
+    uint32_t off = 0;
+    while (off + SPECTRAL_PAYLOAD_SIZE <= length) {
+        uint8_t channel, fiber, sensor;
+        uint32_t num_points;
+        processPacket_spectralPayload_info(payload + off, &channel, &fiber, &sensor, &num_points);
+        off += SPECTRAL_PAYLOAD_SIZE;
+
+        uint64_t bytes = ((uint64_t)num_points + 3) / 4 * SPECTRAL_PAYLOAD_SIZE;
+        if (bytes > length - off) {
+            return -1;
+        }
+        if (detector->spectrum_count < DETECTOR_MAX_SPECTRA) {
+            struct detector_spectrum_t* spectrum = &detector->spectra[detector->spectrum_count++];
+            spectrum->samples = payload + off;
+            spectrum->num_points = num_points;
+            spectrum->channel = channel;
+            spectrum->fiber = fiber;
+            spectrum->sensor = sensor;
+        }
+        else {
+            detector->dropped_spectra++;
+        }
+        off += (uint32_t)bytes;
+    }
+
+    // 2. peaks, inline or split by channel over the workers
+    peaks->count = 0;
+    if (detector->worker_count == 0) {
+        for (uint32_t s = 0; s < detector->spectrum_count; s++) {
+            if (detectSpectrumPeaks(detector->config, &detector->spectra[s], peaks) != 0) {
+                return -1;
+            }
+        }
+        return (int)peaks->count;
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(detector->lock);
+        detector->pending = detector->worker_count;
+        detector->generation++;
+        detector->start.notify_all();
+        detector->done.wait(guard, [&] { return detector->pending == 0; });
+    }
+
+    uint32_t total = 0;
+    for (uint32_t k = 0; k < detector->worker_count; k++) {
+        if (detector->workers[k].result != 0) {
+            return -1;
+        }
+        total += detector->workers[k].peaks.count;
+    }
+    if (reservePeakBatch(peaks, total) != 0) {
+        return -1;
+    }
+    for (uint32_t k = 0; k < detector->worker_count; k++) {
+        const peak_batch_t* part = &detector->workers[k].peaks;
+        memcpy(peaks->channel + peaks->count, part->channel, part->count);
+        memcpy(peaks->fiber + peaks->count, part->fiber, part->count);
+        memcpy(peaks->sensor + peaks->count, part->sensor, part->count);
+        memcpy(peaks->wavelength + peaks->count, part->wavelength, part->count * sizeof(double));
+        memcpy(peaks->timestamp + peaks->count, part->timestamp, part->count * sizeof(double));
+        peaks->count += part->count;
+    }
+    return (int)peaks->count;
+}
+
+#endif // SPECTRAL_PEAK_DETECTOR_H
@@ -0,0 +1,198 @@
+/*
+File    : spectral_pool.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only pool of preallocated, aligned spectrum buffers (C / C++)
+
+A spectral sweep carries, per (channel, fiber, sensor), one spectral info
+payload followed by num_points int16_t amplitudes packed four per 8-byte
+spectral payload. The amplitudes are already little-endian int16_t on the
+wire, so they are received straight into a pool buffer instead of being
+split into scalars.
+
+Buffer life cycle : FREE -> (acquire) FILLING -> (commit) FILLED -> (release) FREE
+A FILLED buffer is never written by the capture loop, the consumer owns it
+until it releases it. All buffers are allocated once in initSpectralPool;
+the capture path does not allocate.
+*/
+
+#ifndef SPECTRAL_POOL_H
+#define SPECTRAL_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include "i4_protocol.h"
+
+#define SPECTRAL_POOL_ALIGNMENT 64 // cache line, also enough for AVX-512 loads
+#define SPECTRAL_POINTS_PER_PAYLOAD (SPECTRAL_PAYLOAD_SIZE / sizeof(int16_t))
+
+#define SPECTRAL_BUFFER_FREE 0
+#define SPECTRAL_BUFFER_FILLING 1
+#define SPECTRAL_BUFFER_FILLED 2
+
+struct spectral_buffer_t {
+    int16_t* samples;        // [capacity], SPECTRAL_POOL_ALIGNMENT aligned
+    uint32_t num_points;     // valid samples
+    uint8_t channel, fiber, sensor;
+    uint16_t packetCounter;  // header of the sweep it came from
+    uint32_t sweep_counter;  // flag of the sweep it came from
+    uint64_t timeStamp;
+    uint64_t sequence;       // commit order, newest is largest
+    int state;
+};
+
+struct spectral_pool_t {
+    struct spectral_buffer_t* buffers;
+    uint32_t count;
+    uint32_t capacity;        // samples per buffer, multiple of SPECTRAL_POINTS_PER_PAYLOAD
+    uint32_t* free_list;      // stack of FREE buffer indices
+    uint32_t free_count;
+    uint64_t committed;       // spectra captured
+    uint64_t exhausted;       // spectra dropped, no FREE buffer
+    uint64_t oversized;       // spectra dropped, more than 'capacity' points
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initSpectralPool, freeSpectralPool : Allocate/release all buffers of the pool.
+* spectralPayloadBytes : Wire bytes of the amplitudes of a num_points spectrum.
+* spectralPool_acquire : Takes a FREE buffer for one spectrum of (channel, fiber, sensor).
+* spectralPool_commit : Marks an acquired buffer FILLED.
+* spectralPool_abort : Returns an acquired buffer that was not filled.
+* spectralPool_release : Returns a FILLED buffer once the consumer is done with it.
+* spectralPool_latest : Newest FILLED buffer of (channel, fiber, sensor).
+* ==============================================================================
+*/
+
+static inline void* spectralPool_alignedAlloc(size_t bytes) {
+#ifdef _MSC_VER
+    return _aligned_malloc(bytes, SPECTRAL_POOL_ALIGNMENT);
+#else
+    void* ptr = NULL;
+    return posix_memalign(&ptr, SPECTRAL_POOL_ALIGNMENT, bytes) == 0 ? ptr : NULL;
+#endif
+}
+
+static inline void spectralPool_alignedFree(void* ptr) {
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static inline void freeSpectralPool(struct spectral_pool_t* pool) {
+    if (pool->buffers != NULL) {
+        for (uint32_t i = 0; i < pool->count; i++) {
+            spectralPool_alignedFree(pool->buffers[i].samples);
+        }
+    }
+    free(pool->buffers);
+    free(pool->free_list);
+    pool->buffers = NULL;
+    pool->free_list = NULL;
+    pool->count = 0;
+    pool->free_count = 0;
+}
+
+/* returns 0, or -1 if allocation failed */
+static inline int initSpectralPool(struct spectral_pool_t* pool, uint32_t count, uint32_t max_points) {
+    // whole spectral payloads are received in place, so round up to 4 samples
+    uint32_t capacity = (max_points + SPECTRAL_POINTS_PER_PAYLOAD - 1) / SPECTRAL_POINTS_PER_PAYLOAD * SPECTRAL_POINTS_PER_PAYLOAD;
+
+    pool->buffers = (struct spectral_buffer_t*)calloc(count, sizeof(struct spectral_buffer_t));
+    pool->free_list = (uint32_t*)malloc(count * sizeof(uint32_t));
+    pool->count = count;
+    pool->capacity = capacity;
+    pool->free_count = 0;
+    pool->committed = 0;
+    pool->exhausted = 0;
+    pool->oversized = 0;
+    if (pool->buffers == NULL || pool->free_list == NULL) {
+        fprintf(stderr, "Spectral pool allocation failed.\n");
+        freeSpectralPool(pool);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct spectral_buffer_t* buffer = &pool->buffers[i];
+        buffer->samples = (int16_t*)spectralPool_alignedAlloc(capacity * sizeof(int16_t));
+        if (buffer->samples == NULL) {
+            fprintf(stderr, "Spectral pool allocation failed.\n");
+            freeSpectralPool(pool);
+            return -1;
+        }
+        buffer->state = SPECTRAL_BUFFER_FREE;
+        pool->free_list[pool->free_count++] = count - 1 - i; // buffer 0 on top
+    }
+    return 0;
+}
+
+static inline uint32_t spectralPayloadBytes(uint32_t num_points) {
+    uint32_t payloads = (num_points + SPECTRAL_POINTS_PER_PAYLOAD - 1) / SPECTRAL_POINTS_PER_PAYLOAD;
+    return payloads * SPECTRAL_PAYLOAD_SIZE;
+}
+
+/* returns NULL (and counts the drop) if the pool is exhausted or the spectrum does not fit */
+static inline struct spectral_buffer_t* spectralPool_acquire(struct spectral_pool_t* pool,
+    uint8_t channel, uint8_t fiber, uint8_t sensor, uint32_t num_points) {
+    if (num_points > pool->capacity) {
+        pool->oversized++;
+        return NULL;
+    }
+    if (pool->free_count == 0) {
+        pool->exhausted++;
+        return NULL;
+    }
+
+    struct spectral_buffer_t* buffer = &pool->buffers[pool->free_list[--pool->free_count]];
+    buffer->channel = channel;
+    buffer->fiber = fiber;
+    buffer->sensor = sensor;
+    buffer->num_points = num_points;
+    buffer->state = SPECTRAL_BUFFER_FILLING;
+    return buffer;
+}
+
+static inline void spectralPool_commit(struct spectral_pool_t* pool, struct spectral_buffer_t* buffer,
+    const struct i4_header_info_t* header, uint32_t sweep_counter) {
+    buffer->packetCounter = header->packetCounter;
+    buffer->timeStamp = header->timeStamp;
+    buffer->sweep_counter = sweep_counter;
+    buffer->sequence = pool->committed++;
+    buffer->state = SPECTRAL_BUFFER_FILLED;
+}
+
+static inline void spectralPool_release(struct spectral_pool_t* pool, struct spectral_buffer_t* buffer) {
+    buffer->state = SPECTRAL_BUFFER_FREE;
+    pool->free_list[pool->free_count++] = (uint32_t)(buffer - pool->buffers);
+}
+
+static inline void spectralPool_abort(struct spectral_pool_t* pool, struct spectral_buffer_t* buffer) {
+    spectralPool_release(pool, buffer);
+}
+
+/* returns NULL if no FILLED buffer of these ids exists */
+static inline struct spectral_buffer_t* spectralPool_latest(struct spectral_pool_t* pool,
+    uint8_t channel, uint8_t fiber, uint8_t sensor) {
+    struct spectral_buffer_t* latest = NULL;
+    for (uint32_t i = 0; i < pool->count; i++) {
+        struct spectral_buffer_t* buffer = &pool->buffers[i];
+        if (buffer->state == SPECTRAL_BUFFER_FILLED && buffer->channel == channel && buffer->fiber == fiber
+            && buffer->sensor == sensor && (latest == NULL || buffer->sequence > latest->sequence)) {
+            latest = buffer;
+        }
+    }
+    return latest;
+}
+
+#endif // SPECTRAL_POOL_H
@@ -0,0 +1,344 @@
+/*
+File    : spectral_reducer.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only reduction of raw I4 spectra (sweep type 1) for remote viewers (C++11)
+
+Shrinks the int16_t amplitude arrays of a spectral sweep, as split by detectSpectralPeaks(),
+to what a viewer on a congested link can follow :
+
+- decimation : every 'factor' input points become one bin, holding their maximum
+  (REDUCER_MODE_MAX, keeps the peaks visible), their rounded mean (REDUCER_MODE_MEAN,
+  keeps the noise floor honest) or both their minimum and maximum (REDUCER_MODE_ENVELOPE).
+  The last bin of a range may hold fewer points.
+- cropping (optional) : only the points within 'margin_nm' of each FBG are kept, i.e.
+  around the detector windows of the spectrum's channel/fiber, or around its detected
+  peaks when it has no windows. Without cropping the whole spectrum is reduced.
+
+Every range goes out as one 'R' message (reduced_spectrum_header_t, then 'count' int16_t
+bins, or 'count' (min, max) pairs in envelope mode), split in several messages if it has
+more than REDUCER_MAX_BINS bins. Bin k covers input points first + k * factor ..,
+i.e. wavelengths from start_nm + k * step_nm, step_nm being the input step * factor.
+
+The bin kernels run 8 samples at a time with SSE2 (min/max, and sums through pmaddwd),
+so they pay off from 8 points per bin on; smaller factors take the scalar loop.
+*/
+
+#ifndef SPECTRAL_REDUCER_H
+#define SPECTRAL_REDUCER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+#include "spectral_peak_detector.h"
+
+#define REDUCER_MODE_MAX 0
+#define REDUCER_MODE_MEAN 1
+#define REDUCER_MODE_ENVELOPE 2
+
+#define REDUCER_DEFAULT_FACTOR 16
+#define REDUCER_MAX_FACTOR 4096
+#define REDUCER_MAX_BINS 4096       // per message
+#define REDUCER_MAX_RANGES 256      // per spectrum, further crop windows are dropped
+#define REDUCER_SENSOR_ALL 0xff     // sensor of an uncropped spectrum
+
+#define REDUCED_MSG_TYPE 0x52       // 'R'
+
+#pragma pack(1)
+struct reduced_spectrum_header_t {
+    uint8_t type;           // REDUCED_MSG_TYPE
+    uint8_t unit;           // I4 unit (0 without fan-in)
+    uint32_t sweep_counter;
+    uint64_t timeStamp;     // I4 header, ns since the NTP epoch
+    uint8_t channel;
+    uint8_t fiber;
+    uint8_t sensor;         // of the crop window, REDUCER_SENSOR_ALL for the whole spectrum
+    uint8_t mode;           // REDUCER_MODE_*
+    uint16_t factor;        // input points per bin
+    uint32_t first;         // input index of bin 0
+    uint16_t count;         // bins
+    double start_nm;        // wavelength of the first point of bin 0
+    double step_nm;         // bin width
+};
+#pragma pack()
+
+#define REDUCED_HEADER_SIZE sizeof(struct reduced_spectrum_header_t)
+
+struct reducer_config_t {
+    int mode;
+    uint32_t factor;
+    int crop;               // 0 : whole spectra
+    double margin_nm;       // crop : kept on both sides of a window / peak
+};
+
+struct reducer_range_t {
+    uint32_t begin, end;    // input points [begin, end)
+    uint8_t sensor;
+};
+
+struct spectral_reducer_t {
+    struct reducer_config_t config;
+    struct reducer_range_t ranges[REDUCER_MAX_RANGES];
+    uint32_t range_count;
+    // totals
+    uint64_t spectra;
+    uint64_t messages;
+    uint64_t bytes_in;      // amplitudes of the spectra, cropped away or not
+    uint64_t bytes_out;     // 'R' messages
+    uint64_t dropped_ranges;
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initReducerConfig : Max of REDUCER_DEFAULT_FACTOR points, no cropping.
+* parseReducerConfig : Reads "<max|mean|envelope>[,<points per bin>[,<crop margin nm>]]".
+* initSpectralReducer : Reducer with zeroed totals.
+* reducerModeName : "max", "mean" or "envelope".
+* spectrumRangeMinMax : Minimum and maximum of samples [begin, end).
+* spectrumRangeSum : Sum of samples [begin, end).
+* reducedMessageSize : Bytes of one 'R' message of 'count' bins.
+* reducerAddRange : Appends the ranges of points [begin, end), split at REDUCER_MAX_BINS bins.
+* reducerAddWindow : Appends the points of a wavelength interval (crop window).
+* reducerRanges : Ranges of one spectrum (whole, or around its windows / detected peaks).
+* encodeReducedSpectrum : Writes the 'R' message of one range.
+* ==============================================================================
+*/
+
+static inline void initReducerConfig(struct reducer_config_t* config) {
+    config->mode = REDUCER_MODE_MAX;
+    config->factor = REDUCER_DEFAULT_FACTOR;
+    config->crop = 0;
+    config->margin_nm = 0.0;
+}
+
+/* returns 0, or -1 if the text is not a valid reduction */
+static inline int parseReducerConfig(struct reducer_config_t* config, const char* text) {
+    size_t length = strcspn(text, ",");
+    if (length == 3 && strncmp(text, "max", 3) == 0) config->mode = REDUCER_MODE_MAX;
+    else if (length == 4 && strncmp(text, "mean", 4) == 0) config->mode = REDUCER_MODE_MEAN;
+    else if (length == 8 && strncmp(text, "envelope", 8) == 0) config->mode = REDUCER_MODE_ENVELOPE;
+    else return -1;
+    text += length;
+    if (*text == '\0') {
+        return 0;
+    }
+
+    char* end;
+    long factor = strtol(text + 1, &end, 10);
+    if (end == text + 1 || factor < 1 || factor > REDUCER_MAX_FACTOR || (*end != '\0' && *end != ',')) {
+        return -1;
+    }
+    config->factor = (uint32_t)factor;
+    if (*end == '\0') {
+        return 0;
+    }
+
+    text = end + 1;
+    double margin = strtod(text, &end);
+    if (end == text || *end != '\0' || margin < 0) {
+        return -1;
+    }
+    config->crop = 1;
+    config->margin_nm = margin;
+    return 0;
+}
+
+static inline void initSpectralReducer(struct spectral_reducer_t* reducer, const struct reducer_config_t* config) {
+    reducer->config = *config;
+    reducer->range_count = 0;
+    reducer->spectra = 0;
+    reducer->messages = 0;
+    reducer->bytes_in = 0;
+    reducer->bytes_out = 0;
+    reducer->dropped_ranges = 0;
+}
+
+static inline const char* reducerModeName(int mode) {
+    return mode == REDUCER_MODE_MEAN ? "mean" : mode == REDUCER_MODE_ENVELOPE ? "envelope" : "max";
+}
+
+/* samples [begin, end), end > begin */
+static inline void spectrumRangeMinMax(const char* samples, uint32_t begin, uint32_t end, int16_t* min_out, int16_t* max_out) {
+    uint32_t i = begin;
+    int16_t min_value = INT16_MAX, max_value = INT16_MIN;
+#if defined(SPECTRAL_DETECTOR_SSE2)
+    if (end - begin >= 8) {
+        __m128i min8 = _mm_set1_epi16(INT16_MAX);
+        __m128i max8 = _mm_set1_epi16(INT16_MIN);
+        for (; i + 8 <= end; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(samples + 2 * (size_t)i));
+            min8 = _mm_min_epi16(min8, x);
+            max8 = _mm_max_epi16(max8, x);
+        }
+        // horizontal min / max of 8 lanes
+        min8 = _mm_min_epi16(min8, _mm_shuffle_epi32(min8, _MM_SHUFFLE(1, 0, 3, 2)));
+        max8 = _mm_max_epi16(max8, _mm_shuffle_epi32(max8, _MM_SHUFFLE(1, 0, 3, 2)));
+        min8 = _mm_min_epi16(min8, _mm_shuffle_epi32(min8, _MM_SHUFFLE(2, 3, 0, 1)));
+        max8 = _mm_max_epi16(max8, _mm_shuffle_epi32(max8, _MM_SHUFFLE(2, 3, 0, 1)));
+        min8 = _mm_min_epi16(min8, _mm_shufflelo_epi16(min8, _MM_SHUFFLE(2, 3, 0, 1)));
+        max8 = _mm_max_epi16(max8, _mm_shufflelo_epi16(max8, _MM_SHUFFLE(2, 3, 0, 1)));
+        min_value = (int16_t)_mm_extract_epi16(min8, 0);
+        max_value = (int16_t)_mm_extract_epi16(max8, 0);
+    }
+#endif
+    for (; i < end; i++) {
+        int16_t value = spectrumSample(samples, i);
+        if (value < min_value) min_value = value;
+        if (value > max_value) max_value = value;
+    }
+    *min_out = min_value;
+    *max_out = max_value;
+}
+
+/* samples [begin, end), end - begin <= REDUCER_MAX_FACTOR so the int32 lanes can't overflow */
+static inline int32_t spectrumRangeSum(const char* samples, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+    int32_t sum = 0;
+#if defined(SPECTRAL_DETECTOR_SSE2)
+    if (end - begin >= 8) {
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i sum4 = _mm_setzero_si128();
+        for (; i + 8 <= end; i += 8) {
+            // pairs of int16 added into 4 int32 lanes
+            sum4 = _mm_add_epi32(sum4, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(samples + 2 * (size_t)i)), ones));
+        }
+        sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_cvtsi128_si32(sum4);
+    }
+#endif
+    for (; i < end; i++) {
+        sum += spectrumSample(samples, i);
+    }
+    return sum;
+}
+
+static inline uint32_t reducedMessageSize(int mode, uint32_t count) {
+    return (uint32_t)REDUCED_HEADER_SIZE + count * (mode == REDUCER_MODE_ENVELOPE ? 4 : 2);
+}
+
+/* points [begin, end), split in ranges of at most REDUCER_MAX_BINS bins */
+static inline void reducerAddRange(struct spectral_reducer_t* reducer, uint32_t begin, uint32_t end, uint8_t sensor) {
+    uint32_t span = REDUCER_MAX_BINS * reducer->config.factor;
+    while (begin < end) {
+        if (reducer->range_count == REDUCER_MAX_RANGES) {
+            reducer->dropped_ranges++;
+            return;
+        }
+        struct reducer_range_t* range = &reducer->ranges[reducer->range_count++];
+        range->begin = begin;
+        range->end = end - begin > span ? begin + span : end;
+        range->sensor = sensor;
+        begin = range->end;
+    }
+}
+
+/* points of [low_nm, high_nm] on an axis of num_points */
+static inline void reducerAddWindow(struct spectral_reducer_t* reducer, uint32_t num_points, double start_nm, double step_nm,
+    double low_nm, double high_nm, uint8_t sensor) {
+    double low = ceil((low_nm - start_nm) / step_nm);
+    double high = floor((high_nm - start_nm) / step_nm);
+    if (high < 0 || low > num_points - 1 || low > high) {
+        return; // outside this spectrum
+    }
+    reducerAddRange(reducer, low < 0 ? 0 : (uint32_t)low, high > num_points - 1 ? num_points : (uint32_t)high + 1, sensor);
+}
+
+/* fills reducer->ranges for one spectrum, 'peaks' are those detected on its sweep; returns the range count */
+static inline uint32_t reducerRanges(struct spectral_reducer_t* reducer, const struct detector_config_t* detector_config,
+    const struct detector_spectrum_t* spectrum, const peak_batch_t* peaks) {
+    reducer->range_count = 0;
+    if (spectrum->num_points == 0) {
+        return 0;
+    }
+    reducer->spectra++;
+    reducer->bytes_in += 2 * (uint64_t)spectrum->num_points;
+    uint32_t c = spectrum->channel & (DETECTOR_MAX_CHANNELS - 1);
+    double start_nm = detector_config->start_nm[c], step_nm = detector_config->step_nm[c];
+    if (!reducer->config.crop) {
+        reducerAddRange(reducer, 0, spectrum->num_points, REDUCER_SENSOR_ALL);
+        return reducer->range_count;
+    }
+
+    double margin = reducer->config.margin_nm;
+    int windowed = 0;
+    for (uint32_t w = 0; w < detector_config->window_count; w++) {
+        const struct detector_window_t* window = &detector_config->windows[w];
+        if (window->channel == spectrum->channel && window->fiber == spectrum->fiber) {
+            windowed = 1;
+            reducerAddWindow(reducer, spectrum->num_points, start_nm, step_nm,
+                window->low_nm - margin, window->high_nm + margin, window->sensor);
+        }
+    }
+    if (!windowed) {
+        for (uint32_t i = 0; i < peaks->count; i++) {
+            if (peaks->channel[i] == spectrum->channel && peaks->fiber[i] == spectrum->fiber) {
+                reducerAddWindow(reducer, spectrum->num_points, start_nm, step_nm,
+                    peaks->wavelength[i] - margin, peaks->wavelength[i] + margin, peaks->sensor[i]);
+            }
+        }
+    }
+    return reducer->range_count;
+}
+
+/* writes reducedMessageSize() bytes into 'out', returns that size */
+static inline uint32_t encodeReducedSpectrum(struct spectral_reducer_t* reducer, const struct detector_config_t* detector_config,
+    const struct detector_spectrum_t* spectrum, const struct reducer_range_t* range, uint8_t unit, uint32_t sweep_counter,
+    uint64_t timeStamp, char* out) {
+    const struct reducer_config_t* config = &reducer->config;
+    uint32_t factor = config->factor;
+    uint32_t count = (range->end - range->begin + factor - 1) / factor;
+    uint32_t c = spectrum->channel & (DETECTOR_MAX_CHANNELS - 1);
+
+    struct reduced_spectrum_header_t header;
+    header.type = REDUCED_MSG_TYPE;
+    header.unit = unit;
+    header.sweep_counter = sweep_counter;
+    header.timeStamp = timeStamp;
+    header.channel = spectrum->channel;
+    header.fiber = spectrum->fiber;
+    header.sensor = range->sensor;
+    header.mode = (uint8_t)config->mode;
+    header.factor = (uint16_t)factor;
+    header.first = range->begin;
+    header.count = (uint16_t)count;
+    header.start_nm = detector_config->start_nm[c] + range->begin * detector_config->step_nm[c];
+    header.step_nm = detector_config->step_nm[c] * factor;
+    memcpy(out, &header, sizeof(header));
+
+    char* bins = out + REDUCED_HEADER_SIZE;
+    for (uint32_t begin = range->begin; begin < range->end; begin += factor) {
+        uint32_t end = range->end - begin > factor ? begin + factor : range->end;
+        int16_t min_value, max_value;
+        if (config->mode == REDUCER_MODE_MEAN) {
+            int32_t sum = spectrumRangeSum(spectrum->samples, begin, end);
+            int32_t n = (int32_t)(end - begin);
+            int16_t mean = (int16_t)(sum >= 0 ? (sum + n / 2) / n : (sum - n / 2) / n);
+            memcpy(bins, &mean, sizeof(mean));
+            bins += sizeof(mean);
+            continue;
+        }
+        spectrumRangeMinMax(spectrum->samples, begin, end, &min_value, &max_value);
+        if (config->mode == REDUCER_MODE_ENVELOPE) {
+            memcpy(bins, &min_value, sizeof(min_value));
+            bins += sizeof(min_value);
+        }
+        memcpy(bins, &max_value, sizeof(max_value));
+        bins += sizeof(max_value);
+    }
+
+    uint32_t size = reducedMessageSize(config->mode, count);
+    reducer->messages++;
+    reducer->bytes_out += size;
+    return size;
+}
+
+#endif // SPECTRAL_REDUCER_H
@@ -0,0 +1,163 @@
+/*
+File    : spsc_ring.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only lock-free single-producer/single-consumer ring (C++11)
+
+Preallocated ring of slots handed from one producer thread (e.g. the I4 ingest
+thread) to one consumer thread (decode/forward). The producer fills a slot in
+place and publishes it; the consumer reads it in place and pops it, so nothing
+is copied or allocated per item. Head and tail live on separate cache lines, and
+each side caches the other side's index to avoid touching it on every call.
+
+Producer :  T* slot = spscRing_acquire(&ring);  // NULL when full -> spscRing_overflow()
+            ...fill slot...
+            spscRing_publish(&ring);
+Consumer :  T* slot = spscRing_front(&ring);    // NULL when empty
+            ...use slot...
+            spscRing_pop(&ring);
+*/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <new>
+
+#define SPSC_CACHE_LINE 64
+
+template <typename T>
+struct spsc_ring_t {
+    T* slots;
+    uint32_t capacity; // power of two
+    uint32_t mask;
+
+    // producer side
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> head; // next slot to publish
+    uint32_t cached_tail;
+    std::atomic<uint64_t> published;
+    std::atomic<uint64_t> overflows;
+    std::atomic<uint32_t> high_watermark;
+
+    // consumer side
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> tail; // next slot to consume
+    uint32_t cached_head;
+};
+
+// ring counters, for sizing the ring against the sweep rate
+struct spsc_ring_stats_t {
+    uint32_t capacity;
+    uint32_t occupancy;      // slots waiting for the consumer
+    uint32_t high_watermark; // max occupancy seen
+    uint64_t published;      // slots handed to the consumer
+    uint64_t overflows;      // items dropped because the ring was full
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* spscRing_init, spscRing_free : Allocate/release 'capacity' slots (rounded up to a power of two).
+* spscRing_acquire, spscRing_publish, spscRing_overflow : Producer side.
+* spscRing_front, spscRing_pop : Consumer side.
+* spscRing_occupancy, spscRing_stats : Counters, safe to read from any thread.
+* ==============================================================================
+*/
+
+template <typename T>
+int spscRing_init(spsc_ring_t<T>* ring, uint32_t capacity) {
+    uint32_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring->slots = new (std::nothrow) T[size];
+    if (ring->slots == NULL) {
+        return -1;
+    }
+    ring->capacity = size;
+    ring->mask = size - 1;
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->cached_tail = 0;
+    ring->cached_head = 0;
+    ring->published.store(0);
+    ring->overflows.store(0);
+    ring->high_watermark.store(0);
+    return 0;
+}
+
+template <typename T>
+void spscRing_free(spsc_ring_t<T>* ring) {
+    delete[] ring->slots;
+    ring->slots = NULL;
+    ring->capacity = 0;
+    ring->mask = 0;
+}
+
+/* returns the next free slot, or NULL if the consumer is 'capacity' slots behind */
+template <typename T>
+T* spscRing_acquire(spsc_ring_t<T>* ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->cached_tail == ring->capacity) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+        if (head - ring->cached_tail == ring->capacity) {
+            return NULL;
+        }
+    }
+    return &ring->slots[head & ring->mask];
+}
+
+template <typename T>
+void spscRing_publish(spsc_ring_t<T>* ring) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed) + 1;
+    ring->head.store(head, std::memory_order_release);
+    ring->published.store(ring->published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    uint32_t occupancy = head - ring->tail.load(std::memory_order_relaxed);
+    if (occupancy > ring->high_watermark.load(std::memory_order_relaxed)) {
+        ring->high_watermark.store(occupancy, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+void spscRing_overflow(spsc_ring_t<T>* ring) {
+    ring->overflows.store(ring->overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/* returns the oldest published slot, or NULL if the ring is empty */
+template <typename T>
+T* spscRing_front(spsc_ring_t<T>* ring) {
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail == ring->cached_head) {
+        ring->cached_head = ring->head.load(std::memory_order_acquire);
+        if (tail == ring->cached_head) {
+            return NULL;
+        }
+    }
+    return &ring->slots[tail & ring->mask];
+}
+
+template <typename T>
+void spscRing_pop(spsc_ring_t<T>* ring) {
+    ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T>
+uint32_t spscRing_occupancy(const spsc_ring_t<T>* ring) {
+    uint32_t tail = ring->tail.load(std::memory_order_acquire); // tail first, so head >= tail
+    uint32_t occupancy = ring->head.load(std::memory_order_acquire) - tail;
+    return occupancy > ring->capacity ? ring->capacity : occupancy;
+}
+
+template <typename T>
+void spscRing_stats(const spsc_ring_t<T>* ring, spsc_ring_stats_t* stats) {
+    stats->capacity = ring->capacity;
+    stats->occupancy = spscRing_occupancy(ring);
+    stats->high_watermark = ring->high_watermark.load(std::memory_order_relaxed);
+    stats->published = ring->published.load(std::memory_order_relaxed);
+    stats->overflows = ring->overflows.load(std::memory_order_relaxed);
+}
+
+#endif // SPSC_RING_H
@@ -0,0 +1,350 @@
+/*
+File    : sweep_assembler.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only timestamp-aligned sweep assembler (C / C++)
+
+Groups the peaks of the sweeps of one or more I4 units into fixed-period,
+time-ordered frames, one slot per (device, channel, fiber, sensor).
+
+Peak time :
+- time-stamped peaks (SWEEP_TYPE_TSPEAK) : the 32-bit 0.5 ns counter of each
+  peak is unwrapped per device (it wraps every ~2.1 s, so sweeps must arrive
+  at least once a second) and anchored once to the header timeStamp of the
+  first sweep of that device, so all devices share the header clock.
+- plain peaks : the header timeStamp of their sweep.
+Frame k covers [k * period, (k + 1) * period) ns of that clock. A slot holds
+the latest peak of its sensor in the frame and its time offset in the frame.
+
+Reorder window : 'window' consecutive frames are kept open in a ring. A frame
+is emitted, in order, as soon as every device has sent a peak past it, or
+when a peak arrives 'window' frames later (so a silent or disconnected device
+delays frames by at most the window). Peaks of already emitted frames are
+counted as late and dropped. Empty frames are skipped.
+All frames and the slot map are allocated in initSweepAssembler, adding
+peaks and emitting frames does not allocate.
+
+Forwarding (FORWARD_MODE_FRAMES of the client), one message per frame :
+    'F' (uint8), frame start [ns] (uint64), slot count (uint16),
+    slot count x (device, channel, fiber, sensor (uint8), offset in frame [ns] (int32), value (double))
+*/
+
+#ifndef SWEEP_ASSEMBLER_H
+#define SWEEP_ASSEMBLER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+#include "i4_calibration.h" // calibrationIndex : (channel, fiber, sensor) table index
+
+#define ASSEMBLER_MAX_DEVICES 16
+#define ASSEMBLER_DEFAULT_WINDOW 8
+#define ASSEMBLER_DEFAULT_SLOTS 1024
+#define ASSEMBLER_NO_SLOT 0xffff
+#define ASSEMBLER_TICKS_PER_S 2e9 // time_stamp() resolution, 0.5 ns
+
+#define FRAME_MSG_TYPE 0x46 // 'F'
+#define FRAME_HEADER_SIZE 11 // type, uint64 start, uint16 count
+#define FRAME_ENTRY_SIZE 16  // 4 ids, int32 offset, double value
+
+#pragma pack(1)
+struct frame_message_header_t {
+    uint8_t type;
+    uint64_t start_ns;
+    uint16_t count;
+};
+struct frame_message_entry_t {
+    uint8_t device, channel, fiber, sensor;
+    int32_t offset_ns;
+    double value;
+};
+#pragma pack()
+
+I4_STATIC_ASSERT(sizeof(struct frame_message_header_t) == FRAME_HEADER_SIZE, "frame_message_header_t must be 11 bytes");
+I4_STATIC_ASSERT(sizeof(struct frame_message_entry_t) == FRAME_ENTRY_SIZE, "frame_message_entry_t must be 16 bytes");
+
+// time base of one device
+struct assembler_clock_t {
+    int active;          // sent at least one sweep
+    int anchored;        // tick counter anchored to the header clock
+    uint32_t last_ticks; // raw 32-bit counter of the last time-stamped peak
+    int64_t ticks;       // unwrapped counter
+    int64_t offset_ns;   // header clock - ticks / 2
+    uint64_t watermark_ns; // latest peak time
+};
+
+struct assembled_frame_t {
+    uint64_t index;      // start_ns = index * period_ns
+    uint64_t start_ns;
+    uint32_t filled;     // slots with a peak
+    uint32_t devices;    // bit mask of contributing devices
+    uint8_t* present;    // [slot_capacity]
+    int32_t* offset_ns;  // [slot_capacity] peak time - start_ns
+    double* value;       // [slot_capacity]
+};
+
+struct sweep_assembler_t;
+
+// called for every emitted frame, returns 0 or -1 (sweepAssembler_add then returns -1)
+typedef int (*assembler_emit_t)(const struct sweep_assembler_t* assembler, const struct assembled_frame_t* frame, void* user);
+
+struct sweep_assembler_t {
+    uint64_t period_ns;
+    uint32_t window;
+    struct assembled_frame_t* frames; // ring [window], frame k at k % window
+    uint64_t head;                    // oldest open frame
+    int started;
+
+    uint32_t device_count;
+    uint16_t* slot_of;                // [device_count * CALIB_TABLE_SIZE]
+    uint8_t* slot_device;             // [slot_capacity] ids of each slot
+    uint8_t* slot_channel;
+    uint8_t* slot_fiber;
+    uint8_t* slot_sensor;
+    uint32_t slot_count;
+    uint32_t slot_capacity;
+    struct assembler_clock_t clock[ASSEMBLER_MAX_DEVICES];
+
+    assembler_emit_t emit;
+    void* user;
+
+    uint64_t emitted;  // frames
+    uint64_t late;     // peaks of already emitted frames
+    uint64_t unmapped; // peaks without a slot (ids out of range, slots exhausted)
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initSweepAssembler, freeSweepAssembler : Allocate/release the frame ring and slot map.
+* sweepAssembler_slot : Slot of (device, channel, fiber, sensor), assigned on first use.
+* sweepAssembler_peakTime : Unwraps the 0.5 ns counter of a time-stamped peak to header clock ns.
+* sweepAssembler_emitDue : Emits (in order) all open frames before a frame index.
+* sweepAssembler_add : Adds the peaks of one decoded sweep, emitting completed frames.
+* sweepAssembler_flush : Emits all open frames (end of acquisition).
+* frameMessageSize, encodeFrameMessage : Forwarding message of one frame.
+* ==============================================================================
+*/
+
+static inline void freeSweepAssembler(struct sweep_assembler_t* assembler) {
+    if (assembler->frames != NULL) {
+        for (uint32_t k = 0; k < assembler->window; k++) {
+            free(assembler->frames[k].present);
+            free(assembler->frames[k].offset_ns);
+            free(assembler->frames[k].value);
+        }
+    }
+    free(assembler->frames);
+    free(assembler->slot_of);
+    free(assembler->slot_device);
+    free(assembler->slot_channel);
+    free(assembler->slot_fiber);
+    free(assembler->slot_sensor);
+    assembler->frames = NULL;
+    assembler->slot_of = NULL;
+    assembler->slot_device = NULL;
+    assembler->slot_channel = NULL;
+    assembler->slot_fiber = NULL;
+    assembler->slot_sensor = NULL;
+    assembler->slot_count = 0;
+}
+
+/* returns 0, or -1 on invalid arguments or allocation failure */
+static inline int initSweepAssembler(struct sweep_assembler_t* assembler, uint64_t period_ns, uint32_t window,
+    uint32_t device_count, uint32_t slot_capacity, assembler_emit_t emit, void* user) {
+    memset(assembler, 0, sizeof(*assembler));
+    if (period_ns == 0 || window == 0 || device_count == 0 || device_count > ASSEMBLER_MAX_DEVICES
+        || slot_capacity == 0 || slot_capacity >= ASSEMBLER_NO_SLOT) {
+        fprintf(stderr, "Invalid sweep assembler settings.\n");
+        return -1;
+    }
+    assembler->period_ns = period_ns;
+    assembler->window = window;
+    assembler->device_count = device_count;
+    assembler->slot_capacity = slot_capacity;
+    assembler->emit = emit;
+    assembler->user = user;
+
+    assembler->frames = (struct assembled_frame_t*)calloc(window, sizeof(struct assembled_frame_t));
+    assembler->slot_of = (uint16_t*)malloc((size_t)device_count * CALIB_TABLE_SIZE * sizeof(uint16_t));
+    assembler->slot_device = (uint8_t*)malloc(slot_capacity);
+    assembler->slot_channel = (uint8_t*)malloc(slot_capacity);
+    assembler->slot_fiber = (uint8_t*)malloc(slot_capacity);
+    assembler->slot_sensor = (uint8_t*)malloc(slot_capacity);
+    int failed = assembler->frames == NULL || assembler->slot_of == NULL || assembler->slot_device == NULL
+        || assembler->slot_channel == NULL || assembler->slot_fiber == NULL || assembler->slot_sensor == NULL;
+    for (uint32_t k = 0; !failed && k < window; k++) {
+        struct assembled_frame_t* frame = &assembler->frames[k];
+        frame->present = (uint8_t*)calloc(slot_capacity, 1);
+        frame->offset_ns = (int32_t*)malloc(slot_capacity * sizeof(int32_t));
+        frame->value = (double*)malloc(slot_capacity * sizeof(double));
+        failed = frame->present == NULL || frame->offset_ns == NULL || frame->value == NULL;
+    }
+    if (failed) {
+        fprintf(stderr, "Sweep assembler allocation failed.\n");
+        freeSweepAssembler(assembler);
+        return -1;
+    }
+
+    for (size_t i = 0; i < (size_t)device_count * CALIB_TABLE_SIZE; i++) {
+        assembler->slot_of[i] = ASSEMBLER_NO_SLOT;
+    }
+    return 0;
+}
+
+/* returns the slot, or ASSEMBLER_NO_SLOT if the ids are out of range or all slots are taken */
+static inline uint32_t sweepAssembler_slot(struct sweep_assembler_t* assembler, uint8_t device,
+    uint8_t channel, uint8_t fiber, uint8_t sensor) {
+    int32_t index = calibrationIndex(channel, fiber, sensor);
+    if (index < 0 || device >= assembler->device_count) {
+        return ASSEMBLER_NO_SLOT;
+    }
+    uint16_t* slot = &assembler->slot_of[(size_t)device * CALIB_TABLE_SIZE + (size_t)index];
+    if (*slot == ASSEMBLER_NO_SLOT && assembler->slot_count < assembler->slot_capacity) {
+        uint32_t s = assembler->slot_count++;
+        assembler->slot_device[s] = device;
+        assembler->slot_channel[s] = channel;
+        assembler->slot_fiber[s] = fiber;
+        assembler->slot_sensor[s] = sensor;
+        *slot = (uint16_t)s;
+    }
+    return *slot;
+}
+
+static inline uint64_t sweepAssembler_peakTime(struct assembler_clock_t* clock, uint64_t header_ns, double timestamp_s) {
+    uint32_t ticks = (uint32_t)(timestamp_s * ASSEMBLER_TICKS_PER_S + 0.5); // back to the raw counter
+    if (!clock->anchored) {
+        clock->ticks = ticks;
+        clock->offset_ns = (int64_t)header_ns - (int64_t)(ticks / 2);
+        clock->anchored = 1;
+    }
+    else {
+        clock->ticks += (int32_t)(ticks - clock->last_ticks); // forward or backward by less than half a wrap
+    }
+    clock->last_ticks = ticks;
+    return (uint64_t)(clock->offset_ns + clock->ticks / 2);
+}
+
+/* returns 0, or -1 if emitting a frame failed */
+static inline int sweepAssembler_emitDue(struct sweep_assembler_t* assembler, uint64_t limit) {
+    int result = 0;
+    uint32_t visited = 0;
+    while (assembler->head < limit) {
+        if (visited++ == assembler->window) {
+            assembler->head = limit; // the rest was never opened
+            break;
+        }
+        struct assembled_frame_t* frame = &assembler->frames[assembler->head % assembler->window];
+        if (frame->filled > 0) {
+            frame->index = assembler->head;
+            frame->start_ns = assembler->head * assembler->period_ns;
+            if (assembler->emit != NULL && assembler->emit(assembler, frame, assembler->user) != 0) {
+                result = -1;
+            }
+            assembler->emitted++;
+            memset(frame->present, 0, assembler->slot_count);
+            frame->filled = 0;
+            frame->devices = 0;
+        }
+        assembler->head++;
+    }
+    return result;
+}
+
+/* value : forwarded value per peak (wavelength or force), returns 0, or -1 if emitting a frame failed */
+static inline int sweepAssembler_add(struct sweep_assembler_t* assembler, uint8_t device, uint64_t header_ns,
+    const peak_batch_t* peaks, const double* value, int timestamped) {
+    if (device >= assembler->device_count) {
+        assembler->unmapped += peaks->count;
+        return 0;
+    }
+    struct assembler_clock_t* clock = &assembler->clock[device];
+    int result = 0;
+
+    for (uint32_t i = 0; i < peaks->count; i++) {
+        uint64_t t = timestamped ? sweepAssembler_peakTime(clock, header_ns, peaks->timestamp[i]) : header_ns;
+        uint64_t index = t / assembler->period_ns;
+        if (!assembler->started) {
+            // leave room for the other devices' first peaks
+            assembler->head = index > assembler->window / 2 ? index - assembler->window / 2 : 0;
+            assembler->started = 1;
+        }
+        if (!clock->active || t > clock->watermark_ns) {
+            clock->watermark_ns = t;
+            clock->active = 1;
+        }
+        if (index < assembler->head) {
+            assembler->late++;
+            continue;
+        }
+        if (index >= assembler->head + assembler->window && sweepAssembler_emitDue(assembler, index - assembler->window + 1) != 0) {
+            result = -1;
+        }
+
+        uint32_t slot = sweepAssembler_slot(assembler, device, peaks->channel[i], peaks->fiber[i], peaks->sensor[i]);
+        if (slot == ASSEMBLER_NO_SLOT) {
+            assembler->unmapped++;
+            continue;
+        }
+        struct assembled_frame_t* frame = &assembler->frames[index % assembler->window];
+        if (!frame->present[slot]) {
+            frame->present[slot] = 1;
+            frame->filled++;
+        }
+        frame->offset_ns[slot] = (int32_t)(t - index * assembler->period_ns);
+        frame->value[slot] = value[i];
+        frame->devices |= 1u << device;
+    }
+
+    // a frame is complete once every device has gone past it (a silent device : only the window bound)
+    uint64_t complete = UINT64_MAX;
+    for (uint32_t d = 0; d < assembler->device_count; d++) {
+        uint64_t index = assembler->clock[d].active ? assembler->clock[d].watermark_ns / assembler->period_ns : 0;
+        complete = index < complete ? index : complete;
+    }
+    if (sweepAssembler_emitDue(assembler, complete) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+static inline int sweepAssembler_flush(struct sweep_assembler_t* assembler) {
+    return assembler->started ? sweepAssembler_emitDue(assembler, assembler->head + assembler->window) : 0;
+}
+
+static inline uint32_t frameMessageSize(const struct assembled_frame_t* frame) {
+    return FRAME_HEADER_SIZE + frame->filled * FRAME_ENTRY_SIZE;
+}
+
+/* writes frameMessageSize(frame) bytes to 'buffer' */
+static inline void encodeFrameMessage(const struct sweep_assembler_t* assembler, const struct assembled_frame_t* frame, char* buffer) {
+    struct frame_message_header_t header;
+    header.type = FRAME_MSG_TYPE;
+    header.start_ns = frame->start_ns;
+    header.count = (uint16_t)frame->filled;
+    memcpy(buffer, &header, sizeof(header));
+
+    char* out = buffer + FRAME_HEADER_SIZE;
+    for (uint32_t s = 0; s < assembler->slot_count; s++) {
+        if (!frame->present[s]) {
+            continue;
+        }
+        struct frame_message_entry_t entry;
+        entry.device = assembler->slot_device[s];
+        entry.channel = assembler->slot_channel[s];
+        entry.fiber = assembler->slot_fiber[s];
+        entry.sensor = assembler->slot_sensor[s];
+        entry.offset_ns = frame->offset_ns[s];
+        entry.value = frame->value[s];
+        memcpy(out, &entry, sizeof(entry));
+        out += FRAME_ENTRY_SIZE;
+    }
+}
+
+#endif // SWEEP_ASSEMBLER_H
@@ -0,0 +1,194 @@
+/*
+File    : sweep_pool.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only sweep-indexed pool of decoded peak sweeps (C / C++)
+
+Shared by the peak ingest thread (port 9931) and the spectral ingest thread (port 9932)
+of one I4, so that every spectrum can be put next to the peaks of the same laser sweep :
+
+- slots are indexed by sweep counter (sweep_counter % count) and hold the decoded peaks,
+  header packetCounter and timeStamp of the last 'count' peak sweeps; all slot buffers are
+  allocated once in initSweepPool
+- the peak thread publishes with a try-lock : if the spectral side holds the pool, the
+  sweep is only counted as skipped, the peak path never waits for the spectral one
+- the spectral thread looks up, under the lock, the slot whose header timeStamp is nearest
+  to that of its spectral sweep (both streams are stamped by the I4 with the same clock)
+
+The lock is an SRWLOCK on Windows and a pthread mutex elsewhere.
+*/
+
+#ifndef SWEEP_POOL_H
+#define SWEEP_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef SRWLOCK sweep_pool_lock_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t sweep_pool_lock_t;
+#endif
+
+#include "i4_protocol.h"
+#include "i4_peak_decoder.h"
+
+#define SWEEP_POOL_DEFAULT_SLOTS 1024
+#define SWEEP_POOL_DEFAULT_PEAKS 256 // per slot, further peaks of a sweep are not kept
+
+struct sweep_pool_slot_t {
+    uint64_t timeStamp;      // header of the peak sweep, 0 : never written
+    uint32_t sweep_counter;
+    uint16_t packetCounter;
+    peak_batch_t peaks;      // capacity max_peaks
+};
+
+struct sweep_pool_t {
+    struct sweep_pool_slot_t* slots;
+    uint32_t count;
+    uint32_t max_peaks;
+    sweep_pool_lock_t lock;
+    // peak thread
+    uint64_t published;
+    uint64_t skipped;        // pool held by the spectral thread
+    uint64_t truncated;      // sweeps with more than max_peaks peaks
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initSweepPool, freeSweepPool : Allocate/release the slots and their peak arrays.
+* sweepPool_lock, sweepPool_unlock : Hold the pool (spectral thread, lookups).
+* sweepPool_publish : Copies one decoded peak sweep into its slot, unless the pool is held.
+* sweepPool_nearest : Slot whose timeStamp is nearest to 'timeStamp' (pool held).
+* sweepPool_findPeak : Index of the peak of (channel, fiber, sensor) in a slot, or -1.
+* ==============================================================================
+*/
+
+static inline void freeSweepPool(struct sweep_pool_t* pool) {
+    if (pool->slots != NULL) {
+        for (uint32_t i = 0; i < pool->count; i++) {
+            freePeakBatch(&pool->slots[i].peaks);
+        }
+#ifndef _WIN32
+        pthread_mutex_destroy(&pool->lock);
+#endif
+    }
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->count = 0;
+}
+
+/* returns 0, or -1 if allocation failed */
+static inline int initSweepPool(struct sweep_pool_t* pool, uint32_t count, uint32_t max_peaks) {
+    pool->slots = (struct sweep_pool_slot_t*)calloc(count, sizeof(struct sweep_pool_slot_t));
+    pool->count = count;
+    pool->max_peaks = max_peaks;
+    pool->published = 0;
+    pool->skipped = 0;
+    pool->truncated = 0;
+    if (pool->slots == NULL) {
+        fprintf(stderr, "Sweep pool allocation failed.\n");
+        pool->count = 0;
+        return -1;
+    }
+#ifdef _WIN32
+    InitializeSRWLock(&pool->lock);
+#else
+    pthread_mutex_init(&pool->lock, NULL);
+#endif
+
+    for (uint32_t i = 0; i < count; i++) {
+        initPeakBatch(&pool->slots[i].peaks, max_peaks);
+        if (pool->slots[i].peaks.capacity < max_peaks) {
+            freeSweepPool(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void sweepPool_lock(struct sweep_pool_t* pool) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+#endif
+}
+
+static inline void sweepPool_unlock(struct sweep_pool_t* pool) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&pool->lock);
+#else
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+/* returns 0, or -1 if the pool was held and the sweep is not kept */
+static inline int sweepPool_publish(struct sweep_pool_t* pool, const struct i4_header_info_t* header,
+    uint32_t sweep_counter, const peak_batch_t* peaks) {
+#ifdef _WIN32
+    int locked = TryAcquireSRWLockExclusive(&pool->lock) != 0;
+#else
+    int locked = pthread_mutex_trylock(&pool->lock) == 0;
+#endif
+    if (!locked) {
+        pool->skipped++;
+        return -1;
+    }
+
+    struct sweep_pool_slot_t* slot = &pool->slots[sweep_counter % pool->count];
+    uint32_t count = peaks->count;
+    if (count > pool->max_peaks) {
+        count = pool->max_peaks;
+        pool->truncated++;
+    }
+    memcpy(slot->peaks.channel, peaks->channel, count);
+    memcpy(slot->peaks.fiber, peaks->fiber, count);
+    memcpy(slot->peaks.sensor, peaks->sensor, count);
+    memcpy(slot->peaks.wavelength, peaks->wavelength, count * sizeof(double));
+    memcpy(slot->peaks.timestamp, peaks->timestamp, count * sizeof(double));
+    slot->peaks.count = count;
+    slot->timeStamp = header->timeStamp;
+    slot->sweep_counter = sweep_counter;
+    slot->packetCounter = header->packetCounter;
+    pool->published++;
+
+    sweepPool_unlock(pool);
+    return 0;
+}
+
+/* pool held by the caller; returns NULL if no peak sweep was published yet */
+static inline const struct sweep_pool_slot_t* sweepPool_nearest(const struct sweep_pool_t* pool, uint64_t timeStamp) {
+    const struct sweep_pool_slot_t* nearest = NULL;
+    uint64_t nearest_distance = 0;
+    for (uint32_t i = 0; i < pool->count; i++) {
+        const struct sweep_pool_slot_t* slot = &pool->slots[i];
+        if (slot->timeStamp == 0) {
+            continue;
+        }
+        uint64_t distance = slot->timeStamp > timeStamp ? slot->timeStamp - timeStamp : timeStamp - slot->timeStamp;
+        if (nearest == NULL || distance < nearest_distance) {
+            nearest = slot;
+            nearest_distance = distance;
+        }
+    }
+    return nearest;
+}
+
+static inline int32_t sweepPool_findPeak(const struct sweep_pool_slot_t* slot, uint8_t channel, uint8_t fiber, uint8_t sensor) {
+    for (uint32_t i = 0; i < slot->peaks.count; i++) {
+        if (slot->peaks.channel[i] == channel && slot->peaks.fiber[i] == fiber && slot->peaks.sensor[i] == sensor) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+#endif // SWEEP_POOL_H
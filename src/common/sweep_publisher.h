@@ -0,0 +1,454 @@
+/*
+File    : sweep_publisher.h
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Header-only publish/subscribe fan-out of the forwarded messages (C++11)
+
+Every message the forwarder sends to the main server (one sweep in batch / compact mode,
+one frame in frames mode, one packet in legacy mode) is also handed to publisher_send()
+once, which copies it into the send queue of every subscriber :
+
+- TCP subscribers connect to a listening port (-P <port>[,drop|,disconnect]) and get the
+  same byte stream as the main server. Each has a bounded queue and its own sender thread,
+  so a slow one only ever backs up its own queue. When it is full the subscriber either
+  loses its oldest whole messages (PUBLISH_POLICY_DROP_OLDEST) or is disconnected
+  (PUBLISH_POLICY_DISCONNECT); the forwarder never waits for it.
+- UDP (-M <ip:port>, multicast group or unicast) : one datagram per message from a
+  non-blocking socket, messages above PUBLISH_MAX_DATAGRAM are counted and skipped.
+
+Compact layouts : a subscriber that joined late or lost messages needs the layout again.
+publisher_send() bumps 'generation' on every join / drop (and every PUBLISH_LAYOUT_REFRESH_MS
+with UDP), and the forwarder sends a fresh layout when it sees a new generation.
+
+publisher_send() must be called from one thread at a time (the forwarder's send lock).
+*/
+
+#ifndef SWEEP_PUBLISHER_H
+#define SWEEP_PUBLISHER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform_socket.h"
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "socket_poller.h"
+
+#define PUBLISH_POLICY_DROP_OLDEST 0
+#define PUBLISH_POLICY_DISCONNECT 1
+
+#define PUBLISH_MAX_LISTENERS 4
+#define PUBLISH_MAX_SUBSCRIBERS 16
+#define PUBLISH_QUEUE_BYTES (4 * 1024 * 1024) // per subscriber
+#define PUBLISH_SEND_CHUNK (256 * 1024)      // bytes moved out of a queue per send
+#define PUBLISH_MAX_DATAGRAM 65507
+#define PUBLISH_ACCEPT_TIMEOUT_MS 100
+#define PUBLISH_LAYOUT_REFRESH_MS 1000
+#define PUBLISH_DRAIN_TIMEOUT_MS 1000        // at stop, for the subscribers to get their queued messages
+#define PUBLISH_LENGTH_SIZE 4                // uint32_t length in front of every queued message
+#ifdef MSG_NOSIGNAL
+#define PUBLISH_SEND_FLAGS MSG_NOSIGNAL      // a vanished subscriber is a send() error, not SIGPIPE
+#else
+#define PUBLISH_SEND_FLAGS 0
+#endif
+
+// one TCP subscriber, its queue is a byte ring of (uint32 length, message) records
+struct publish_subscriber_t {
+    SOCKET hSocket;
+    int policy;
+    uint32_t id;
+
+    std::mutex lock;
+    std::condition_variable ready;
+    char* queue;
+    uint32_t capacity;
+    uint32_t head;              // oldest record
+    uint32_t size;              // bytes queued
+    bool active;                // false : sender thread stops, slot is reaped
+    bool draining;              // sender thread stops once the queue is empty
+    std::atomic<bool> finished; // sender thread has ended
+    std::thread thread;
+
+    uint64_t messages;          // queued
+    uint64_t dropped;           // lost to PUBLISH_POLICY_DROP_OLDEST
+    uint64_t bytes_sent;        // by the sender thread
+};
+
+struct publish_listener_t {
+    SOCKET hSocket;
+    uint16_t port;
+    int policy;
+};
+
+struct publisher_t {
+    struct publish_listener_t listeners[PUBLISH_MAX_LISTENERS];
+    uint32_t listener_count;
+    struct publish_subscriber_t* subscribers[PUBLISH_MAX_SUBSCRIBERS]; // NULL : free slot
+    std::mutex lock;            // subscriber slots
+    uint32_t next_id;
+
+    SOCKET udp;                 // INVALID_SOCKET : no UDP
+    SOCKADDR_IN udp_address;
+    uint64_t udp_sent;
+    uint64_t udp_skipped;       // too large or the socket buffer was full
+    std::chrono::steady_clock::time_point layout_refresh;
+
+    std::atomic<uint32_t> generation; // compact layouts must be sent again when it changes
+    std::atomic<bool> running;
+    std::thread thread;         // accepts subscribers, reaps finished ones
+};
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* publisher_init : Empty publisher, no listener, no UDP.
+* publisher_listen : Listens for TCP subscribers on a port with a slow-consumer policy.
+* publisher_udp : Sends every message as a datagram to "ip:port" (multicast group or unicast).
+* publisher_start, publisher_stop : Start / stop accepting, stop also ends every subscriber.
+* publisher_active : Whether there is anyone to publish to.
+* publisher_send : Queues one message for every subscriber (never blocks on a subscriber).
+* publishQueue_write, publishQueue_read : Copy into / out of a subscriber's byte ring.
+* publishSubscriber_enqueue : Queues one message, applying the subscriber's policy if it does not fit.
+* publishSubscriber_thread : Sends the queued messages of one subscriber.
+* publisher_reap : Joins and frees finished subscribers (all of them at stop, after a bounded drain) and prints their counters.
+* publisher_accept : Takes a new subscriber from a listener.
+* publisher_thread : Accepts subscribers and reaps the finished ones.
+* ==============================================================================
+*/
+
+static inline void publisher_init(struct publisher_t* publisher) {
+    publisher->listener_count = 0;
+    for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS; i++) {
+        publisher->subscribers[i] = NULL;
+    }
+    publisher->next_id = 0;
+    publisher->udp = INVALID_SOCKET;
+    publisher->udp_sent = 0;
+    publisher->udp_skipped = 0;
+    publisher->generation.store(0);
+    publisher->running.store(false);
+}
+
+/* returns 0, or -1 if the port can't be opened */
+static inline int publisher_listen(struct publisher_t* publisher, uint16_t port, int policy) {
+    if (publisher->listener_count == PUBLISH_MAX_LISTENERS) {
+        return -1;
+    }
+    SOCKET hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (hSocket == INVALID_SOCKET) {
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(hSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(hSocket, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR || listen(hSocket, PUBLISH_MAX_SUBSCRIBERS) == SOCKET_ERROR) {
+        closesocket(hSocket);
+        return -1;
+    }
+    struct publish_listener_t* listener = &publisher->listeners[publisher->listener_count++];
+    listener->hSocket = hSocket;
+    listener->port = port;
+    listener->policy = policy;
+    return 0;
+}
+
+/* endpoint : "ip:port", returns 0 or -1 */
+static inline int publisher_udp(struct publisher_t* publisher, const char* endpoint) {
+    char address[64];
+    const char* colon = strrchr(endpoint, ':');
+    if (colon == NULL || colon == endpoint || (size_t)(colon - endpoint) >= sizeof(address) || atoi(colon + 1) <= 0) {
+        return -1;
+    }
+    memcpy(address, endpoint, colon - endpoint);
+    address[colon - endpoint] = '\0';
+
+    memset(&publisher->udp_address, 0, sizeof(publisher->udp_address));
+    publisher->udp_address.sin_family = AF_INET;
+    publisher->udp_address.sin_port = htons((uint16_t)atoi(colon + 1));
+    if (inet_pton(AF_INET, address, &publisher->udp_address.sin_addr) <= 0) {
+        return -1;
+    }
+    publisher->udp = socket(AF_INET, SOCK_DGRAM, 0);
+    if (publisher->udp == INVALID_SOCKET) {
+        return -1;
+    }
+    int ttl = 1; // multicast stays on the lab network
+    setsockopt(publisher->udp, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+    socketSetNonBlocking(publisher->udp);
+    publisher->layout_refresh = std::chrono::steady_clock::now();
+    return 0;
+}
+
+static inline bool publisher_active(const struct publisher_t* publisher) {
+    return publisher->listener_count > 0 || publisher->udp != INVALID_SOCKET;
+}
+
+static inline void publishQueue_write(struct publish_subscriber_t* subscriber, const char* data, uint32_t length) {
+    uint32_t tail = (subscriber->head + subscriber->size) % subscriber->capacity;
+    uint32_t first = subscriber->capacity - tail < length ? subscriber->capacity - tail : length;
+    memcpy(subscriber->queue + tail, data, first);
+    memcpy(subscriber->queue, data + first, length - first);
+    subscriber->size += length;
+}
+
+/* out == NULL only skips the bytes */
+static inline void publishQueue_read(struct publish_subscriber_t* subscriber, char* out, uint32_t length) {
+    if (out != NULL) {
+        uint32_t first = subscriber->capacity - subscriber->head < length ? subscriber->capacity - subscriber->head : length;
+        memcpy(out, subscriber->queue + subscriber->head, first);
+        memcpy(out + first, subscriber->queue, length - first);
+    }
+    subscriber->head = (subscriber->head + length) % subscriber->capacity;
+    subscriber->size -= length;
+}
+
+/* returns 1 if older messages were dropped, 0 otherwise */
+static inline int publishSubscriber_enqueue(struct publish_subscriber_t* subscriber, const char* data, uint32_t length) {
+    std::lock_guard<std::mutex> guard(subscriber->lock);
+    if (!subscriber->active) {
+        return 0;
+    }
+    uint32_t needed = PUBLISH_LENGTH_SIZE + length;
+    int dropped = 0;
+    if (subscriber->size + needed > subscriber->capacity) {
+        if (subscriber->policy == PUBLISH_POLICY_DISCONNECT || needed > subscriber->capacity) {
+            subscriber->active = false; // the sender thread closes the connection
+            shutdown(subscriber->hSocket, SD_BOTH); // also ends a send() stuck on a full socket
+            subscriber->ready.notify_all();
+            return 0;
+        }
+        while (subscriber->size + needed > subscriber->capacity) {
+            uint32_t oldest;
+            publishQueue_read(subscriber, (char*)&oldest, PUBLISH_LENGTH_SIZE);
+            publishQueue_read(subscriber, NULL, oldest);
+            subscriber->dropped++;
+        }
+        dropped = 1;
+    }
+    publishQueue_write(subscriber, (const char*)&length, PUBLISH_LENGTH_SIZE);
+    publishQueue_write(subscriber, data, length);
+    subscriber->messages++;
+    subscriber->ready.notify_all();
+    return dropped;
+}
+
+static inline void publishSubscriber_thread(struct publish_subscriber_t* subscriber) {
+    char* out = (char*)malloc(PUBLISH_SEND_CHUNK);
+    uint32_t out_capacity = PUBLISH_SEND_CHUNK;
+    while (out != NULL) {
+        uint32_t length = 0;
+        {
+            // whole messages only, so a drop never cuts one that is already on the wire
+            std::unique_lock<std::mutex> guard(subscriber->lock);
+            subscriber->ready.wait(guard, [subscriber] { return subscriber->size > 0 || !subscriber->active || subscriber->draining; });
+            if (!subscriber->active || subscriber->size == 0) {
+                break;
+            }
+            while (subscriber->size > 0) {
+                uint32_t next;
+                uint32_t head = subscriber->head;
+                publishQueue_read(subscriber, (char*)&next, PUBLISH_LENGTH_SIZE);
+                if (length > 0 && length + next > out_capacity) {
+                    subscriber->head = head; // put the length back, next round
+                    subscriber->size += PUBLISH_LENGTH_SIZE;
+                    break;
+                }
+                if (next > out_capacity) {
+                    char* grown = (char*)realloc(out, next);
+                    if (grown == NULL) {
+                        subscriber->active = false;
+                        break;
+                    }
+                    out = grown;
+                    out_capacity = next;
+                }
+                publishQueue_read(subscriber, out + length, next);
+                length += next;
+            }
+        }
+        uint32_t sent = 0;
+        while (sent < length) {
+            int bytesSent = send(subscriber->hSocket, out + sent, (int)(length - sent), PUBLISH_SEND_FLAGS);
+            if (bytesSent <= 0) {
+                break;
+            }
+            sent += (uint32_t)bytesSent;
+        }
+        subscriber->bytes_sent += sent;
+        if (sent < length) {
+            std::lock_guard<std::mutex> guard(subscriber->lock);
+            subscriber->active = false; // subscriber went away
+            break;
+        }
+    }
+    free(out);
+    closesocket(subscriber->hSocket);
+    subscriber->finished.store(true);
+}
+
+static inline void publisher_reap(struct publisher_t* publisher, bool all) {
+    std::lock_guard<std::mutex> guard(publisher->lock);
+    if (all) {
+        // let them drain first, so a stream only ends cut when a subscriber can't keep up
+        for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS; i++) {
+            if (publisher->subscribers[i] != NULL) {
+                std::lock_guard<std::mutex> subscriber_guard(publisher->subscribers[i]->lock);
+                publisher->subscribers[i]->draining = true;
+                publisher->subscribers[i]->ready.notify_all();
+            }
+        }
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PUBLISH_DRAIN_TIMEOUT_MS);
+        for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS; i++) {
+            while (publisher->subscribers[i] != NULL && !publisher->subscribers[i]->finished.load() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+    for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS; i++) {
+        struct publish_subscriber_t* subscriber = publisher->subscribers[i];
+        if (subscriber == NULL) {
+            continue;
+        }
+        if (all) {
+            std::lock_guard<std::mutex> subscriber_guard(subscriber->lock);
+            subscriber->active = false;
+            shutdown(subscriber->hSocket, SD_BOTH);
+            subscriber->ready.notify_all();
+        }
+        if (all || subscriber->finished.load()) {
+            subscriber->thread.join();
+            printf("Subscriber #%u %s : %llu messages, %llu dropped, %llu bytes sent\n", subscriber->id,
+                subscriber->policy == PUBLISH_POLICY_DISCONNECT ? "(disconnect policy)" : "(drop policy)",
+                (unsigned long long)subscriber->messages, (unsigned long long)subscriber->dropped,
+                (unsigned long long)subscriber->bytes_sent);
+            free(subscriber->queue);
+            delete subscriber;
+            publisher->subscribers[i] = NULL;
+        }
+    }
+}
+
+static inline void publisher_accept(struct publisher_t* publisher, const struct publish_listener_t* listener) {
+    SOCKET hSocket = accept(listener->hSocket, NULL, NULL);
+    if (hSocket == INVALID_SOCKET) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(publisher->lock);
+    int slot = -1;
+    for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS && slot < 0; i++) {
+        slot = publisher->subscribers[i] == NULL ? i : -1;
+    }
+    struct publish_subscriber_t* subscriber = slot < 0 ? NULL : new publish_subscriber_t;
+    char* queue = subscriber == NULL ? NULL : (char*)malloc(PUBLISH_QUEUE_BYTES);
+    if (queue == NULL) {
+        fprintf(stderr, "Subscriber rejected on port %u (%s).\n", listener->port, slot < 0 ? "too many" : "no memory");
+        delete subscriber;
+        closesocket(hSocket);
+        return;
+    }
+    subscriber->hSocket = hSocket;
+    subscriber->policy = listener->policy;
+    subscriber->id = publisher->next_id++;
+    subscriber->queue = queue;
+    subscriber->capacity = PUBLISH_QUEUE_BYTES;
+    subscriber->head = 0;
+    subscriber->size = 0;
+    subscriber->active = true;
+    subscriber->draining = false;
+    subscriber->finished.store(false);
+    subscriber->messages = 0;
+    subscriber->dropped = 0;
+    subscriber->bytes_sent = 0;
+    subscriber->thread = std::thread(publishSubscriber_thread, subscriber);
+    publisher->subscribers[slot] = subscriber;
+    publisher->generation++; // it needs the compact layouts
+    printf("Subscriber #%u connected on port %u\n", subscriber->id, listener->port);
+}
+
+static inline void publisher_thread(struct publisher_t* publisher) {
+    while (publisher->running.load()) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        SOCKET highest = 0;
+        for (uint32_t k = 0; k < publisher->listener_count; k++) {
+            FD_SET(publisher->listeners[k].hSocket, &readable);
+            highest = publisher->listeners[k].hSocket > highest ? publisher->listeners[k].hSocket : highest;
+        }
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = PUBLISH_ACCEPT_TIMEOUT_MS * 1000;
+        int ready = publisher->listener_count > 0 ? select((int)highest + 1, &readable, NULL, NULL, &timeout) : 0;
+        if (publisher->listener_count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(PUBLISH_ACCEPT_TIMEOUT_MS));
+        }
+        for (uint32_t k = 0; ready > 0 && k < publisher->listener_count; k++) {
+            if (FD_ISSET(publisher->listeners[k].hSocket, &readable)) {
+                publisher_accept(publisher, &publisher->listeners[k]);
+            }
+        }
+        publisher_reap(publisher, false);
+    }
+}
+
+static inline void publisher_start(struct publisher_t* publisher) {
+    publisher->running.store(true);
+    publisher->thread = std::thread(publisher_thread, publisher);
+}
+
+static inline void publisher_stop(struct publisher_t* publisher) {
+    if (publisher->running.load()) {
+        publisher->running.store(false);
+        publisher->thread.join();
+    }
+    publisher_reap(publisher, true);
+    for (uint32_t k = 0; k < publisher->listener_count; k++) {
+        closesocket(publisher->listeners[k].hSocket);
+    }
+    publisher->listener_count = 0;
+    if (publisher->udp != INVALID_SOCKET) {
+        printf("UDP : %llu datagrams sent, %llu skipped\n",
+            (unsigned long long)publisher->udp_sent, (unsigned long long)publisher->udp_skipped);
+        closesocket(publisher->udp);
+        publisher->udp = INVALID_SOCKET;
+    }
+}
+
+static inline void publisher_send(struct publisher_t* publisher, const char* data, uint32_t length) {
+    if (publisher->udp != INVALID_SOCKET) {
+        if (length <= PUBLISH_MAX_DATAGRAM && sendto(publisher->udp, data, (int)length, 0,
+            (SOCKADDR*)&publisher->udp_address, sizeof(publisher->udp_address)) == (int)length) {
+            publisher->udp_sent++;
+        }
+        else {
+            publisher->udp_skipped++;
+        }
+        // datagrams get lost : layouts go out again now and then
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - publisher->layout_refresh >= std::chrono::milliseconds(PUBLISH_LAYOUT_REFRESH_MS)) {
+            publisher->layout_refresh = now;
+            publisher->generation++;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(publisher->lock);
+    for (int i = 0; i < PUBLISH_MAX_SUBSCRIBERS; i++) {
+        if (publisher->subscribers[i] != NULL && publishSubscriber_enqueue(publisher->subscribers[i], data, length)) {
+            publisher->generation++;
+        }
+    }
+}
+
+#endif // SWEEP_PUBLISHER_H
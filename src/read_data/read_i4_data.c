@@ -0,0 +1,593 @@
+/*
+File    : read_i4_data.c
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Client program for the peak and the spectral stream of one I4 Interrogator at once.
+Protocol    : TCP/IP
+
+read_peak_data.c (port 9931) and read_spectral_data.c (port 9932) in one process, each stream
+on its own thread :
+
+- peak thread (this thread, normal priority) : receives and decodes every peak sweep exactly like
+  read_peak_data.c (stream checks, error counts, -v output) and publishes it into a sweep-indexed
+  pool (../common/sweep_pool.h). Publishing is a try-lock, so the peak path never waits for the
+  spectral one.
+- spectral thread (THREAD_PRIORITY_BELOW_NORMAL, nice +SPECTRAL_THREAD_NICE on Linux) : receives the spectra straight into the aligned
+  buffers of ../common/spectral_pool.h like read_spectral_data.c -c, then matches every spectral
+  sweep to the peak sweep with the nearest header timeStamp (same I4 clock) and prints each
+  spectrum next to the peak of its sensor in that sweep.
+
+Spectral sweeps without a peak sweep within the tolerance (-t) are counted as unmatched, e.g.
+when a large spectrum arrives later than the -s peak sweeps the pool keeps.
+
+- -i, --ip <address>       : I4 address (default SERVER_IP)
+- -v, --verbosity <0|1|2>  : peak output as in read_peak_data.c, spectra are printed from 1 on
+- -t, --tolerance <us>     : largest timeStamp difference of a match (default 500)
+- -s, --sweeps <n>         : peak sweeps kept for matching (default SWEEP_POOL_DEFAULT_SLOTS)
+- -p, --pool <buffers>, -n, --points <max points per spectrum> : spectral pool, as read_spectral_data.c
+
+Windows and Linux (../common/platform_socket.h); Ctrl+C / SIGTERM end both streams with the
+summaries printed (../common/console_control.h).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_error_stats.h"
+#include "../common/i4_peak_decoder.h"
+#include "../common/i4_stream_sync.h"
+#include "../common/spectral_pool.h"
+#include "../common/sweep_pool.h"
+
+#ifdef _WIN32
+#define THREAD_RESULT DWORD WINAPI
+typedef LPVOID thread_param_t;
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+#define THREAD_RESULT void*
+typedef void* thread_param_t;
+#define SPECTRAL_THREAD_NICE 5 // Linux : the nice value is per thread
+#endif
+
+#define PORT_PEAK 9931
+#define PORT_SPECTRAL 9932
+#define SERVER_IP "10.100.51.16"
+#define MAX_DATA_LENGTH (16 * 1024 * 1024) // sanity bound on header dataLength
+
+// console output
+#define LOG_LEVEL_QUIET 0 // errors (first occurrence) and summaries only
+#define LOG_LEVEL_SWEEP 1 // one line per sweep / spectrum
+#define LOG_LEVEL_PEAK 2  // one line per peak
+#define STDOUT_BUFFER_SIZE 65536
+#define ERROR_SUMMARY_SWEEPS 10000
+
+// spectral capture
+#define SPECTRAL_DEFAULT_BUFFERS 16
+#define SPECTRAL_DEFAULT_MAX_POINTS 32768
+#define DISCARD_BUFFER_SIZE 4096
+#define MATCH_DEFAULT_TOLERANCE_US 500
+
+struct spectral_context_t {
+    SOCKET hSocket;
+    struct spectral_pool_t pool;
+    struct sweep_pool_t* sweeps;
+    uint64_t tolerance_ns;
+    int verbosity;
+    // spectral thread only
+    uint64_t matched;
+    uint64_t unmatched;       // no peak sweep within the tolerance
+    double sum_offset_ns;     // matched spectra, |spectral - peak timeStamp|
+    uint64_t resyncs;         // realignments onto a spectral header
+    uint64_t skipped_bytes;   // bytes dropped while realigning
+    int result;
+};
+
+// function redefinition
+int recvAll(SOCKET hSocket, char* buffer, int length);
+int recvDiscard(SOCKET hSocket, int length);
+SOCKET connectI4(const char* address, int port);
+int receivePeaks(SOCKET hSocket, struct sweep_pool_t* sweeps, int verbosity);
+THREAD_RESULT spectralThread(thread_param_t param);
+int captureSpectra(struct spectral_context_t* context);
+void matchSpectrum(struct spectral_context_t* context, const struct spectral_buffer_t* spectrum);
+
+
+int main(int argc, char* argv[]) {
+
+    const char* address = SERVER_IP;
+    int verbosity = LOG_LEVEL_SWEEP;
+    uint32_t tolerance_us = MATCH_DEFAULT_TOLERANCE_US;
+    uint32_t sweep_slots = SWEEP_POOL_DEFAULT_SLOTS;
+    uint32_t pool_buffers = SPECTRAL_DEFAULT_BUFFERS;
+    uint32_t max_points = SPECTRAL_DEFAULT_MAX_POINTS;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--ip") == 0) && i + 1 < argc) {
+            address = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbosity") == 0) && i + 1 < argc) {
+            verbosity = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tolerance") == 0) && i + 1 < argc) {
+            tolerance_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sweeps") == 0) && i + 1 < argc) {
+            sweep_slots = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pool") == 0) && i + 1 < argc) {
+            pool_buffers = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--points") == 0) && i + 1 < argc) {
+            max_points = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-i|--ip <address>] [-v|--verbosity <0|1|2>] [-t|--tolerance <us>] "
+                "[-s|--sweeps <n>] [-p|--pool <buffers>] [-n|--points <max points per spectrum>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (sweep_slots == 0 || pool_buffers == 0 || max_points == 0) {
+        fprintf(stderr, "Sweeps, pool buffers and points must be positive.\n");
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, STDOUT_BUFFER_SIZE);
+
+    struct sweep_pool_t sweeps;
+    if (initSweepPool(&sweeps, sweep_slots, SWEEP_POOL_DEFAULT_PEAKS) != 0) {
+        return 1;
+    }
+    struct spectral_context_t spectral;
+    memset(&spectral, 0, sizeof(spectral));
+    spectral.sweeps = &sweeps;
+    spectral.tolerance_ns = (uint64_t)tolerance_us * 1000;
+    spectral.verbosity = verbosity;
+    if (initSpectralPool(&spectral.pool, pool_buffers, max_points) != 0) {
+        freeSweepPool(&sweeps);
+        return 1;
+    }
+
+
+    /* Initialize winsock */
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed.\n");
+        freeSpectralPool(&spectral.pool);
+        freeSweepPool(&sweeps);
+        return 1;
+    }
+
+    SOCKET hPeak = connectI4(address, PORT_PEAK);
+    spectral.hSocket = hPeak != INVALID_SOCKET ? connectI4(address, PORT_SPECTRAL) : INVALID_SOCKET;
+    if (spectral.hSocket == INVALID_SOCKET) {
+        if (hPeak != INVALID_SOCKET) closesocket(hPeak);
+        freeSpectralPool(&spectral.pool);
+        freeSweepPool(&sweeps);
+        WSACleanup();
+        return 1;
+    }
+
+    // spectra are diagnostics : below the peak path, which keeps the normal priority
+    consoleControl_install();
+#ifdef _WIN32
+    HANDLE hSpectral = CreateThread(NULL, 0, spectralThread, &spectral, CREATE_SUSPENDED, NULL);
+    if (hSpectral == NULL) {
+#else
+    pthread_t hSpectral;
+    if (pthread_create(&hSpectral, NULL, spectralThread, &spectral) != 0) {
+#endif
+        fprintf(stderr, "Spectral thread creation failed.\n");
+        closesocket(spectral.hSocket);
+        closesocket(hPeak);
+        freeSpectralPool(&spectral.pool);
+        freeSweepPool(&sweeps);
+        WSACleanup();
+        return 1;
+    }
+#ifdef _WIN32
+    SetThreadPriority(hSpectral, THREAD_PRIORITY_BELOW_NORMAL);
+    ResumeThread(hSpectral);
+#endif
+
+    int result = receivePeaks(hPeak, &sweeps, verbosity);
+
+    // ends a spectral thread still waiting in recv
+    shutdown(spectral.hSocket, SD_BOTH);
+#ifdef _WIN32
+    WaitForSingleObject(hSpectral, INFINITE);
+    CloseHandle(hSpectral);
+#else
+    pthread_join(hSpectral, NULL);
+#endif
+
+    printf("Sweep pool : %llu peak sweeps published, %llu skipped (held by the spectral thread), %llu truncated to %u peaks\n",
+        (unsigned long long)sweeps.published, (unsigned long long)sweeps.skipped,
+        (unsigned long long)sweeps.truncated, sweeps.max_peaks);
+    printf("Spectra : %llu captured, %llu dropped (pool exhausted), %llu dropped (over %u points), %llu resyncs (%llu bytes skipped)\n",
+        (unsigned long long)spectral.pool.committed, (unsigned long long)spectral.pool.exhausted,
+        (unsigned long long)spectral.pool.oversized, spectral.pool.capacity,
+        (unsigned long long)spectral.resyncs, (unsigned long long)spectral.skipped_bytes);
+    printf("Matching : %llu spectra matched (mean offset %.1f us), %llu without a peak sweep within %u us\n",
+        (unsigned long long)spectral.matched,
+        spectral.matched > 0 ? spectral.sum_offset_ns / (double)spectral.matched / 1000.0 : 0.0,
+        (unsigned long long)spectral.unmatched, tolerance_us);
+    fflush(stdout);
+
+    closesocket(spectral.hSocket);
+    closesocket(hPeak);
+    freeSpectralPool(&spectral.pool);
+    freeSweepPool(&sweeps);
+    WSACleanup();
+    return result;
+}
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* recvAll : Receives exactly 'length' bytes, looping over partial receives.
+* recvDiscard : Receives and drops 'length' bytes (spectra without a pool buffer).
+* connectI4 : Connects to one port of the I4.
+* receivePeaks : Peak stream loop of read_peak_data.c, every sweep also published into the sweep pool.
+* spectralThread : Thread entry of the spectral stream.
+* captureSpectra : Spectral stream loop of read_spectral_data.c -c, every spectrum matched once its sweep is complete.
+* matchSpectrum : Looks up the peak sweep nearest to a spectrum and prints both.
+* ==============================================================================
+*/
+
+/* receives exactly 'length' bytes, returns 0 on disconnect and SOCKET_ERROR on failure */
+int recvAll(SOCKET hSocket, char* buffer, int length) {
+    int received = 0;
+    while (received < length) {
+        int bytesRead = recv(hSocket, buffer + received, length - received, 0);
+        if (bytesRead == SOCKET_ERROR || bytesRead == 0) {
+            return bytesRead;
+        }
+        received += bytesRead;
+    }
+    return received;
+}
+
+int recvDiscard(SOCKET hSocket, int length) {
+    char discard[DISCARD_BUFFER_SIZE];
+    while (length > 0) {
+        int chunk = length < DISCARD_BUFFER_SIZE ? length : DISCARD_BUFFER_SIZE;
+        int bytesRead = recvAll(hSocket, discard, chunk);
+        if (bytesRead <= 0) {
+            return bytesRead;
+        }
+        length -= bytesRead;
+    }
+    return 1;
+}
+
+SOCKET connectI4(const char* address, int port) {
+    SOCKET hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (hSocket == INVALID_SOCKET) {
+        fprintf(stderr, "Socket creation failed.\n");
+        return INVALID_SOCKET;
+    }
+
+    SOCKADDR_IN tAddr;
+    memset(&tAddr, 0, sizeof(tAddr));
+    tAddr.sin_family = AF_INET;
+    tAddr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address, &tAddr.sin_addr) <= 0) {
+        fprintf(stderr, "inet_pton failed.\n");
+        closesocket(hSocket);
+        return INVALID_SOCKET;
+    }
+    if (connect(hSocket, (SOCKADDR*)&tAddr, sizeof(tAddr)) == SOCKET_ERROR) {
+        fprintf(stderr, "Connection to %s:%d failed.\n", address, port);
+        closesocket(hSocket);
+        return INVALID_SOCKET;
+    }
+    return hSocket;
+}
+
+/* returns 0 when the I4 disconnects, 1 if a buffer can't be allocated */
+int receivePeaks(SOCKET hSocket, struct sweep_pool_t* sweeps, int verbosity) {
+    struct i4_error_stats_t error_stats;
+    initErrorStats(&error_stats);
+    uint64_t reported_errors = 0;
+    uint64_t sweep_count = 0;
+    struct i4_stream_stats_t stream_stats;
+    initStreamStats(&stream_stats);
+
+    // whole payload of one sweep, decoded at once
+    char* buffer_payload = NULL;
+    int payload_capacity = 0;
+    peak_batch_t peaks;
+    initPeakBatch(&peaks, 0);
+    int result = 0;
+
+    while (!consoleShutdownRequested()) {
+        /* 1. Receiving header packet (realigned onto the next possible header if the stream is off) */
+        char buffer_header[HEADER_SIZE] = { 0 };
+        int hbytesRead = recvAll(hSocket, buffer_header, HEADER_SIZE);
+        if (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+            stream_stats.malformed++;
+            while (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+                uint32_t skip = i4ScanHeader(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH);
+                memmove(buffer_header, buffer_header + skip, HEADER_SIZE - skip);
+                stream_stats.skipped_bytes += skip;
+                hbytesRead = recvAll(hSocket, buffer_header + HEADER_SIZE - skip, (int)skip);
+            }
+            stream_stats.resyncs++;
+        }
+        if (hbytesRead <= 0) {
+            printf(consoleShutdownRequested() ? "Exiting program.\n" : "Peak stream disconnected\n");
+            break;
+        }
+
+        struct i4_header_info_t header_info;
+        processPacket_HeaderInfo(buffer_header, &header_info);
+
+        int sweep_type = header_info.sweepingType;
+        int DO = header_info.dataOffset, DL = (int)header_info.dataLength; // offset for error handling
+
+        /* 2. Receiving error payload (if error exists..), counted once the sweep checked out */
+        char error_payloads[I4_SYNC_MAX_ERROR_PAYLOADS * ERROR_PAYLOAD_SIZE];
+        if (DO > HEADER_SIZE && recvAll(hSocket, error_payloads, DO - HEADER_SIZE) <= 0) {
+            perror("error receiving failed");
+            break;
+        }
+
+        /* 3. Receiving payload packet (peak or peak with timestamps) */
+        if (DL > payload_capacity) {
+            char* grown = (char*)realloc(buffer_payload, DL);
+            if (grown != NULL) buffer_payload = grown;
+            if (grown == NULL || reservePeakBatch(&peaks, DL / PEAK_PAYLOAD_SIZE) != 0) {
+                fprintf(stderr, "Payload buffer allocation failed.\n");
+                result = 1;
+                break;
+            }
+            payload_capacity = DL;
+        }
+        if (DL > 0 && recvAll(hSocket, buffer_payload, DL) <= 0) {
+            perror("Receiving failed");
+            break;
+        }
+
+        /* 4. Receiving flag packet */
+        struct I4PacketFlag flag;
+        if (recvAll(hSocket, (char*)&flag, FLAG_SIZE) <= 0) {
+            perror("flag receiving failed");
+            break;
+        }
+        if (!i4PayloadPlausible(buffer_payload, (uint32_t)DL, sweep_type) || !i4SweepPlausible(&stream_stats, flag.sweep_counter)) {
+            stream_stats.malformed++; // false header : realign on the next one
+            continue;
+        }
+        uint32_t missed = trackSweep(&stream_stats, header_info.packetCounter, flag.sweep_counter);
+
+        for (int off = 0; off + ERROR_PAYLOAD_SIZE <= DO - HEADER_SIZE; off += ERROR_PAYLOAD_SIZE) {
+            if (countPacket_errorPayload(&error_stats, error_payloads + off) == 1) {
+                processPacket_errorPayload(error_payloads + off); // first occurrence of this source in full
+            }
+        }
+
+        int payload_size = (sweep_type == SWEEP_TYPE_TSPEAK) ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE;
+        if (decodeSweepPeaks(sweep_type, buffer_payload, (uint32_t)DL, &peaks) >= 0) {
+            sweepPool_publish(sweeps, &header_info, flag.sweep_counter, &peaks);
+
+            if (verbosity >= LOG_LEVEL_PEAK) {
+                for (uint32_t i = 0; i < peaks.count; i++) {
+                    if (sweep_type == SWEEP_TYPE_TSPEAK) {
+                        printf("Sensor#%u, Fiber#%u, Channel#%u\tWavelength:%.5f nm\tTime:%.9f s\n",
+                            peaks.sensor[i], peaks.fiber[i], peaks.channel[i], peaks.wavelength[i], peaks.timestamp[i]);
+                    }
+                    else {
+                        printf("Sensor#%u, Fiber#%u, Channel#%u\tWavelength:%.5f nm\n",
+                            peaks.sensor[i], peaks.fiber[i], peaks.channel[i], peaks.wavelength[i]);
+                    }
+                }
+            }
+        }
+
+        sweep_count++;
+        if (verbosity >= LOG_LEVEL_SWEEP) {
+            if (missed > 0) {
+                printf("Lost %u sweeps before sweep %u\n", missed, flag.sweep_counter);
+            }
+            printf("Counter:%u\tSweep:%u\tPeaks:%d, Errors:%llu\n", header_info.packetCounter, flag.sweep_counter,
+                DL / payload_size, (unsigned long long)error_stats.total);
+        }
+        if (sweep_count % ERROR_SUMMARY_SWEEPS == 0) {
+            if (error_stats.total != reported_errors) {
+                printErrorStats(&error_stats);
+                reported_errors = error_stats.total;
+            }
+            printStreamStats(&stream_stats);
+        }
+    }
+
+    printErrorStats(&error_stats);
+    printStreamStats(&stream_stats);
+
+    free(buffer_payload);
+    freePeakBatch(&peaks);
+    return result;
+}
+
+THREAD_RESULT spectralThread(thread_param_t param) {
+    struct spectral_context_t* context = (struct spectral_context_t*)param;
+#ifndef _WIN32
+    setpriority(PRIO_PROCESS, 0, SPECTRAL_THREAD_NICE);
+#endif
+    context->result = captureSpectra(context);
+    return 0;
+}
+
+/* returns 0 when the I4 disconnects, 1 on a receive or framing error */
+int captureSpectra(struct spectral_context_t* context) {
+    SOCKET hSocket = context->hSocket;
+    struct spectral_pool_t* pool = &context->pool;
+
+    // buffers filled in the current sweep, committed once its flag arrives
+    struct spectral_buffer_t** captured = (struct spectral_buffer_t**)malloc(pool->count * sizeof(*captured));
+    if (captured == NULL) {
+        fprintf(stderr, "Spectral pool allocation failed.\n");
+        return 1;
+    }
+
+    int result = 0;
+    while (!consoleShutdownRequested()) {
+        uint32_t captured_count = 0;
+
+        /* 1. Receiving header packet (realigned onto the next possible header if the stream is off) */
+        char buffer_header[HEADER_SIZE] = { 0 };
+        int hbytesRead = recvAll(hSocket, buffer_header, HEADER_SIZE);
+        if (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+            while (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+                uint32_t skip = i4ScanHeader(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH);
+                memmove(buffer_header, buffer_header + skip, HEADER_SIZE - skip);
+                context->skipped_bytes += skip;
+                hbytesRead = recvAll(hSocket, buffer_header + HEADER_SIZE - skip, (int)skip);
+            }
+            context->resyncs++;
+        }
+        if (hbytesRead <= 0) {
+            printf("Spectral stream disconnected\n");
+            break;
+        }
+        struct i4_header_info_t header_info;
+        processPacket_HeaderInfo(buffer_header, &header_info);
+
+        /* 2. Receiving error payload (the peak thread reports the errors of the I4) */
+        if (header_info.dataOffset > HEADER_SIZE && recvDiscard(hSocket, header_info.dataOffset - HEADER_SIZE) <= 0) {
+            result = 1;
+            break;
+        }
+
+        /* 3. Receiving payload packet : spectral info + amplitudes, per sensor */
+        uint32_t remaining = header_info.dataLength;
+        if (header_info.sweepingType != SWEEP_TYPE_SPECTRAL) {
+            if (recvDiscard(hSocket, (int)remaining) <= 0 && remaining > 0) {
+                result = 1;
+                break;
+            }
+            remaining = 0;
+        }
+        while (remaining >= SPECTRAL_PAYLOAD_SIZE) {
+            char buffer_info[SPECTRAL_PAYLOAD_SIZE];
+            if (recvAll(hSocket, buffer_info, SPECTRAL_PAYLOAD_SIZE) <= 0) {
+                result = 1;
+                break;
+            }
+            remaining -= SPECTRAL_PAYLOAD_SIZE;
+
+            uint8_t channel, fiber, sensor;
+            uint32_t num_points;
+            processPacket_spectralPayload_info(buffer_info, &channel, &fiber, &sensor, &num_points);
+            uint32_t bytes = spectralPayloadBytes(num_points);
+            if (bytes > remaining) {
+                fprintf(stderr, "spectral payload error (%u points, %u bytes left)\n", num_points, remaining);
+                result = 1;
+                break;
+            }
+
+            struct spectral_buffer_t* spectrum = spectralPool_acquire(pool, channel, fiber, sensor, num_points);
+            int bytesRead = (spectrum != NULL)
+                ? recvAll(hSocket, (char*)spectrum->samples, (int)bytes) // amplitudes land in place, no copy
+                : recvDiscard(hSocket, (int)bytes);
+            if (bytesRead <= 0 && bytes > 0) {
+                if (spectrum != NULL) {
+                    spectralPool_abort(pool, spectrum);
+                }
+                result = 1;
+                break;
+            }
+            if (spectrum != NULL) {
+                captured[captured_count++] = spectrum;
+            }
+            remaining -= bytes;
+        }
+        if (result == 0 && remaining > 0 && recvDiscard(hSocket, (int)remaining) <= 0) {
+            result = 1;
+        }
+
+        /* 4. Receiving flag packet */
+        struct I4PacketFlag flag;
+        if (result == 0 && recvAll(hSocket, (char*)&flag, FLAG_SIZE) <= 0) {
+            result = 1;
+        }
+        if (result != 0) {
+            for (uint32_t i = 0; i < captured_count; i++) {
+                spectralPool_abort(pool, captured[i]);
+            }
+            break;
+        }
+
+        /* 5. Matching the spectra of the sweep to the peak sweep of the same time */
+        for (uint32_t i = 0; i < captured_count; i++) {
+            spectralPool_commit(pool, captured[i], &header_info, flag.sweep_counter);
+        }
+        for (uint32_t i = 0; i < captured_count; i++) {
+            matchSpectrum(context, captured[i]);
+            spectralPool_release(pool, captured[i]);
+        }
+    }
+
+    free(captured);
+    return result;
+}
+
+void matchSpectrum(struct spectral_context_t* context, const struct spectral_buffer_t* spectrum) {
+    int16_t max_amplitude = INT16_MIN;
+    uint32_t max_index = 0;
+    for (uint32_t i = 0; i < spectrum->num_points; i++) {
+        if (spectrum->samples[i] > max_amplitude) {
+            max_amplitude = spectrum->samples[i];
+            max_index = i;
+        }
+    }
+
+    // copied out under the lock, printed after it
+    int matched = 0;
+    int64_t offset_ns = 0;
+    uint32_t peak_sweep = 0;
+    int32_t peak = -1;
+    double peak_wavelength = 0.0;
+
+    sweepPool_lock(context->sweeps);
+    const struct sweep_pool_slot_t* slot = sweepPool_nearest(context->sweeps, spectrum->timeStamp);
+    if (slot != NULL) {
+        offset_ns = (int64_t)(spectrum->timeStamp - slot->timeStamp);
+        matched = (uint64_t)(offset_ns < 0 ? -offset_ns : offset_ns) <= context->tolerance_ns;
+        peak_sweep = slot->sweep_counter;
+        peak = sweepPool_findPeak(slot, spectrum->channel, spectrum->fiber, spectrum->sensor);
+        peak_wavelength = peak >= 0 ? slot->peaks.wavelength[peak] : 0.0;
+    }
+    sweepPool_unlock(context->sweeps);
+
+    if (!matched) {
+        context->unmatched++;
+        if (context->verbosity >= LOG_LEVEL_SWEEP) {
+            printf("Spectrum\tSweep:%u\t(Sensor#%u, Fiber#%u, Channel#%u)\tPoints:%u\tMax:%d @ %u\tno peak sweep within tolerance\n",
+                spectrum->sweep_counter, spectrum->sensor, spectrum->fiber, spectrum->channel, spectrum->num_points,
+                max_amplitude, max_index);
+        }
+        return;
+    }
+    context->matched++;
+    context->sum_offset_ns += (double)(offset_ns < 0 ? -offset_ns : offset_ns);
+
+    if (context->verbosity >= LOG_LEVEL_SWEEP) {
+        printf("Spectrum\tSweep:%u\t(Sensor#%u, Fiber#%u, Channel#%u)\tPoints:%u\tMax:%d @ %u\t"
+            "Peak sweep:%u (%+.1f us)\t", spectrum->sweep_counter, spectrum->sensor, spectrum->fiber, spectrum->channel,
+            spectrum->num_points, max_amplitude, max_index, peak_sweep, (double)offset_ns / 1000.0);
+        if (peak >= 0) {
+            printf("Wavelength:%.5f nm\n", peak_wavelength);
+        }
+        else {
+            printf("no peak of this sensor\n");
+        }
+    }
+}
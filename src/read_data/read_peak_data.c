@@ -2,7 +2,7 @@
 File    : read_peak_data.c
 Author  : Sooyeon Kim
 Date    : June 06, 2023
-Update  : April 21, 2024
+Update  : October 14, 2026
 Description : Client program for communicating with an I4 Interrogator device.
 Protocol    : TCP/IP
 
@@ -19,30 +19,52 @@ Updates:
 - Implemented error handling for receiving payload and error packets.
 - Included a calibration function to calculate force based on wavelength measurements.
 - Defined constants for initial wavelengths of FBGs on different channels and sensors.
+- Packet layouts and decoders moved to the shared header ../common/i4_protocol.h.
+- Calibration : per-sensor base wavelength and gain from a config file (-c), force computed for
+  the whole sweep at once with one multiply-add per peak (../common/i4_calibration.h).
+- Console output : -v <0|1|2> selects quiet / per-sweep summary (default) / per-peak lines,
+  stdout is fully buffered and repeated error payloads are only counted.
+- Stream checks : implausible headers are skipped by realigning onto the next possible header,
+  implausible peak payloads are dropped, and packetCounter / sweep_counter gaps are counted
+  (../common/i4_stream_sync.h).
+- Statistics : -T <sweeps> follows every sensor with running mean / deviation, EWMA and sliding
+  min / max of its wavelength (../common/sensor_stats.h) and prints them every <sweeps> sweeps.
+  The 't' key tares : the base wavelengths of FBGs_info are rebased onto the EWMAs, so drift of
+  the unloaded FBGs stops reading as force; -t <sweeps> tares once after that many sweeps.
+- Platforms : Windows and Linux (../common/platform_socket.h); Ctrl+C / SIGTERM end the reading
+  loop with the summaries printed, and the 't' key is read every CONSOLE_POLL_INTERVAL_MS
+  instead of on every sweep (../common/console_control.h).
 */
 
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <winsock2.h>
+#include <string.h>
 #include <stdint.h>
-#include <Windows.h>
 #include <time.h>
 #include <inttypes.h>
 
-#pragma comment(lib, "ws2_32.lib")
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_error_stats.h"
+#include "../common/i4_peak_decoder.h"
+#include "../common/i4_calibration.h"
+#include "../common/i4_stream_sync.h"
+#include "../common/sensor_stats.h"
 
 #define PORT 9931
 #define SERVER_IP "10.100.51.16"
+#define MAX_DATA_LENGTH (16 * 1024 * 1024) // sanity bound on header dataLength
 
-// packet size
-#define HEADER_SIZE 16
-#define ERROR_PAYLOAD_SIZE 8
-#define PEAK_PAYLOAD_SIZE 8
-#define TSPEAK_PAYLOAD_SIZE 12
-#define FLAG_SIZE 8
+// console output
+#define LOG_LEVEL_QUIET 0 // errors (first occurrence) and summaries only
+#define LOG_LEVEL_SWEEP 1 // one line per sweep
+#define LOG_LEVEL_PEAK 2  // one line per peak
+#define STDOUT_BUFFER_SIZE 65536
+#define ERROR_SUMMARY_SWEEPS 10000
 
-// initial wavelength of FBGs [mm]
+// initial wavelength of FBGs [nm], used when no calibration file is given
 #define CHANNEL_1_SENSOR_1_WAVELENGTH 1534.63
 #define CHANNEL_1_SENSOR_2_WAVELENGTH 1549.65
 #define CHANNEL_2_SENSOR_1_WAVELENGTH 1534.63
@@ -52,61 +74,73 @@ Updates:
 #define CHANNEL_4_SENSOR_1_WAVELENGTH 1534.63
 #define CHANNEL_4_SENSOR_2_WAVELENGTH 1549.65
 
-#pragma pack(1)
-struct ts_peak_payload_t {
-    uint32_t ts_peak_payload_LSB : 32;
-    uint32_t ts_peak_payload_MSB : 32;
-    uint32_t time_stamp : 32;
-};
-struct peak_payload_t {
-    uint32_t peak_payload_LSB : 32;
-    uint32_t peak_payload_MSB : 32;
-};
-struct error_payload_t {
-    uint32_t error_id : 32;
-    uint32_t error_description : 32;
-};
-struct I4PacketHeader {
-    uint16_t info : 16; // packetCounter(12) + sweepingType(3) + triggerMode(1)
-    uint16_t dataOffset : 16;
-    uint32_t dataLength : 32;
-    uint64_t timeStamp : 64;
-};
-struct I4PacketFlag {
-    uint32_t sweep_counter : 32;
-    uint32_t reserved : 32;
-};
-#pragma pack()
-
 
 // function redefinition
-typedef uint32_t peak_data_t[2];
-typedef uint32_t ts_peak_data_t[3];
-
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL);
-int processPacket_Payload(char* buffer_payload, int* channel, int* fiber, int* sensor, double* wavelenght);
-int processPacket_tsPayload(char* buffer_payload, int* channel, int* fiber, int* sensor, double* wavelenght);
-int processPacket_errorPayload(char* error_payload);
-int calibrationForce(const double* initial_wavelength, const double* wavelength, double* force);
+int recvAll(SOCKET hSocket, char* buffer, int length);
+void printSensorStats(const struct stats_engine_t* stats, const struct calibration_table_t* table);
 
-double wavelength(const uint32_t* const peak_data);
-uint8_t channel_id(const uint32_t* const peak_data);
-uint8_t fiber_id(const uint32_t* const peak_data);
-uint8_t sensor_id(const uint32_t* const peak_data);
-double time_stamp(const uint32_t* const peak_data);
 
+int main(int argc, char* argv[]) {
 
-int main() {
+    int verbosity = LOG_LEVEL_SWEEP;
+    const char* calibration_path = NULL;
+    uint32_t stats_interval = 0;
+    uint32_t tare_after = 0;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbosity") == 0) && i + 1 < argc) {
+            verbosity = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--calibration") == 0) && i + 1 < argc) {
+            calibration_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--stats") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            stats_interval = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tare") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            tare_after = (uint32_t)atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-v|--verbosity <0|1|2>] [-c|--calibration <file>] [-T|--stats <sweeps>] [-t|--tare <sweeps>]\n", argv[0]);
+            return 1;
+        }
+    }
+    setvbuf(stdout, NULL, _IOFBF, STDOUT_BUFFER_SIZE);
+
+    struct i4_error_stats_t error_stats;
+    initErrorStats(&error_stats);
+    uint64_t reported_errors = 0;
+    uint64_t sweeps = 0;
+    struct i4_stream_stats_t stream_stats;
+    initStreamStats(&stream_stats);
+    struct stats_engine_t sensor_stats;
+    int stats_enabled = stats_interval > 0 || tare_after > 0;
+    if (stats_enabled && initStatsEngine(&sensor_stats, STATS_DEFAULT_ALPHA, STATS_DEFAULT_WINDOW) != 0) {
+        return 1;
+    }
 
-    double FBGs_info[4][1][2]; // channel - fibre - sensor
-    FBGs_info[0][0][0] = CHANNEL_1_SENSOR_1_WAVELENGTH / 1e9;
-    FBGs_info[0][0][1] = CHANNEL_1_SENSOR_2_WAVELENGTH / 1e9;
-    FBGs_info[1][0][0] = CHANNEL_2_SENSOR_1_WAVELENGTH / 1e9;
-    FBGs_info[1][0][1] = CHANNEL_2_SENSOR_2_WAVELENGTH / 1e9;
-    FBGs_info[2][0][0] = CHANNEL_3_SENSOR_1_WAVELENGTH / 1e9;
-    FBGs_info[2][0][1] = CHANNEL_3_SENSOR_2_WAVELENGTH / 1e9;
-    FBGs_info[3][0][0] = CHANNEL_4_SENSOR_1_WAVELENGTH / 1e9;
-    FBGs_info[3][0][1] = CHANNEL_4_SENSOR_2_WAVELENGTH / 1e9;
+    // channel - fibre - sensor calibration, built-in FBGs unless a config file is given
+    struct calibration_table_t FBGs_info;
+    if (initCalibration(&FBGs_info) != 0) {
+        return 1;
+    }
+    if (calibration_path != NULL) {
+        int loaded = loadCalibration(&FBGs_info, calibration_path);
+        if (loaded < 0) {
+            freeCalibration(&FBGs_info);
+            return 1;
+        }
+        printf("Loaded %d FBGs from %s\n", loaded, calibration_path);
+    }
+    else {
+        setCalibration(&FBGs_info, 0, 0, 0, CHANNEL_1_SENSOR_1_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 0, 0, 1, CHANNEL_1_SENSOR_2_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 1, 0, 0, CHANNEL_2_SENSOR_1_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 1, 0, 1, CHANNEL_2_SENSOR_2_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 2, 0, 0, CHANNEL_3_SENSOR_1_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 2, 0, 1, CHANNEL_3_SENSOR_2_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 3, 0, 0, CHANNEL_4_SENSOR_1_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+        setCalibration(&FBGs_info, 3, 0, 1, CHANNEL_4_SENSOR_2_WAVELENGTH, CALIB_DEFAULT_GAIN, CALIB_DEFAULT_P_EPSILON);
+    }
 
 
     /* Initialize winsock */
@@ -142,305 +176,171 @@ int main() {
         return 1;
     }
 
+    // whole payload of one sweep, decoded at once
+    char* buffer_payload = NULL;
+    int payload_capacity = 0;
+    peak_batch_t peaks;
+    initPeakBatch(&peaks, 0);
+    double* force = NULL;
+
+    consoleControl_install();
+    while (!consoleShutdownRequested()) {
+        /* 1. Receiving header packet (realigned onto the next possible header if the stream is off) */
+        char buffer_header[HEADER_SIZE] = { 0 };
+        int hbytesRead = recvAll(hSocket, buffer_header, HEADER_SIZE);
+        if (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+            stream_stats.malformed++;
+            while (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+                uint32_t skip = i4ScanHeader(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH);
+                memmove(buffer_header, buffer_header + skip, HEADER_SIZE - skip);
+                stream_stats.skipped_bytes += skip;
+                hbytesRead = recvAll(hSocket, buffer_header + HEADER_SIZE - skip, (int)skip);
+            }
+            stream_stats.resyncs++;
+        }
+        if (hbytesRead <= 0) {
+            printf(consoleShutdownRequested() ? "Exiting program.\n" : "Client disconnected\n");
+            break;
+        }
+
+        struct i4_header_info_t header_info;
+        processPacket_HeaderInfo(buffer_header, &header_info);
 
-    while (1) {
-        /* 1. Receiving header packet */
-        char* buffer_header[HEADER_SIZE] = { 0 };
-        int hbytesRead = recv(hSocket, buffer_header, HEADER_SIZE, 0);
+        int sweep_type = header_info.sweepingType;
+        int DO = header_info.dataOffset, DL = (int)header_info.dataLength; // offset for error handling
 
-       if (hbytesRead == SOCKET_ERROR) {
+        /* 2. Receiving error payload (if error exists..), counted once the sweep checked out */
+        char error_payloads[I4_SYNC_MAX_ERROR_PAYLOADS * ERROR_PAYLOAD_SIZE];
+        if (DO > HEADER_SIZE && recvAll(hSocket, error_payloads, DO - HEADER_SIZE) <= 0) {
+            perror("error receiving failed");
+            break;
+        }
+
+        /* 3. Receiving payload packet (peak or peak with timestamps) */
+        if (DL > payload_capacity) {
+            char* grown = (char*)realloc(buffer_payload, DL);
+            double* grown_force = (double*)realloc(force, (DL / PEAK_PAYLOAD_SIZE) * sizeof(double));
+            if (grown != NULL) buffer_payload = grown;
+            if (grown_force != NULL) force = grown_force;
+            if (grown == NULL || grown_force == NULL || reservePeakBatch(&peaks, DL / PEAK_PAYLOAD_SIZE) != 0) {
+                fprintf(stderr, "Payload buffer allocation failed.\n");
+                break;
+            }
+            payload_capacity = DL;
+        }
+        if (DL > 0 && recvAll(hSocket, buffer_payload, DL) <= 0) {
             perror("Receiving failed");
+            break;
         }
-        else if (hbytesRead == 0) {
-            printf("Client disconnected\n");
+
+        /* 4. Receiving flag packet */
+        struct I4PacketFlag flag;
+        if (recvAll(hSocket, (char*)&flag, FLAG_SIZE) <= 0) {
+            perror("flag receiving failed");
+            break;
         }
-        if (hbytesRead != HEADER_SIZE) {
-            perror("packet header size error");
+        if (!i4PayloadPlausible(buffer_payload, (uint32_t)DL, sweep_type) || !i4SweepPlausible(&stream_stats, flag.sweep_counter)) {
+            stream_stats.malformed++; // false header : realign on the next one
+            continue;
         }
+        uint32_t missed = trackSweep(&stream_stats, header_info.packetCounter, flag.sweep_counter);
 
-        int sweep_type, DO, DL; // offset for error handling
-        processPacket_Header(buffer_header, &sweep_type, &DO, &DL);
-
-        int channel=0, fiber=0, sensor=0;
-        double wavelength=0, force=0;
-
-        /* 2. Receiving payload packet */
-        if (DO == 16) { // or 0X0010
-            // receiving peak payload
-            if (sweep_type == 0) { // peak
-                char* buffer_payload[PEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / PEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, PEAK_PAYLOAD_SIZE, 0);
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength);
-                    double initial_wavelength = FBGs_info[channel][fiber][sensor];
-                    calibrationForce(&initial_wavelength, &wavelength, &force);
-                }
-            }
-            // receiving time-stamped peak payload
-            else if (sweep_type == 2) { // peak with timestamps
-                char* buffer_payload[TSPEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / TSPEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, TSPEAK_PAYLOAD_SIZE, 0);
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_tsPayload(buffer_payload, &channel, &fiber, &sensor, &wavelength);
-                    double initial_wavelength = FBGs_info[channel][fiber][sensor];
-                    calibrationForce(&initial_wavelength, &wavelength, &force);
-                    printf("Sensor#%u, ", sensor);
-                    printf("Fiber#%u, ", fiber);
-                    printf("Channel#%u\t", channel);
-                    printf("Force:%.5f mN\n", force);
-                }
+        for (int off = 0; off + ERROR_PAYLOAD_SIZE <= DO - HEADER_SIZE; off += ERROR_PAYLOAD_SIZE) {
+            if (countPacket_errorPayload(&error_stats, error_payloads + off) == 1) {
+                processPacket_errorPayload(error_payloads + off); // first occurrence of this source in full
             }
         }
 
-        else { // if error exists..
-            // receiving error payload
-            char* error_payload[ERROR_PAYLOAD_SIZE] = { 0 };
-            int ebytesRead = recv(hSocket, error_payload, ERROR_PAYLOAD_SIZE, 0);
-            if (ebytesRead == SOCKET_ERROR) {
-                perror("error receiving failed");
-            }
-            else if (ebytesRead == 0) {
-                printf("Client disconnected\n");
-            }
-            processPacket_errorPayload(error_payload);
-
-            // receiving peak payload
-            if (sweep_type == 0) { // peak
-                char* buffer_payload[PEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / PEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, PEAK_PAYLOAD_SIZE, 0);
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength);
-                    double initial_wavelength = FBGs_info[channel][fiber][sensor];
-                    calibrationForce(&initial_wavelength, &wavelength, &force);
+        int payload_size = (sweep_type == SWEEP_TYPE_TSPEAK) ? TSPEAK_PAYLOAD_SIZE : PEAK_PAYLOAD_SIZE;
+        if (decodeSweepPeaks(sweep_type, buffer_payload, (uint32_t)DL, &peaks) >= 0) {
+            if (stats_enabled) {
+                statsEngine_add(&sensor_stats, &peaks);
+                int tare = sensor_stats.sweeps == tare_after;
+                if (consolePollKey() == 't') {
+                    tare = 1;
+                }
+                if (tare) {
+                    printf("Tare at sweep %u : %u sensors rebased\n", flag.sweep_counter, statsTare(&sensor_stats, &FBGs_info));
                 }
             }
-            // receiving time-stamped peak payload
-            else if (sweep_type == 2) { // peak with timestamps
-                char* buffer_payload[TSPEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / TSPEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, TSPEAK_PAYLOAD_SIZE, 0);
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
+            calibrationForce_batch(&FBGs_info, &peaks, force);
+
+            if (verbosity >= LOG_LEVEL_PEAK) {
+                for (uint32_t i = 0; i < peaks.count; i++) {
+                    if (sweep_type == SWEEP_TYPE_TSPEAK) {
+                        printf("Sensor#%u, Fiber#%u, Channel#%u\tForce:%.5f mN\tTime:%.9f s\n",
+                            peaks.sensor[i], peaks.fiber[i], peaks.channel[i], force[i], peaks.timestamp[i]);
                     }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
+                    else {
+                        printf("Sensor#%u, Fiber#%u, Channel#%u\tForce:%.5f mN\n",
+                            peaks.sensor[i], peaks.fiber[i], peaks.channel[i], force[i]);
                     }
-                    processPacket_tsPayload(buffer_payload, &channel, &fiber, &sensor, &wavelength);
-                    double initial_wavelength = FBGs_info[channel][fiber][sensor];
-                    calibrationForce(&initial_wavelength, &wavelength, &force);
-                    printf("Sensor#%u, ", sensor);
-                    printf("Fiber#%u, ", fiber);
-                    printf("Channel#%u\t", channel);
-                    printf("Force:%.5f mN\n", force);
                 }
             }
-            
         }
 
-
-        /* 3. Receiving flag packet */
-        char* buffer_flag[FLAG_SIZE] = { 0 };
-        int fbytesRead = recv(hSocket, buffer_flag, FLAG_SIZE, 0);
-
-        if (fbytesRead == SOCKET_ERROR) {
-            perror("flag receiving failed");
+        sweeps++;
+        if (verbosity >= LOG_LEVEL_SWEEP) {
+            if (missed > 0) {
+                printf("Lost %u sweeps before sweep %u\n", missed, flag.sweep_counter);
+            }
+            printf("Counter:%u\tSweep:%u\tPeaks:%d, Errors:%llu\n", header_info.packetCounter, flag.sweep_counter,
+                DL / payload_size, (unsigned long long)error_stats.total);
         }
-        else if (fbytesRead == 0) {
-            printf("Client disconnected\n");
+        if (sweeps % ERROR_SUMMARY_SWEEPS == 0) {
+            if (error_stats.total != reported_errors) {
+                printErrorStats(&error_stats);
+                reported_errors = error_stats.total;
+            }
+            printStreamStats(&stream_stats);
+        }
+        if (stats_interval > 0 && sweeps % stats_interval == 0) {
+            printSensorStats(&sensor_stats, &FBGs_info);
         }
-
-        //free(buffer_header);
-        //free(buffer_payload);
-        //closesocket(hSocket);
-        //WSACleanup();
 
         //break; // read 1st packet only
 
     }
-    return 0;
-}
-
-
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL) {
-
-    struct I4PacketHeader* header = (struct I4PacketHeader*)(buffer_header);
-
-    // Packet Header (bit field mask)
-    uint16_t packetCounterMask = 0xFFF; // lower 12 bits
-    uint16_t sweepingTypeMask = 0x7000; // middle 3 bits
-    uint16_t triggerModeMask = 0x8000;  // top 1 bit
-
-    uint16_t packetCounter = header->info & packetCounterMask;
-    uint16_t sweepingType = (header->info & sweepingTypeMask) >> 12;
-    uint16_t triggerMode = (header->info & triggerModeMask) >> 15;
-
-    uint16_t dataOffset = header->dataOffset; // 0~65535 byte offset
-    uint32_t dataLength = header->dataLength; // bytes
-    uint32_t totalPacketSize = dataOffset + dataLength + 8;
-
-    *sweep_type = sweepingType;
-    *DO = dataOffset;
-    *DL = dataLength;
-
-    // time stamp
-    //time_t unix_time = (header->timeStamp / 1000000000) - 2208988800;
-    //struct tm tm_info;
-    //gmtime_s(&tm_info, &unix_time);
-    //char time_buffer[30];
-    //strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &tm_info);
-
-    // data print
-    //printf("Time\t\t:%s\n", time_buffer);
-    //printf("Packet Counter\t:%u\n", packetCounter);
-    //printf("Sweeping Type\t:%u  (Peak(0), Spectral(1), Peak with timestamps(2))\n", sweepingType);
-    //printf("Trigger Mode\t:%u  (Internal trigger(0), External trigger(1))\n", triggerMode);
-    //printf("Data Offset\t:0x%04X (%"PRIu16")\n", dataOffset, dataOffset);
-    //printf("Data Length\t:%"PRIu32"\n", dataLength);
-    //printf("Packet Size\t:%"PRIu32"\n", totalPacketSize);
-
-    printf("Counter:%u\t", packetCounter);
-
-    return 0;
-}
-
-int processPacket_tsPayload(char* buffer_payload, int* channel, int* fiber, int* sensor, double* wavelenght) {
-
-    struct ts_peak_payload_t* ts_payload = (struct ts_peak_payload_t*)(buffer_payload);
-
-    ts_peak_data_t peak_data;
-    peak_data[0] = ts_payload->ts_peak_payload_LSB;
-    peak_data[1] = ts_payload->ts_peak_payload_MSB;
-    peak_data[2] = ts_payload->time_stamp;
-
-    *channel = channel_id(peak_data);
-    *fiber = fiber_id(peak_data);
-    *sensor = sensor_id(peak_data);
-    *wavelenght = wavelength(peak_data);
-
-    //printf("Sensor ID\t:%u\n", sensor_id(peak_data));
-    //printf("Fiber ID\t:%u\n", fiber_id(peak_data));
-    //printf("Channel ID\t:%u\n", channel_id(peak_data));
-    //printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
-    //printf("Timestamp\t:%f ns\n", time_stamp(peak_data) * 0.5);
-
-    //printf("(Sensor#%u, ", sensor_id(peak_data));
-    //printf("Fiber#%u, ", fiber_id(peak_data));
-    //printf("Channel#%u)\t", channel_id(peak_data));
-    //printf("Wavelength:%.10e meters\n", wavelength(peak_data));
-
-    return 0;
-}
-
-int processPacket_Payload(char* buffer_payload, int* channel, int* fiber, int* sensor, double* wavelenght) {
-
-    struct peak_payload_t* payload = (struct peak_payload_t*)(buffer_payload);
-
-    peak_data_t peak_data;
-    peak_data[0] = payload->peak_payload_LSB;
-    peak_data[1] = payload->peak_payload_MSB;
-
-    *channel = channel_id(peak_data);
-    *fiber = fiber_id(peak_data);
-    *sensor = sensor_id(peak_data);
-    *wavelenght = wavelength(peak_data);
-
-    //printf("Sensor ID\t:%u\n", sensor_id(peak_data));
-    //printf("Fiber ID\t:%u\n", fiber_id(peak_data));
-    //printf("Channel ID\t:%u\n", channel_id(peak_data));
-    //printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
 
-    //printf("(Sensor#%u, ", sensor_id(peak_data));
-    //printf("Fiber#%u, ", fiber_id(peak_data));
-    //printf("Channel#%u)\t", channel_id(peak_data));
-    //printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
+    printErrorStats(&error_stats);
+    printStreamStats(&stream_stats);
+    fflush(stdout);
 
+    free(buffer_payload);
+    free(force);
+    freePeakBatch(&peaks);
+    if (stats_enabled) {
+        printSensorStats(&sensor_stats, &FBGs_info);
+        freeStatsEngine(&sensor_stats);
+    }
+    freeCalibration(&FBGs_info);
+    closesocket(hSocket);
+    WSACleanup();
     return 0;
 }
 
-int processPacket_errorPayload(char* error_payload) {
-
-    struct error_payload_t* payload = (struct error_payload_t*)(error_payload);
-
-    peak_data_t data;
-    data[1] = payload->error_id;
-    data[0] = payload->error_description;
 
-    if (data[1] == 500) {
-        printf("Error type : Missing Peak\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source: No peak was detected where one was "
-            "expected from the interrogator configuration.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n"
-            "* disconnected sensor\n");
-    }
-    else if (data[1] == 501) {
-        printf("Error type : Multiple Peaks\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source : More than the expected number of peaks was "
-            "detected in the sensors wavelength range.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n");
-    }
-    else {
-        printf("Error type : Internal Error\n");
-        printf("Error source: Internal error\n"
-            "Possible causes include :\n"
-            "* Transient mismatch of configuration and data stream\n"
-            "* Internal failure\n");
+/* receives exactly 'length' bytes, returns 0 on disconnect and SOCKET_ERROR on failure */
+int recvAll(SOCKET hSocket, char* buffer, int length) {
+    int received = 0;
+    while (received < length) {
+        int bytesRead = recv(hSocket, buffer + received, length - received, 0);
+        if (bytesRead == SOCKET_ERROR || bytesRead == 0) {
+            return bytesRead;
+        }
+        received += bytesRead;
     }
-
-    return 0;
+    return received;
 }
 
-int calibrationForce(const double* initial_wavelength, const double* wavelength, double* force) {
-    double present_wavelength = *wavelength;
-    double delta_wavelength = present_wavelength - *initial_wavelength;
-    double P_epsilon = 0.28;
-    double strain = delta_wavelength / *initial_wavelength / (1 - P_epsilon);
-    double K = 1.0 / 460.0 / 0.02986; // [/N]
-    *force = strain / K *1000; // mN
-
-    return 0;
-}
 
-/* extract wavelength value in meters */
-double wavelength(const uint32_t* const peak_data) {
-    uint32_t peak_value[2];
-    peak_value[0] = (peak_data[0] & ~0xffff) | 0x7fff; /* mask out id bits */
-    peak_value[1] = peak_data[1];
-    return *(double*)&peak_value;
-}
-uint8_t channel_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 12) & 0x0f;
-}
-uint8_t fiber_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 8) & 0x0f;
-}
-uint8_t sensor_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] & 0xff);
-}
-/* extract time stamp value in seconds */
-double time_stamp(const uint32_t* const peak_data) {
-    return (double)peak_data[2] * 5e-10;
+void printSensorStats(const struct stats_engine_t* stats, const struct calibration_table_t* table) {
+    for (uint32_t s = 0; s < stats->count; s++) {
+        const struct sensor_stats_t* sensor = &stats->slots[s];
+        int32_t index = calibrationIndex(sensor->channel, sensor->fiber, sensor->sensor);
+        printf("Sensor#%u, Fiber#%u, Channel#%u\tMean:%.5f nm, Std:%.2f pm, EWMA:%.5f nm (%.5f mN), Window:%.5f..%.5f nm, Base:%.5f nm\n",
+            sensor->sensor, sensor->fiber, sensor->channel, sensor->mean, statsStd(sensor) * 1000.0, sensor->ewma,
+            calibrationForce(table, sensor->channel, sensor->fiber, sensor->sensor, sensor->ewma),
+            statsWindowMin(sensor), statsWindowMax(sensor), table->base_wavelength[index]);
+    }
 }
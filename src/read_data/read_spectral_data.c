@@ -2,7 +2,7 @@
 File    : read_spectral_data.c
 Author  : Sooyeon Kim
 Date    : June 06, 2023
-Update  : April 21, 2024
+Update  : October 15, 2026
 Description : Client program for communicating with an I4 Interrogator device.
 Protocol    : TCP/IP
 
@@ -21,85 +21,76 @@ The program continuously receives packets from the server and processes them acc
 
 Updates:
 - April 21, 2024: Added comments, improved error handling, and optimized code structure.
+- October 14, 2026: Packet layouts and decoders moved to the shared header ../common/i4_protocol.h.
+- October 14, 2026: Continuous spectral capture (-c). Each spectrum is received in place into an aligned
+  int16_t buffer from a preallocated pool (../common/spectral_pool.h), kept until the consumer releases it.
+  Without -c the program still prints the first sweep and exits.
+- October 14, 2026: Builds on Windows and Linux (../common/platform_socket.h); Ctrl+C / SIGTERM end the
+  continuous capture with its summary printed (../common/console_control.h).
+- October 14, 2026: The first sweep is received whole, after all of its error payloads, and decoded once
+  for its sweep type (../common/i4_peak_decoder.h); time-stamped peaks are printed with their time stamp.
+- October 15, 2026: Headers are checked against the bounds of ../common/i4_stream_sync.h before their
+  dataOffset / dataLength are trusted, and the stream is realigned onto the next plausible header,
+  as in read_peak_data.c. The continuous capture prints the stream counters with its summary.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <winsock2.h>
 #include <stdint.h>
-#include <Windows.h>
 #include <time.h>
 #include <inttypes.h>
+#include <string.h>
 
-#pragma comment(lib, "ws2_32.lib")
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_peak_decoder.h"
+#include "../common/i4_stream_sync.h"
+#include "../common/spectral_pool.h"
 
 #define PORT 9932
 #define SERVER_IP "10.100.51.16"
+#define MAX_DATA_LENGTH (16 * 1024 * 1024) // sanity bound on header dataLength
 
-// packet size
-#define HEADER_SIZE 16
-#define ERROR_PAYLOAD_SIZE 8
-#define PEAK_PAYLOAD_SIZE 8
-#define TSPEAK_PAYLOAD_SIZE 12
-#define SPECTRAL_PAYLOAD_SIZE 8
-#define FLAG_SIZE 8
-
-#pragma pack(1)
-struct ts_peak_payload_t {
-    uint32_t ts_peak_payload_LSB : 32;
-    uint32_t ts_peak_payload_MSB : 32;
-    uint32_t time_stamp : 32;
-};
-struct peak_payload_t {
-    uint32_t peak_payload_LSB : 32;
-    uint32_t peak_payload_MSB : 32;
-};
-struct spectral_payload_info_t {
-    uint32_t spectral_payload_LSB : 32;
-    uint32_t spectral_payload_MSB : 32;
-};
-struct spectral_payload_t {
-    int16_t spectral_amplitude_1 : 16;
-    int16_t spectral_amplitude_2 : 16;
-    int16_t spectral_amplitude_3 : 16;
-    int16_t spectral_amplitude_4 : 16;
-};
-struct error_payload_t {
-    uint32_t error_id : 32;
-    uint32_t error_description : 32;
-};
-struct I4PacketHeader {
-    uint16_t info : 16; // packetCounter(12) + sweepingType(3) + triggerMode(1)
-    uint16_t dataOffset : 16;
-    uint32_t dataLength : 32;
-    uint64_t timeStamp : 64;
-};
-struct I4PacketFlag {
-    uint32_t sweep_counter : 32;
-    uint32_t reserved : 32;
-};
-#pragma pack()
-
+// continuous capture
+#define SPECTRAL_DEFAULT_BUFFERS 16
+#define SPECTRAL_DEFAULT_MAX_POINTS 32768
+#define DISCARD_BUFFER_SIZE 4096
 
 // function redefinition
-typedef uint32_t peak_data_t[2];
-typedef uint32_t ts_peak_data_t[3];
-
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL);
-int processPacket_Payload(char* buffer_header);
-int processPacket_tsPayload(char* buffer_header);
-int processPacket_spectralPayload_info(char* buffer_payload);
-int processPacket_spectralPayload(char* buffer_payload, int16_t* data1, int16_t* data2, int16_t* data3, int16_t* data4);
-int processPacket_errorPayload(char* error_payload);
-
-double wavelength(const uint32_t* const peak_data);
-uint8_t channel_id(const uint32_t* const peak_data);
-uint8_t fiber_id(const uint32_t* const peak_data);
-uint8_t sensor_id(const uint32_t* const peak_data);
-double time_stamp(const uint32_t* const peak_data);
-
-
-int main() {
+int recvAll(SOCKET hSocket, char* buffer, int length);
+int recvDiscard(SOCKET hSocket, int length);
+int recvHeader(SOCKET hSocket, char* buffer_header, struct i4_stream_stats_t* stream_stats);
+int captureSpectra(SOCKET hSocket, struct spectral_pool_t* pool, struct i4_stream_stats_t* stream_stats);
+int consumeSpectrum(const struct spectral_buffer_t* spectrum);
+int printPacket_Header(const char* buffer_header, int* sweep_type, int* DO, int* DL);
+int printPacket_Peaks(int sweep_type, const char* buffer_payload, int DL);
+int printPacket_spectralPayload_info(const char* buffer_payload);
+
+int main(int argc, char* argv[]) {
+
+    int continuous = 0;
+    uint32_t pool_buffers = SPECTRAL_DEFAULT_BUFFERS;
+    uint32_t max_points = SPECTRAL_DEFAULT_MAX_POINTS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--continuous") == 0) {
+            continuous = 1;
+        }
+        else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pool") == 0) && i + 1 < argc) {
+            pool_buffers = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--points") == 0) && i + 1 < argc) {
+            max_points = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-c|--continuous] [-p|--pool <buffers>] [-n|--points <max points per spectrum>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pool_buffers == 0 || max_points == 0) {
+        fprintf(stderr, "Pool buffers and points must be positive.\n");
+        return 1;
+    }
 
     /* Initialize winsock */
     WSADATA wsaData;
@@ -134,305 +125,346 @@ int main() {
         return 1;
     }
 
-    while (1) {
-        /* 1. Receiving header packet */
-        char* buffer_header[HEADER_SIZE] = { 0 };
-        int hbytesRead = recv(hSocket, buffer_header, HEADER_SIZE, 0);
+    struct i4_stream_stats_t stream_stats;
+    initStreamStats(&stream_stats);
 
-        if (hbytesRead == SOCKET_ERROR) {
-            perror("Receiving failed");
-        }
-        else if (hbytesRead == 0) {
-            printf("Client disconnected\n");
+    if (continuous) {
+        struct spectral_pool_t pool;
+        if (initSpectralPool(&pool, pool_buffers, max_points) != 0) {
+            closesocket(hSocket);
+            WSACleanup();
+            return 1;
         }
-        if (hbytesRead != HEADER_SIZE) {
-            perror("packet header size error");
+        int result = captureSpectra(hSocket, &pool, &stream_stats);
+        printStreamStats(&stream_stats);
+        printf("Spectra : %llu captured, %llu dropped (pool exhausted), %llu dropped (over %u points)\n",
+            (unsigned long long)pool.committed, (unsigned long long)pool.exhausted,
+            (unsigned long long)pool.oversized, pool.capacity);
+        freeSpectralPool(&pool);
+        closesocket(hSocket);
+        WSACleanup();
+        return result;
+    }
+
+    int result = 0;
+    while (1) {
+        /* 1. Receiving header packet (realigned onto the next possible header if the stream is off) */
+        char buffer_header[HEADER_SIZE] = { 0 };
+        int hbytesRead = recvHeader(hSocket, buffer_header, &stream_stats);
+        if (hbytesRead <= 0) {
+            printf(hbytesRead == 0 ? "Client disconnected\n" : "Receiving failed\n");
+            result = 1;
+            break;
         }
 
         int sweep_type, DO, DL; // offset for error handling
-        processPacket_Header(buffer_header, &sweep_type, &DO, &DL);
-
-
-        /* 2. Receiving payload packet */
-        if (DO == 16) { // or 0X0010
-
-            // receiving peak payload
-            if (sweep_type == 0) { // peak
-                char* buffer_payload[PEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / PEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, PEAK_PAYLOAD_SIZE, 0);
-
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload);
-                }
-            }
-            // receiving spectral payload
-            else if (sweep_type == 1) { // spectral
-                char* buffer_payload[SPECTRAL_PAYLOAD_SIZE] = { 0 };
-
-                // spectral info
-                int pbytesRead = recv(hSocket, buffer_payload, SPECTRAL_PAYLOAD_SIZE, 0);
-                if (pbytesRead == SOCKET_ERROR) {
-                    perror("Receiving failed");
-                }
-                else if (pbytesRead == 0) {
-                    printf("Client disconnected\n");
-                }
-                processPacket_spectralPayload_info(buffer_payload);
-
-                // spectral data
-                int16_t data1, data2, data3, data4;
-                for (int i = 1; i < (DL / SPECTRAL_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, SPECTRAL_PAYLOAD_SIZE, 0);
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_spectralPayload(buffer_payload, &data1, &data2, &data3, &data4);
-
-                    //printf("Spectral Amplitude P %u\t: %u\n", 4 * i - 3, data1);
-                    //printf("Spectral Amplitude P %u\t: %u\n", 4 * i - 2, data2);
-                    //printf("Spectral Amplitude P %u\t: %u\n", 4 * i - 1, data2);
-                    //printf("Spectral Amplitude P %u\t: %u\n", 4 * i    , data3);
-                }
-            }
-            // receiving time-stamped peak payload
-            else if (sweep_type == 2) { // peak with timestamps
-                char* buffer_payload[TSPEAK_PAYLOAD_SIZE] = { 0 };
-
-                for (int i = 0; i < (DL / TSPEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket, buffer_payload, TSPEAK_PAYLOAD_SIZE, 0);
-
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receiving failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_tsPayload(buffer_payload);
-                }
-            }
-        }
+        printPacket_Header(buffer_header, &sweep_type, &DO, &DL);
 
-        else { // if error exists..
-            // receiving error payload
-            char* error_payload[ERROR_PAYLOAD_SIZE] = { 0 };
-            int ebytesRead = recv(hSocket, error_payload, ERROR_PAYLOAD_SIZE, 0);
-            if (ebytesRead == SOCKET_ERROR) {
+        /* 2. Receiving error payload (if error exists..), every one of them ahead of the payload */
+        char error_payload[ERROR_PAYLOAD_SIZE] = { 0 };
+        int off = HEADER_SIZE;
+        for (; off + ERROR_PAYLOAD_SIZE <= DO; off += ERROR_PAYLOAD_SIZE) {
+            if (recvAll(hSocket, error_payload, ERROR_PAYLOAD_SIZE) <= 0) {
                 perror("error receiving failed");
-            }
-            else if (ebytesRead == 0) {
-                printf("Client disconnected\n");
+                break;
             }
             processPacket_errorPayload(error_payload);
-
-            break; // 강제 종료
+        }
+        if (off + ERROR_PAYLOAD_SIZE <= DO) {
+            result = 1;
+            break;
         }
 
-
-        /* 3. Receiving flag packet */
-        char* buffer_flag[FLAG_SIZE] = { 0 };
-        int fbytesRead = recv(hSocket, buffer_flag, FLAG_SIZE, 0);
-
-        if (fbytesRead == SOCKET_ERROR) {
-            perror("flag receiving failed");
+        /* 3. Receiving payload packet, decoded once for its sweep type */
+        char* buffer_payload = (char*)malloc(DL > 0 ? DL : 1);
+        if (buffer_payload == NULL || (DL > 0 && recvAll(hSocket, buffer_payload, DL) <= 0)) {
+            perror("Receiving failed");
+            free(buffer_payload);
+            result = 1;
+            break;
+        }
+        if (sweep_type == SWEEP_TYPE_SPECTRAL) {
+            if (DL >= SPECTRAL_PAYLOAD_SIZE) {
+                printPacket_spectralPayload_info(buffer_payload); // spectral info, the amplitudes follow
+            }
         }
-        else if (fbytesRead == 0) {
-            printf("Client disconnected\n");
+        else {
+            printPacket_Peaks(sweep_type, buffer_payload, DL);
         }
+        free(buffer_payload);
 
-        //free(buffer_header);
-        //free(buffer_payload);
-        //closesocket(hSocket);
-        //WSACleanup();
+        /* 4. Receiving flag packet */
+        char buffer_flag[FLAG_SIZE] = { 0 };
+        if (recvAll(hSocket, buffer_flag, FLAG_SIZE) <= 0) {
+            perror("flag receiving failed");
+            result = 1;
+        }
 
         break; // 1st packet만 수신
 
     }
-    return 0;
+    closesocket(hSocket);
+    WSACleanup();
+    return result;
 }
 
 
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL) {
-
-    struct I4PacketHeader* header = (struct I4PacketHeader*)(buffer_header);
-
-    // Packet Header (bit field mask)
-    uint16_t packetCounterMask = 0xFFF; // lower 12 bits
-    uint16_t sweepingTypeMask = 0x7000; // middle 3 bits
-    uint16_t triggerModeMask = 0x8000;  // top 1 bit
-
-    uint16_t packetCounter = header->info & packetCounterMask;
-    uint16_t sweepingType = (header->info & sweepingTypeMask) >> 12;
-    uint16_t triggerMode = (header->info & triggerModeMask) >> 15;
-
-    uint16_t dataOffset = header->dataOffset; // 0~65535 byte offset
-    uint32_t dataLength = header->dataLength; // bytes
-    uint32_t totalPacketSize = dataOffset + dataLength + 8;
-
-    *sweep_type = sweepingType;
-    *DO = dataOffset;
-    *DL = dataLength;
-
-    // time stamp
-    time_t unix_time = (header->timeStamp / 1000000000) - 2208988800;
-    struct tm tm_info;
-    gmtime_s(&tm_info, &unix_time);
-    char time_buffer[30];
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &tm_info);
-
-    // data print
-    printf("Time\t\t:%s\n", time_buffer);
-    printf("Packet Counter\t:%u\n", packetCounter);
-    printf("Sweeping Type\t:%u  (Peak(0), Spectral(1), Peak with timestamps(2))\n", sweepingType);
-    printf("Trigger Mode\t:%u  (Internal trigger(0), External trigger(1))\n", triggerMode);
-    printf("Data Offset\t:0x%04X (%"PRIu16")\n", dataOffset, dataOffset);
-    printf("Data Length\t:%"PRIu32"\n", dataLength);
-    printf("Packet Size\t:%"PRIu32"\n", totalPacketSize);
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* recvAll : Receives exactly 'length' bytes, looping over partial receives.
+* recvDiscard : Receives and drops 'length' bytes (spectra without a pool buffer).
+* recvHeader : Receives a header, realigned onto the next plausible one (../common/i4_stream_sync.h).
+* captureSpectra : Receives spectral sweeps continuously, each spectrum straight into a pool buffer.
+* consumeSpectrum : Consumer of one captured spectrum (summary line).
+* printPacket_Header, printPacket_Peaks, printPacket_spectralPayload_info :
+*     Print decoded packets of the first sweep (without -c).
+* ==============================================================================
+*/
 
-    //printf("Counter:%u\t", packetCounter);
-    //printf("DO:0x%04X(%"PRIu16")\t", dataOffset, dataOffset);
-    //printf("DL:%"PRIu32"\n", dataLength);
+int recvAll(SOCKET hSocket, char* buffer, int length) {
+    int received = 0;
+    while (received < length) {
+        int bytesRead = recv(hSocket, buffer + received, length - received, 0);
+        if (bytesRead == SOCKET_ERROR || bytesRead == 0) {
+            return bytesRead;
+        }
+        received += bytesRead;
+    }
+    return received;
+}
 
-    return 0;
+int recvDiscard(SOCKET hSocket, int length) {
+    char discard[DISCARD_BUFFER_SIZE];
+    while (length > 0) {
+        int chunk = length < DISCARD_BUFFER_SIZE ? length : DISCARD_BUFFER_SIZE;
+        int bytesRead = recvAll(hSocket, discard, chunk);
+        if (bytesRead <= 0) {
+            return bytesRead;
+        }
+        length -= bytesRead;
+    }
+    return 1;
 }
 
-int processPacket_tsPayload(char* buffer_payload) {
+/* returns recvAll()'s result; DO / DL of the header are within the i4HeaderPlausible() bounds once it is > 0 */
+int recvHeader(SOCKET hSocket, char* buffer_header, struct i4_stream_stats_t* stream_stats) {
+    int hbytesRead = recvAll(hSocket, buffer_header, HEADER_SIZE);
+    if (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+        stream_stats->malformed++;
+        while (hbytesRead > 0 && !i4HeaderPlausible(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH)) {
+            uint32_t skip = i4ScanHeader(buffer_header, HEADER_SIZE, MAX_DATA_LENGTH);
+            memmove(buffer_header, buffer_header + skip, HEADER_SIZE - skip);
+            stream_stats->skipped_bytes += skip;
+            hbytesRead = recvAll(hSocket, buffer_header + HEADER_SIZE - skip, (int)skip);
+        }
+        stream_stats->resyncs++;
+    }
+    return hbytesRead;
+}
 
-    struct ts_peak_payload_t* ts_payload = (struct ts_peak_payload_t*)(buffer_payload);
+/* returns 0 when the I4 disconnects, 1 on a receive or framing error */
+int captureSpectra(SOCKET hSocket, struct spectral_pool_t* pool, struct i4_stream_stats_t* stream_stats) {
+    // buffers filled in the current sweep, committed once its flag arrives
+    struct spectral_buffer_t** captured = (struct spectral_buffer_t**)malloc(pool->count * sizeof(*captured));
+    if (captured == NULL) {
+        fprintf(stderr, "Spectral pool allocation failed.\n");
+        return 1;
+    }
 
-    ts_peak_data_t peak_data;
-    peak_data[0] = ts_payload->ts_peak_payload_LSB;
-    peak_data[1] = ts_payload->ts_peak_payload_MSB;
-    peak_data[2] = ts_payload->time_stamp;
+    int result = 0;
+    consoleControl_install();
+    while (!consoleShutdownRequested()) {
+        uint32_t captured_count = 0;
 
-    //printf("Sensor ID\t:%u\n", sensor_id(peak_data));
-    //printf("Fiber ID\t:%u\n", fiber_id(peak_data));
-    //printf("Channel ID\t:%u\n", channel_id(peak_data));
-    //printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
-    //printf("Timestamp\t:%f ns\n", time_stamp(peak_data) * 0.5);
+        /* 1. Receiving header packet (realigned onto the next possible header if the stream is off) */
+        char buffer_header[HEADER_SIZE] = { 0 };
+        if (recvHeader(hSocket, buffer_header, stream_stats) <= 0) {
+            printf(consoleShutdownRequested() ? "Exiting program.\n" : "Client disconnected\n");
+            break;
+        }
+        struct i4_header_info_t header_info;
+        processPacket_HeaderInfo(buffer_header, &header_info);
+
+        /* 2. Receiving error payload (if error exists..) */
+        for (uint32_t off = HEADER_SIZE; off + ERROR_PAYLOAD_SIZE <= header_info.dataOffset; off += ERROR_PAYLOAD_SIZE) {
+            char error_payload[ERROR_PAYLOAD_SIZE] = { 0 };
+            if (recvAll(hSocket, error_payload, ERROR_PAYLOAD_SIZE) <= 0) {
+                result = 1;
+                break;
+            }
+            processPacket_errorPayload(error_payload);
+        }
+        if (result != 0) {
+            perror("error receiving failed");
+            break;
+        }
 
-    printf("(Sensor#%u, ", sensor_id(peak_data));
-    printf("Fiber#%u, ", fiber_id(peak_data));
-    printf("Channel#%u)\t", channel_id(peak_data));
-    printf("Wavelength:%.10e meters\n", wavelength(peak_data));
+        /* 3. Receiving payload packet : spectral info + amplitudes, per sensor */
+        uint32_t remaining = header_info.dataLength;
+        if (header_info.sweepingType != SWEEP_TYPE_SPECTRAL) {
+            if (recvDiscard(hSocket, (int)remaining) <= 0 && remaining > 0) {
+                result = 1;
+                break;
+            }
+            remaining = 0;
+        }
+        while (remaining >= SPECTRAL_PAYLOAD_SIZE) {
+            char buffer_info[SPECTRAL_PAYLOAD_SIZE];
+            if (recvAll(hSocket, buffer_info, SPECTRAL_PAYLOAD_SIZE) <= 0) {
+                result = 1;
+                break;
+            }
+            remaining -= SPECTRAL_PAYLOAD_SIZE;
+
+            uint8_t channel, fiber, sensor;
+            uint32_t num_points;
+            processPacket_spectralPayload_info(buffer_info, &channel, &fiber, &sensor, &num_points);
+            uint32_t bytes = spectralPayloadBytes(num_points);
+            if (bytes > remaining) {
+                fprintf(stderr, "spectral payload error (%u points, %u bytes left)\n", num_points, remaining);
+                result = 1;
+                break;
+            }
 
-    return 0;
-}
+            struct spectral_buffer_t* spectrum = spectralPool_acquire(pool, channel, fiber, sensor, num_points);
+            int bytesRead = (spectrum != NULL)
+                ? recvAll(hSocket, (char*)spectrum->samples, (int)bytes) // amplitudes land in place, no copy
+                : recvDiscard(hSocket, (int)bytes);
+            if (bytesRead <= 0 && bytes > 0) {
+                if (spectrum != NULL) {
+                    spectralPool_abort(pool, spectrum);
+                }
+                result = 1;
+                break;
+            }
+            if (spectrum != NULL) {
+                captured[captured_count++] = spectrum;
+            }
+            remaining -= bytes;
+        }
+        if (result == 0 && remaining > 0 && recvDiscard(hSocket, (int)remaining) <= 0) {
+            result = 1;
+        }
 
-int processPacket_Payload(char* buffer_payload) {
+        /* 4. Receiving flag packet */
+        struct I4PacketFlag flag;
+        if (result == 0 && recvAll(hSocket, (char*)&flag, FLAG_SIZE) <= 0) {
+            result = 1;
+        }
+        if (result != 0) {
+            perror("Receiving failed");
+            for (uint32_t i = 0; i < captured_count; i++) {
+                spectralPool_abort(pool, captured[i]);
+            }
+            break;
+        }
 
-    struct peak_payload_t* payload = (struct peak_payload_t*)(buffer_payload);
+        trackSweep(stream_stats, header_info.packetCounter, flag.sweep_counter);
 
-    peak_data_t peak_data;
-    peak_data[0] = payload->peak_payload_LSB;
-    peak_data[1] = payload->peak_payload_MSB;
+        /* 5. Handing the spectra of the sweep to the consumer */
+        for (uint32_t i = 0; i < captured_count; i++) {
+            spectralPool_commit(pool, captured[i], &header_info, flag.sweep_counter);
+        }
+        for (uint32_t i = 0; i < captured_count; i++) {
+            consumeSpectrum(captured[i]);
+            spectralPool_release(pool, captured[i]);
+        }
+    }
 
-    //printf("Sensor ID\t:%u\n", sensor_id(peak_data));
-    //printf("Fiber ID\t:%u\n", fiber_id(peak_data));
-    //printf("Channel ID\t:%u\n", channel_id(peak_data));
-    //printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
+    free(captured);
+    return result;
+}
 
-    printf("Sensor#%u, ", sensor_id(peak_data));
-    printf("Fiber#%u, ", fiber_id(peak_data));
-    printf("Channel#%u)\t", channel_id(peak_data));
-    printf("Wavelength\t:%.10e meters\n", wavelength(peak_data));
+int consumeSpectrum(const struct spectral_buffer_t* spectrum) {
+    int16_t min_amplitude = INT16_MAX, max_amplitude = INT16_MIN;
+    uint32_t max_index = 0;
+    for (uint32_t i = 0; i < spectrum->num_points; i++) {
+        int16_t amplitude = spectrum->samples[i];
+        if (amplitude < min_amplitude) min_amplitude = amplitude;
+        if (amplitude > max_amplitude) {
+            max_amplitude = amplitude;
+            max_index = i;
+        }
+    }
 
+    printf("Counter:%u\tSweep:%u\t(Sensor#%u, Fiber#%u, Channel#%u)\tPoints:%u\tMin:%d\tMax:%d @ %u\n",
+        spectrum->packetCounter, spectrum->sweep_counter, spectrum->sensor, spectrum->fiber, spectrum->channel,
+        spectrum->num_points, min_amplitude, max_amplitude, max_index);
     return 0;
 }
 
-int processPacket_spectralPayload_info(char* buffer_payload) {
+int printPacket_Header(const char* buffer_header, int* sweep_type, int* DO, int* DL) {
 
-    struct spectral_payload_info_t* payload = (struct spectral_payload_info_t*)(buffer_payload);
+    struct i4_header_info_t header;
+    processPacket_HeaderInfo(buffer_header, &header);
 
-    uint32_t data[2];
-    data[0] = payload->spectral_payload_LSB;
-    data[1] = payload->spectral_payload_MSB;
+    uint32_t totalPacketSize = header.dataOffset + header.dataLength + 8;
 
-    printf("Sensor ID\t:%u\n", sensor_id(data));
-    printf("Fiber ID\t:%u\n", fiber_id(data));
-    printf("Channel ID\t:%u\n", channel_id(data));
-    printf("Number of Spectral Points\t:%u\n", data[1]);
+    *sweep_type = header.sweepingType;
+    *DO = header.dataOffset;
+    *DL = (int)header.dataLength;
 
-    return 0;
-}
-
-int processPacket_spectralPayload(char* buffer_payload, int16_t* data1, int16_t* data2, int16_t* data3, int16_t* data4) {
+    // time stamp
+    time_t unix_time = (header.timeStamp / 1000000000) - 2208988800;
+    struct tm tm_info;
+#ifdef _WIN32
+    gmtime_s(&tm_info, &unix_time);
+#else
+    gmtime_r(&unix_time, &tm_info);
+#endif
+    char time_buffer[30];
+    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &tm_info);
 
-    struct spectral_payload_t* payload = (struct spectral_payload_t*)(buffer_payload);
+    // data print
+    printf("Time\t\t:%s\n", time_buffer);
+    printf("Packet Counter\t:%u\n", header.packetCounter);
+    printf("Sweeping Type\t:%u  (Peak(0), Spectral(1), Peak with timestamps(2))\n", header.sweepingType);
+    printf("Trigger Mode\t:%u  (Internal trigger(0), External trigger(1))\n", header.triggerMode);
+    printf("Data Offset\t:0x%04X (%"PRIu16")\n", header.dataOffset, header.dataOffset);
+    printf("Data Length\t:%"PRIu32"\n", header.dataLength);
+    printf("Packet Size\t:%"PRIu32"\n", totalPacketSize);
 
-    *data1 = payload->spectral_amplitude_1;
-    *data2 = payload->spectral_amplitude_2;
-    *data3 = payload->spectral_amplitude_3;
-    *data4 = payload->spectral_amplitude_4;
+    //printf("Counter:%u\t", header.packetCounter);
+    //printf("DO:0x%04X(%"PRIu16")\t", header.dataOffset, header.dataOffset);
+    //printf("DL:%"PRIu32"\n", header.dataLength);
 
     return 0;
 }
 
-int processPacket_errorPayload(char* error_payload) {
+/* every peak of the sweep, with its time stamp for a peak-with-timestamps sweep */
+int printPacket_Peaks(int sweep_type, const char* buffer_payload, int DL) {
 
-    struct error_payload_t* payload = (struct error_payload_t*)(error_payload);
-
-    peak_data_t data;
-    data[1] = payload->error_id;
-    data[0] = payload->error_description;
-
-    if (data[1] == 500) {
-        printf("Error type : Missing Peak\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source: No peak was detected where one was "
-            "expected from the interrogator configuration.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n"
-            "* disconnected sensor\n");
+    peak_batch_t peaks;
+    initPeakBatch(&peaks, (uint32_t)DL / PEAK_PAYLOAD_SIZE);
+    if (decodeSweepPeaks(sweep_type, buffer_payload, (uint32_t)DL, &peaks) < 0) {
+        freePeakBatch(&peaks);
+        return -1;
     }
-    else if (data[1] == 501) {
-        printf("Error type : Multiple Peaks\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source : More than the expected number of peaks was "
-            "detected in the sensors wavelength range.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n");
-    }
-    else {
-        printf("Error type : Internal Error\n");
-        printf("Error source: Internal error\n"
-            "Possible causes include :\n"
-            "* Transient mismatch of configuration and data stream\n"
-            "* Internal failure\n");
+
+    for (uint32_t i = 0; i < peaks.count; i++) {
+        printf("(Sensor#%u, Fiber#%u, Channel#%u)\t", peaks.sensor[i], peaks.fiber[i], peaks.channel[i]);
+        printf("Wavelength:%.10e meters", peaks.wavelength[i] / 1e9);
+        if (sweep_type == SWEEP_TYPE_TSPEAK) {
+            printf("\tTimestamp:%.10f s", peaks.timestamp[i]);
+        }
+        printf("\n");
     }
 
+    freePeakBatch(&peaks);
     return 0;
 }
 
+int printPacket_spectralPayload_info(const char* buffer_payload) {
 
+    uint8_t channel, fiber, sensor;
+    uint32_t num_points;
+    processPacket_spectralPayload_info(buffer_payload, &channel, &fiber, &sensor, &num_points);
 
-/* extract wavelength value in meters */
-double wavelength(const uint32_t* const peak_data) {
-    uint32_t peak_value[2];
-    peak_value[0] = (peak_data[0] & ~0xffff) | 0x7fff; /* mask out id bits */
-    peak_value[1] = peak_data[1];
-    return *(double*)&peak_value;
-}
-uint8_t channel_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 12) & 0x0f;
-}
-uint8_t fiber_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 8) & 0x0f;
-}
-uint8_t sensor_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] & 0xff);
-}
-/* extract time stamp value in seconds */
-double time_stamp(const uint32_t* const peak_data) {
-    return (double)peak_data[2] * 5e-10;
+    printf("Sensor ID\t:%u\n", sensor);
+    printf("Fiber ID\t:%u\n", fiber);
+    printf("Channel ID\t:%u\n", channel);
+    printf("Number of Spectral Points\t:%u\n", num_points);
+
+    return 0;
 }
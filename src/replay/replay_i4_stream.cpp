@@ -0,0 +1,270 @@
+/*
+File    : replay_i4_stream.cpp
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : C++11
+Protocol    : TCP/IP Server replaying a recorded I4 stream
+
+Serves a recording made with client_FBGs_data_tx -R (../common/i4_recorder.h) on the I4
+port, so the forwarder and the read_data tools decode it exactly like the live interrogator
+(e.g. client_FBGs_data_tx -i 127.0.0.1).
+
+- wire speed (default) : the recorded frames go out back to back in REPLAY_CHUNK_SIZE sends
+- -t, --timing         : every frame is sent at its recorded header timestamp (-x : speed factor)
+- -d, --device <n>     : frames of one I4 unit of a fan-in recording only
+- -f, --from <s>       : start <s> seconds into the recording (index lookup)
+- -l, --loop           : replay again until ESC
+
+ESC, Ctrl+C or SIGTERM stop a replay after the current send; the keys are read every
+CONSOLE_POLL_INTERVAL_MS (../common/console_control.h). Builds on Windows and Linux
+(../common/platform_socket.h).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <thread>
+#include <chrono>
+
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_recorder.h"
+
+#define PORT_I4 9931
+#define REPLAY_CHUNK_SIZE (4 * 1024 * 1024)
+#define REPLAY_ALL_DEVICES -1
+
+struct replay_options_t {
+    bool timing;     // original timing instead of wire speed
+    double speed;    // timing only : 2.0 = twice as fast
+    int device;      // REPLAY_ALL_DEVICES or one unit
+    double from_s;   // offset into the recording
+    bool loop;
+};
+
+struct replay_stats_t {
+    uint64_t frames;
+    uint64_t bytes;
+};
+
+int sendAll(SOCKET hSocket, const char* buffer, int length);
+int replayWireSpeed(SOCKET hSocket, const i4_recording_t* recording, uint64_t first, replay_stats_t* stats);
+int replayFrames(SOCKET hSocket, const i4_recording_t* recording, uint64_t first, const replay_options_t* options,
+    replay_stats_t* stats);
+bool escapePressed(void);
+
+/* =============================================================================
+ *
+ * Main Function
+ *
+ * =============================================================================
+ */
+
+int main(int argc, char* argv[]) {
+    const char* path = NULL;
+    int port = PORT_I4;
+    replay_options_t options;
+    options.timing = false;
+    options.speed = 1.0;
+    options.device = REPLAY_ALL_DEVICES;
+    options.from_s = 0.0;
+    options.loop = false;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timing") == 0) {
+            options.timing = true;
+        }
+        else if ((strcmp(argv[i], "-x") == 0 || strcmp(argv[i], "--speed") == 0) && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            options.speed = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--device") == 0) && i + 1 < argc) {
+            options.device = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--from") == 0) && i + 1 < argc) {
+            options.from_s = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--loop") == 0) {
+            options.loop = true;
+        }
+        else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s <recording> [-p|--port <port>] [-t|--timing [-x|--speed <factor>]] "
+            "[-d|--device <n>] [-f|--from <s>] [-l|--loop]\n", argv[0]);
+        return 1;
+    }
+
+    i4_recording_t recording;
+    if (recordingOpen(&recording, path) != 0) {
+        return 1;
+    }
+    uint64_t first = recordingFind(&recording, recording.header->first_ns + (uint64_t)(options.from_s * 1e9));
+    printf("%s : %llu sweeps, %.3f s, replaying from sweep %llu\n", path, (unsigned long long)recording.count,
+        (double)(recording.header->last_ns - recording.header->first_ns) * 1e-9, (unsigned long long)first);
+
+    /*****************************************/
+    /**** Initialize TCP/IP communication ****/
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed.\n");
+        recordingClose(&recording);
+        return 1;
+    }
+
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, 0);
+    if (hListen == INVALID_SOCKET) {
+        fprintf(stderr, "Socket creation failed.\n");
+        recordingClose(&recording);
+        WSACleanup();
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(hListen, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    SOCKADDR_IN serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons((u_short)port);
+    serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(hListen, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR || listen(hListen, 1) == SOCKET_ERROR) {
+        fprintf(stderr, "Can't listen on port %d.\n", port);
+        closesocket(hListen);
+        recordingClose(&recording);
+        WSACleanup();
+        return 1;
+    }
+    printf("Waiting for a client on port %d\n", port);
+
+    SOCKET hSocket = accept(hListen, NULL, NULL);
+    if (hSocket == INVALID_SOCKET) {
+        fprintf(stderr, "Accept failed.\n");
+        closesocket(hListen);
+        recordingClose(&recording);
+        WSACleanup();
+        return 1;
+    }
+    printf("Client connected\n");
+    consoleControl_install();
+
+    /**************************************/
+    /**** Replaying the recorded sweeps ****/
+    replay_stats_t stats;
+    stats.frames = 0;
+    stats.bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int result;
+    do {
+        if (!options.timing && options.device == REPLAY_ALL_DEVICES) {
+            result = replayWireSpeed(hSocket, &recording, first, &stats);
+        }
+        else {
+            result = replayFrames(hSocket, &recording, first, &options, &stats);
+        }
+    } while (result == 0 && options.loop && !escapePressed());
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Replayed %llu sweeps (%llu bytes) in %.3f s : %.0f sweeps/s, %.1f MB/s\n",
+        (unsigned long long)stats.frames, (unsigned long long)stats.bytes, elapsed,
+        elapsed > 0 ? stats.frames / elapsed : 0.0, elapsed > 0 ? stats.bytes / elapsed / 1e6 : 0.0);
+
+    closesocket(hSocket);
+    closesocket(hListen);
+    recordingClose(&recording);
+
+    // Close TCP/IP communication
+    WSACleanup();
+
+    return result == 0 ? 0 : 1;
+}
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* sendAll : Sends exactly 'length' bytes, looping over partial sends.
+* replayWireSpeed : Sends all frames from 'first' on as one contiguous range, REPLAY_CHUNK_SIZE per send.
+* replayFrames : Sends the frames one by one, filtered by unit and/or at their recorded time.
+* escapePressed : Whether ESC was pressed or a shutdown signal came in (ends a replay).
+* ==============================================================================
+*/
+
+int sendAll(SOCKET hSocket, const char* buffer, int length) {
+    int sent = 0;
+    while (sent < length) {
+        int bytesSent = send(hSocket, buffer + sent, length - sent, 0);
+        if (bytesSent == SOCKET_ERROR) {
+            fprintf(stderr, "Send failed (%d).\n", WSAGetLastError());
+            return SOCKET_ERROR;
+        }
+        sent += bytesSent;
+    }
+    return sent;
+}
+
+/* returns 0, or -1 if the client went away or ESC was pressed */
+int replayWireSpeed(SOCKET hSocket, const i4_recording_t* recording, uint64_t first, replay_stats_t* stats) {
+    if (first >= recording->count) {
+        return 0;
+    }
+    // frames are stored back to back in arrival order
+    const char* data = recordingFrame(recording, first);
+    const char* end = recording->base + recording->header->header_size + recording->header->data_bytes;
+    while (data < end) {
+        int chunk = end - data > REPLAY_CHUNK_SIZE ? REPLAY_CHUNK_SIZE : (int)(end - data);
+        if (escapePressed() || sendAll(hSocket, data, chunk) == SOCKET_ERROR) {
+            return -1;
+        }
+        data += chunk;
+        stats->bytes += (uint64_t)chunk;
+    }
+    stats->frames += recording->count - first;
+    return 0;
+}
+
+/* returns 0, or -1 if the client went away or ESC was pressed */
+int replayFrames(SOCKET hSocket, const i4_recording_t* recording, uint64_t first, const replay_options_t* options,
+    replay_stats_t* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t start_ns = first < recording->count ? recording->entries[first].timestamp_ns : 0;
+
+    for (uint64_t i = first; i < recording->count; i++) {
+        const recording_index_entry_t* entry = &recording->entries[i];
+        if (options->device != REPLAY_ALL_DEVICES && entry->device != options->device) {
+            continue;
+        }
+        if (options->timing) {
+            // frames with a timestamp before the first one (other units) go out at once
+            double offset_ns = entry->timestamp_ns > start_ns ? (double)(entry->timestamp_ns - start_ns) / options->speed : 0.0;
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds((long long)offset_ns));
+            if (escapePressed()) {
+                return -1;
+            }
+        }
+        if (sendAll(hSocket, recordingFrame(recording, i), (int)entry->size) == SOCKET_ERROR) {
+            return -1;
+        }
+        stats->frames++;
+        stats->bytes += entry->size;
+    }
+    return 0;
+}
+
+bool escapePressed(void) {
+    if (consolePollKey() == CONSOLE_KEY_ESC) {
+        consoleRequestShutdown();
+    }
+    return consoleShutdownRequested();
+}
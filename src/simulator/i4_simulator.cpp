@@ -0,0 +1,397 @@
+/*
+File    : i4_simulator.cpp
+Author  : Sooyeon Kim
+Date    : October 15, 2026
+Update  : October 15, 2026
+Description : C++11
+Protocol    : TCP/IP Server acting as a synthetic I4 Interrogator
+
+Serves a deterministic synthetic I4 data stream on the I4 port, for load and soak tests
+of client_FBGs_data_tx and the read_data tools without a physical interrogator (e.g.
+client_FBGs_data_tx -i 127.0.0.1). Every sweep is a complete I4PacketHeader + error
+payloads + peak / time-stamped peak / spectral payloads + I4PacketFlag frame, built by
+../common/i4_stream_generator.h; the same seed gives the same stream on every connection
+(apart from the header timestamps, which follow this host's clock).
+
+- -p, --port <port>      : listening port (default 9931)
+- -m, --mode <peak|tspeak|spectral> : payload type (default peak)
+- -n, --sensors <n>      : sensors (peaks) per sweep, spread over 4 channels (default 64)
+- -k, --points <n>       : spectral points per spectrum (default 16384)
+- -r, --rate <Hz>        : sweep rate (default 1000, 0 = as fast as the client reads)
+- -s, --sweeps <n>       : sweeps per connection (default 0 = until ESC / Ctrl+C)
+- -e, --errors <rate>    : fraction of sweeps with 1..4 error payloads (default 0)
+- -E, --error-id <id|mix>: id of the error payloads, e.g. 500 (Missing Peak) or 501
+                           (Multiple Peaks); mix (default) : 500, 501 and internal 3 : 1 : 1
+- -F, --fragment <bytes> : splits the stream into sends of 1..<bytes> bytes (seeded), so
+                           headers and payloads arrive cut at arbitrary byte boundaries
+- -S, --seed <n>         : xorshift seed of the stream and the fragment sizes
+- -o, --once             : exit after the first client instead of waiting for the next
+
+Pacing : the sweeps due by now (start + k / rate) are generated back to back into one
+buffer and sent with one send() (SIMULATOR_BATCH_BYTES at most), so the rate is kept at
+tens of kHz although a sleep is much coarser than a sweep period; the last
+SIMULATOR_SPIN_US before a sweep is due are spent yielding instead of sleeping.
+
+Every SIMULATOR_REPORT_MS it prints the sweeps/s and MB/s sent, the lag (sweeps due but
+not sent yet) and the share of the time spent blocked in send(). A client that keeps up
+shows no lag and little blocking; at saturation its receive window fills, send() blocks
+and the lag grows. With -r 0 the rate printed is the client's saturation rate.
+
+ESC, Ctrl+C or SIGTERM end the simulator (../common/console_control.h). Builds on Windows
+and Linux (../common/platform_socket.h).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <thread>
+#include <chrono>
+#include <memory>
+
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_stream_generator.h"
+#include "../common/low_latency.h"
+
+#define PORT_I4 9931
+#define SIMULATOR_BATCH_BYTES (256 * 1024) // one send() at most, or one sweep if larger
+#define SIMULATOR_SPIN_US 200
+#define SIMULATOR_REPORT_MS 1000
+#define SIMULATOR_FRAGMENT_SALT 0xD1B54A32D192ED03ULL // fragment sizes draw from their own xorshift
+
+struct simulator_options_t {
+    struct generator_config_t generator;
+    int port;
+    uint64_t sweeps;  // per connection, 0 : unlimited
+    int fragment;     // largest send in bytes, 0 : whole batches
+    bool once;
+};
+
+struct simulator_stats_t {
+    uint64_t sweeps;
+    uint64_t bytes;
+    uint64_t sends;
+    uint64_t blocked_ns; // inside send()
+    uint64_t max_lag;    // sweeps
+};
+
+int sendAll(SOCKET hSocket, const char* buffer, int length);
+int sendFragmented(SOCKET hSocket, const char* buffer, int length, int fragment, uint64_t* state);
+SOCKET listenOn(int port);
+int serveClient(SOCKET hSocket, const struct simulator_options_t* options, struct simulator_stats_t* stats);
+void printReport(double elapsed_s, double interval_s, const struct simulator_stats_t* interval, uint64_t lag);
+bool escapePressed(void);
+
+/* =============================================================================
+ *
+ * Main Function
+ *
+ * =============================================================================
+ */
+
+int main(int argc, char* argv[]) {
+    struct simulator_options_t options;
+    initGeneratorConfig(&options.generator);
+    options.port = PORT_I4;
+    options.sweeps = 0;
+    options.fragment = 0;
+    options.once = false;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.port = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mode") == 0) && i + 1 < argc) {
+            i++;
+            options.generator.sweep_type = strcmp(argv[i], "peak") == 0 ? SWEEP_TYPE_PEAK
+                : strcmp(argv[i], "tspeak") == 0 ? SWEEP_TYPE_TSPEAK
+                : strcmp(argv[i], "spectral") == 0 ? SWEEP_TYPE_SPECTRAL : -1;
+            valid = options.generator.sweep_type >= 0;
+        }
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--sensors") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.generator.peaks = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--points") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.generator.spectral_points = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            options.generator.rate_hz = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sweeps") == 0) && i + 1 < argc && atoll(argv[i + 1]) >= 0) {
+            options.sweeps = (uint64_t)atoll(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--errors") == 0) && i + 1 < argc) {
+            options.generator.error_rate = atof(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-E") == 0 || strcmp(argv[i], "--error-id") == 0) && i + 1 < argc) {
+            i++;
+            options.generator.error_id = strcmp(argv[i], "mix") == 0 ? GENERATOR_ERROR_MIX : (uint32_t)strtoul(argv[i], NULL, 10);
+            valid = strcmp(argv[i], "mix") == 0 || options.generator.error_id != GENERATOR_ERROR_MIX;
+        }
+        else if ((strcmp(argv[i], "-F") == 0 || strcmp(argv[i], "--fragment") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.fragment = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--seed") == 0) && i + 1 < argc) {
+            options.generator.seed = (uint64_t)strtoull(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--once") == 0) {
+            options.once = true;
+        }
+        else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        fprintf(stderr, "Usage: %s [-p|--port <port>] [-m|--mode <peak|tspeak|spectral>] [-n|--sensors <n>] "
+            "[-k|--points <n>] [-r|--rate <Hz>] [-s|--sweeps <n>] [-e|--errors <rate>] [-E|--error-id <id|mix>] "
+            "[-F|--fragment <bytes>] [-S|--seed <n>] [-o|--once]\n", argv[0]);
+        return 1;
+    }
+    if (options.generator.peaks > GENERATOR_MAX_PEAKS) {
+        options.generator.peaks = GENERATOR_MAX_PEAKS;
+    }
+    if (options.generator.spectral_points > GENERATOR_MAX_SPECTRAL_POINTS) {
+        options.generator.spectral_points = GENERATOR_MAX_SPECTRAL_POINTS;
+    }
+
+    /*****************************************/
+    /**** Initialize TCP/IP communication ****/
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed.\n");
+        return 1;
+    }
+
+    SOCKET hListen = listenOn(options.port);
+    if (hListen == INVALID_SOCKET) {
+        WSACleanup();
+        return 1;
+    }
+    consoleControl_install();
+
+    const char* mode = options.generator.sweep_type == SWEEP_TYPE_TSPEAK ? "tspeak"
+        : options.generator.sweep_type == SWEEP_TYPE_SPECTRAL ? "spectral" : "peak";
+    printf("I4 simulator : %s sweeps, %u sensors, %.0f Hz%s, up to %u bytes per sweep\n", mode, options.generator.peaks,
+        options.generator.rate_hz, options.generator.rate_hz > 0.0 ? "" : " (as fast as the client reads)",
+        generatorMaxSweepSize(&options.generator));
+
+    /*******************************/
+    /**** Serving the clients ****/
+    int result = 0;
+    while (!consoleShutdownRequested()) {
+        printf("Waiting for a client on port %d\n", options.port);
+        SOCKET hSocket = accept(hListen, NULL, NULL);
+        if (hSocket == INVALID_SOCKET) {
+            if (!consoleShutdownRequested()) {
+                fprintf(stderr, "Accept failed.\n");
+                result = 1;
+            }
+            break;
+        }
+        printf("Client connected\n");
+        socketSetNoDelay(hSocket);
+
+        struct simulator_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        uint64_t start_ns = latencySteady_ns();
+        serveClient(hSocket, &options, &stats);
+        double elapsed = (double)(latencySteady_ns() - start_ns) * 1e-9;
+        closesocket(hSocket);
+
+        printf("Sent %llu sweeps (%llu bytes, %llu sends) in %.3f s : %.0f sweeps/s, %.1f MB/s, "
+            "%.1f %% blocked in send, lag at most %llu sweeps\n",
+            (unsigned long long)stats.sweeps, (unsigned long long)stats.bytes, (unsigned long long)stats.sends, elapsed,
+            elapsed > 0 ? stats.sweeps / elapsed : 0.0, elapsed > 0 ? stats.bytes / elapsed / 1e6 : 0.0,
+            elapsed > 0 ? 100.0 * (double)stats.blocked_ns * 1e-9 / elapsed : 0.0, (unsigned long long)stats.max_lag);
+        if (options.once) {
+            break;
+        }
+    }
+    closesocket(hListen);
+
+    // Close TCP/IP communication
+    WSACleanup();
+
+    return result;
+}
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* sendAll : Sends exactly 'length' bytes, looping over partial sends.
+* sendFragmented : Sends 'length' bytes in pieces of 1..fragment bytes drawn from 'state'.
+* listenOn : Listening socket on a port of every interface.
+* serveClient : Generates and sends the sweeps to one client, paced to the configured rate.
+* printReport : One line of rates, lag and send blocking for the last interval.
+* escapePressed : Whether ESC was pressed or a shutdown signal came in.
+* ==============================================================================
+*/
+
+int sendAll(SOCKET hSocket, const char* buffer, int length) {
+    int sent = 0;
+    while (sent < length) {
+        int bytesSent = send(hSocket, buffer + sent, length - sent, 0);
+        if (bytesSent == SOCKET_ERROR) {
+            if (!consoleShutdownRequested()) {
+                fprintf(stderr, "Send failed (%d).\n", WSAGetLastError());
+            }
+            return SOCKET_ERROR;
+        }
+        sent += bytesSent;
+    }
+    return sent;
+}
+
+int sendFragmented(SOCKET hSocket, const char* buffer, int length, int fragment, uint64_t* state) {
+    int sent = 0;
+    while (sent < length) {
+        uint64_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        *state = x;
+        int piece = 1 + (int)(x % (uint64_t)fragment);
+        if (piece > length - sent) {
+            piece = length - sent;
+        }
+        if (sendAll(hSocket, buffer + sent, piece) == SOCKET_ERROR) {
+            return SOCKET_ERROR;
+        }
+        sent += piece;
+    }
+    return sent;
+}
+
+SOCKET listenOn(int port) {
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, 0);
+    if (hListen == INVALID_SOCKET) {
+        fprintf(stderr, "Socket creation failed.\n");
+        return INVALID_SOCKET;
+    }
+    int reuse = 1;
+    setsockopt(hListen, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    SOCKADDR_IN serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons((u_short)port);
+    serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(hListen, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR || listen(hListen, 1) == SOCKET_ERROR) {
+        fprintf(stderr, "Can't listen on port %d.\n", port);
+        closesocket(hListen);
+        return INVALID_SOCKET;
+    }
+    return hListen;
+}
+
+/* returns 0 after options->sweeps sweeps, or -1 if the client went away or ESC was pressed */
+int serveClient(SOCKET hSocket, const struct simulator_options_t* options, struct simulator_stats_t* stats) {
+    struct generator_config_t config = options->generator;
+    bool paced = config.rate_hz > 0.0;
+    if (!paced) {
+        config.rate_hz = 1000.0; // tick counter of the time-stamped peaks only, headers are stamped when sent
+    }
+    config.start_ns = latencyNow_ns();
+
+    struct i4_generator_t generator;
+    initGenerator(&generator, &config);
+    uint32_t max_size = generatorMaxSweepSize(&config);
+    uint32_t capacity = max_size > SIMULATOR_BATCH_BYTES ? max_size : SIMULATOR_BATCH_BYTES;
+    std::unique_ptr<char[]> batch(new char[capacity]);
+    uint64_t fragment_state = (config.seed != 0 ? config.seed : GENERATOR_DEFAULT_SEED) ^ SIMULATOR_FRAGMENT_SALT;
+
+    uint64_t start_ns = latencySteady_ns();
+    uint64_t report_ns = start_ns;
+    struct simulator_stats_t reported = *stats;
+    uint64_t sent = 0;
+    while (options->sweeps == 0 || sent < options->sweeps) {
+        if (escapePressed()) {
+            return -1;
+        }
+        uint64_t now_ns = latencySteady_ns();
+        uint64_t due = paced ? (uint64_t)((double)(now_ns - start_ns) * 1e-9 * config.rate_hz) + 1 : UINT64_MAX;
+        if (options->sweeps != 0 && due > options->sweeps) {
+            due = options->sweeps;
+        }
+        uint64_t lag = paced && due > sent ? due - sent - 1 : 0; // overdue before the sweep due now
+        if (lag > stats->max_lag) {
+            stats->max_lag = lag;
+        }
+
+        if (now_ns - report_ns >= (uint64_t)SIMULATOR_REPORT_MS * 1000000ULL) {
+            struct simulator_stats_t interval;
+            interval.sweeps = stats->sweeps - reported.sweeps;
+            interval.bytes = stats->bytes - reported.bytes;
+            interval.sends = stats->sends - reported.sends;
+            interval.blocked_ns = stats->blocked_ns - reported.blocked_ns;
+            interval.max_lag = 0;
+            printReport((double)(now_ns - start_ns) * 1e-9, (double)(now_ns - report_ns) * 1e-9, &interval, lag);
+            reported = *stats;
+            report_ns = now_ns;
+        }
+
+        if (sent >= due) {
+            // ahead of the schedule : sleep, then yield through the last SIMULATOR_SPIN_US
+            uint64_t next_ns = start_ns + (uint64_t)((double)sent * 1e9 / config.rate_hz);
+            uint64_t remaining_ns = next_ns > now_ns ? next_ns - now_ns : 0;
+            if (remaining_ns > SIMULATOR_SPIN_US * 1000ULL) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(remaining_ns - SIMULATOR_SPIN_US * 1000ULL));
+            }
+            else {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+
+        // every sweep due by now, back to back
+        uint32_t length = 0;
+        uint64_t stamp_ns = paced ? 0 : latencyNow_ns();
+        while (sent < due && length + max_size <= capacity) {
+            char* frame = batch.get() + length;
+            length += generateSweep(&generator, frame);
+            if (!paced) {
+                struct I4PacketHeader header;
+                memcpy(&header, frame, sizeof(header));
+                header.timeStamp = stamp_ns;
+                memcpy(frame, &header, sizeof(header));
+            }
+            sent++;
+        }
+
+        uint64_t send_ns = latencySteady_ns();
+        int result = options->fragment > 0
+            ? sendFragmented(hSocket, batch.get(), (int)length, options->fragment, &fragment_state)
+            : sendAll(hSocket, batch.get(), (int)length);
+        stats->blocked_ns += latencySteady_ns() - send_ns;
+        if (result == SOCKET_ERROR) {
+            printf("Client disconnected\n");
+            return -1;
+        }
+        stats->sweeps = sent;
+        stats->bytes += length;
+        stats->sends++;
+    }
+    if (generator.errors > 0) {
+        printf("%llu error payloads sent\n", (unsigned long long)generator.errors);
+    }
+    return 0;
+}
+
+void printReport(double elapsed_s, double interval_s, const struct simulator_stats_t* interval, uint64_t lag) {
+    printf("%8.1f s : %9.0f sweeps/s, %8.1f MB/s, %6.1f sweeps/send, lag %llu sweeps, %5.1f %% blocked in send\n",
+        elapsed_s, interval->sweeps / interval_s, interval->bytes / interval_s / 1e6,
+        interval->sends > 0 ? (double)interval->sweeps / interval->sends : 0.0, (unsigned long long)lag,
+        100.0 * (double)interval->blocked_ns * 1e-9 / interval_s);
+}
+
+bool escapePressed(void) {
+    if (consolePollKey() == CONSOLE_KEY_ESC) {
+        consoleRequestShutdown();
+    }
+    return consoleShutdownRequested();
+}
@@ -2,85 +2,343 @@
 File    : client_FBGs_data_tx.cpp
 Author  : Sooyeon Kim
 Date    : June 06, 2023
-Update  : April 14, 2024
-Description : C++98
+Update  : October 14, 2026
+Description : C++11
 Protocol    : TCP/IP Client for I4 Interrogator
 
 This C++ program acts as a client for an I4 Interrogator device, communicating over TCP/IP.
 It receives data packets from the I4 device, processes them, and sends the processed data
-to a main server. The packets include header information, payload data (peak or timestamped peaks),
-and error information. The program then sends the processed data to a main server.
+to a main server, either one 11-byte packet per peak or, with -b/--batch, all peaks of a
+sweep in one send() prefixed with the sweep counter and peak count. The packets include
+header information, payload data (peak or timestamped peaks), and error information.
+
+Fan-in : -i <ip[:port]> may be given for several I4 units. One ingest thread serves all of
+them through ../common/socket_poller.h (I/O completion port on Windows, epoll on Linux),
+and their sweeps are decoded by one worker per core (-w), each unit always on the same
+worker. With more than one unit every message to the main server (batch or compact) is
+preceded by one byte holding the unit's index in the -i list.
+
+Frames : with -a <period_us> the peaks of all units are aligned on their timestamps into
+fixed-period frames by ../common/sweep_assembler.h and one message per frame is sent.
+
+Recording : -R <file> keeps every sweep frame as received from the I4 units in a memory-mapped
+file with a timestamp index (../common/i4_recorder.h), see ../replay/replay_i4_stream.cpp.
+
+Logging : -L <file> writes every forwarded sample of every sensor (wavelength, or force with -c)
+to a columnar binary log per unit (../common/columnar_logger.h, <file>.<unit> with several
+units, -z to deflate the chunks); ../tcp_server_rx/export_fbg_log.py converts it to CSV.
+
+Subscribers : besides the main server, -P <port>[,drop|,disconnect] lets further consumers connect
+and receive the same stream, each through its own bounded queue, and -M <ip:port> sends every
+message as a UDP datagram (../common/sweep_publisher.h). A slow subscriber loses messages or is
+disconnected; it never holds up the main server.
+
+Low latency : for a closed control loop, -l sets TCP_NODELAY on the I4 and main server sockets,
+busy-polls the non-blocking I4 sockets and the sweep rings instead of waiting on them, and logs
+nothing per sweep or peak unless -v says so. -C <ingest core>,<worker 0 core>,... pins those
+threads to cores with raised priority (../common/low_latency.h). Every run ends with the latency
+histograms of the forwarded sweeps : from the I4 header timestamp (needs synchronised clocks)
+and from the complete reception of the sweep frame, each to the completion of its send.
+
+Metrics : the ingest thread and every worker count into a cache-line slot of their own (bytes,
+sweeps, drops, peaks, sends, I4 errors by type, ring occupancy, recv / decode / send time per
+sweep, ../common/pipeline_metrics.h); -m <port> serves them to Prometheus at http://<host>:<port>/metrics.
+
+Reduced spectra : with -s, -S <port|ip:port>[,<max|mean|envelope>[,<N>[,<margin nm>]]] also publishes
+every spectrum decimated to one bin per N points (max, mean or min/max envelope), optionally cropped
+to <margin nm> around each FBG, as 'R' messages (../common/spectral_reducer.h) to TCP subscribers of
+<port> or as datagrams to <ip:port>, for live viewing of the spectral shape on a slow link.
+
+Statistics : -T <sweeps> follows every sensor of every unit with running mean / deviation, EWMA
+and sliding-window min / max of its wavelength (../common/sensor_stats.h) and, with -p, sends
+them as a compact statistics message after every <sweeps> sweeps of the unit. With -c, the
+'t' key tares (auto-zero) : every sensor's base wavelength is rebased onto its EWMA, so drift
+of the unloaded FBGs stops reading as force; -t <sweeps> tares once, after that many sweeps.
+Each unit tares its own copy of the calibration, whichever decode worker it lands on.
+
+Filtering : -f <sweep rate Hz>,<stage>[,<stage>..][,decimate:<D>] runs every sensor's forwarded value
+(force with -c, else wavelength) through a chain of biquad low-pass / notch and moving-average stages
+at the full sweep rate (../common/force_filter.h), e.g. -f 5000,notch:50,lowpass:20,decimate:50, and
+forwards only every D-th sweep of each unit. The columnar log (-L) keeps the unfiltered values.
+
+Management : -A <setting>[,<setting>..] writes settings of every I4 through its Management API
+(../common/i4_management.h) before the streams start : downsample=<n> (every n-th sweep sent),
+cutoff=<Hz|none> (butterworth on the I4), spectral=<channel>:<4|16|off>, port=<n> (80). At runtime
+'+' / '-' halve / double the downsampling, and adapt=<max> doubles it (up to <max>) while a unit's
+sweeps are dropped on a full ring, then steps back once the ring has kept up for a while. Not
+with -f, whose filter is designed for one sweep rate.
+
+Sessions : a unit that goes away is reconnected by the ingest thread with exponential backoff
+(10 ms doubling up to 2 s) while the others keep streaming, and its stream restarts on the next
+header. The main server connection is a session of ../common/session_manager.h : messages are
+written straight through while the link keeps up, otherwise queued (-q <KiB>, 4 MiB by default)
+and sent by a thread of its own, which also reconnects. A full queue makes the workers wait
+(block, the default : the sweep rings then drop and count), or loses the oldest / newest whole
+messages (drop / drop-newest). -n ends the program on a lost main server, and once all units
+are gone, instead of reconnecting.
+
+Shared memory : -H <name>[,<ring sweeps>[,<max peaks>]] also writes every forwarded sweep (ids,
+wavelength, forwarded value, time stamp of every peak) into a named shared-memory region for
+consumers on the same PC (../common/shm_transport.h) : the latest sweep of each unit and a ring of
+the last sweeps, each record behind a seqlock, read without a system call or a lock by
+../tcp_server_rx/fbg_shm_reader.py or C++ controllers. -N runs without a main server, for a
+client whose consumers are all local (-H) or subscribers (-P, -M).
+
+Platforms : Windows (Winsock) and Linux (BSD sockets, epoll) through ../common/platform_socket.h.
+ESC, Ctrl+C or SIGTERM end the program (../common/console_control.h); the main thread only watches
+the console, checking the flag set by the signal handler and reading the keys every
+CONSOLE_POLL_INTERVAL_MS, while every decode worker runs on a thread of its own. A worker waiting
+for room in the main server queue (-q ..,block, the default, server down) is released by serverSession_requestStop(),
+so the exit never hangs on it. With -l, SO_BUSY_POLL is also set on the I4 sockets on Linux.
 */
 
 
-#include <WinSock2.h>
-#include <Ws2tcpip.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <conio.h> // For _kbhit and _getch
 #include <stdint.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
 
+#include <new>
 #include <thread>
 #include <chrono>
-
-#pragma comment(lib, "ws2_32.lib")
+#include <atomic>
+#include <mutex>
+
+#include "../common/platform_socket.h"
+#include "../common/console_control.h"
+#include "../common/i4_protocol.h"
+#include "../common/i4_peak_decoder.h"
+#include "../common/i4_calibration.h"
+#include "../common/fbg_compact_protocol.h"
+#include "../common/spectral_peak_detector.h"
+#include "../common/spectral_reducer.h"
+#include "../common/sensor_stats.h"
+#include "../common/force_filter.h"
+#include "../common/i4_management.h"
+#include "../common/spsc_ring.h"
+#include "../common/log_sink.h"
+#include "../common/socket_poller.h"
+#include "../common/session_manager.h"
+#include "../common/sweep_assembler.h"
+#include "../common/i4_stream_sync.h"
+#include "../common/i4_recorder.h"
+#include "../common/columnar_logger.h"
+#include "../common/sweep_publisher.h"
+#include "../common/shm_transport.h"
+#include "../common/low_latency.h"
+#include "../common/pipeline_metrics.h"
 
 #define PORT 4578
 #define PACKET_SIZE 11  // int8_t 3, double 1
+#define BATCH_HEADER_SIZE 6 // uint32_t sweep counter, uint16_t peak count
 #define SERVER_IP "0.0.0.0"
 
 #define PORT_I4 9931
+#define PORT_I4_SPECTRAL 9932 // -s : spectra, peaks detected on this host
 #define SERVER_I4_IP "10.100.51.16"
 
-// I4 packet size
-#define HEADER_SIZE 16
-#define ERROR_PAYLOAD_SIZE 8
-#define PEAK_PAYLOAD_SIZE 8
-#define TSPEAK_PAYLOAD_SIZE 12
-#define FLAG_SIZE 8
+// sweep frame buffer
+#define FRAME_INITIAL_CAPACITY 4096
+#define FRAME_MAX_DATA_LENGTH (16 * 1024 * 1024) // sanity bound on header dataLength
+
+// sweep ring between ingest and forwarding thread
+#define RING_DEFAULT_SLOTS 64
+#define RING_STATS_INTERVAL_MS 5000
+
+// fan-in of several I4 units
+#define FANIN_MAX_DEVICES 16
+#define FANIN_POLL_TIMEOUT_MS 100
+#define FANIN_DEVICE_ID_SIZE 1 // uint8_t prefix of every message with more than one unit
+#define DEVICE_ADDRESS_SIZE 64
+#define LOG_PATH_SIZE 512
+#define CORE_LIST_SIZE (1 + FANIN_MAX_DEVICES) // -C : ingest thread, then the workers
+
+// I4 Management API (-A)
+#define MANAGEMENT_POLL_MS 50
+#define MANAGEMENT_ADAPT_INTERVAL_MS 1000
+#define MANAGEMENT_ADAPT_CALM_INTERVALS 10 // intervals without drops before the downsampling steps back
 
 #pragma pack(1)
-struct ts_peak_payload_t {
-    uint32_t ts_peak_payload_LSB : 32;
-    uint32_t ts_peak_payload_MSB : 32;
-    uint32_t time_stamp : 32;
+// batch forwarding : header followed by peak_count x PACKET_SIZE records
+struct forward_batch_header_t {
+    uint32_t sweep_counter;
+    uint16_t peak_count;
 };
-struct peak_payload_t {
-    uint32_t peak_payload_LSB : 32;
-    uint32_t peak_payload_MSB : 32;
+#pragma pack()
+
+// forwarding mode to main server
+#define FORWARD_MODE_LEGACY 0 // one PACKET_SIZE send() per peak
+#define FORWARD_MODE_BATCH 1  // one send() per sweep (forward_batch_header_t + packets)
+#define FORWARD_MODE_COMPACT 2 // v2 : layout once, then one 4-byte value per peak (fbg_compact_protocol.h)
+#define FORWARD_MODE_FRAMES 3  // time-aligned frames of all units (sweep_assembler.h)
+
+// one I4 sweep frame : header + error payload + data payload + flag
+struct sweep_frame_t {
+    char* data;         // reusable receive buffer, grown on demand
+    uint32_t capacity;  // allocated bytes
+    uint32_t size;      // bytes of the current frame (DO + DL + FLAG_SIZE)
+    int sweep_type;
+    uint32_t DO, DL;
+    uint8_t device;     // I4 unit it came from
+    uint64_t received_ns; // latencySteady_ns() once the frame was complete
 };
-struct error_payload_t {
-    uint32_t error_id : 32;
-    uint32_t error_description : 32;
+
+void initSweepFrame(sweep_frame_t* frame);
+void freeSweepFrame(sweep_frame_t* frame);
+
+// outgoing packets of one sweep, sent to the main server in one call
+struct forward_buffer_t {
+    char* data;
+    uint32_t capacity;
+    uint32_t size;
+    uint32_t headroom; // FANIN_DEVICE_ID_SIZE with several I4 units, else 0
 };
-struct I4PacketHeader {
-    uint16_t info : 16; // packetCounter(12) + sweepingType(3) + triggerMode(1)
-    uint16_t dataOffset : 16;
-    uint32_t dataLength : 32;
-    uint64_t timeStamp : 64;
+
+void initForwardBuffer(forward_buffer_t* buffer, uint32_t headroom);
+void freeForwardBuffer(forward_buffer_t* buffer);
+void beginForwardMessage(forward_buffer_t* buffer, uint8_t device);
+void beginForwardBatch(forward_buffer_t* buffer, uint8_t device, uint32_t sweep_counter);
+char* appendForwardBytes(forward_buffer_t* buffer, uint32_t bytes);
+char* appendForwardPacket(forward_buffer_t* buffer);
+int sendForwardBatch(struct server_session_t* server, forward_buffer_t* buffer, uint32_t generation);
+
+// one I4 unit of the fan-in, owned by the ingest thread
+struct i4_device_t {
+    char address[DEVICE_ADDRESS_SIZE];
+    uint16_t port;
+    uint8_t id;                       // index in the -i list
+    SOCKET hSocket;
+    bool connected;
+    sweep_frame_t staging;            // sweep being received, swapped into the ring once complete
+    uint32_t received;                // bytes of 'staging' so far
+    uint32_t frame_size;              // 0 until the header is in
+    spsc_ring_t<sweep_frame_t>* ring; // of the worker forwarding this unit
+    std::atomic<uint64_t> sweeps;
+    std::atomic<uint64_t> dropped;    // ring full
+    struct i4_stream_stats_t stream;  // gaps and resyncs of the I4 stream, read after the ingest thread ended
+    bool resyncing;                   // dropping bytes until a plausible header
+    struct i4_recorder_t* recorder;   // NULL : not recording, shared by all units of the ingest thread
+    struct metrics_slot_t* metrics;   // of the ingest thread
+    uint64_t frame_start_ns;          // first bytes of 'staging' received
+    std::atomic<uint32_t> sweep_step; // I4 downsampling, set by the management thread
+    struct session_backoff_t backoff; // reconnect attempts after a disconnect
+    SOCKET pending;                   // reconnect in progress, INVALID_SOCKET if none
+    uint64_t pending_since_ms;
 };
-struct I4PacketFlag {
-    uint32_t sweep_counter : 32;
-    uint32_t reserved : 32;
+
+int parseDeviceEndpoint(const char* text, uint16_t default_port, i4_device_t* device);
+int connectDevice(i4_device_t* device);
+int receiveDeviceData(i4_device_t* device);
+
+// I4 ingest thread : only receives and frames sweeps of all units into the rings
+struct ingest_context_t {
+    i4_device_t* devices;
+    uint32_t device_count;
+    struct socket_poller_t poller;
+    std::atomic<bool> running;
+    bool busy_poll;                   // -l : spin on the non-blocking sockets, no poller
+    bool reconnect;                   // -n clears it : a unit that went away stays down
+    int core;                         // -C, -1 : not pinned
 };
-#pragma pack()
 
-// function redefinition
-typedef uint32_t peak_data_t[2];
-typedef uint32_t ts_peak_data_t[3];
+void disconnectDevice(ingest_context_t* ingest, i4_device_t* device);
+int reconnectDevice(ingest_context_t* ingest, i4_device_t* device, uint64_t now_ms);
+uint32_t reconnectDevices(ingest_context_t* ingest);
+void ingestThread(ingest_context_t* ingest);
+
+// I4 Management API thread : runtime changes of the downsampling ('+' / '-', adapt=)
+struct management_context_t {
+    i4_device_t* devices;
+    uint32_t device_count;
+    struct i4_management_t* units;            // one per device
+    struct management_config_t config;
+    uint32_t downsampling[FANIN_MAX_DEVICES]; // current
+    uint32_t base[FANIN_MAX_DEVICES];         // set at startup or by the keys, adapt= never goes below
+    double sampling_hz[FANIN_MAX_DEVICES];
+    std::atomic<int> step_request;            // '+' : -1, '-' : +1
+    std::atomic<bool> running;
+    std::thread thread;
+};
 
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL);
-int processPacket_Payload(char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data);
-int processPacket_tsPayload(char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data);
-int processPacket_errorPayload(char* error_payload);
+int setDeviceDownsampling(management_context_t* management, uint32_t d, uint32_t downsampling);
+void managementThread(management_context_t* management);
+// decode/forward state of the forwarding thread
+struct forwarder_t {
+    struct server_session_t* server;  // main server, shared by the workers
+    std::mutex* send_lock;            // one message at a time to the main server and the publisher
+    int forward_mode;
+    int compact_encoding;             // FORWARD_MODE_COMPACT only
+    struct compact_layout_t layout[FANIN_MAX_DEVICES]; // last layout sent per unit in FORWARD_MODE_COMPACT
+    peak_batch_t peaks;
+    forward_buffer_t forward;
+    log_sink_t* log;
+    struct calibration_table_t* calibration; // NULL : forward wavelength [nm], else force [mN]
+    struct calibration_table_t* unit_calibration; // NULL : 'calibration' for every unit, else one per unit (tared apart)
+    double* force;
+    uint32_t force_capacity;
+    struct spectral_detector_t* detector;    // NULL : spectral sweeps are not forwarded
+    struct sweep_assembler_t* assembler;     // FORWARD_MODE_FRAMES, shared by the workers under send_lock
+    struct columnar_logger_t* loggers;       // NULL : not logging, else one per unit
+    struct publisher_t* publisher;           // NULL : main server only
+    struct shm_writer_t* shm;                // NULL : no shared memory, else written under send_lock
+    struct stats_engine_t* stats;            // NULL : no statistics, else one per unit
+    uint32_t stats_interval;                 // sweeps between statistics messages, 0 : not sent
+    uint32_t tare_after;                     // sweeps of a unit before its automatic tare, 0 : none
+    std::atomic<uint32_t>* tare_request;     // bumped by the 't' key
+    uint32_t tare_seen[FANIN_MAX_DEVICES];   // last request applied per unit
+    struct force_filter_t* filters;          // NULL : unfiltered, else one per unit
+    struct spectral_reducer_t* reducer;      // NULL : spectra are not published
+    struct publisher_t* spectra_publisher;   // 'R' messages, under send_lock
+    forward_buffer_t reduced;
+    uint32_t layout_generation;              // main server + publisher generation the compact layouts were last sent for
+    uint32_t server_generation;              // main server part of it, the compact messages are sent for
+    struct latency_histogram_t latency_i4;   // I4 header timestamp -> sent
+    struct latency_histogram_t latency_host; // sweep frame received -> sent
+    struct metrics_slot_t* metrics;          // of the worker
+};
 
-double wavelength(const uint32_t* const peak_data);
-uint8_t channel_id(const uint32_t* const peak_data);
-uint8_t fiber_id(const uint32_t* const peak_data);
-uint8_t sensor_id(const uint32_t* const peak_data);
-double time_stamp(const uint32_t* const peak_data);
+void initForwarder(forwarder_t* forwarder, struct server_session_t* server, std::mutex* send_lock, int forward_mode, int compact_encoding,
+    uint32_t headroom, log_sink_t* log, struct calibration_table_t* calibration, struct calibration_table_t* unit_calibration,
+    struct spectral_detector_t* detector,
+    struct sweep_assembler_t* assembler, struct columnar_logger_t* loggers, struct publisher_t* publisher,
+    struct stats_engine_t* stats, uint32_t stats_interval, uint32_t tare_after, std::atomic<uint32_t>* tare_request,
+    struct force_filter_t* filters, struct spectral_reducer_t* reducer, struct publisher_t* spectra_publisher, struct metrics_slot_t* metrics,
+    struct shm_writer_t* shm);
+void freeForwarder(forwarder_t* forwarder);
+int forwardSweep(forwarder_t* forwarder, const sweep_frame_t* frame);
+int publishForward(forwarder_t* forwarder);
+struct calibration_table_t* forwarderCalibration(forwarder_t* forwarder, uint8_t device);
+void updateSensorStats(forwarder_t* forwarder, uint8_t device, uint32_t sweep_counter);
+void publishReducedSpectra(forwarder_t* forwarder, uint8_t device, uint32_t sweep_counter, uint64_t timeStamp);
+int sendAssembledFrame(const struct sweep_assembler_t* assembler, const struct assembled_frame_t* frame, void* user);
+
+// decode worker : one per core, at most one per unit
+struct forward_worker_t {
+    spsc_ring_t<sweep_frame_t> ring;
+    log_sink_t log;
+    forwarder_t forwarder;
+    spectral_detector_t detector;
+    spectral_reducer_t reducer;
+    std::thread thread;
+    std::atomic<bool>* ingest_running;
+    std::atomic<bool>* stop;
+    bool busy_poll;                   // -l : no sleep while the ring is empty
+    int core;                         // -C, -1 : not pinned
+};
 
+forward_worker_t* allocWorkers(uint32_t count);
+void freeWorkers(forward_worker_t* workers, uint32_t count);
+int forwardPending(forward_worker_t* worker);
+void forwardWorkerThread(forward_worker_t* worker);
+void printRingStats(const spsc_ring_t<sweep_frame_t>* ring, log_sink_t* log);
+void printDeviceStats(const i4_device_t* devices, uint32_t device_count, log_sink_t* log);
+void printLatencyStats(const forward_worker_t* workers, uint32_t worker_count);
+void printReducerStats(const forward_worker_t* workers, uint32_t worker_count);
+int parseCoreList(const char* text, int* cores, int max_cores);
+void pinThread(const char* name, int core);
 
 /* =============================================================================
  *
@@ -89,7 +347,284 @@ double time_stamp(const uint32_t* const peak_data);
  * =============================================================================
  */
 
-int main() {
+int main(int argc, char* argv[]) {
+    int forward_mode = FORWARD_MODE_LEGACY;
+    int compact_encoding = COMPACT_ENCODING_FLOAT32;
+    uint32_t ring_slots = RING_DEFAULT_SLOTS;
+    int verbosity = LOG_LEVEL_SWEEP;
+    const char* calibration_path = NULL;
+    const char* detector_path = NULL;
+    const char* endpoints[FANIN_MAX_DEVICES];
+    uint32_t device_count = 0;
+    uint32_t worker_count = 0; // 0 : one per core
+    uint64_t frame_period_ns = 0;
+    uint32_t frame_window = ASSEMBLER_DEFAULT_WINDOW;
+    const char* record_path = NULL;
+    const char* log_path = NULL;
+    int log_compression = COLUMNAR_COMPRESSION_NONE;
+    const char* publish_ports[PUBLISH_MAX_LISTENERS];
+    uint32_t publish_count = 0;
+    const char* udp_endpoint = NULL;
+    bool low_latency = false;
+    bool verbosity_set = false;
+    int cores[CORE_LIST_SIZE];
+    int core_count = 0;
+    int metrics_port = 0;
+    const char* spectra_spec = NULL;
+    uint32_t stats_interval = 0;
+    uint32_t tare_after = 0;
+    bool stats_enabled = false;
+    const char* filter_spec = NULL;
+    const char* management_spec = NULL;
+    const char* queue_spec = NULL;
+    bool reconnect = true;
+    const char* shm_spec = NULL;
+    bool no_server = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--batch") == 0) {
+            forward_mode = FORWARD_MODE_BATCH;
+        }
+        else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--compact") == 0) && i + 1 < argc) {
+            forward_mode = FORWARD_MODE_COMPACT;
+            i++;
+            if (strcmp(argv[i], "float32") == 0) {
+                compact_encoding = COMPACT_ENCODING_FLOAT32;
+            }
+            else if (strcmp(argv[i], "int32") == 0) {
+                compact_encoding = COMPACT_ENCODING_INT32; // pm offsets from the layout base
+            }
+            else {
+                fprintf(stderr, "Unknown compact encoding '%s' (float32 or int32).\n", argv[i]);
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--assemble") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            forward_mode = FORWARD_MODE_FRAMES;
+            frame_period_ns = (uint64_t)atoi(argv[++i]) * 1000; // us
+        }
+        else if ((strcmp(argv[i], "-W") == 0 || strcmp(argv[i], "--window") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            frame_window = (uint32_t)atoi(argv[++i]); // frames kept open for late units
+        }
+        else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--record") == 0) && i + 1 < argc) {
+            record_path = argv[++i]; // raw I4 frames + .idx
+        }
+        else if ((strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "--log") == 0) && i + 1 < argc) {
+            log_path = argv[++i]; // every sample, columnar
+        }
+        else if (strcmp(argv[i], "-z") == 0 || strcmp(argv[i], "--log-deflate") == 0) {
+            log_compression = COLUMNAR_COMPRESSION_DEFLATE;
+        }
+        else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--publish") == 0) && i + 1 < argc && publish_count < PUBLISH_MAX_LISTENERS) {
+            publish_ports[publish_count++] = argv[++i]; // port[,drop|,disconnect]
+        }
+        else if ((strcmp(argv[i], "-M") == 0 || strcmp(argv[i], "--multicast") == 0) && i + 1 < argc) {
+            udp_endpoint = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--ring") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            ring_slots = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbosity") == 0) && i + 1 < argc) {
+            verbosity = atoi(argv[++i]); // 0 : quiet, 1 : per sweep, 2 : per peak
+            verbosity_set = true;
+        }
+        else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--low-latency") == 0) {
+            low_latency = true;
+        }
+        else if ((strcmp(argv[i], "-C") == 0 || strcmp(argv[i], "--cores") == 0) && i + 1 < argc
+            && (core_count = parseCoreList(argv[i + 1], cores, CORE_LIST_SIZE)) > 0) {
+            i++; // ingest core, worker 0 core, ...
+        }
+        else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--metrics") == 0) && i + 1 < argc
+            && atoi(argv[i + 1]) > 0 && atoi(argv[i + 1]) <= 65535) {
+            metrics_port = atoi(argv[++i]); // Prometheus endpoint
+        }
+        else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--calibration") == 0) && i + 1 < argc) {
+            calibration_path = argv[++i]; // forward force [mN] instead of wavelength [nm]
+        }
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--spectral") == 0) && i + 1 < argc) {
+            detector_path = argv[++i]; // spectral port, peaks found by spectral_peak_detector.h
+        }
+        else if ((strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--stats") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            stats_interval = (uint32_t)atoi(argv[++i]); // sweeps between statistics messages
+            stats_enabled = true;
+        }
+        else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tare") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            tare_after = (uint32_t)atoi(argv[++i]); // auto-zero after that many sweeps
+            stats_enabled = true;
+        }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--filter") == 0) && i + 1 < argc) {
+            filter_spec = argv[++i]; // rate,stage[,stage..][,decimate:D]
+        }
+        else if ((strcmp(argv[i], "-A") == 0 || strcmp(argv[i], "--api") == 0) && i + 1 < argc) {
+            management_spec = argv[++i]; // setting=value[,setting=value..]
+        }
+        else if ((strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "--spectra") == 0) && i + 1 < argc) {
+            spectra_spec = argv[++i]; // port|ip:port[,reduction]
+        }
+        else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--i4") == 0) && i + 1 < argc && device_count < FANIN_MAX_DEVICES) {
+            endpoints[device_count++] = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workers") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            worker_count = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--queue") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            queue_spec = argv[++i]; // KiB[,block|,drop|,drop-newest]
+        }
+        else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--no-reconnect") == 0) {
+            reconnect = false;
+        }
+        else if ((strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--shm") == 0) && i + 1 < argc) {
+            shm_spec = argv[++i]; // name[,ring sweeps[,max peaks]]
+        }
+        else if (strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "--no-server") == 0) {
+            no_server = true;
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-b|--batch | -p|--compact <float32|int32> | -a|--assemble <frame period us> [-W|--window <frames>]] [-r|--ring <sweep slots>] "
+                "[-v|--verbosity <0|1|2>] [-c|--calibration <file> [-t|--tare <sweeps>]] [-T|--stats <sweeps>] "
+                "[-f|--filter <sweep rate Hz>,<lowpass:<Hz>[:Q]|notch:<Hz>[:Q]|average:<N>>[,..][,decimate:<D>]] [-s|--spectral <detector config> "
+                "[-S|--spectra <port|ip:port>[,<max|mean|envelope>[,<points per bin>[,<crop margin nm>]]]]] "
+                "[-A|--api <downsample=<n>|cutoff=<Hz|none>|spectral=<channel>:<4|16|off>|adapt=<max downsample>|port=<n>>[,..]] "
+                "[-i|--i4 <ip[:port]>]... [-w|--workers <n>] [-R|--record <file>] [-L|--log <file> [-z|--log-deflate]] "
+                "[-P|--publish <port>[,drop|,disconnect]]... [-M|--multicast <ip:port>] [-l|--low-latency] [-C|--cores <ingest>,<worker>,...] [-m|--metrics <port>] "
+                "[-q|--queue <KiB>[,block|,drop|,drop-newest]] [-n|--no-reconnect] [-H|--shm <name>[,<ring sweeps>[,<max peaks>]]] [-N|--no-server]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (device_count == 0) {
+        endpoints[device_count++] = SERVER_I4_IP;
+    }
+    if (device_count > 1 && forward_mode == FORWARD_MODE_LEGACY) {
+        fprintf(stderr, "Several I4 units need -b or -p, per-peak packets carry no unit id.\n");
+        return 1;
+    }
+    if (tare_after > 0 && calibration_path == NULL) {
+        fprintf(stderr, "-t needs a calibration (-c) to tare.\n");
+        return 1;
+    }
+    if (stats_interval > 0 && forward_mode != FORWARD_MODE_COMPACT) {
+        stats_interval = 0; // only the compact format has room for statistics messages
+        fprintf(stderr, "Statistics messages need -p, they are only kept on the client.\n");
+    }
+    struct filter_config_t filter_config;
+    if (filter_spec != NULL) {
+        if (parseFilterConfig(&filter_config, filter_spec) != 0) {
+            fprintf(stderr, "Invalid filter '%s'.\n", filter_spec);
+            return 1;
+        }
+        if (filter_config.decimation > 1 && forward_mode == FORWARD_MODE_FRAMES) {
+            fprintf(stderr, "Frames are not decimated, set their period with -a instead.\n");
+            return 1;
+        }
+        if (stats_interval > 0 && stats_interval % filter_config.decimation != 0) {
+            fprintf(stderr, "Statistics messages fall on decimated sweeps, -T should be a multiple of the decimation.\n");
+        }
+    }
+    management_context_t management;
+    initManagementConfig(&management.config);
+    management.running = false;
+    if (management_spec != NULL && parseManagementConfig(&management.config, management_spec) != 0) {
+        fprintf(stderr, "Invalid management settings '%s'.\n", management_spec);
+        return 1;
+    }
+    if (management.config.adapt_max > 0 && filter_spec != NULL) {
+        fprintf(stderr, "adapt= changes the sweep rate the filter (-f) is designed for.\n");
+        return 1;
+    }
+    uint32_t queue_bytes = SESSION_DEFAULT_QUEUE_BYTES;
+    int queue_policy = SESSION_POLICY_BLOCK;
+    if (queue_spec != NULL) {
+        const char* comma = strchr(queue_spec, ',');
+        queue_policy = comma == NULL || strcmp(comma + 1, "block") == 0 ? SESSION_POLICY_BLOCK
+            : strcmp(comma + 1, "drop") == 0 ? SESSION_POLICY_DROP_OLDEST
+            : strcmp(comma + 1, "drop-newest") == 0 ? SESSION_POLICY_DROP_NEWEST : -1;
+        if (queue_policy < 0 || atoi(queue_spec) > SESSION_MAX_QUEUE_KIB) {
+            fprintf(stderr, "Invalid main server queue '%s'.\n", queue_spec);
+            return 1;
+        }
+        queue_bytes = (uint32_t)atoi(queue_spec) * 1024;
+    }
+    char shm_name[SHM_NAME_SIZE] = "";
+    uint32_t shm_slots = SHM_DEFAULT_SLOTS;
+    uint32_t shm_max_peaks = SHM_DEFAULT_MAX_PEAKS;
+    if (shm_spec != NULL) {
+        const char* comma = strchr(shm_spec, ',');
+        size_t length = comma != NULL ? (size_t)(comma - shm_spec) : strlen(shm_spec);
+        if (comma != NULL) {
+            char* end;
+            shm_slots = (uint32_t)strtoul(comma + 1, &end, 10);
+            if (*end == ',') {
+                shm_max_peaks = (uint32_t)strtoul(end + 1, &end, 10);
+            }
+            if (*end != '\0') {
+                shm_slots = 0;
+            }
+        }
+        if (length == 0 || length >= sizeof(shm_name) - 1 || shm_slots == 0 || shm_slots > SHM_MAX_SLOTS
+            || shm_max_peaks == 0 || shm_max_peaks > SHM_MAX_PEAKS) {
+            fprintf(stderr, "Invalid shared memory '%s'.\n", shm_spec);
+            return 1;
+        }
+        memcpy(shm_name, shm_spec, length);
+        shm_name[length] = '\0';
+    }
+    if (no_server && shm_spec == NULL && publish_count == 0 && udp_endpoint == NULL) {
+        fprintf(stderr, "-N needs another consumer : -H, -P or -M.\n");
+        return 1;
+    }
+    if (worker_count == 0) {
+        worker_count = std::thread::hardware_concurrency();
+    }
+    worker_count = worker_count < 1 ? 1 : worker_count > device_count ? device_count : worker_count;
+    struct reducer_config_t reducer_config;
+    initReducerConfig(&reducer_config);
+    char spectra_endpoint[DEVICE_ADDRESS_SIZE + 8] = "";
+    if (spectra_spec != NULL) {
+        const char* comma = strchr(spectra_spec, ',');
+        size_t length = comma != NULL ? (size_t)(comma - spectra_spec) : strlen(spectra_spec);
+        if (detector_path == NULL) {
+            fprintf(stderr, "-S needs the spectral stream (-s).\n");
+            return 1;
+        }
+        if (length == 0 || length >= sizeof(spectra_endpoint) || (comma != NULL && parseReducerConfig(&reducer_config, comma + 1) != 0)) {
+            fprintf(stderr, "Invalid spectra reduction '%s'.\n", spectra_spec);
+            return 1;
+        }
+        memcpy(spectra_endpoint, spectra_spec, length);
+        spectra_endpoint[length] = '\0';
+    }
+    uint32_t headroom = device_count > 1 ? FANIN_DEVICE_ID_SIZE : 0;
+    if (low_latency && !verbosity_set) {
+        verbosity = LOG_LEVEL_QUIET; // no formatting on the forwarding path
+    }
+
+    i4_device_t* devices = new i4_device_t[device_count];
+    for (uint32_t d = 0; d < device_count; d++) {
+        if (parseDeviceEndpoint(endpoints[d], detector_path != NULL ? PORT_I4_SPECTRAL : PORT_I4, &devices[d]) != 0) {
+            fprintf(stderr, "Invalid I4 endpoint '%s'.\n", endpoints[d]);
+            return 1;
+        }
+        devices[d].id = (uint8_t)d;
+    }
+
+    struct calibration_table_t calibration;
+    if (calibration_path != NULL) {
+        if (initCalibration(&calibration) != 0 || loadCalibration(&calibration, calibration_path) < 0) {
+            return 1;
+        }
+        printf("Loaded %u FBGs from %s, forwarding force [mN]\n", calibration.sensors, calibration_path);
+    }
+
+    struct detector_config_t detector_config;
+    if (detector_path != NULL) {
+        initDetectorConfig(&detector_config);
+        int windows = loadDetectorConfig(&detector_config, detector_path);
+        if (windows < 0) {
+            return 1;
+        }
+        printf("Detecting peaks on spectra (%d windows, %u threads)\n", windows, detector_config.threads);
+    }
+
     /*****************************************/
     /**** Initialize TCP/IP communication ****/
     WSADATA wsaData;
@@ -98,381 +633,1401 @@ int main() {
         return 1;
     }
 
-    SOCKET hSocket, hSocket_I4;
-    hSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (hSocket == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed for main server.\n");
+    struct server_session_t server;
+    if (serverSession_init(&server, no_server ? NULL : SERVER_IP, PORT, queue_policy, queue_bytes, reconnect, low_latency) != 0) {
         WSACleanup();
         return 1;
     }
-    hSocket_I4 = socket(AF_INET, SOCK_STREAM, 0);
-    if (hSocket_I4 == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed for I4.\n");
-        closesocket(hSocket);
+    if (no_server) {
+        printf("No main server (-N)\n");
+    }
+    else if (serverSession_connect(&server, SESSION_CONNECT_TIMEOUT_MS) != 0) {
+        fprintf(stderr, "Connection failed for main server.\n");
+        serverSession_free(&server);
         WSACleanup();
         return 1;
     }
+    else {
+        printf("Connected to main server\n");
+    }
+    server.stateful = forward_mode == FORWARD_MODE_COMPACT; // sweeps on the layouts sent before them
+
+    struct publisher_t publisher;
+    publisher_init(&publisher);
+    for (uint32_t k = 0; k < publish_count; k++) {
+        const char* comma = strchr(publish_ports[k], ',');
+        int policy = comma != NULL && strcmp(comma + 1, "disconnect") == 0 ? PUBLISH_POLICY_DISCONNECT : PUBLISH_POLICY_DROP_OLDEST;
+        if (atoi(publish_ports[k]) <= 0 || (comma != NULL && policy == PUBLISH_POLICY_DROP_OLDEST && strcmp(comma + 1, "drop") != 0)
+            || publisher_listen(&publisher, (uint16_t)atoi(publish_ports[k]), policy) != 0) {
+            fprintf(stderr, "Can't publish on '%s'.\n", publish_ports[k]);
+            serverSession_free(&server);
+            WSACleanup();
+            return 1;
+        }
+        printf("Publishing on port %d (%s)\n", atoi(publish_ports[k]), policy == PUBLISH_POLICY_DISCONNECT ? "disconnect" : "drop oldest");
+    }
+    if (udp_endpoint != NULL) {
+        if (publisher_udp(&publisher, udp_endpoint) != 0) {
+            fprintf(stderr, "Invalid UDP endpoint '%s'.\n", udp_endpoint);
+            serverSession_free(&server);
+            WSACleanup();
+            return 1;
+        }
+        printf("Publishing datagrams to %s\n", udp_endpoint);
+    }
+    struct publisher_t spectra_publisher;
+    publisher_init(&spectra_publisher);
+    if (spectra_spec != NULL) {
+        // ip:port : datagrams, else a TCP port whose subscribers lose their oldest messages when behind
+        int result = strchr(spectra_endpoint, ':') != NULL ? publisher_udp(&spectra_publisher, spectra_endpoint)
+            : atoi(spectra_endpoint) > 0 && atoi(spectra_endpoint) <= 65535
+            ? publisher_listen(&spectra_publisher, (uint16_t)atoi(spectra_endpoint), PUBLISH_POLICY_DROP_OLDEST) : -1;
+        if (result != 0) {
+            fprintf(stderr, "Can't publish spectra on '%s'.\n", spectra_endpoint);
+            serverSession_free(&server);
+            WSACleanup();
+            return 1;
+        }
+        if (reducer_config.crop) {
+            printf("Publishing spectra to %s (%s of %u points, %.3f nm around each FBG)\n", spectra_endpoint,
+                reducerModeName(reducer_config.mode), reducer_config.factor, reducer_config.margin_nm);
+        }
+        else {
+            printf("Publishing spectra to %s (%s of %u points)\n", spectra_endpoint,
+                reducerModeName(reducer_config.mode), reducer_config.factor);
+        }
+    }
 
-    SOCKADDR_IN serverAddr, serverAddr_I4;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(PORT);
-    if (inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr) <= 0) {
-        fprintf(stderr, "inet_pton failed.\n");
-        closesocket(hSocket);
-        WSACleanup();
-        return 1;
+    if (management_spec != NULL) {
+        // before the streams connect, so they start with the new settings
+        management.devices = devices;
+        management.device_count = device_count;
+        management.units = new i4_management_t[device_count];
+        for (uint32_t d = 0; d < device_count; d++) {
+            i4_management_t* unit = &management.units[d];
+            if (initManagement(unit, devices[d].address, management.config.port) != 0
+                || applyManagementConfig(unit, &management.config) != 0
+                || managementReadRate(unit, &management.sampling_hz[d], &management.downsampling[d]) != 0) {
+                fprintf(stderr, "Management of I4 #%u (%s:%u) failed.\n", d, devices[d].address, management.config.port);
+                serverSession_free(&server);
+                WSACleanup();
+                return 1;
+            }
+            management.downsampling[d] = management.downsampling[d] < 1 ? 1 : management.downsampling[d];
+            management.base[d] = management.downsampling[d];
+            devices[d].sweep_step = management.downsampling[d];
+            printf("I4 #%u : %.0f Hz sweeps, every %u sent (%.1f Hz)\n", d, management.sampling_hz[d],
+                management.downsampling[d], management.sampling_hz[d] / management.downsampling[d]);
+        }
     }
-    if (connect(hSocket, (SOCKADDR*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        fprintf(stderr, "Connection failed for main server.\n");
-        closesocket(hSocket);
-        WSACleanup();
-        return 1;
+
+    struct metrics_t metrics;
+    metrics_init(&metrics);
+    struct metrics_slot_t* ingest_metrics = metrics_slot(&metrics, "ingest");
+    for (uint32_t d = 0; d < device_count; d++) {
+        devices[d].metrics = ingest_metrics;
     }
-    printf("Connected to main server\n");
 
-    serverAddr_I4.sin_family = AF_INET;
-    serverAddr_I4.sin_port = htons(PORT_I4);
-    if (inet_pton(AF_INET, SERVER_I4_IP, &serverAddr_I4.sin_addr) <= 0) {
-        fprintf(stderr, "inet_pton failed.\n");
-        closesocket(hSocket_I4);
+    ingest_context_t ingest;
+    ingest.devices = devices;
+    ingest.device_count = device_count;
+    ingest.busy_poll = low_latency;
+    ingest.reconnect = reconnect;
+    ingest.core = core_count > 0 ? cores[0] : -1;
+    if (pollerInit(&ingest.poller, device_count) != 0) {
+        serverSession_free(&server);
         WSACleanup();
         return 1;
     }
-    if (connect(hSocket_I4, (SOCKADDR*)&serverAddr_I4, sizeof(serverAddr_I4)) == SOCKET_ERROR) {
-        fprintf(stderr, "Connection failed for I4.\n");
-        closesocket(hSocket_I4);
-        WSACleanup();
-        return 1;
+    for (uint32_t d = 0; d < device_count; d++) {
+        if (connectDevice(&devices[d]) != 0 || (low_latency && socketSetNoDelay(devices[d].hSocket) != 0)
+            || (low_latency ? socketSetNonBlocking(devices[d].hSocket) : pollerAdd(&ingest.poller, devices[d].hSocket, d)) != 0) {
+            fprintf(stderr, "Connection failed for I4 #%u (%s:%u).\n", d, devices[d].address, devices[d].port);
+            for (uint32_t k = 0; k <= d; k++) {
+                if (devices[k].connected) {
+                    closesocket(devices[k].hSocket);
+                }
+            }
+            pollerFree(&ingest.poller);
+            serverSession_free(&server);
+            WSACleanup();
+            return 1;
+        }
+        if (low_latency && socketSetBusyPoll(devices[d].hSocket, LOW_LATENCY_BUSY_POLL_US) < 0) {
+            printf("SO_BUSY_POLL not permitted, I4 #%u is left to interrupts.\n", d);
+        }
+        printf("Connected to I4 #%u (%s:%u)\n", d, devices[d].address, devices[d].port);
     }
-    printf("Connected to I4\n");
 
     /*****************************************************************/
     /**** Receiving data from I4, and sending data to main server ****/
 
-    while (1) {
-        if (_kbhit()) { // Loop until ESC key is pressed
-            int ch = _getch();
-            if (ch == 27) {
-                printf("Exiting program.\n");
-                closesocket(hSocket);
-                closesocket(hSocket_I4);
-                break;
+    std::atomic<bool> stop(false);
+    std::mutex send_lock;
+    std::atomic<uint32_t> tare_request(0);
+    struct stats_engine_t* stats = NULL;
+    if (stats_enabled) {
+        stats = new stats_engine_t[device_count];
+        for (uint32_t d = 0; d < device_count; d++) {
+            if (initStatsEngine(&stats[d], STATS_DEFAULT_ALPHA, STATS_DEFAULT_WINDOW) != 0) {
+                return 1;
             }
         }
+        if (stats_interval > 0) {
+            printf("Sensor statistics sent every %u sweeps\n", stats_interval);
+        }
+        if (calibration_path != NULL) {
+            printf("Tare : 't' key%s\n", tare_after > 0 ? ", and once after the first sweeps (-t)" : "");
+        }
+    }
+    // taring rewrites the calibration : each unit tares a copy of its own, whichever worker decodes it
+    struct calibration_table_t* unit_calibration = NULL;
+    if (stats_enabled && calibration_path != NULL) {
+        unit_calibration = new calibration_table_t[device_count];
+        for (uint32_t d = 0; d < device_count; d++) {
+            if (copyCalibration(&unit_calibration[d], &calibration) != 0) {
+                return 1;
+            }
+        }
+    }
+    struct force_filter_t* filters = NULL;
+    if (filter_spec != NULL) {
+        filters = new force_filter_t[device_count];
+        for (uint32_t d = 0; d < device_count; d++) {
+            if (initForceFilter(&filters[d], &filter_config) != 0) {
+                return 1;
+            }
+        }
+        char description[256];
+        describeFilterConfig(&filter_config, description, sizeof(description));
+        printf("Filtering at %s\n", description);
+    }
+    struct sweep_assembler_t assembler;
+    if (forward_mode == FORWARD_MODE_FRAMES) {
+        if (initSweepAssembler(&assembler, frame_period_ns, frame_window, device_count, ASSEMBLER_DEFAULT_SLOTS,
+            sendAssembledFrame, NULL) != 0) {
+            return 1;
+        }
+        printf("Assembling %llu us frames (window of %u frames)\n", (unsigned long long)(frame_period_ns / 1000), frame_window);
+    }
+    columnar_logger_t* loggers = NULL;
+    if (log_path != NULL) {
+        loggers = new columnar_logger_t[device_count];
+        for (uint32_t d = 0; d < device_count; d++) {
+            char path[LOG_PATH_SIZE];
+            if (device_count > 1) {
+                snprintf(path, sizeof(path), "%s.%u", log_path, d);
+            }
+            else {
+                snprintf(path, sizeof(path), "%s", log_path);
+            }
+            if (columnarLog_open(&loggers[d], path, calibration_path != NULL ? COLUMNAR_UNIT_FORCE_MN : COLUMNAR_UNIT_WAVELENGTH_NM,
+                (uint8_t)d, log_compression) != 0) {
+                return 1;
+            }
+        }
+        printf("Logging every sample to %s%s\n", log_path, device_count > 1 ? ".<unit>" : "");
+    }
+    struct shm_writer_t shm;
+    if (shm_spec != NULL) {
+        if (shmWriter_open(&shm, shm_name, shm_slots, shm_max_peaks, device_count,
+            calibration_path != NULL ? SHM_VALUE_FORCE : SHM_VALUE_WAVELENGTH) != 0) {
+            return 1;
+        }
+        printf("Sharing sweeps in memory '%s' (%u ring slots of up to %u peaks)\n", shm_name, shm.header->slots, shm_max_peaks);
+    }
+    forward_worker_t* workers = allocWorkers(worker_count);
+    if (workers == NULL) {
+        fprintf(stderr, "Worker allocation failed.\n");
+        return 1;
+    }
+    for (uint32_t k = 0; k < worker_count; k++) {
+        forward_worker_t* worker = &workers[k];
+        if (spscRing_init(&worker->ring, ring_slots) != 0 || logSink_start(&worker->log, verbosity, LOG_DEFAULT_LINES_PER_SEC) != 0) {
+            fprintf(stderr, "Sweep/log ring allocation failed.\n");
+            return 1;
+        }
+        for (uint32_t i = 0; i < worker->ring.capacity; i++) {
+            initSweepFrame(&worker->ring.slots[i]);
+        }
+        if (detector_path != NULL) {
+            initSpectralDetector(&worker->detector, &detector_config);
+        }
+        initSpectralReducer(&worker->reducer, &reducer_config);
+        char name[METRICS_NAME_SIZE];
+        snprintf(name, sizeof(name), "worker%u", k);
+        initForwarder(&worker->forwarder, &server, &send_lock, forward_mode, compact_encoding, headroom, &worker->log,
+            calibration_path != NULL ? &calibration : NULL, unit_calibration, detector_path != NULL ? &worker->detector : NULL,
+            forward_mode == FORWARD_MODE_FRAMES ? &assembler : NULL, log_path != NULL ? loggers : NULL,
+            publisher_active(&publisher) ? &publisher : NULL, stats, stats_interval, tare_after, &tare_request, filters,
+            spectra_spec != NULL ? &worker->reducer : NULL,
+            &spectra_publisher, metrics_slot(&metrics, name), shm_spec != NULL ? &shm : NULL);
+        worker->ingest_running = &ingest.running;
+        worker->stop = &stop;
+        worker->busy_poll = low_latency;
+        worker->core = 1 + (int)k < core_count ? cores[1 + k] : -1;
+    }
+    for (uint32_t d = 0; d < device_count; d++) {
+        devices[d].ring = &workers[d % worker_count].ring; // a unit's sweeps stay in order on one worker
+    }
+    if (device_count > 1) {
+        printf("Fan-in of %u I4 units on %u decode workers\n", device_count, worker_count);
+    }
+    if (low_latency) {
+        printf("Low-latency mode : TCP_NODELAY, busy polling%s\n", verbosity == LOG_LEVEL_QUIET ? ", no per-sweep log" : "");
+    }
 
-        /* 1. Receiving header packet */
-        char buffer_header[HEADER_SIZE] = { 0 };
-        int hbytesRead = recv(hSocket_I4, buffer_header, HEADER_SIZE, 0);
-
-        if (hbytesRead == SOCKET_ERROR) {
-            perror("Receive failed");
+    struct i4_recorder_t recorder;
+    if (record_path != NULL) {
+        if (recorderOpen(&recorder, record_path, RECORDER_DEFAULT_RESERVE) != 0) {
+            return 1;
         }
-        else if (hbytesRead == 0) {
-            printf("Client disconnected\n");
+        for (uint32_t d = 0; d < device_count; d++) {
+            devices[d].recorder = &recorder;
         }
-        if (hbytesRead != HEADER_SIZE) {
-            perror("Packet header size error");
+        printf("Recording to %s\n", record_path);
+    }
+
+    if (metrics_port > 0) {
+        if (metrics_serve(&metrics, (uint16_t)metrics_port) != 0) {
+            fprintf(stderr, "Can't serve metrics on port %d.\n", metrics_port);
+            return 1;
         }
+        printf("Metrics on http://0.0.0.0:%d/metrics\n", metrics_port);
+    }
+    if (publisher_active(&publisher)) {
+        publisher_start(&publisher);
+    }
+    if (publisher_active(&spectra_publisher)) {
+        publisher_start(&spectra_publisher);
+    }
+    serverSession_start(&server);
+    ingest.running = true;
+    std::thread ingest_thread(ingestThread, &ingest);
+    if (management_spec != NULL && filter_spec == NULL) {
+        management.step_request = 0;
+        management.running = true;
+        management.thread = std::thread(managementThread, &management);
+        printf("Downsampling : '+' / '-'%s\n", management.config.adapt_max > 0 ? ", raised on ring drops (adapt=)" : "");
+    }
+    else if (management_spec != NULL) {
+        printf("Downsampling : fixed, '+' / '-' are off with -f (the filter is designed for one sweep rate)\n");
+    }
+    for (uint32_t k = 0; k < worker_count; k++) {
+        workers[k].thread = std::thread(forwardWorkerThread, &workers[k]);
+    }
 
-        int sweep_type, DO, DL; // offset for error handling
-        processPacket_Header(buffer_header, &sweep_type, &DO, &DL);
+    // the main thread only watches the console and logs the ring stats (a sink of its own, one producer each)
+    log_sink_t main_log;
+    if (logSink_start(&main_log, verbosity, LOG_DEFAULT_LINES_PER_SEC) != 0) {
+        fprintf(stderr, "Log ring allocation failed.\n");
+        consoleRequestShutdown();
+    }
+    consoleControl_install();
+    std::chrono::steady_clock::time_point stats_time = std::chrono::steady_clock::now();
+    while (!stop.load()) {
+        if (consoleShutdownRequested()) { // Ctrl+C / SIGTERM, or ESC below
+            printf("Exiting program.\n");
+            stop = true;
+            serverSession_requestStop(&server); // a worker waiting for queue room must not hold up the exit
+            break;
+        }
+        if (!ingest.running.load()) {
+            break; // all I4 units disconnected : the workers drain their rings and return
+        }
+        int ch = consoleKey();
+        if (ch >= 0) {
+            if (ch == CONSOLE_KEY_ESC) {
+                consoleRequestShutdown();
+                continue;
+            }
+            if (ch == 't' && stats != NULL && calibration_path != NULL) {
+                tare_request++; // applied by each worker on the next sweep of each of its units
+                printf("Tare requested\n");
+            }
+            if ((ch == '+' || ch == '-') && management.running.load()) {
+                management.step_request += ch == '+' ? -1 : 1; // applied by the management thread
+            }
+        }
 
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - stats_time >= std::chrono::milliseconds(RING_STATS_INTERVAL_MS)) {
+            for (uint32_t k = 0; k < worker_count; k++) {
+                printRingStats(&workers[k].ring, &main_log);
+            }
+            printDeviceStats(devices, device_count, &main_log);
+            stats_time = now;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(CONSOLE_POLL_INTERVAL_MS));
+    }
+    logSink_stop(&main_log);
 
-        uint8_t channel = 0, fiber = 0, sensor = 0;
-        double wavelength_data = 0, force = 0;
+    if (management.running.load()) {
+        management.running = false;
+        management.thread.join();
+    }
+    // the ingest thread polls with a timeout, so it sees 'running' within FANIN_POLL_TIMEOUT_MS
+    ingest.running = false;
+    ingest_thread.join();
+    if (record_path != NULL) {
+        printf("Recorded %llu sweeps (%llu bytes) to %s\n", (unsigned long long)recorder.header.frames,
+            (unsigned long long)(recorder.used - RECORDER_HEADER_SIZE), record_path);
+        recorderClose(&recorder);
+    }
+    for (uint32_t k = 0; k < worker_count; k++) {
+        workers[k].thread.join();
+    }
+    // workers joined : the main thread logs through worker 0's sink from here on
+    for (uint32_t k = 0; k < worker_count; k++) {
+        printRingStats(&workers[k].ring, &workers[0].log);
+    }
+    printDeviceStats(devices, device_count, &workers[0].log);
+    if (forward_mode != FORWARD_MODE_FRAMES) {
+        printLatencyStats(workers, worker_count);
+    }
+    if (forward_mode == FORWARD_MODE_FRAMES) {
+        // the frames still open in the reorder window
+        assembler.user = &workers[0].forwarder;
+        sweepAssembler_flush(&assembler);
+        logSink_text(&workers[0].log, "Frames : %llu sent, %llu late peaks, %llu peaks without slot",
+            (unsigned long long)assembler.emitted, (unsigned long long)assembler.late, (unsigned long long)assembler.unmapped);
+    }
 
+    if (spectra_spec != NULL) {
+        printReducerStats(workers, worker_count);
+    }
+    serverSession_stop(&server);
+    serverSession_print(&server, "Main server");
+    if (shm_spec != NULL) {
+        shmWriter_print(&shm);
+        shmWriter_close(&shm);
+    }
 
-        /* 2. Receiving payload packet */
-        if (DO == 16) { // or 0X0010
-            // receiving peak payload
-            if (sweep_type == 0) { // peak
-                char buffer_payload[PEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / PEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket_I4, buffer_payload, PEAK_PAYLOAD_SIZE, 0);
+    publisher_stop(&publisher);
+    publisher_stop(&spectra_publisher);
+    metrics_stop(&metrics);
+    if (log_path != NULL) {
+        for (uint32_t d = 0; d < device_count; d++) {
+            columnarLog_close(&loggers[d]);
+            printf("Logged I4 #%u : %llu sweeps in %llu chunks (%llu bytes), %llu writer stalls\n", d,
+                (unsigned long long)loggers[d].rows, (unsigned long long)loggers[d].chunks_written,
+                (unsigned long long)loggers[d].bytes, (unsigned long long)loggers[d].stalls);
+        }
+        delete[] loggers;
+    }
 
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receive failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength_data);
+    for (uint32_t k = 0; k < worker_count; k++) {
+        forward_worker_t* worker = &workers[k];
+        logSink_stop(&worker->log);
+        for (uint32_t i = 0; i < worker->ring.capacity; i++) {
+            freeSweepFrame(&worker->ring.slots[i]);
+        }
+        spscRing_free(&worker->ring);
+        freeForwarder(&worker->forwarder);
+        if (detector_path != NULL) {
+            freeSpectralDetector(&worker->detector);
+        }
+    }
+    freeWorkers(workers, worker_count);
+    if (unit_calibration != NULL) {
+        for (uint32_t d = 0; d < device_count; d++) {
+            freeCalibration(&unit_calibration[d]);
+        }
+        delete[] unit_calibration;
+    }
+    if (stats != NULL) {
+        for (uint32_t d = 0; d < device_count; d++) {
+            printf("I4 #%u statistics : %u sensors, %llu sweeps, %u tares, %llu samples untracked\n", d, stats[d].count,
+                (unsigned long long)stats[d].sweeps, stats[d].tares, (unsigned long long)stats[d].untracked);
+            freeStatsEngine(&stats[d]);
+        }
+        delete[] stats;
+    }
+    if (filters != NULL) {
+        for (uint32_t d = 0; d < device_count; d++) {
+            printf("I4 #%u filter : %u sensors, %llu sweeps, %llu samples unfiltered\n", d, filters[d].count,
+                (unsigned long long)filters[d].sweeps, (unsigned long long)filters[d].untracked);
+            freeForceFilter(&filters[d]);
+        }
+        delete[] filters;
+    }
+    for (uint32_t d = 0; d < device_count; d++) {
+        printf("I4 #%u ", d);
+        printStreamStats(&devices[d].stream);
+    }
+    if (management_spec != NULL) {
+        for (uint32_t d = 0; d < device_count; d++) {
+            printf("I4 #%u management : every %u sweeps sent, %llu requests, %llu failed\n", d, management.downsampling[d],
+                (unsigned long long)management.units[d].requests, (unsigned long long)management.units[d].failures);
+            freeManagement(&management.units[d]);
+        }
+        delete[] management.units;
+    }
+    if (forward_mode == FORWARD_MODE_FRAMES) {
+        freeSweepAssembler(&assembler);
+    }
+    if (calibration_path != NULL) {
+        freeCalibration(&calibration);
+    }
+    for (uint32_t d = 0; d < device_count; d++) {
+        if (devices[d].connected) {
+            closesocket(devices[d].hSocket);
+        }
+        if (devices[d].pending != INVALID_SOCKET) {
+            closesocket(devices[d].pending);
+        }
+        freeSweepFrame(&devices[d].staging);
+    }
+    pollerFree(&ingest.poller);
+    delete[] devices;
+    serverSession_free(&server);
 
-                    uint8_t int_data[3] = { channel, fiber, sensor };
-                    char cBuffer[PACKET_SIZE];
-                    //memset(cBuffer, 0, PACKET_SIZE);
+    // Close TCP/IP communication
+    WSACleanup();
 
-                    memcpy(cBuffer, int_data, sizeof(int_data));
-                    memcpy(cBuffer + sizeof(int_data), &wavelength_data, sizeof(wavelength_data));
-                    send(hSocket, cBuffer, PACKET_SIZE, 0);
+    return 0;
+}
 
-                    printf("Sent data %u - Channel#%u, Sensor#%u, Wavelength: %.5f nm\n",
-                        fiber, channel, sensor, wavelength_data);
 
-                }
-            }
-            // receiving time-stamped peak payload
-            else if (sweep_type == 2) { // peak with timestamps
-                char buffer_payload[TSPEAK_PAYLOAD_SIZE] = { 0 };
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* initSweepFrame, freeSweepFrame : Allocate/release the frame buffer.
+* beginForwardBatch, appendForwardPacket, sendForwardBatch : Pack the peaks of one sweep and send them at once.
+* beginForwardMessage : Starts a message, with the unit id in the headroom in fan-in mode.
+* appendForwardBytes : Reserves bytes at the end of the forward buffer, growing it on demand.
+* parseDeviceEndpoint : Reads "ip[:port]" of one I4 unit.
+* connectDevice : Connects to one I4 unit.
+* receiveDeviceData : Receives what one non-blocking unit has, handing each completed sweep frame to its ring
+*                     (realigning on the next plausible header, counting sweep gaps, ../common/i4_stream_sync.h).
+* disconnectDevice : Closes the socket of a unit that went away and schedules its reconnect.
+* reconnectDevice, reconnectDevices : Non-blocking reconnect of one / every disconnected unit, with backoff.
+* ingestThread : Polls all I4 units and frames their sweeps into the rings, dropping them when a ring is full.
+* setDeviceDownsampling : Sets the downsampling of one I4 through its Management API (-A).
+* managementThread : Applies the '+' / '-' keys, and raises / lowers the downsampling on ring drops (adapt=).
+* initForwarder, freeForwarder : Allocate/release the decode and send buffers of a forwarding worker.
+* forwardSweep : Decodes one sweep frame, or detects the peaks of a spectral one, (and its forces if calibrated),
+*                logs it if -L, filters it if -f and sends its peaks to the main server.
+* sendAssembledFrame : Sends one frame of the sweep assembler (FORWARD_MODE_FRAMES).
+* publishForward : Sends the forward buffer to the main server and queues it for the subscribers.
+* forwarderCalibration : The calibration of one unit (its own tared copy, or the shared table).
+* updateSensorStats : Adds a decoded sweep to its unit's statistics and applies a pending tare (-T, -t, 't').
+* publishReducedSpectra : Publishes the reduced spectra of the last detected sweep (-S).
+* allocWorkers, freeWorkers : Decode workers on cache-line aligned storage (new[] ignores alignas before C++17).
+* forwardPending, forwardWorkerThread : Forward every sweep waiting in a worker's ring / loop of one worker thread.
+* printRingStats, printDeviceStats : Log ring occupancy and per-unit counters.
+* printLatencyStats : Prints the latency histograms of all workers combined.
+* printReducerStats : Prints the spectra reduction totals of all workers combined.
+* parseCoreList, pinThread : Read the -C list / pin the calling thread to its core (../common/low_latency.h).
+* (per-thread metrics and their endpoint : ../common/pipeline_metrics.h)
+* (packet decoders : ../common/i4_protocol.h, batch peak decoder : ../common/i4_peak_decoder.h)
+* ==============================================================================
+*/
 
-                for (int i = 0; i < (DL / TSPEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket_I4, buffer_payload, TSPEAK_PAYLOAD_SIZE, 0);
+void initSweepFrame(sweep_frame_t* frame) {
+    frame->capacity = FRAME_INITIAL_CAPACITY;
+    frame->data = (char*)malloc(frame->capacity);
+    frame->size = 0;
+    frame->sweep_type = 0;
+    frame->DO = 0;
+    frame->DL = 0;
+    frame->device = 0;
+    frame->received_ns = 0;
+}
 
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receive failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength_data);
+void freeSweepFrame(sweep_frame_t* frame) {
+    free(frame->data);
+    frame->data = NULL;
+    frame->capacity = 0;
+    frame->size = 0;
+}
 
-                    //printf("sensor#%u, ", sensor);
-                    //printf("fiber#%u, ", fiber);
-                    //printf("channel#%u\t", channel);
-                    //printf("wavelength::%.3f nm\n", wavelength_data);
+void initForwardBuffer(forward_buffer_t* buffer, uint32_t headroom) {
+    buffer->capacity = FRAME_INITIAL_CAPACITY;
+    buffer->data = (char*)malloc(buffer->capacity);
+    buffer->size = 0;
+    buffer->headroom = headroom;
+}
 
-                    uint8_t int_data[3] = { channel, fiber, sensor };
-                    char cBuffer[PACKET_SIZE];
-                    //memset(cBuffer, 0, PACKET_SIZE);
+void freeForwardBuffer(forward_buffer_t* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->capacity = 0;
+    buffer->size = 0;
+}
 
-                    memcpy(cBuffer, int_data, sizeof(int_data));
-                    memcpy(cBuffer + sizeof(int_data), &wavelength_data, sizeof(wavelength_data));
-                    send(hSocket, cBuffer, PACKET_SIZE, 0);
+void beginForwardMessage(forward_buffer_t* buffer, uint8_t device) {
+    if (buffer->headroom > 0) {
+        buffer->data[0] = (char)device;
+    }
+    buffer->size = buffer->headroom;
+}
 
-                    printf("Sent data %u - Channel#%u, Sensor#%u, Wavelength: %.5f nm\n",
-                        fiber, channel, sensor, wavelength_data);
+void beginForwardBatch(forward_buffer_t* buffer, uint8_t device, uint32_t sweep_counter) {
+    beginForwardMessage(buffer, device);
+    struct forward_batch_header_t* batch = (struct forward_batch_header_t*)(buffer->data + buffer->headroom);
+    batch->sweep_counter = sweep_counter;
+    batch->peak_count = 0;
+    buffer->size += BATCH_HEADER_SIZE;
+}
 
-                }
-            }
+/* returns the first of 'bytes' reserved bytes */
+char* appendForwardBytes(forward_buffer_t* buffer, uint32_t bytes) {
+    if (buffer->size + bytes > buffer->capacity) {
+        uint32_t capacity = buffer->capacity * 2;
+        while (capacity < buffer->size + bytes) {
+            capacity *= 2;
         }
+        char* grown = (char*)realloc(buffer->data, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Forward buffer allocation failed.\n");
+            exit(1);
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
 
-        else { // if error exists..
-            // receiving error payload
-            char error_payload[ERROR_PAYLOAD_SIZE] = { 0 };
-            int ebytesRead = recv(hSocket_I4, error_payload, ERROR_PAYLOAD_SIZE, 0);
-            if (ebytesRead == SOCKET_ERROR) {
-                perror("Error receive failed");
-            }
-            else if (ebytesRead == 0) {
-                printf("Client disconnected\n");
-            }
-            processPacket_errorPayload(error_payload);
+    char* bytes_start = buffer->data + buffer->size;
+    buffer->size += bytes;
+    return bytes_start;
+}
 
-            // receiving peak payload
-            if (sweep_type == 0) { // peak
-                char buffer_payload[PEAK_PAYLOAD_SIZE] = { 0 };
-                for (int i = 0; i < (DL / PEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket_I4, buffer_payload, PEAK_PAYLOAD_SIZE, 0);
+/* returns the next free PACKET_SIZE slot of the batch */
+char* appendForwardPacket(forward_buffer_t* buffer) {
+    char* packet = appendForwardBytes(buffer, PACKET_SIZE);
 
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receive failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength_data);
+    struct forward_batch_header_t* batch = (struct forward_batch_header_t*)(buffer->data + buffer->headroom);
+    batch->peak_count++;
+    return packet;
+}
 
-                    uint8_t int_data[3] = { channel, fiber, sensor };
-                    char cBuffer[PACKET_SIZE];
-                    //memset(cBuffer, 0, PACKET_SIZE);
+/* returns 0 (sent, queued or dropped by the queue policy), or -1 if the main server session failed;
+   'generation' : of the main server session the batch was encoded for */
+int sendForwardBatch(struct server_session_t* server, forward_buffer_t* buffer, uint32_t generation) {
+    return serverSession_sendFor(server, buffer->data, buffer->size, generation);
+}
 
-                    memcpy(cBuffer, int_data, sizeof(int_data));
-                    memcpy(cBuffer + sizeof(int_data), &wavelength_data, sizeof(wavelength_data));
-                    send(hSocket, cBuffer, PACKET_SIZE, 0);
+/* returns 0, or -1 if 'text' is not ip[:port] */
+int parseDeviceEndpoint(const char* text, uint16_t default_port, i4_device_t* device) {
+    const char* colon = strchr(text, ':');
+    size_t length = colon != NULL ? (size_t)(colon - text) : strlen(text);
+    if (length == 0 || length >= DEVICE_ADDRESS_SIZE) {
+        return -1;
+    }
+    memcpy(device->address, text, length);
+    device->address[length] = '\0';
+
+    device->port = default_port;
+    if (colon != NULL) {
+        char* end;
+        unsigned long port = strtoul(colon + 1, &end, 10);
+        if (end == colon + 1 || *end != '\0' || port == 0 || port > 65535) {
+            return -1;
+        }
+        device->port = (uint16_t)port;
+    }
 
-                    printf("Sent data %u - Channel#%u, Sensor#%u, Wavelength: %.5f nm\n",
-                        fiber, channel, sensor, wavelength_data);
+    device->hSocket = INVALID_SOCKET;
+    device->connected = false;
+    initSweepFrame(&device->staging);
+    device->received = 0;
+    device->frame_size = 0;
+    device->ring = NULL;
+    device->sweeps = 0;
+    device->dropped = 0;
+    initStreamStats(&device->stream);
+    device->resyncing = false;
+    device->recorder = NULL;
+    device->metrics = NULL;
+    device->frame_start_ns = 0;
+    device->sweep_step = 1;
+    sessionBackoff_init(&device->backoff);
+    device->pending = INVALID_SOCKET;
+    device->pending_since_ms = 0;
+    return 0;
+}
+
+/* returns 0, or -1 if the unit can't be reached */
+int connectDevice(i4_device_t* device) {
+    device->hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (device->hSocket == INVALID_SOCKET) {
+        return -1;
+    }
+    device->connected = true;
+
+    SOCKADDR_IN serverAddr_I4;
+    memset(&serverAddr_I4, 0, sizeof(serverAddr_I4));
+    serverAddr_I4.sin_family = AF_INET;
+    serverAddr_I4.sin_port = htons(device->port);
+    if (inet_pton(AF_INET, device->address, &serverAddr_I4.sin_addr) <= 0) {
+        return -1;
+    }
+    if (connect(device->hSocket, (SOCKADDR*)&serverAddr_I4, sizeof(serverAddr_I4)) == SOCKET_ERROR) {
+        return -1;
+    }
+    return 0;
+}
+
+/* returns 1 once the socket is drained, 0 when the unit disconnected, -1 on error */
+int receiveDeviceData(i4_device_t* device) {
+    sweep_frame_t* staging = &device->staging;
+    while (1) {
+        uint32_t need = device->frame_size == 0 ? HEADER_SIZE : device->frame_size;
+        int bytesRead = recv(device->hSocket, staging->data + device->received, (int)(need - device->received), 0);
+        if (bytesRead > 0) {
+            if (device->received == 0) {
+                device->frame_start_ns = latencySteady_ns();
+            }
+            metrics_add(device->metrics->bytes_received, (uint64_t)bytesRead);
+        }
+        if (bytesRead == SOCKET_ERROR) {
+            if (socketWouldBlock()) {
+                return 1;
+            }
+            fprintf(stderr, "Receive failed for I4 #%u (%d).\n", device->id, WSAGetLastError());
+            return -1;
+        }
+        if (bytesRead == 0) {
+            return 0; // disconnected
+        }
+        device->received += (uint32_t)bytesRead;
+        if (device->received < need) {
+            continue;
+        }
 
+        if (device->frame_size == 0) {
+            // header complete : size the rest of the frame
+            if (!i4HeaderPlausible(staging->data, HEADER_SIZE, FRAME_MAX_DATA_LENGTH)) {
+                // misaligned : keep the bytes from the next possible header start and read on
+                uint32_t skip = i4ScanHeader(staging->data, HEADER_SIZE, FRAME_MAX_DATA_LENGTH);
+                memmove(staging->data, staging->data + skip, HEADER_SIZE - skip);
+                device->received -= skip;
+                device->stream.skipped_bytes += skip;
+                if (!device->resyncing) {
+                    fprintf(stderr, "Stream of I4 #%u misaligned, resyncing\n", device->id);
+                    device->stream.malformed++;
+                    device->resyncing = true;
                 }
+                continue;
             }
-            // receiving time-stamped peak payload
-            else if (sweep_type == 2) { // peak with timestamps
-                char buffer_payload[TSPEAK_PAYLOAD_SIZE] = { 0 };
+            if (device->resyncing) {
+                device->stream.resyncs++;
+                device->resyncing = false;
+            }
+            int sweep_type, DO, DL;
+            processPacket_Header(staging->data, &sweep_type, &DO, &DL);
+            uint32_t frameSize = (uint32_t)DO + (uint32_t)DL + FLAG_SIZE;
+            if (frameSize > staging->capacity) {
+                char* grown = (char*)realloc(staging->data, frameSize);
+                if (grown == NULL) {
+                    fprintf(stderr, "Frame buffer allocation failed.\n");
+                    return -1;
+                }
+                staging->data = grown;
+                staging->capacity = frameSize;
+            }
+            staging->sweep_type = sweep_type;
+            staging->DO = (uint32_t)DO;
+            staging->DL = (uint32_t)DL;
+            device->frame_size = frameSize;
+            continue;
+        }
 
-                for (int i = 0; i < (DL / TSPEAK_PAYLOAD_SIZE); i++) {
-                    int pbytesRead = recv(hSocket_I4, buffer_payload, TSPEAK_PAYLOAD_SIZE, 0);
+        // frame complete : a false header shows in its payload, then resync on the next one
+        struct i4_header_info_t header;
+        struct I4PacketFlag flag;
+        processPacket_HeaderInfo(staging->data, &header);
+        memcpy(&flag, staging->data + staging->DO + staging->DL, sizeof(flag));
+        if (!i4PayloadPlausible(staging->data + staging->DO, staging->DL, staging->sweep_type)
+            || !i4SweepPlausible(&device->stream, flag.sweep_counter)) {
+            device->stream.malformed++;
+            device->resyncing = true;
+            device->received = 0;
+            device->frame_size = 0;
+            continue;
+        }
+        device->stream.sweep_step = device->sweep_step.load(std::memory_order_relaxed);
+        trackSweep(&device->stream, header.packetCounter, flag.sweep_counter);
+        if (device->recorder != NULL) {
+            recorderWrite(device->recorder, device->id, staging->data, device->frame_size); // also sweeps the ring drops
+        }
 
-                    if (pbytesRead == SOCKET_ERROR) {
-                        perror("Receive failed");
-                    }
-                    else if (pbytesRead == 0) {
-                        printf("Client disconnected\n");
-                    }
-                    processPacket_Payload(buffer_payload, &channel, &fiber, &sensor, &wavelength_data);
+        // swap buffers with a free ring slot, nothing is copied
+        uint64_t complete_ns = latencySteady_ns();
+        metrics_add(device->metrics->sweeps_received, 1);
+        metricsTime_add(&device->metrics->stages[METRICS_STAGE_RECV], complete_ns - device->frame_start_ns);
+        sweep_frame_t* slot = spscRing_acquire(device->ring);
+        if (slot == NULL) {
+            spscRing_overflow(device->ring);
+            device->dropped.fetch_add(1, std::memory_order_relaxed);
+            metrics_add(device->metrics->sweeps_dropped, 1);
+        }
+        else {
+            char* data = slot->data;
+            uint32_t capacity = slot->capacity;
+            slot->data = staging->data;
+            slot->capacity = staging->capacity;
+            slot->size = device->frame_size;
+            slot->sweep_type = staging->sweep_type;
+            slot->DO = staging->DO;
+            slot->DL = staging->DL;
+            slot->device = device->id;
+            slot->received_ns = complete_ns;
+            staging->data = data;
+            staging->capacity = capacity;
+            spscRing_publish(device->ring);
+            device->sweeps.fetch_add(1, std::memory_order_relaxed);
+        }
+        device->received = 0;
+        device->frame_size = 0;
+    }
+}
 
-                    uint8_t int_data[3] = { channel, fiber, sensor };
-                    char cBuffer[PACKET_SIZE];
-                    //memset(cBuffer, 0, PACKET_SIZE);
+void disconnectDevice(ingest_context_t* ingest, i4_device_t* device) {
+    printf("I4 #%u disconnected%s\n", device->id, ingest->reconnect ? ", reconnecting" : "");
+    if (!ingest->busy_poll) {
+        pollerRemove(&ingest->poller, device->hSocket, device->id);
+    }
+    closesocket(device->hSocket);
+    device->hSocket = INVALID_SOCKET;
+    device->connected = false;
+    sessionBackoff_failed(&device->backoff, sessionTime_ms());
+}
 
-                    memcpy(cBuffer, int_data, sizeof(int_data));
-                    memcpy(cBuffer + sizeof(int_data), &wavelength_data, sizeof(wavelength_data));
-                    send(hSocket, cBuffer, PACKET_SIZE, 0);
+/* returns 1 once the unit is connected again, 0 while it is not */
+int reconnectDevice(ingest_context_t* ingest, i4_device_t* device, uint64_t now_ms) {
+    int result;
+    if (device->pending == INVALID_SOCKET) {
+        if (!sessionBackoff_due(&device->backoff, now_ms)) {
+            return 0;
+        }
+        result = sessionConnect_start(device->address, device->port, &device->pending);
+        device->pending_since_ms = now_ms;
+    }
+    else {
+        result = sessionConnect_result(device->pending, 0);
+        if (result == 0 && now_ms - device->pending_since_ms >= SESSION_CONNECT_TIMEOUT_MS) {
+            result = -1;
+        }
+    }
+    if (result > 0 && ingest->busy_poll) {
+        socketSetNoDelay(device->pending);
+        socketSetBusyPoll(device->pending, LOW_LATENCY_BUSY_POLL_US);
+    }
+    else if (result > 0 && pollerAdd(&ingest->poller, device->pending, device->id) != 0) {
+        result = -1;
+    }
+    if (result < 0) {
+        if (device->pending != INVALID_SOCKET) {
+            closesocket(device->pending);
+            device->pending = INVALID_SOCKET;
+        }
+        sessionBackoff_failed(&device->backoff, now_ms);
+        return 0;
+    }
+    if (result == 0) {
+        return 0;
+    }
 
-                    printf("Sent data %u - Channel#%u, Sensor#%u, Wavelength: %.5f nm\n",
-                        fiber, channel, sensor, wavelength_data);
+    // header-aligned restart : the frame cut on the old connection is dropped, the first byte starts a header
+    device->hSocket = device->pending;
+    device->pending = INVALID_SOCKET;
+    device->received = 0;
+    device->frame_size = 0;
+    device->resyncing = false;
+    streamReconnected(&device->stream);
+    device->connected = true;
+    printf("I4 #%u reconnected after %u attempts\n", device->id, device->backoff.failures);
+    sessionBackoff_init(&device->backoff);
+    return 1;
+}
 
-                }
-            }
+/* returns the number of units connected again */
+uint32_t reconnectDevices(ingest_context_t* ingest) {
+    uint64_t now_ms = sessionTime_ms();
+    uint32_t reconnected = 0;
+    for (uint32_t d = 0; d < ingest->device_count; d++) {
+        if (!ingest->devices[d].connected) {
+            reconnected += (uint32_t)reconnectDevice(ingest, &ingest->devices[d], now_ms);
         }
+    }
+    return reconnected;
+}
 
-        /* 3. Receiving flag packet */
-        char buffer_flag[FLAG_SIZE] = { 0 };
-        int fbytesRead = recv(hSocket_I4, buffer_flag, FLAG_SIZE, 0);
+void ingestThread(ingest_context_t* ingest) {
+    uint32_t connected = ingest->device_count;
+    uint32_t keys[POLLER_MAX_EVENTS];
+    pinThread("Ingest", ingest->core);
 
-        if (fbytesRead == SOCKET_ERROR) {
-            perror("Flag receive failed");
+    while (ingest->busy_poll && ingest->running.load(std::memory_order_relaxed) && (connected > 0 || ingest->reconnect)) {
+        if (connected < ingest->device_count && ingest->reconnect) {
+            connected += reconnectDevices(ingest);
         }
-        else if (fbytesRead == 0) {
-            printf("Client disconnected\n");
+        // every unit in turn, a sweep is picked up as soon as its last byte is in
+        for (uint32_t d = 0; d < ingest->device_count; d++) {
+            i4_device_t* device = &ingest->devices[d];
+            if (!device->connected || receiveDeviceData(device) > 0) {
+                continue;
+            }
+            disconnectDevice(ingest, device);
+            connected--;
+        }
+        std::this_thread::yield();
+    }
+    while (!ingest->busy_poll && ingest->running.load(std::memory_order_relaxed) && (connected > 0 || ingest->reconnect)) {
+        if (connected < ingest->device_count && ingest->reconnect) {
+            connected += reconnectDevices(ingest);
+        }
+        // shorter waits while a unit reconnects, its attempts are polled between them
+        int ready = pollerWait(&ingest->poller, keys, POLLER_MAX_EVENTS,
+            connected < ingest->device_count && ingest->reconnect ? SESSION_POLL_MS : FANIN_POLL_TIMEOUT_MS);
+        if (ready < 0) {
+            fprintf(stderr, "Polling the I4 sockets failed.\n");
+            break;
         }
 
+        for (int r = 0; r < ready; r++) {
+            i4_device_t* device = &ingest->devices[keys[r]];
+            if (!device->connected) {
+                continue; // completion of a socket closed earlier
+            }
+            int result = receiveDeviceData(device);
+            if (result > 0 && pollerRearm(&ingest->poller, keys[r]) == 0) {
+                continue;
+            }
+            disconnectDevice(ingest, device);
+            connected--;
+        }
     }
 
-    // Close TCP/IP communication
-    WSACleanup();
+    ingest->running = false;
+}
 
+/* returns 0, or -1 if the I4 refused the setting (the stream keeps its previous rate) */
+int setDeviceDownsampling(management_context_t* management, uint32_t d, uint32_t downsampling) {
+    downsampling = downsampling < 1 ? 1 : downsampling > MANAGEMENT_MAX_DOWNSAMPLING ? MANAGEMENT_MAX_DOWNSAMPLING : downsampling;
+    if (downsampling == management->downsampling[d]) {
+        return 0;
+    }
+    if (managementSetDownsampling(&management->units[d], downsampling) != 0) {
+        return -1;
+    }
+    // sweeps sent before the change may still count one gap of the old step
+    management->devices[d].sweep_step = downsampling;
+    management->downsampling[d] = downsampling;
+    printf("I4 #%u : every %u sweeps sent (%.1f Hz)\n", d, downsampling, management->sampling_hz[d] / downsampling);
     return 0;
 }
 
+void managementThread(management_context_t* management) {
+    uint64_t last_dropped[FANIN_MAX_DEVICES];
+    uint32_t calm[FANIN_MAX_DEVICES];
+    for (uint32_t d = 0; d < management->device_count; d++) {
+        last_dropped[d] = management->devices[d].dropped.load(std::memory_order_relaxed);
+        calm[d] = 0;
+    }
+    std::chrono::steady_clock::time_point adapt_time = std::chrono::steady_clock::now();
+    while (management->running.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(MANAGEMENT_POLL_MS));
+
+        int steps = management->step_request.exchange(0);
+        for (; steps != 0; steps += steps < 0 ? 1 : -1) {
+            for (uint32_t d = 0; d < management->device_count; d++) {
+                uint32_t current = management->downsampling[d];
+                if (setDeviceDownsampling(management, d, steps < 0 ? current / 2 : current * 2) == 0) {
+                    management->base[d] = management->downsampling[d]; // adapt= starts from the chosen rate
+                }
+            }
+        }
 
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (management->config.adapt_max == 0 || now - adapt_time < std::chrono::milliseconds(MANAGEMENT_ADAPT_INTERVAL_MS)) {
+            continue;
+        }
+        adapt_time = now;
+        for (uint32_t d = 0; d < management->device_count; d++) {
+            uint64_t dropped = management->devices[d].dropped.load(std::memory_order_relaxed);
+            uint32_t current = management->downsampling[d];
+            if (dropped != last_dropped[d]) {
+                // the workers can't keep up : fewer sweeps from the source
+                calm[d] = 0;
+                if (current < management->config.adapt_max) {
+                    uint32_t raised = current * 2 > management->config.adapt_max ? management->config.adapt_max : current * 2;
+                    setDeviceDownsampling(management, d, raised);
+                }
+            }
+            else if (++calm[d] >= MANAGEMENT_ADAPT_CALM_INTERVALS && current > management->base[d]) {
+                calm[d] = 0;
+                setDeviceDownsampling(management, d, current / 2 < management->base[d] ? management->base[d] : current / 2);
+            }
+            last_dropped[d] = dropped;
+        }
+    }
+}
 
-/* =============================================================================
-* Function Descriptions :
-* ------------------------------------------------------------------------------
-* processPacket_Header : Extracts packet header info(counter, type, offset, length).
-* processPacket_tsPayload : Extracts timestamp payload info(channel, fiber, sensor, wavelength).
-* processPacket_Payload : Extracts peak payload info(channel, fiber, sensor, wavelength).
-* processPacket_errorPayload : Processes error payload and provides error details.
-* wavelength : Extracts wavelength in meters from peak data.
-* channel_id, fiber_id, sensor_id : Extract respective IDs from peak data.
-* time_stamp : Extracts time stamp in seconds from peak data.
-* ==============================================================================
-*/
-
-int processPacket_Header(char* buffer_header, int* sweep_type, int* DO, int* DL) {
-    struct I4PacketHeader* header = (struct I4PacketHeader*)(buffer_header);
+void initForwarder(forwarder_t* forwarder, struct server_session_t* server, std::mutex* send_lock, int forward_mode, int compact_encoding,
+    uint32_t headroom, log_sink_t* log, struct calibration_table_t* calibration, struct calibration_table_t* unit_calibration,
+    struct spectral_detector_t* detector,
+    struct sweep_assembler_t* assembler, struct columnar_logger_t* loggers, struct publisher_t* publisher,
+    struct stats_engine_t* stats, uint32_t stats_interval, uint32_t tare_after, std::atomic<uint32_t>* tare_request,
+    struct force_filter_t* filters, struct spectral_reducer_t* reducer, struct publisher_t* spectra_publisher, struct metrics_slot_t* metrics,
+    struct shm_writer_t* shm) {
+    forwarder->server = server;
+    forwarder->send_lock = send_lock;
+    forwarder->forward_mode = forward_mode;
+    forwarder->compact_encoding = compact_encoding;
+    for (int d = 0; d < FANIN_MAX_DEVICES; d++) {
+        initCompactLayout(&forwarder->layout[d]);
+    }
+    initPeakBatch(&forwarder->peaks, FRAME_INITIAL_CAPACITY / PEAK_PAYLOAD_SIZE);
+    initForwardBuffer(&forwarder->forward, headroom);
+    forwarder->log = log;
+    forwarder->calibration = calibration;
+    forwarder->unit_calibration = unit_calibration;
+    forwarder->force = NULL;
+    forwarder->force_capacity = 0;
+    forwarder->detector = detector;
+    forwarder->assembler = assembler;
+    forwarder->loggers = loggers;
+    forwarder->publisher = publisher;
+    forwarder->shm = shm;
+    forwarder->stats = stats;
+    forwarder->stats_interval = stats_interval;
+    forwarder->tare_after = tare_after;
+    forwarder->tare_request = tare_request;
+    for (int d = 0; d < FANIN_MAX_DEVICES; d++) {
+        forwarder->tare_seen[d] = 0;
+    }
+    forwarder->filters = filters;
+    forwarder->reducer = reducer;
+    forwarder->spectra_publisher = spectra_publisher;
+    initForwardBuffer(&forwarder->reduced, 0);
+    forwarder->layout_generation = 0;
+    forwarder->server_generation = server->generation.load();
+    latencyHistogram_init(&forwarder->latency_i4);
+    latencyHistogram_init(&forwarder->latency_host);
+    forwarder->metrics = metrics;
+}
 
-    // Packet Header (bit field mask)
-    uint16_t packetCounterMask = 0xFFF; // lower 12 bits
-    uint16_t sweepingTypeMask = 0x7000; // middle 3 bits
-    uint16_t triggerModeMask = 0x8000;  // top 1 bit
+void freeForwarder(forwarder_t* forwarder) {
+    freePeakBatch(&forwarder->peaks);
+    freeForwardBuffer(&forwarder->forward);
+    freeForwardBuffer(&forwarder->reduced);
+    for (int d = 0; d < FANIN_MAX_DEVICES; d++) {
+        freeCompactLayout(&forwarder->layout[d]);
+    }
+    free(forwarder->force);
+    forwarder->force = NULL;
+    forwarder->force_capacity = 0;
+}
 
-    uint16_t packetCounter = header->info & packetCounterMask;
-    uint16_t sweepingType = (header->info & sweepingTypeMask) >> 12;
-    uint16_t triggerMode = (header->info & triggerModeMask) >> 15;
+/* returns 0, or -1 if the batch could not be allocated or sent */
+int forwardSweep(forwarder_t* forwarder, const sweep_frame_t* frame) {
+    peak_batch_t* peaks = &forwarder->peaks;
+    forward_buffer_t* forward = &forwarder->forward;
+    log_sink_t* log = forwarder->log;
+    struct metrics_slot_t* metrics = forwarder->metrics;
+    uint64_t start_ns = latencySteady_ns();
+
+    /* 1. Processing error payload (DO > 16 if error exists..) */
+    uint32_t error_count = 0;
+    for (uint32_t off = HEADER_SIZE; off + ERROR_PAYLOAD_SIZE <= frame->DO; off += ERROR_PAYLOAD_SIZE) {
+        logSink_error(log, frame->data + off);
+        metricsError_add(metrics, frame->data + off);
+        error_count++;
+    }
 
-    uint16_t dataOffset = header->dataOffset; // 0~65535 byte offset
-    uint32_t dataLength = header->dataLength; // bytes
-    uint32_t totalPacketSize = dataOffset + dataLength + 8;
+    /* 2. Processing payload packet (peaks from the I4, or detected on its spectra) */
+    int payload_size = 0;
+    if (frame->sweep_type == SWEEP_TYPE_PEAK) {
+        payload_size = PEAK_PAYLOAD_SIZE;
+    }
+    else if (frame->sweep_type == SWEEP_TYPE_TSPEAK) {
+        payload_size = TSPEAK_PAYLOAD_SIZE;
+    }
+    else if (frame->sweep_type != SWEEP_TYPE_SPECTRAL || forwarder->detector == NULL) {
+        return 0;
+    }
 
-    *sweep_type = sweepingType;
-    *DO = dataOffset;
-    *DL = dataLength;
+    struct i4_header_info_t header;
+    processPacket_HeaderInfo(frame->data, &header);
+    struct I4PacketFlag flag;
+    memcpy(&flag, frame->data + frame->DO + frame->DL, sizeof(flag));
+    beginForwardBatch(forward, frame->device, flag.sweep_counter);
+
+    uint32_t peak_count;
+    if (payload_size == 0) {
+        int detected = detectSpectralPeaks(forwarder->detector, frame->data + frame->DO, frame->DL, peaks);
+        if (detected < 0) {
+            logSink_text(log, "Spectral sweep %u skipped (malformed payload)", flag.sweep_counter);
+            return 0;
+        }
+        peak_count = (uint32_t)detected;
+    }
+    else {
+        peak_count = frame->DL / payload_size;
+        if (reservePeakBatch(peaks, peak_count) != 0) {
+            return -1;
+        }
+        decodeSweepPeaks(frame->sweep_type, frame->data + frame->DO, frame->DL, peaks); // specialised per sweep type
+    }
+    metrics_add(metrics->peaks_decoded, peak_count);
+    if (forwarder->stats != NULL) {
+        updateSensorStats(forwarder, frame->device, flag.sweep_counter);
+    }
 
-    return 0;
-}
+    // forwarded value : force [mN] if calibrated, else wavelength [nm]
+    double* value = peaks->wavelength;
+    if (forwarder->calibration != NULL) {
+        if (peak_count > forwarder->force_capacity) {
+            double* grown = (double*)realloc(forwarder->force, peak_count * sizeof(double));
+            if (grown == NULL) {
+                return -1;
+            }
+            forwarder->force = grown;
+            forwarder->force_capacity = peak_count;
+        }
+        calibrationForce_batch(forwarderCalibration(forwarder, frame->device), peaks, forwarder->force);
+        value = forwarder->force;
+    }
+    if (forwarder->loggers != NULL) {
+        if (columnarLog_append(&forwarder->loggers[frame->device], header.timeStamp, flag.sweep_counter, peaks, value) != 0) {
+            return -1;
+        }
+    }
+    // filtered in place, after the log : the forces, or the wavelengths of the batch without calibration
+    if (forwarder->filters != NULL && !forceFilter_apply(&forwarder->filters[frame->device], peaks, value)) {
+        return 0; // decimated away
+    }
+    if (forwarder->shm != NULL) {
+        // local consumers first : no system call between them and the decoded sweep
+        std::lock_guard<std::mutex> guard(*forwarder->send_lock);
+        shmWriter_publish(forwarder->shm, frame->device, frame->sweep_type, flag.sweep_counter, header.timeStamp, peaks, value);
+    }
 
-int processPacket_tsPayload(char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data) {
-    // 초기화
-    memset(channel, 0, sizeof(uint8_t));
-    memset(fiber, 0, sizeof(uint8_t));
-    memset(sensor, 0, sizeof(uint8_t));
-    memset(wavelength_data, 0, sizeof(double));
-    
-    struct ts_peak_payload_t* ts_payload = (struct ts_peak_payload_t*)(buffer_payload);
+    if (forwarder->forward_mode == FORWARD_MODE_COMPACT) {
+        // ids only go out again when the peak set changes (sensor lost / regained, ..)
+        struct compact_layout_t* layout = &forwarder->layout[frame->device];
+        forwarder->server_generation = forwarder->server->generation.load();
+        uint32_t generation = forwarder->server_generation
+            + (forwarder->publisher != NULL ? forwarder->publisher->generation.load() : 0);
+        if (generation != forwarder->layout_generation) {
+            // the main server reconnected, or it or a subscriber lost messages / joined : every unit's layout goes out again
+            forwarder->layout_generation = generation;
+            for (int d = 0; d < FANIN_MAX_DEVICES; d++) {
+                forwarder->layout[d].valid = 0;
+            }
+        }
+        beginForwardMessage(forward, frame->device);
+        if (!compactLayoutMatches(layout, peaks)) {
+            if (setCompactLayout(layout, peaks, value) != 0) {
+                return -1;
+            }
+            encodeCompactLayout(layout, forwarder->compact_encoding,
+                appendForwardBytes(forward, compactLayoutSize(peaks->count)));
+            if (forward->headroom > 0) {
+                // one unit id per message : the sweep message gets its own
+                appendForwardBytes(forward, FANIN_DEVICE_ID_SIZE)[0] = (char)frame->device;
+            }
+        }
+        encodeCompactSweep(layout, forwarder->compact_encoding, flag.sweep_counter, value,
+            appendForwardBytes(forward, compactSweepSize(peaks->count)));
+        if (forwarder->stats != NULL && forwarder->stats_interval > 0
+            && forwarder->stats[frame->device].sweeps % forwarder->stats_interval == 0) {
+            const struct stats_engine_t* stats = &forwarder->stats[frame->device];
+            if (forward->headroom > 0) {
+                appendForwardBytes(forward, FANIN_DEVICE_ID_SIZE)[0] = (char)frame->device;
+            }
+            encodeStatsMessage(stats, forwarderCalibration(forwarder, frame->device), flag.sweep_counter,
+                appendForwardBytes(forward, compactStatsSize(stats->count)));
+        }
+    }
+    if (forwarder->forward_mode == FORWARD_MODE_COMPACT || forwarder->forward_mode == FORWARD_MODE_FRAMES) {
+        for (uint32_t i = 0; logSink_enabled(log, LOG_LEVEL_PEAK) && i < peaks->count; i++) {
+            logSink_peak(log, peaks->channel[i], peaks->fiber[i], peaks->sensor[i], value[i]);
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < peaks->count; i++) {
+            uint8_t int_data[3] = { peaks->channel[i], peaks->fiber[i], peaks->sensor[i] };
+            char* cBuffer = appendForwardPacket(forward);
+
+            memcpy(cBuffer, int_data, sizeof(int_data));
+            memcpy(cBuffer + sizeof(int_data), &value[i], sizeof(double));
+            if (forwarder->forward_mode == FORWARD_MODE_LEGACY) {
+                if (forwarder->publisher == NULL) {
+                    if (serverSession_send(forwarder->server, cBuffer, PACKET_SIZE) != 0) {
+                        return -1;
+                    }
+                }
+                else {
+                    std::lock_guard<std::mutex> guard(*forwarder->send_lock);
+                    if (serverSession_send(forwarder->server, cBuffer, PACKET_SIZE) != 0) {
+                        return -1;
+                    }
+                    publisher_send(forwarder->publisher, cBuffer, PACKET_SIZE);
+                }
+            }
 
-    ts_peak_data_t peak_data;
-    peak_data[0] = ts_payload->ts_peak_payload_LSB;
-    peak_data[1] = ts_payload->ts_peak_payload_MSB;
-    peak_data[2] = ts_payload->time_stamp;
+            if (logSink_enabled(log, LOG_LEVEL_PEAK)) {
+                logSink_peak(log, peaks->channel[i], peaks->fiber[i], peaks->sensor[i], value[i]);
+            }
+        }
+    }
+    logSink_sweep(log, flag.sweep_counter, peaks->count, error_count);
+    if (forwarder->forward_mode == FORWARD_MODE_LEGACY) {
+        metrics_add(metrics->messages_sent, peaks->count); // sent one by one above, timed as part of the decode
+        metrics_add(metrics->bytes_sent, (uint64_t)peaks->count * PACKET_SIZE);
+    }
+    uint64_t send_ns = latencySteady_ns();
+    metricsTime_add(&metrics->stages[METRICS_STAGE_DECODE], send_ns - start_ns);
+
+    /* 3. Sending the whole sweep to main server (workers share the socket, one message at a time) */
+    if (forwarder->forward_mode == FORWARD_MODE_FRAMES) {
+        // frames are sent from the assembler as they complete, by whichever worker completes them
+        std::lock_guard<std::mutex> guard(*forwarder->send_lock);
+        forwarder->assembler->user = forwarder;
+        if (sweepAssembler_add(forwarder->assembler, frame->device, header.timeStamp, peaks, value,
+            frame->sweep_type == SWEEP_TYPE_TSPEAK) != 0) {
+            return -1;
+        }
+    }
+    else if (forwarder->forward_mode != FORWARD_MODE_LEGACY) {
+        std::lock_guard<std::mutex> guard(*forwarder->send_lock);
+        if (publishForward(forwarder) != 0) {
+            return -1;
+        }
+    }
+    uint64_t sent_ns = latencySteady_ns();
+    if (forwarder->forward_mode != FORWARD_MODE_LEGACY) {
+        metricsTime_add(&metrics->stages[METRICS_STAGE_SEND], sent_ns - send_ns); // frames : adding to the assembler, and the frames it completes
+    }
+    if (forwarder->forward_mode != FORWARD_MODE_FRAMES) {
+        latencyHistogram_add(&forwarder->latency_i4, header.timeStamp, latencyNow_ns());
+        latencyHistogram_add(&forwarder->latency_host, frame->received_ns, sent_ns);
+    }
 
-    *channel = channel_id(peak_data);
-    *fiber = fiber_id(peak_data);
-    *sensor = sensor_id(peak_data);
-    *wavelength_data = 1e9 * wavelength(peak_data); //nm
+    /* 4. Publishing the reduced spectra, after the peaks so they add nothing to their latency */
+    if (payload_size == 0 && forwarder->reducer != NULL) {
+        publishReducedSpectra(forwarder, frame->device, flag.sweep_counter, header.timeStamp);
+    }
 
     return 0;
 }
 
-int processPacket_Payload(char* buffer_payload, uint8_t* channel, uint8_t* fiber, uint8_t* sensor, double* wavelength_data) {
-    // 초기화
-    memset(channel, 0, sizeof(uint8_t));
-    memset(fiber, 0, sizeof(uint8_t));
-    memset(sensor, 0, sizeof(uint8_t));
-    memset(wavelength_data, 0, sizeof(double));
-    
-    struct peak_payload_t* payload = (struct peak_payload_t*)(buffer_payload);
+/* the spectra split by the detector on the sweep just forwarded, 'peaks' still holds its peaks */
+void publishReducedSpectra(forwarder_t* forwarder, uint8_t device, uint32_t sweep_counter, uint64_t timeStamp) {
+    struct spectral_detector_t* detector = forwarder->detector;
+    struct spectral_reducer_t* reducer = forwarder->reducer;
+    forward_buffer_t* reduced = &forwarder->reduced;
+    std::lock_guard<std::mutex> guard(*forwarder->send_lock); // publisher_send, one thread at a time
+    for (uint32_t s = 0; s < detector->spectrum_count; s++) {
+        const struct detector_spectrum_t* spectrum = &detector->spectra[s];
+        uint32_t range_count = reducerRanges(reducer, detector->config, spectrum, &forwarder->peaks);
+        for (uint32_t r = 0; r < range_count; r++) {
+            const struct reducer_range_t* range = &reducer->ranges[r];
+            uint32_t bins = (range->end - range->begin + reducer->config.factor - 1) / reducer->config.factor;
+            reduced->size = 0;
+            char* out = appendForwardBytes(reduced, reducedMessageSize(reducer->config.mode, bins));
+            encodeReducedSpectrum(reducer, detector->config, spectrum, range, device, sweep_counter, timeStamp, out);
+            publisher_send(forwarder->spectra_publisher, reduced->data, reduced->size); // one message per range
+        }
+    }
+}
 
-    peak_data_t peak_data;
-    peak_data[0] = payload->peak_payload_LSB;
-    peak_data[1] = payload->peak_payload_MSB;
+/* the calibration a unit's sweeps are converted with, NULL without calibration */
+struct calibration_table_t* forwarderCalibration(forwarder_t* forwarder, uint8_t device) {
+    return forwarder->unit_calibration != NULL ? &forwarder->unit_calibration[device] : forwarder->calibration;
+}
 
-    *channel = channel_id(peak_data);
-    *fiber = fiber_id(peak_data);
-    *sensor = sensor_id(peak_data);
-    *wavelength_data = 1e9 * wavelength(peak_data); //nm
+/* adds the decoded peaks to the unit's statistics, then tares its sensors if asked to */
+void updateSensorStats(forwarder_t* forwarder, uint8_t device, uint32_t sweep_counter) {
+    struct stats_engine_t* stats = &forwarder->stats[device];
+    statsEngine_add(stats, &forwarder->peaks);
+    if (forwarder->calibration == NULL) {
+        return;
+    }
+    uint32_t request = forwarder->tare_request->load();
+    if (request != forwarder->tare_seen[device] || stats->sweeps == forwarder->tare_after) {
+        forwarder->tare_seen[device] = request;
+        uint32_t rebased = statsTare(stats, forwarderCalibration(forwarder, device));
+        logSink_text(forwarder->log, "I4 #%u tared at sweep %u : %u sensors rebased", device, sweep_counter, rebased);
+    }
+}
 
+/* emit callback of the sweep assembler, 'user' is the forwarder adding the sweep */
+int sendAssembledFrame(const struct sweep_assembler_t* assembler, const struct assembled_frame_t* frame, void* user) {
+    forwarder_t* forwarder = (forwarder_t*)user;
+    forward_buffer_t* forward = &forwarder->forward;
+    forward->size = 0;
+    encodeFrameMessage(assembler, frame, appendForwardBytes(forward, frameMessageSize(frame)));
+    return publishForward(forwarder);
+}
+
+/* the forward buffer to the main server, then to the subscribers; called under send_lock, returns 0 or -1 */
+int publishForward(forwarder_t* forwarder) {
+    uint32_t generation = forwarder->forward_mode == FORWARD_MODE_COMPACT
+        ? forwarder->server_generation : forwarder->server->generation.load();
+    if (sendForwardBatch(forwarder->server, &forwarder->forward, generation) != 0) {
+        return -1;
+    }
+    metrics_add(forwarder->metrics->messages_sent, 1);
+    metrics_add(forwarder->metrics->bytes_sent, forwarder->forward.size);
+    if (forwarder->publisher != NULL) {
+        publisher_send(forwarder->publisher, forwarder->forward.data, forwarder->forward.size);
+    }
     return 0;
 }
 
-int processPacket_errorPayload(char* error_payload) {
-    struct error_payload_t* payload = (struct error_payload_t*)(error_payload);
-
-    peak_data_t data;
-    data[1] = payload->error_id;
-    data[0] = payload->error_description;
-
-    if (data[1] == 500) {
-        printf("Error type : Missing Peak\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source: No peak was detected where one was "
-            "expected from the interrogator configuration.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n"
-            "* disconnected sensor\n");
-    }
-    else if (data[1] == 501) {
-        printf("Error type : Multiple Peaks\n");
-        printf("Sensor #%u, Fiber #%u, Channel #%u\n",
-            sensor_id(data), fiber_id(data), channel_id(data));
-        printf("Error source : More than the expected number of peaks was "
-            "detected in the sensors wavelength range.\n"
-            "Possible causes include :\n"
-            "* Misconfiguration of sensor wavelength range or threshold\n");
+forward_worker_t* allocWorkers(uint32_t count) {
+    size_t bytes = count * sizeof(forward_worker_t);
+#ifdef _MSC_VER
+    void* storage = _aligned_malloc(bytes, alignof(forward_worker_t));
+#else
+    void* storage = NULL;
+    if (posix_memalign(&storage, alignof(forward_worker_t), bytes) != 0) {
+        storage = NULL;
     }
-    else {
-        printf("Error type : Internal Error\n");
-        printf("Error source: Internal error\n"
-            "Possible causes include :\n"
-            "* Transient mismatch of configuration and data stream\n"
-            "* Internal failure\n");
+#endif
+    if (storage == NULL) {
+        return NULL;
+    }
+    forward_worker_t* workers = (forward_worker_t*)storage;
+    for (uint32_t k = 0; k < count; k++) {
+        new (&workers[k]) forward_worker_t;
     }
+    return workers;
+}
 
-    return 0;
+void freeWorkers(forward_worker_t* workers, uint32_t count) {
+    for (uint32_t k = 0; k < count; k++) {
+        workers[k].~forward_worker_t();
+    }
+#ifdef _MSC_VER
+    _aligned_free(workers);
+#else
+    free(workers);
+#endif
 }
 
-/* extract wavelength value in meters */
-double wavelength(const uint32_t* const peak_data) {
-    uint32_t peak_value[2];
-    peak_value[0] = (peak_data[0] & ~0xffff) | 0x7fff; /* mask out id bits */
-    peak_value[1] = peak_data[1];
-    return *(double*)&peak_value;
+/* returns the number of sweeps forwarded, or -1 if forwarding failed */
+int forwardPending(forward_worker_t* worker) {
+    int forwarded = 0;
+    sweep_frame_t* frame;
+    metrics_set(worker->forwarder.metrics->ring_occupancy, spscRing_occupancy(&worker->ring));
+    metrics_set(worker->forwarder.metrics->ring_high_watermark, worker->ring.high_watermark.load(std::memory_order_relaxed));
+    while ((frame = spscRing_front(&worker->ring)) != NULL) {
+        int result = forwardSweep(&worker->forwarder, frame);
+        spscRing_pop(&worker->ring);
+        if (result != 0) {
+            return -1;
+        }
+        forwarded++;
+    }
+    return forwarded;
 }
 
-uint8_t channel_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 12) & 0x0f;
+void forwardWorkerThread(forward_worker_t* worker) {
+    pinThread("Worker", worker->core);
+    while (!worker->stop->load()) {
+        int forwarded = forwardPending(worker);
+        if (forwarded < 0) {
+            worker->stop->store(true);
+            break;
+        }
+        if (forwarded == 0) {
+            if (!worker->ingest_running->load()) {
+                if (forwardPending(worker) == 0) {
+                    break; // all I4 units disconnected and ring drained
+                }
+            }
+            else if (worker->busy_poll) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+}
+
+void printRingStats(const spsc_ring_t<sweep_frame_t>* ring, log_sink_t* log) {
+    spsc_ring_stats_t stats;
+    spscRing_stats(ring, &stats);
+    logSink_text(log, "Sweep ring : %u/%u slots used (max %u), %llu sweeps, %llu dropped",
+        stats.occupancy, stats.capacity, stats.high_watermark,
+        (unsigned long long)stats.published, (unsigned long long)stats.overflows);
+}
+
+void printDeviceStats(const i4_device_t* devices, uint32_t device_count, log_sink_t* log) {
+    if (device_count < 2) {
+        return; // same as the ring stats
+    }
+    for (uint32_t d = 0; d < device_count; d++) {
+        logSink_text(log, "I4 #%u (%s:%u) : %llu sweeps, %llu dropped", devices[d].id, devices[d].address, devices[d].port,
+            (unsigned long long)devices[d].sweeps.load(std::memory_order_relaxed),
+            (unsigned long long)devices[d].dropped.load(std::memory_order_relaxed));
+    }
+}
+
+void printLatencyStats(const forward_worker_t* workers, uint32_t worker_count) {
+    struct latency_histogram_t latency_i4, latency_host;
+    latencyHistogram_init(&latency_i4);
+    latencyHistogram_init(&latency_host);
+    for (uint32_t k = 0; k < worker_count; k++) {
+        latencyHistogram_merge(&latency_i4, &workers[k].forwarder.latency_i4);
+        latencyHistogram_merge(&latency_host, &workers[k].forwarder.latency_host);
+    }
+    latencyHistogram_print(&latency_i4, "Latency I4 timestamp -> sent");
+    latencyHistogram_print(&latency_host, "Latency received -> sent");
 }
 
-uint8_t fiber_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] >> 8) & 0x0f;
+void printReducerStats(const forward_worker_t* workers, uint32_t worker_count) {
+    uint64_t spectra = 0, messages = 0, bytes_in = 0, bytes_out = 0, dropped = 0;
+    for (uint32_t k = 0; k < worker_count; k++) {
+        const struct spectral_reducer_t* reducer = &workers[k].reducer;
+        spectra += reducer->spectra;
+        messages += reducer->messages;
+        bytes_in += reducer->bytes_in;
+        bytes_out += reducer->bytes_out;
+        dropped += reducer->dropped_ranges;
+    }
+    printf("Reduced spectra : %llu spectra in %llu messages, %llu -> %llu bytes (%.1f%%), %llu crop windows dropped\n",
+        (unsigned long long)spectra, (unsigned long long)messages, (unsigned long long)bytes_in, (unsigned long long)bytes_out,
+        bytes_in > 0 ? 100.0 * (double)bytes_out / (double)bytes_in : 0.0, (unsigned long long)dropped);
 }
 
-uint8_t sensor_id(const uint32_t* const peak_data) {
-    return (uint8_t)(peak_data[0] & 0xff);
+/* "2,3,5" : returns the number of cores read (at most max_cores), or 0 if 'text' is not such a list */
+int parseCoreList(const char* text, int* cores, int max_cores) {
+    int count = 0;
+    const char* next = text;
+    while (count < max_cores) {
+        char* end;
+        long core = strtol(next, &end, 10);
+        if (end == next || core < 0) {
+            return 0;
+        }
+        cores[count++] = (int)core;
+        if (*end == '\0') {
+            return count;
+        }
+        if (*end != ',') {
+            return 0;
+        }
+        next = end + 1;
+    }
+    return 0;
 }
 
-/* extract time stamp value in seconds */
-double time_stamp(const uint32_t* const peak_data) {
-    return (double)peak_data[2] * 5e-10;
+void pinThread(const char* name, int core) {
+    if (core < 0) {
+        return;
+    }
+    int result = threadPinCurrent(core);
+    if (result < 0) {
+        fprintf(stderr, "%s thread could not be pinned to core %d.\n", name, core);
+    }
+    else {
+        printf("%s thread on core %d%s\n", name, core, result > 0 ? " (priority not raised)" : ", raised priority");
+    }
 }
@@ -0,0 +1,111 @@
+"""
+File    : export_fbg_log.py
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Converts a columnar binary log of the client (-L, see src/common/columnar_logger.h) to CSV.
+
+Usage: python export_fbg_log.py <log file> [<csv file>]
+
+One CSV row per logged sweep : timestamp [ns], sweep counter, then one column per sensor
+(channel, fiber, sensor), wavelength [nm] or force [mN] as logged. Sensors missing in a
+sweep are left empty. Without <csv file> <log file>.csv is written.
+"""
+
+
+import struct
+import sys
+import csv
+import zlib
+import math
+from array import array
+
+
+LOG_HEADER_FORMAT = '<8sIBBH'
+LOG_MAGIC = b'FBGLOG01'
+CHUNK_HEADER_FORMAT = '<IIHBBQQII'
+CHUNK_MAGIC = 0x4B4E4843
+COMPRESSION_DEFLATE = 1
+UNITS = {0: 'nm', 1: 'mN'}
+
+
+def read_chunks(log_file):
+    # Yields (timestamps, sweep_counters, ids, columns) of every chunk
+    while True:
+        raw_header = log_file.read(struct.calcsize(CHUNK_HEADER_FORMAT))
+        if len(raw_header) == 0:
+            return
+        if len(raw_header) < struct.calcsize(CHUNK_HEADER_FORMAT):
+            raise ValueError("Truncated chunk header")
+        magic, rows, sensors, compression, _, first_ns, last_ns, raw_bytes, stored_bytes = \
+            struct.unpack(CHUNK_HEADER_FORMAT, raw_header)
+        if magic != CHUNK_MAGIC:
+            raise ValueError("Bad chunk magic")
+        payload = log_file.read(stored_bytes)
+        if len(payload) < stored_bytes:
+            raise ValueError("Truncated chunk")
+        if compression == COMPRESSION_DEFLATE:
+            payload = zlib.decompress(payload)
+        if len(payload) != raw_bytes:
+            raise ValueError("Chunk size mismatch")
+
+        offset = 0
+        timestamps = array('Q', payload[offset:offset + 8 * rows])
+        offset += 8 * rows
+        sweep_counters = array('I', payload[offset:offset + 4 * rows])
+        offset += 4 * rows
+        columns = []
+        for _ in range(sensors):
+            columns.append(array('f', payload[offset:offset + 4 * rows]))
+            offset += 4 * rows
+        ids = [tuple(payload[offset + 3 * s:offset + 3 * s + 3]) for s in range(sensors)]
+        if sys.byteorder != 'little':
+            for column in [timestamps, sweep_counters] + columns:
+                column.byteswap()
+        yield timestamps, sweep_counters, ids, columns
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: python export_fbg_log.py <log file> [<csv file>]")
+        return 1
+    log_path = sys.argv[1]
+    csv_path = sys.argv[2] if len(sys.argv) > 2 else log_path + '.csv'
+
+    with open(log_path, 'rb') as log_file:
+        magic, version, unit, device, _ = struct.unpack(LOG_HEADER_FORMAT, log_file.read(struct.calcsize(LOG_HEADER_FORMAT)))
+        if magic != LOG_MAGIC:
+            raise ValueError(f"{log_path} is not an FBG log")
+        data_start = log_file.tell()
+
+        # pass 1 : the sensors of all chunks, the sensor set may change from chunk to chunk
+        all_ids = set()
+        for _, _, ids, _ in read_chunks(log_file):
+            all_ids.update(ids)
+        all_ids = sorted(all_ids)
+        position = {sensor_id: k for k, sensor_id in enumerate(all_ids)}
+
+        # pass 2 : the rows
+        log_file.seek(data_start)
+        rows = 0
+        with open(csv_path, mode='w', newline='') as csv_file:
+            csv_writer = csv.writer(csv_file)
+            csv_writer.writerow(['Time [ns]', 'Sweep'] +
+                                [f"Channel {c} Fiber {f} Sensor {s} [{UNITS.get(unit, '?')}]" for c, f, s in all_ids])
+            for timestamps, sweep_counters, ids, columns in read_chunks(log_file):
+                slots = [position[sensor_id] for sensor_id in ids]
+                for r in range(len(timestamps)):
+                    row = [''] * len(all_ids)
+                    for slot, column in zip(slots, columns):
+                        value = column[r]
+                        if not math.isnan(value):
+                            row[slot] = f"{value:.8g}"  # float32 : ~0.1 pm at 1550 nm
+                    csv_writer.writerow([timestamps[r], sweep_counters[r]] + row)
+                rows += len(timestamps)
+
+    print(f"I4 #{device} : {rows} sweeps of {len(all_ids)} sensors written to {csv_path}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
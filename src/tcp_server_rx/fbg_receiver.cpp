@@ -0,0 +1,487 @@
+/*
+File    : fbg_receiver.cpp
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : C++11, shared library
+Protocol    : TCP/IP receiver of the main server, native side of fbg_receiver.py
+
+Receives what client_FBGs_data_tx forwards (11-byte packets, -b batches or -p compact v2, with
+or without the fan-in unit byte) on a native thread. Each recv() takes as much as the socket
+has (up to the receive buffer), whole messages are decoded in place and their peaks written as
+fixed 16-byte samples into a preallocated ring. Python maps the ring once as a NumPy structured
+array and gets each batch of new samples as a slice of it, so nothing is copied or unpacked
+under the GIL.
+
+Sample (little endian, 16 bytes) : uint8 device, channel, fiber, sensor, uint32 sweep counter
+(0 for 11-byte packets), double value (nm, or mN with a calibrated client; NaN if invalid).
+
+Build :
+    Windows : cl /O2 /EHsc /LD fbg_receiver.cpp ws2_32.lib
+    Linux   : g++ -std=c++11 -O2 -shared -fPIC -pthread fbg_receiver.cpp -o libfbg_receiver.so
+*/
+
+
+#include "../common/platform_socket.h"
+#ifdef _WIN32
+#define FBGRX_API extern "C" __declspec(dllexport)
+#else
+#define FBGRX_API extern "C" __attribute__((visibility("default")))
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "../common/fbg_compact_protocol.h"
+
+#define FBGRX_FORMAT_PACKET 0  // one 11-byte packet per peak
+#define FBGRX_FORMAT_BATCH 1   // client -b
+#define FBGRX_FORMAT_COMPACT 2 // client -p
+
+#define FBGRX_STATE_RUNNING 0
+#define FBGRX_STATE_CLOSED 1   // connection closed by the client
+#define FBGRX_STATE_ERROR -1   // recv failed or malformed message
+
+#define FBGRX_PACKET_SIZE 11   // uint8_t 3, double 1
+#define FBGRX_BATCH_HEADER_SIZE 6
+#define FBGRX_MAX_DEVICES 256  // fan-in unit byte
+#define FBGRX_DEFAULT_CAPACITY (1u << 20)
+#define FBGRX_RECV_BUFFER_SIZE (1024 * 1024)
+#define FBGRX_WAIT_MS 10
+
+struct fbg_sample_t {
+    uint8_t device;
+    uint8_t channel;
+    uint8_t fiber;
+    uint8_t sensor;
+    uint32_t sweep_counter;
+    double value;
+};
+
+I4_STATIC_ASSERT(sizeof(struct fbg_sample_t) == 16, "fbg_sample_t must be 16 bytes");
+
+// exported counters, same layout as FbgReceiverStats in fbg_receiver.py
+struct fbg_receiver_stats_t {
+    uint64_t bytes;
+    uint64_t messages;
+    uint64_t samples;
+    uint64_t layouts;      // compact layout messages
+    uint64_t ring_waits;   // receiver waited for Python to release samples
+    int32_t state;         // FBGRX_STATE_*
+    uint32_t capacity;     // ring samples
+};
+
+// last layout message of one unit (compact)
+struct fbg_rx_layout_t {
+    int encoding;
+    struct compact_layout_t entries; // ids and int32 bases
+};
+
+struct fbg_receiver_t {
+    SOCKET hSocket;
+    int format;
+    int fanin;
+
+    fbg_sample_t* samples;
+    uint32_t capacity;                // power of two
+    uint32_t mask;
+    std::atomic<uint64_t> head;       // samples written
+    std::atomic<uint64_t> tail;       // samples released by Python
+
+    char* buffer;                     // received bytes not decoded yet
+    uint32_t buffer_capacity;
+    uint32_t buffered;
+    fbg_rx_layout_t* layouts;         // [FBGRX_MAX_DEVICES]
+
+    std::mutex lock;
+    std::condition_variable changed;  // new samples / released samples / state
+    std::atomic<int> state;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    fbg_receiver_stats_t counters;    // owned by the receive thread
+    fbg_receiver_stats_t stats;       // copy of 'counters' under 'lock', for fbgrx_stats
+};
+
+int receiverReserve(fbg_receiver_t* rx, uint32_t count);
+int decodeMessage(fbg_receiver_t* rx, const char* data, uint32_t length, uint32_t* consumed);
+int decodePackets(fbg_receiver_t* rx, const char* data, uint32_t count, uint8_t device, uint32_t sweep_counter);
+int decodeCompactLayout(fbg_receiver_t* rx, const char* data, uint32_t length, uint8_t device, uint32_t* consumed);
+int decodeCompactSweep(fbg_receiver_t* rx, const char* data, uint32_t length, uint8_t device, uint32_t* consumed);
+void receiveThread(fbg_receiver_t* rx);
+
+
+/* =============================================================================
+* Function Descriptions :
+* ------------------------------------------------------------------------------
+* fbgrx_open, fbgrx_close : Take over a connected socket and start / stop the receive thread.
+* fbgrx_samples, fbgrx_capacity : Base address and size of the sample ring (mapped once by Python).
+* fbgrx_read : Waits up to timeout_ms for new samples, returns how many follow index 'first' without wrapping.
+* fbgrx_release : Gives samples back to the receive thread.
+* fbgrx_stats : Copies the counters.
+* receiverReserve : Waits until 'count' samples are free in the ring.
+* decodeMessage : Decodes the next whole message of the buffer, 0 if it is still incomplete.
+* decodePackets, decodeCompactLayout, decodeCompactSweep : Decode one message body into samples.
+* receiveThread : recv() into the buffer, decode all whole messages, keep the rest.
+* ==============================================================================
+*/
+
+/* socket : connected socket handle (Python socket.detach()), now owned by the receiver; returns NULL on failure */
+FBGRX_API fbg_receiver_t* fbgrx_open(uint64_t socket_handle, int format, int fanin, uint32_t capacity) {
+    if (format < FBGRX_FORMAT_PACKET || format > FBGRX_FORMAT_COMPACT || (fanin && format == FBGRX_FORMAT_PACKET)) {
+        fprintf(stderr, "Unsupported receiver format %d%s.\n", format, fanin ? " with fan-in" : "");
+        return NULL;
+    }
+    fbg_receiver_t* rx = new fbg_receiver_t;
+    rx->hSocket = (SOCKET)socket_handle;
+    rx->format = format;
+    rx->fanin = fanin;
+
+    uint32_t size = 1;
+    while (size < (capacity > 0 ? capacity : FBGRX_DEFAULT_CAPACITY)) {
+        size <<= 1;
+    }
+    rx->samples = (fbg_sample_t*)malloc((size_t)size * sizeof(fbg_sample_t));
+    rx->buffer = (char*)malloc(FBGRX_RECV_BUFFER_SIZE);
+    rx->layouts = new fbg_rx_layout_t[FBGRX_MAX_DEVICES];
+    if (rx->samples == NULL || rx->buffer == NULL) {
+        fprintf(stderr, "Receiver allocation failed.\n");
+        free(rx->samples);
+        free(rx->buffer);
+        delete[] rx->layouts;
+        delete rx;
+        return NULL;
+    }
+    rx->capacity = size;
+    rx->mask = size - 1;
+    rx->head.store(0);
+    rx->tail.store(0);
+    rx->buffer_capacity = FBGRX_RECV_BUFFER_SIZE;
+    rx->buffered = 0;
+    for (int d = 0; d < FBGRX_MAX_DEVICES; d++) {
+        rx->layouts[d].encoding = COMPACT_ENCODING_FLOAT32;
+        initCompactLayout(&rx->layouts[d].entries);
+    }
+    memset(&rx->counters, 0, sizeof(rx->counters));
+    rx->counters.capacity = size;
+    rx->stats = rx->counters;
+    rx->state.store(FBGRX_STATE_RUNNING);
+    rx->running.store(true);
+    rx->thread = std::thread(receiveThread, rx);
+    return rx;
+}
+
+FBGRX_API void fbgrx_close(fbg_receiver_t* rx) {
+    rx->running.store(false);
+    shutdown(rx->hSocket, SD_BOTH); // wakes a blocking recv()
+    {
+        std::lock_guard<std::mutex> guard(rx->lock);
+        rx->changed.notify_all();
+    }
+    rx->thread.join();
+    closesocket(rx->hSocket);
+    for (int d = 0; d < FBGRX_MAX_DEVICES; d++) {
+        freeCompactLayout(&rx->layouts[d].entries);
+    }
+    delete[] rx->layouts;
+    free(rx->samples);
+    free(rx->buffer);
+    delete rx;
+}
+
+FBGRX_API fbg_sample_t* fbgrx_samples(fbg_receiver_t* rx) {
+    return rx->samples;
+}
+
+FBGRX_API uint32_t fbgrx_capacity(fbg_receiver_t* rx) {
+    return rx->capacity;
+}
+
+/* returns the number of contiguous new samples from ring index *first (0 on timeout),
+   or -1 once the connection is gone and every sample has been read */
+FBGRX_API int32_t fbgrx_read(fbg_receiver_t* rx, int32_t timeout_ms, uint64_t* first) {
+    uint64_t tail = rx->tail.load(std::memory_order_relaxed);
+    uint64_t head = rx->head.load(std::memory_order_acquire);
+    if (head == tail) {
+        std::unique_lock<std::mutex> guard(rx->lock);
+        rx->changed.wait_for(guard, std::chrono::milliseconds(timeout_ms), [rx, tail] {
+            return rx->head.load(std::memory_order_acquire) != tail || rx->state.load() != FBGRX_STATE_RUNNING;
+        });
+        head = rx->head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return rx->state.load() != FBGRX_STATE_RUNNING ? -1 : 0;
+        }
+    }
+    uint32_t start = (uint32_t)(tail & rx->mask);
+    uint64_t available = head - tail;
+    uint32_t to_end = rx->capacity - start;
+    *first = start;
+    return (int32_t)(available < to_end ? available : to_end);
+}
+
+FBGRX_API void fbgrx_release(fbg_receiver_t* rx, uint32_t count) {
+    uint64_t tail = rx->tail.load(std::memory_order_relaxed) + count;
+    uint64_t head = rx->head.load(std::memory_order_acquire);
+    rx->tail.store(tail > head ? head : tail, std::memory_order_release);
+    std::lock_guard<std::mutex> guard(rx->lock);
+    rx->changed.notify_all();
+}
+
+FBGRX_API void fbgrx_stats(fbg_receiver_t* rx, fbg_receiver_stats_t* stats) {
+    std::lock_guard<std::mutex> guard(rx->lock);
+    *stats = rx->stats;
+    stats->state = rx->state.load();
+}
+
+/* returns 0, or -1 if the receiver is being closed */
+int receiverReserve(fbg_receiver_t* rx, uint32_t count) {
+    if (count > rx->capacity) {
+        return -1;
+    }
+    uint64_t head = rx->head.load(std::memory_order_relaxed);
+    if (head + count - rx->tail.load(std::memory_order_acquire) <= rx->capacity) {
+        return 0;
+    }
+    // Python is behind : TCP flow control slows the client down instead of dropping samples
+    std::unique_lock<std::mutex> guard(rx->lock);
+    rx->counters.ring_waits++;
+    while (head + count - rx->tail.load(std::memory_order_acquire) > rx->capacity) {
+        if (!rx->running.load()) {
+            return -1;
+        }
+        rx->changed.wait_for(guard, std::chrono::milliseconds(FBGRX_WAIT_MS));
+    }
+    return 0;
+}
+
+/* 'data' : 'count' 11-byte packets */
+int decodePackets(fbg_receiver_t* rx, const char* data, uint32_t count, uint8_t device, uint32_t sweep_counter) {
+    if (receiverReserve(rx, count) != 0) {
+        return -1;
+    }
+    uint64_t head = rx->head.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++, data += FBGRX_PACKET_SIZE) {
+        fbg_sample_t* sample = &rx->samples[(head + i) & rx->mask];
+        sample->device = device;
+        sample->channel = (uint8_t)data[0];
+        sample->fiber = (uint8_t)data[1];
+        sample->sensor = (uint8_t)data[2];
+        sample->sweep_counter = sweep_counter;
+        memcpy(&sample->value, data + 3, sizeof(double));
+    }
+    rx->head.store(head + count, std::memory_order_release);
+    rx->counters.samples += count;
+    return 0;
+}
+
+/* 'data' starts at the type byte; returns 0 (*consumed = 0 if incomplete) or -1 if malformed */
+int decodeCompactLayout(fbg_receiver_t* rx, const char* data, uint32_t length, uint8_t device, uint32_t* consumed) {
+    if (length < COMPACT_LAYOUT_HEADER_SIZE) {
+        return 0;
+    }
+    struct compact_layout_header_t header;
+    memcpy(&header, data, sizeof(header));
+    uint32_t size = compactLayoutSize(header.count);
+    if (length < size) {
+        return 0;
+    }
+
+    fbg_rx_layout_t* layout = &rx->layouts[device];
+    struct compact_layout_t* entries = &layout->entries;
+    if (header.count > entries->capacity) {
+        uint8_t* channel = (uint8_t*)realloc(entries->channel, header.count);
+        if (channel != NULL) entries->channel = channel;
+        uint8_t* fiber = (uint8_t*)realloc(entries->fiber, header.count);
+        if (fiber != NULL) entries->fiber = fiber;
+        uint8_t* sensor = (uint8_t*)realloc(entries->sensor, header.count);
+        if (sensor != NULL) entries->sensor = sensor;
+        double* base = (double*)realloc(entries->base, header.count * sizeof(double));
+        if (base != NULL) entries->base = base;
+        if (channel == NULL || fiber == NULL || sensor == NULL || base == NULL) {
+            return -1;
+        }
+        entries->capacity = header.count;
+    }
+    const char* entry = data + COMPACT_LAYOUT_HEADER_SIZE;
+    for (uint32_t i = 0; i < header.count; i++, entry += COMPACT_LAYOUT_ENTRY_SIZE) {
+        struct compact_layout_entry_t e;
+        memcpy(&e, entry, sizeof(e));
+        entries->channel[i] = e.channel;
+        entries->fiber[i] = e.fiber;
+        entries->sensor[i] = e.sensor;
+        entries->base[i] = e.base;
+    }
+    entries->count = header.count;
+    entries->valid = 1;
+    layout->encoding = header.encoding;
+    rx->counters.layouts++;
+    *consumed = size;
+    return 0;
+}
+
+int decodeCompactSweep(fbg_receiver_t* rx, const char* data, uint32_t length, uint8_t device, uint32_t* consumed) {
+    if (length < COMPACT_SWEEP_HEADER_SIZE) {
+        return 0;
+    }
+    struct compact_sweep_header_t header;
+    memcpy(&header, data, sizeof(header));
+    uint32_t size = compactSweepSize(header.count);
+    if (length < size) {
+        return 0;
+    }
+    fbg_rx_layout_t* layout = &rx->layouts[device];
+    if (!layout->entries.valid || layout->entries.count != header.count) {
+        fprintf(stderr, "Sweep of %u values without a matching layout (I4 #%u).\n", header.count, device);
+        return -1;
+    }
+    if (receiverReserve(rx, header.count) != 0) {
+        return -1;
+    }
+
+    const struct compact_layout_t* entries = &layout->entries;
+    const char* value = data + COMPACT_SWEEP_HEADER_SIZE;
+    uint64_t head = rx->head.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < header.count; i++, value += COMPACT_VALUE_SIZE) {
+        fbg_sample_t* sample = &rx->samples[(head + i) & rx->mask];
+        sample->device = device;
+        sample->channel = entries->channel[i];
+        sample->fiber = entries->fiber[i];
+        sample->sensor = entries->sensor[i];
+        sample->sweep_counter = header.sweep_counter;
+        if (layout->encoding == COMPACT_ENCODING_INT32) {
+            int32_t offset;
+            memcpy(&offset, value, sizeof(offset));
+            sample->value = offset == COMPACT_INT32_INVALID ? NAN : entries->base[i] + offset / COMPACT_INT32_SCALE;
+        }
+        else {
+            float v;
+            memcpy(&v, value, sizeof(v));
+            sample->value = v;
+        }
+    }
+    rx->head.store(head + header.count, std::memory_order_release);
+    rx->counters.samples += header.count;
+    *consumed = size;
+    return 0;
+}
+
+/* returns 0 (*consumed = 0 if the message is incomplete) or -1 if malformed / closing */
+int decodeMessage(fbg_receiver_t* rx, const char* data, uint32_t length, uint32_t* consumed) {
+    *consumed = 0;
+    uint32_t prefix = rx->fanin ? 1 : 0;
+    if (length < prefix + 1) {
+        return 0;
+    }
+    uint8_t device = rx->fanin ? (uint8_t)data[0] : 0;
+    const char* body = data + prefix;
+    uint32_t available = length - prefix;
+    uint32_t size = 0;
+    int result = 0;
+
+    if (rx->format == FBGRX_FORMAT_PACKET) {
+        // as many whole packets as there are : one "message" per recv()
+        uint32_t count = available / FBGRX_PACKET_SIZE;
+        if (count > rx->capacity) {
+            count = rx->capacity;
+        }
+        if (count > 0) {
+            result = decodePackets(rx, body, count, 0, 0);
+            size = count * FBGRX_PACKET_SIZE;
+        }
+    }
+    else if (rx->format == FBGRX_FORMAT_BATCH) {
+        if (available < FBGRX_BATCH_HEADER_SIZE) {
+            return 0;
+        }
+        uint32_t sweep_counter;
+        uint16_t count;
+        memcpy(&sweep_counter, body, sizeof(sweep_counter));
+        memcpy(&count, body + sizeof(sweep_counter), sizeof(count));
+        if (available < FBGRX_BATCH_HEADER_SIZE + (uint32_t)count * FBGRX_PACKET_SIZE) {
+            return 0;
+        }
+        result = decodePackets(rx, body + FBGRX_BATCH_HEADER_SIZE, count, device, sweep_counter);
+        size = FBGRX_BATCH_HEADER_SIZE + (uint32_t)count * FBGRX_PACKET_SIZE;
+    }
+    else if ((uint8_t)body[0] == COMPACT_MSG_LAYOUT) {
+        result = decodeCompactLayout(rx, body, available, device, &size);
+    }
+    else if ((uint8_t)body[0] == COMPACT_MSG_SWEEP) {
+        result = decodeCompactSweep(rx, body, available, device, &size);
+    }
+    else if ((uint8_t)body[0] == COMPACT_MSG_STATS) {
+        // sensor statistics (client -T) carry no samples, skipped whole
+        if (available < COMPACT_STATS_HEADER_SIZE) {
+            return 0;
+        }
+        struct compact_sweep_header_t header;
+        memcpy(&header, body, sizeof(header));
+        size = compactStatsSize(header.count);
+        if (available < size) {
+            return 0;
+        }
+    }
+    else {
+        fprintf(stderr, "Unknown compact message type %#x.\n", (uint8_t)body[0]);
+        return -1;
+    }
+
+    if (result == 0 && size > 0) {
+        *consumed = prefix + size;
+        rx->counters.messages++;
+    }
+    return result;
+}
+
+void receiveThread(fbg_receiver_t* rx) {
+    int state = FBGRX_STATE_CLOSED;
+    while (rx->running.load()) {
+        if (rx->buffered == rx->buffer_capacity) {
+            // one message larger than the buffer
+            char* grown = (char*)realloc(rx->buffer, (size_t)rx->buffer_capacity * 2);
+            if (grown == NULL) {
+                state = FBGRX_STATE_ERROR;
+                break;
+            }
+            rx->buffer = grown;
+            rx->buffer_capacity *= 2;
+        }
+        int bytesReceived = recv(rx->hSocket, rx->buffer + rx->buffered, (int)(rx->buffer_capacity - rx->buffered), 0);
+        if (bytesReceived <= 0) {
+            state = bytesReceived == 0 || !rx->running.load() ? FBGRX_STATE_CLOSED : FBGRX_STATE_ERROR;
+            break;
+        }
+        rx->buffered += (uint32_t)bytesReceived;
+        rx->counters.bytes += (uint64_t)bytesReceived;
+
+        uint32_t offset = 0, consumed = 0;
+        int result = 0;
+        while ((result = decodeMessage(rx, rx->buffer + offset, rx->buffered - offset, &consumed)) == 0 && consumed > 0) {
+            offset += consumed;
+        }
+        if (result != 0) {
+            state = rx->running.load() ? FBGRX_STATE_ERROR : FBGRX_STATE_CLOSED;
+            break;
+        }
+        // keep the incomplete message for the next recv()
+        memmove(rx->buffer, rx->buffer + offset, rx->buffered - offset);
+        rx->buffered -= offset;
+
+        std::lock_guard<std::mutex> guard(rx->lock);
+        rx->stats = rx->counters;
+        rx->changed.notify_all();
+    }
+
+    std::lock_guard<std::mutex> guard(rx->lock);
+    rx->stats = rx->counters;
+    rx->state.store(state);
+    rx->changed.notify_all();
+}
@@ -0,0 +1,110 @@
+"""
+File    : fbg_receiver.py
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 14, 2026
+Description : Python bindings (ctypes) of the native receiver fbg_receiver.cpp
+
+The native side receives and decodes on its own thread into a preallocated ring of 16-byte
+samples. The ring is mapped once as a NumPy structured array (SAMPLE_DTYPE); read() returns
+the newest samples as a slice of it, without copying. The slice stays valid until release().
+
+    receiver = FbgReceiver(client_socket, FORMAT_COMPACT, fanin=False)
+    while True:
+        samples = receiver.read()          # None once the client is gone
+        if samples is None:
+            break
+        ... samples['value'], samples['channel'], ...
+        receiver.release(len(samples))
+    receiver.close()
+
+The library is looked up next to this file (fbg_receiver.dll / libfbg_receiver.so), or at
+the path given in FBG_RECEIVER_LIB; see fbg_receiver.cpp for the build commands.
+"""
+
+
+import ctypes
+import os
+import sys
+import numpy as np
+
+
+FORMAT_PACKET = 0   # one 11-byte packet per peak
+FORMAT_BATCH = 1    # client -b
+FORMAT_COMPACT = 2  # client -p
+
+STATE_RUNNING = 0
+STATE_CLOSED = 1
+STATE_ERROR = -1
+
+DEFAULT_CAPACITY = 1 << 20
+DEFAULT_TIMEOUT_MS = 100
+
+SAMPLE_DTYPE = np.dtype([('device', 'u1'), ('channel', 'u1'), ('fiber', 'u1'), ('sensor', 'u1'),
+                         ('sweep_counter', '<u4'), ('value', '<f8')])
+
+
+class FbgReceiverStats(ctypes.Structure):
+    _fields_ = [('bytes', ctypes.c_uint64), ('messages', ctypes.c_uint64), ('samples', ctypes.c_uint64),
+                ('layouts', ctypes.c_uint64), ('ring_waits', ctypes.c_uint64),
+                ('state', ctypes.c_int32), ('capacity', ctypes.c_uint32)]
+
+
+def load_library(path=None):
+    if path is None:
+        path = os.environ.get('FBG_RECEIVER_LIB')
+    if path is None:
+        name = 'fbg_receiver.dll' if sys.platform == 'win32' else 'libfbg_receiver.so'
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+    library = ctypes.CDLL(path)
+    library.fbgrx_open.restype = ctypes.c_void_p
+    library.fbgrx_open.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.c_int, ctypes.c_uint32]
+    library.fbgrx_close.restype = None
+    library.fbgrx_close.argtypes = [ctypes.c_void_p]
+    library.fbgrx_samples.restype = ctypes.c_void_p
+    library.fbgrx_samples.argtypes = [ctypes.c_void_p]
+    library.fbgrx_capacity.restype = ctypes.c_uint32
+    library.fbgrx_capacity.argtypes = [ctypes.c_void_p]
+    library.fbgrx_read.restype = ctypes.c_int32
+    library.fbgrx_read.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(ctypes.c_uint64)]
+    library.fbgrx_release.restype = None
+    library.fbgrx_release.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    library.fbgrx_stats.restype = None
+    library.fbgrx_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FbgReceiverStats)]
+    return library
+
+
+class FbgReceiver:
+    def __init__(self, sock, data_format, fanin=False, capacity=DEFAULT_CAPACITY, library_path=None):
+        self._library = load_library(library_path)
+        # the native side owns the socket from here on
+        self._rx = self._library.fbgrx_open(sock.detach(), data_format, int(fanin), capacity)
+        if not self._rx:
+            raise RuntimeError("Native receiver could not be started")
+        count = self._library.fbgrx_capacity(self._rx)
+        ring = (ctypes.c_uint8 * (count * SAMPLE_DTYPE.itemsize)).from_address(self._library.fbgrx_samples(self._rx))
+        self._samples = np.frombuffer(ring, dtype=SAMPLE_DTYPE)
+        self._first = ctypes.c_uint64()
+
+    def read(self, timeout_ms=DEFAULT_TIMEOUT_MS):
+        # Returns a view of the new samples (empty on timeout), or None once the stream has ended
+        count = self._library.fbgrx_read(self._rx, timeout_ms, ctypes.byref(self._first))
+        if count < 0:
+            return None
+        start = self._first.value
+        return self._samples[start:start + count]
+
+    def release(self, count):
+        # The samples of the last read() may be overwritten from now on
+        self._library.fbgrx_release(self._rx, count)
+
+    def stats(self):
+        stats = FbgReceiverStats()
+        self._library.fbgrx_stats(self._rx, ctypes.byref(stats))
+        return stats
+
+    def close(self):
+        if self._rx:
+            self._samples = None
+            self._library.fbgrx_close(self._rx)
+            self._rx = None
@@ -0,0 +1,176 @@
+"""
+File    : fbg_shm_reader.py
+Author  : Sooyeon Kim
+Date    : October 14, 2026
+Update  : October 15, 2026
+Description : Reader of the forwarder's shared-memory sweeps (client -H, src/common/shm_transport.h)
+
+The region is mapped read-only once; its header, snapshots and ring are NumPy views of the
+mapping (HEADER_DTYPE, RECORD_DTYPE), so reading a sweep is a copy of one record and no system
+call. Every record is behind a seqlock : it is copied between two reads of its 'sequence' and
+the copy is kept only if both are equal and even. CPython reads them in program order and x86
+does not reorder loads, which is what the seqlock needs on this side.
+
+    shm = FbgSharedMemory('fbg')
+    while True:
+        for sweep in shm.read():           # sweeps since the last read(), oldest first
+            peaks = sweep['peaks'][:sweep['count']]
+            ... peaks['value'], peaks['wavelength'], peaks['timestamp'], peaks['sensor'], ...
+        latest = shm.snapshot(0)           # newest sweep of I4 #0, or None
+    shm.close()
+
+On Linux the region is /dev/shm/<name>; on Windows the named file mapping <name>, which only
+exists while the forwarder runs. It is opened, never created (OpenFileMappingW) : a reader
+waiting for the forwarder must not take the name the forwarder is about to create.
+"""
+
+
+import mmap
+import sys
+import numpy as np
+
+
+MAGIC = b'FBGSHM01'
+VERSION = 1
+HEADER_SIZE = 128
+STATE_RUNNING = 1
+STATE_CLOSED = 2
+VALUE_WAVELENGTH = 0  # value [nm]
+VALUE_FORCE = 1       # value [mN]
+
+HEADER_DTYPE = np.dtype([('magic', 'S8'), ('version', '<u4'), ('header_size', '<u4'), ('record_size', '<u4'),
+                         ('max_peaks', '<u4'), ('devices', '<u4'), ('slots', '<u4'), ('snapshot_offset', '<u8'),
+                         ('ring_offset', '<u8'), ('total_size', '<u8'), ('value_kind', '<u4'), ('reserved', '<u4'),
+                         ('published', '<u8'), ('state', '<u4'), ('padding', '<u4'),
+                         ('truncated', '<u8'), ('tail', 'V40')])
+PEAK_DTYPE = np.dtype([('channel', 'u1'), ('fiber', 'u1'), ('sensor', 'u1'), ('reserved', 'V5'),
+                       ('wavelength', '<f8'), ('value', '<f8'), ('timestamp', '<f8')])
+
+
+def record_dtype(max_peaks):
+    return np.dtype([('sequence', '<u4'), ('sweep_counter', '<u4'), ('index', '<u8'), ('timestamp_ns', '<u8'),
+                     ('device', 'u1'), ('sweep_type', 'u1'), ('count', '<u2'), ('reserved', '<u4'),
+                     ('peaks', PEAK_DTYPE, (max_peaks,))])
+
+
+class WindowsMapping:
+    """Read view of an existing named file mapping; FileNotFoundError while it does not exist."""
+    FILE_MAP_READ = 0x0004
+
+    def __init__(self, name, size):
+        import ctypes
+        from ctypes import wintypes
+        kernel32 = ctypes.WinDLL('kernel32', use_last_error=True)
+        kernel32.OpenFileMappingW.restype = wintypes.HANDLE
+        kernel32.OpenFileMappingW.argtypes = [wintypes.DWORD, wintypes.BOOL, wintypes.LPCWSTR]
+        kernel32.MapViewOfFile.restype = ctypes.c_void_p
+        kernel32.MapViewOfFile.argtypes = [wintypes.HANDLE, wintypes.DWORD, wintypes.DWORD, wintypes.DWORD, ctypes.c_size_t]
+        kernel32.UnmapViewOfFile.argtypes = [ctypes.c_void_p]
+        kernel32.CloseHandle.argtypes = [wintypes.HANDLE]
+        self._kernel32 = kernel32
+        self._handle = kernel32.OpenFileMappingW(self.FILE_MAP_READ, False, name)
+        if not self._handle:
+            raise FileNotFoundError(ctypes.get_last_error(), f"no shared memory '{name}' (forwarder not running)")
+        self._address = kernel32.MapViewOfFile(self._handle, self.FILE_MAP_READ, 0, 0, size)
+        if not self._address:
+            error = ctypes.get_last_error()
+            kernel32.CloseHandle(self._handle)
+            raise OSError(error, f"can't map shared memory '{name}'")
+        self.view = (ctypes.c_char * size).from_address(self._address)
+
+    def close(self):
+        # the NumPy views on 'view' have to be dropped first
+        self.view = None
+        self._kernel32.UnmapViewOfFile(self._address)
+        self._kernel32.CloseHandle(self._handle)
+
+
+def map_region(name, size):
+    """returns (buffer, closable) of a read-only mapping of the region"""
+    if sys.platform == 'win32':
+        mapping = WindowsMapping(name, size)
+        return mapping.view, mapping
+    with open('/dev/shm/' + name.lstrip('/'), 'rb') as region:
+        mapping = mmap.mmap(region.fileno(), size, access=mmap.ACCESS_READ)
+        return mapping, mapping
+
+
+class FbgSharedMemory:
+    def __init__(self, name):
+        self.name = name
+        buffer, self._map = map_region(name, HEADER_SIZE)
+        header = np.frombuffer(buffer, dtype=HEADER_DTYPE, count=1).copy()[0]  # no view left on the small map
+        buffer = None
+        if header['magic'] != MAGIC or header['version'] != VERSION:
+            self._map.close()
+            raise ValueError(f"'{name}' is not a forwarder region (or not ready yet)")
+        size = int(header['total_size'])
+        self._map.close()
+        buffer, self._map = map_region(name, size)
+
+        self._header = np.frombuffer(buffer, dtype=HEADER_DTYPE, count=1)
+        self.max_peaks = int(self._header['max_peaks'][0])
+        self.devices = int(self._header['devices'][0])
+        self.slots = int(self._header['slots'][0])
+        self.value_kind = int(self._header['value_kind'][0])
+        self.record = record_dtype(self.max_peaks)
+        if self.record.itemsize != int(self._header['record_size'][0]):
+            raise ValueError("Record layout does not match the forwarder's")
+        self._snapshots = np.frombuffer(buffer, dtype=self.record, count=self.devices,
+                                        offset=int(self._header['snapshot_offset'][0]))
+        self._ring = np.frombuffer(buffer, dtype=self.record, count=self.slots,
+                                   offset=int(self._header['ring_offset'][0]))
+        self._next = self.published()  # from the newest sweep on
+        self.lost = 0
+        self.retries = 0
+
+    def published(self):
+        return int(self._header['published'][0])
+
+    def closed(self):
+        # the forwarder ended : open the name again to follow its next run
+        return int(self._header['state'][0]) == STATE_CLOSED
+
+    def _copy(self, records, k):
+        # seqlock copy of one record, None while the forwarder writes it
+        before = int(records['sequence'][k])
+        if before & 1:
+            return None
+        copy = records[k].copy()
+        if int(records['sequence'][k]) != before:
+            return None
+        return copy
+
+    def snapshot(self, device):
+        # newest sweep of one I4 unit, or None before its first one
+        if device >= self.devices:
+            return None
+        while True:
+            copy = self._copy(self._snapshots, device)
+            if copy is not None:
+                return copy if copy['sequence'] != 0 else None
+            self.retries += 1
+
+    def read(self, limit=None):
+        # copies of the sweeps published since the last call, oldest first
+        sweeps = []
+        while limit is None or len(sweeps) < limit:
+            published = self.published()
+            if self._next >= published:
+                break
+            if published - self._next > self.slots:
+                self.lost += published - self.slots - self._next
+                self._next = published - self.slots  # the oldest record still in the ring
+            copy = self._copy(self._ring, self._next % self.slots)
+            if copy is None:
+                self.retries += 1
+                continue
+            if int(copy['index']) != self._next:
+                continue  # overwritten by a later lap
+            sweeps.append(copy)
+            self._next += 1
+        return sweeps
+
+    def close(self):
+        self._header = self._snapshots = self._ring = None
+        self._map.close()
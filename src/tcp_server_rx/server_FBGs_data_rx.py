@@ -2,8 +2,10 @@
 File    : Server with data logging.py
 Author  : Sooyeon Kim
 Date    : September 17, 2023
-Update  : April 17, 2024
-Description : This script is a server program for receiving FBG sensor data over TCP/IP from a client. It also logs the data to a CSV file.
+Update  : October 14, 2026
+Description : This script is a server program for receiving FBG sensor data over TCP/IP from a client.
+Logging : every sample is logged by the client (-L, src/common/columnar_logger.h);
+export_fbg_log.py converts such a log to CSV.
 
 Protocol:
 - Each data packet is 11 bytes:
@@ -11,30 +13,93 @@ Protocol:
     - 2nd byte: Fiber number
     - 3rd byte: Sensor number (1 or 2)
     - Remaining 8 bytes: FBG data (double precision, 64-bit floating point)
+- Batch mode (--batch, client started with -b): one message per sweep
+    - 6-byte header: sweep counter (uint32), peak count (uint16)
+    - followed by peak count x 11-byte packets as above
+- Compact mode (--compact, client started with -p float32|int32): see src/common/fbg_compact_protocol.h
+    - layout message, once and whenever the sensor set changes:
+      'L', encoding (uint8), count (uint16), count x (channel, fiber, sensor, base double)
+    - sweep message: 'S', sweep counter (uint32), count (uint16), count x float32 value
+      or int32 offset from base in 1/1000 units (picometres)
+    - statistics message (client -T): 'T', sweep counter (uint32), count (uint16), count x (channel, fiber,
+      sensor, samples (uint32), mean, std, ewma, window min, window max, base [nm], force of the ewma [mN])
+- Fan-in (--fanin, client started with several -i): every batch or compact message is
+  preceded by one byte, the index of the I4 unit it came from; compact layouts are per unit
+- Frames mode (--frames, client started with -a): peaks of all units aligned into fixed-period
+  frames, see src/common/sweep_assembler.h; one message per frame:
+    'F', frame start ns (uint64), count (uint16),
+    count x (device, channel, fiber, sensor (uint8), offset in frame ns (int32), value double)
+- Native (--native, with the packet, --batch, --compact and --fanin formats): received and decoded
+  by the fbg_receiver.cpp library on its own thread, sweeps arrive here as NumPy views (fbg_receiver.py)
+- Subscriber (--subscribe <ip:port>, client started with -P <port>): connects to the client as one
+  more consumer instead of waiting for it, same formats as above
+- Shared memory (--shm <name>, client on the same PC started with -H <name>, and -N unless another
+  main server runs): every sweep is read from the client's shared-memory region (fbg_shm_reader.py),
+  no socket at all; the region is opened again when the client restarts
 """
 
 
 import socket
 import struct
-import time
-from datetime import datetime
 import threading
-import csv
-
+import time
+import sys
 
-csv_file_path = "C:/Users/user/Desktop/Data.csv"
 
 ### Setting for TCP/IP communication
 PORT = 4578
 FBG_PACKET_SIZE = 11
-
-server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-server_socket.bind(("0.0.0.0", PORT))
-server_socket.listen(1)  # Listen for incoming connections
-print("Server waiting for client connection...")
-
-client_socket, addr = server_socket.accept()  # Accept a connection from a client
-print(f"Connection from {addr}")
+BATCH_HEADER_SIZE = 6
+BATCH_MODE = "--batch" in sys.argv[1:]
+COMPACT_MODE = "--compact" in sys.argv[1:]
+FANIN_MODE = "--fanin" in sys.argv[1:]
+FRAMES_MODE = "--frames" in sys.argv[1:]
+NATIVE_MODE = "--native" in sys.argv[1:]
+SUBSCRIBE_ENDPOINT = sys.argv[sys.argv.index("--subscribe") + 1] if "--subscribe" in sys.argv[1:-1] else None
+SHM_NAME = sys.argv[sys.argv.index("--shm") + 1] if "--shm" in sys.argv[1:-1] else None
+SHM_POLL_S = 0.0002  # between two looks at an idle region
+SHM_OPEN_RETRY_S = 0.5
+if COMPACT_MODE or NATIVE_MODE:
+    import numpy as np  # only the compact decoder and the native receiver need numpy
+if SHM_NAME is not None:
+    from fbg_shm_reader import FbgSharedMemory, VALUE_FORCE
+if NATIVE_MODE:
+    if FRAMES_MODE:
+        sys.exit("--native does not decode --frames")
+    from fbg_receiver import FbgReceiver, FORMAT_PACKET, FORMAT_BATCH, FORMAT_COMPACT
+
+COMPACT_MSG_LAYOUT = 0x4C
+COMPACT_MSG_SWEEP = 0x53
+COMPACT_MSG_STATS = 0x54
+COMPACT_ENCODING_INT32 = 1
+COMPACT_INT32_SCALE = 1000.0
+COMPACT_INT32_INVALID = -2**31
+FRAME_MSG_TYPE = 0x46
+FRAME_HEADER_FORMAT = '<BQH'
+FRAME_ENTRY_FORMAT = '<BBBBid'
+COMPACT_LAYOUT_DTYPE = np.dtype([('channel', 'u1'), ('fiber', 'u1'), ('sensor', 'u1'), ('base', '<f8')]) if COMPACT_MODE else None
+COMPACT_STATS_DTYPE = np.dtype([('channel', 'u1'), ('fiber', 'u1'), ('sensor', 'u1'), ('samples', '<u4'),
+                                ('mean', '<f8'), ('std', '<f8'), ('ewma', '<f8'), ('min', '<f8'), ('max', '<f8'),
+                                ('base', '<f8'), ('force', '<f8')]) if COMPACT_MODE else None
+
+if SHM_NAME is not None:
+    # sweeps from the client's memory, nothing to connect
+    server_socket = None
+    client_socket = None
+elif SUBSCRIBE_ENDPOINT is not None:
+    # one more consumer of a running client (-P), next to its main server
+    server_socket = None
+    subscribe_host, subscribe_port = SUBSCRIBE_ENDPOINT.rsplit(':', 1)
+    client_socket = socket.create_connection((subscribe_host, int(subscribe_port)))
+    print(f"Subscribed to client at {SUBSCRIBE_ENDPOINT}")
+else:
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.bind(("0.0.0.0", PORT))
+    server_socket.listen(1)  # Listen for incoming connections
+    print("Server waiting for client connection...")
+
+    client_socket, addr = server_socket.accept()  # Accept a connection from a client
+    print(f"Connection from {addr}")
 
 channel_num = [1, 2]  # (I4에서 오픈한 채널) 0~3
 ### Data
@@ -47,83 +112,203 @@ force1, force2, force3, force4 = 0, 0, 0, 0
 exit_event = threading.Event()
 
 ### Thread for TCP communication
+def recv_exact(sock, size):
+    data = b''
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            # Client connection closed
+            raise ConnectionError("Connection closed unexpectedly")
+        data += chunk
+    return data
+
+def update_FBGs_data(id_info, FBGs):
+    global force1, force2, force3, force4
+
+    # Update force values based on sensor and channel
+    if id_info[0] == id_val[0][0]:  # 1st channel
+        if id_info[2] == id_val[0][1]:  # 1st sensor
+            force1 = FBGs
+        elif id_info[2] == id_val[0][2]:  # 2nd sensor
+            force2 = FBGs
+    elif id_info[0] == id_val[1][0]:  # 2nd channel
+        if id_info[2] == id_val[1][1]:  # 1st sensor
+            force3 = FBGs
+        elif id_info[2] == id_val[1][2]:  # 2nd sensor
+            force4 = FBGs
+
+def receive_device_id(sock):
+    # I4 unit of the next message, always 0 without fan-in
+    return recv_exact(sock, 1)[0] if FANIN_MODE else 0
+
+def device_prefix(device):
+    return f"I4 #{device} " if FANIN_MODE else ""
+
+def receive_compact_sweep(sock, layouts):
+    # Returns (device, layout, values) of the next sweep, reading any layout message first
+    while True:
+        device = receive_device_id(sock)
+        msg_type = recv_exact(sock, 1)[0]
+        if msg_type == COMPACT_MSG_LAYOUT:
+            encoding, count = struct.unpack('<BH', recv_exact(sock, 3))
+            entries = np.frombuffer(recv_exact(sock, count * COMPACT_LAYOUT_DTYPE.itemsize), dtype=COMPACT_LAYOUT_DTYPE)
+            layouts[device] = (encoding, entries)
+        elif msg_type == COMPACT_MSG_SWEEP:
+            layout = layouts.get(device)
+            if layout is None:
+                raise ValueError("Sweep message before layout message")
+            sweep_counter, count = struct.unpack('<IH', recv_exact(sock, 6))
+            encoding, entries = layout
+            if count != len(entries):
+                raise ValueError(f"Sweep of {count} values for a layout of {len(entries)} sensors")
+            raw = recv_exact(sock, count * 4)
+            if encoding == COMPACT_ENCODING_INT32:
+                offsets = np.frombuffer(raw, dtype='<i4')
+                values = entries['base'] + offsets / COMPACT_INT32_SCALE
+                values[offsets == COMPACT_INT32_INVALID] = np.nan
+            else:
+                values = np.frombuffer(raw, dtype='<f4').astype(np.float64)
+            return device, layout, values
+        elif msg_type == COMPACT_MSG_STATS:
+            sweep_counter, count = struct.unpack('<IH', recv_exact(sock, 6))
+            entries = np.frombuffer(recv_exact(sock, count * COMPACT_STATS_DTYPE.itemsize), dtype=COMPACT_STATS_DTYPE)
+            for e in entries:
+                print(f"{device_prefix(device)}Stats sweep {sweep_counter} {e['fiber']}:: Sensor ID: {e['sensor']}, "
+                      f"Channel: {e['channel']}, mean {e['mean']:.5f} nm, std {e['std'] * 1000:.2f} pm, "
+                      f"ewma {e['ewma']:.5f} nm, window {e['min']:.5f}..{e['max']:.5f} nm, "
+                      f"base {e['base']:.5f} nm, force {e['force']:.3f} mN ({e['samples']} samples)")
+        else:
+            raise ValueError(f"Unknown compact message type {msg_type:#x}")
+
+def receive_frame(sock):
+    # Returns (start_ns, entries) of the next assembled frame, entries are (device, channel, fiber, sensor, offset_ns, value)
+    msg_type, start_ns, count = struct.unpack(FRAME_HEADER_FORMAT, recv_exact(sock, struct.calcsize(FRAME_HEADER_FORMAT)))
+    if msg_type != FRAME_MSG_TYPE:
+        raise ValueError(f"Unknown frame message type {msg_type:#x}")
+    entries = list(struct.iter_unpack(FRAME_ENTRY_FORMAT, recv_exact(sock, count * struct.calcsize(FRAME_ENTRY_FORMAT))))
+    return start_ns, entries
+
+def receive_native():
+    # Hot path in fbg_receiver.cpp, every batch of samples is a zero-copy view of its ring
+    data_format = FORMAT_COMPACT if COMPACT_MODE else FORMAT_BATCH if BATCH_MODE or FANIN_MODE else FORMAT_PACKET
+    receiver = FbgReceiver(client_socket, data_format, fanin=FANIN_MODE)
+    while not exit_event.is_set():
+        samples = receiver.read()
+        if samples is None:
+            break
+        if len(samples) == 0:
+            continue
+
+        # latest value of each sensor in the batch
+        keys = (samples['device'].astype(np.uint32) << 24) | (samples['channel'].astype(np.uint32) << 16) \
+            | (samples['fiber'].astype(np.uint32) << 8) | samples['sensor']
+        _, reversed_index = np.unique(keys[::-1], return_index=True)
+        for k in (len(samples) - 1 - reversed_index).tolist():
+            update_FBGs_data((int(samples['channel'][k]), int(samples['fiber'][k]), int(samples['sensor'][k])),
+                             float(samples['value'][k]))
+        print(f"{len(samples)} samples, sweeps {samples['sweep_counter'][0]}..{samples['sweep_counter'][-1]}, "
+              f"forces {force1:.3f} {force2:.3f} {force3:.3f} {force4:.3f}")
+        receiver.release(len(samples))
+
+    stats = receiver.stats()
+    print(f"Native receiver : {stats.bytes} bytes, {stats.messages} messages, {stats.samples} samples, "
+          f"{stats.ring_waits} ring waits")
+    receiver.close()  # also closes the client socket
+
+def receive_shm():
+    # Every sweep the client wrote since the last look, copied out of the mapping without a system call
+    shm = None
+    while not exit_event.is_set():
+        if shm is None or shm.closed():
+            if shm is not None:
+                print(f"Shared memory '{SHM_NAME}' closed : {shm.lost} sweeps lost, waiting for the client")
+                shm.close()
+                shm = None
+            try:
+                shm = FbgSharedMemory(SHM_NAME)
+            except (OSError, ValueError):
+                time.sleep(SHM_OPEN_RETRY_S)
+                continue
+            unit = "mN" if shm.value_kind == VALUE_FORCE else "nm"
+            print(f"Reading shared memory '{SHM_NAME}' ({shm.slots} sweeps of up to {shm.max_peaks} peaks, {unit})")
+
+        sweeps = shm.read()
+        if not sweeps:
+            time.sleep(SHM_POLL_S)
+            continue
+        for sweep in sweeps:
+            device = int(sweep['device'])
+            for peak in sweep['peaks'][:int(sweep['count'])].tolist():
+                channel, fiber, sensor, _, wavelength, FBGs, timestamp = peak
+                update_FBGs_data((channel, fiber, sensor), FBGs)
+                print(f"I4 #{device} sweep {sweep['sweep_counter']} {fiber}:: Sensor ID: {sensor}, Channel: {channel}, "
+                      f"FBGs: {FBGs} ({wavelength:.5f} nm, {timestamp:.9f} s)")
+    if shm is not None:
+        print(f"Shared memory : {shm.lost} sweeps lost, {shm.retries} copies retried")
+        shm.close()
+
 def receive_FBGs_data():
-    global received_FBGs_data, force1, force2, force3, force4
+    global received_FBGs_data
 
+    if SHM_NAME is not None:
+        receive_shm()
+        return
+
+    if NATIVE_MODE:
+        receive_native()
+        if server_socket is not None:
+            server_socket.close()
+        return
+
+    layouts = {}  # per I4 unit
     while not exit_event.is_set():
         try:
-            chunk = client_socket.recv(FBG_PACKET_SIZE)
-            if not chunk:
-                # Client connection closed
-                raise ConnectionError("Connection closed unexpectedly")
+            if FRAMES_MODE:
+                start_ns, entries = receive_frame(client_socket)
+                for device, channel, fiber, sensor, offset_ns, FBGs in entries:
+                    update_FBGs_data((channel, fiber, sensor), FBGs)
+                    print(f"{start_ns + offset_ns} ns I4 #{device} {fiber}:: Sensor ID: {sensor}, Channel: {channel}, FBGs: {FBGs} nm")
+                continue
+            if COMPACT_MODE:
+                device, layout, values = receive_compact_sweep(client_socket, layouts)
+                entries = layout[1]
+                for channel, fiber, sensor, FBGs in zip(entries['channel'].tolist(), entries['fiber'].tolist(),
+                                                        entries['sensor'].tolist(), values.tolist()):
+                    update_FBGs_data((channel, fiber, sensor), FBGs)
+                    print(f"{device_prefix(device)}{fiber}:: Sensor ID: {sensor}, Channel: {channel}, FBGs: {FBGs} nm")
+                continue
+            device = 0
+            if BATCH_MODE or FANIN_MODE:
+                device = receive_device_id(client_socket)
+                sweep_counter, peak_count = struct.unpack('<IH', recv_exact(client_socket, BATCH_HEADER_SIZE))
+                received_data = recv_exact(client_socket, peak_count * FBG_PACKET_SIZE)
+            else:
+                received_data = recv_exact(client_socket, FBG_PACKET_SIZE)
         except Exception as e:
             exit_event.is_set()
             print(f"Error in receive_data: {e}")
             break
 
-        received_data = chunk
-
-        if len(received_data) >= FBG_PACKET_SIZE:
-            id_info = struct.unpack('BBB', received_data[:3])
-            FBGs = struct.unpack('d', received_data[3:])[0]
+        received_FBGs_data = received_data
 
-            # Update force values based on sensor and channel
-            if id_info[0] == id_val[0][0]:  # 1st channel
-                if id_info[2] == id_val[0][1]:  # 1st sensor
-                    force1 = FBGs
-                elif id_info[2] == id_val[0][2]:  # 2nd sensor
-                    force2 = FBGs
-            elif id_info[0] == id_val[1][0]:  # 2nd channel
-                if id_info[2] == id_val[1][1]:  # 1st sensor
-                    force3 = FBGs
-                elif id_info[2] == id_val[1][2]:  # 2nd sensor
-                    force4 = FBGs
+        for channel, fiber, sensor, FBGs in struct.iter_unpack('<BBBd', received_data):
+            id_info = (channel, fiber, sensor)
+            update_FBGs_data(id_info, FBGs)
 
             ## Print received data
-            print(f"{id_info[1]}:: Sensor ID: {id_info[2]}, Channel: {id_info[0]}, FBGs: {FBGs} nm")
+            print(f"{device_prefix(device)}{id_info[1]}:: Sensor ID: {id_info[2]}, Channel: {id_info[0]}, FBGs: {FBGs} nm")
 
     # Close client and server sockets when thread ends
     client_socket.close()
-    server_socket.close()
-
-
-
-### Thread for data logging
-log_lock = threading.Lock()
-log_freq = 10
-
-def log_data(log_lock, csv_file_path):
-    global force1, force2, force3, force4
-
-    with open(csv_file_path, mode='w', newline='') as csv_file:
-        csv_writer = csv.writer(csv_file)
-        csv_writer.writerow(['Time', 'Channel 1', '', 'Channel 2', ''])
-        csv_writer.writerow(['', 'Sensor 1', 'Sensor 2', 'Sensor 1', 'Sensor 2'])
-
-
-    while not exit_event.is_set():
-
-        start_time = time.time()
-        time.sleep(max(0, 1/log_freq - (time.time() - start_time)))
-
-        data_to_write = []
-        data_to_write.append([datetime.now(), force1, force2, force3, force4])
-
-        with log_lock:
-            with open(csv_file_path, mode='a', newline='') as csv_file:
-                csv_writer = csv.writer(csv_file)
-                csv_writer.writerows(data_to_write)
-
+    if server_socket is not None:
+        server_socket.close()
 
-    csv_file.close()
-    print("Logging stopped.")
 
 
 def main():
     threads = []
     ## Threads
     threads.append(threading.Thread(target=receive_FBGs_data))
-    threads.append(threading.Thread(target=log_data, args=(log_lock, csv_file_path)))
 
     for thread in threads:
         thread.start()